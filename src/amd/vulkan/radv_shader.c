@@ -201,6 +201,67 @@ radv_optimize_nir(struct nir_shader *shader, bool optimize_conservatively,
         NIR_PASS(progress, shader, nir_opt_move_load_ubo);
 }
 
+/* Everything done to the shader here only depends on the SPIR-V and on
+ * what goes into the NIR cache key, so the result can be shared between
+ * pipelines.
+ */
+static nir_shader *
+radv_spirv_to_nir(const uint32_t *spirv, size_t word_count,
+		  const struct nir_spirv_specialization *spec_entries,
+		  unsigned num_spec_entries,
+		  gl_shader_stage stage, const char *entrypoint_name,
+		  const struct spirv_to_nir_options *spirv_options)
+{
+	nir_shader *nir = spirv_to_nir(spirv, word_count,
+				       spec_entries, num_spec_entries,
+				       stage, entrypoint_name,
+				       spirv_options, &nir_options);
+	assert(nir->info.stage == stage);
+	nir_validate_shader(nir, "after spirv_to_nir");
+
+	/* We have to lower away local constant initializers right before we
+	 * inline functions.  That way they get properly initialized at the top
+	 * of the function and not at the top of its caller.
+	 */
+	NIR_PASS_V(nir, nir_lower_constant_initializers, nir_var_function_temp);
+	NIR_PASS_V(nir, nir_lower_returns);
+	NIR_PASS_V(nir, nir_inline_functions);
+	NIR_PASS_V(nir, nir_opt_deref);
+
+	/* Pick off the single entrypoint that we want */
+	foreach_list_typed_safe(nir_function, func, node, &nir->functions) {
+		if (func->is_entrypoint)
+			func->name = ralloc_strdup(func, "main");
+		else
+			exec_node_remove(&func->node);
+	}
+	assert(exec_list_length(&nir->functions) == 1);
+
+	/* Make sure we lower constant initializers on output variables so that
+	 * nir_remove_dead_variables below sees the corresponding stores
+	 */
+	NIR_PASS_V(nir, nir_lower_constant_initializers, nir_var_shader_out);
+
+	/* Now that we've deleted all but the main function, we can go ahead and
+	 * lower the rest of the constant initializers.
+	 */
+	NIR_PASS_V(nir, nir_lower_constant_initializers, ~0);
+
+	/* Split member structs.  We do this before lower_io_to_temporaries so that
+	 * it doesn't lower system values to temporaries by accident.
+	 */
+	NIR_PASS_V(nir, nir_split_var_copies);
+	NIR_PASS_V(nir, nir_split_per_member_structs);
+
+	NIR_PASS_V(nir, nir_remove_dead_variables,
+	           nir_var_shader_in | nir_var_shader_out | nir_var_system_value);
+
+	NIR_PASS_V(nir, nir_lower_system_values);
+	NIR_PASS_V(nir, nir_lower_clip_cull_distance_arrays);
+
+	return nir;
+}
+
 nir_shader *
 radv_shader_compile_to_nir(struct radv_device *device,
 			   struct radv_shader_module *module,
@@ -231,7 +292,10 @@ radv_shader_compile_to_nir(struct radv_device *device,
 		struct nir_spirv_specialization *spec_entries = NULL;
 		if (spec_info && spec_info->mapEntryCount > 0) {
 			num_spec_entries = spec_info->mapEntryCount;
-			spec_entries = malloc(num_spec_entries * sizeof(*spec_entries));
+			/* Zeroed, so that the cache key doesn't depend on the
+			 * unused half of 32-bit values.
+			 */
+			spec_entries = calloc(num_spec_entries, sizeof(*spec_entries));
 			for (uint32_t i = 0; i < num_spec_entries; i++) {
 				VkSpecializationMapEntry entry = spec_info->pMapEntries[i];
 				const void *data = spec_info->pData + entry.offset;
@@ -289,54 +353,27 @@ radv_shader_compile_to_nir(struct radv_device *device,
 			.push_const_addr_format = nir_address_format_logical,
 			.shared_addr_format = nir_address_format_32bit_offset,
 		};
-		nir = spirv_to_nir(spirv, module->size / 4,
-				   spec_entries, num_spec_entries,
-				   stage, entrypoint_name,
-				   &spirv_options, &nir_options);
-		assert(nir->info.stage == stage);
-		nir_validate_shader(nir, "after spirv_to_nir");
-
-		free(spec_entries);
-
-		/* We have to lower away local constant initializers right before we
-		 * inline functions.  That way they get properly initialized at the top
-		 * of the function and not at the top of its caller.
-		 */
-		NIR_PASS_V(nir, nir_lower_constant_initializers, nir_var_function_temp);
-		NIR_PASS_V(nir, nir_lower_returns);
-		NIR_PASS_V(nir, nir_inline_functions);
-		NIR_PASS_V(nir, nir_opt_deref);
-
-		/* Pick off the single entrypoint that we want */
-		foreach_list_typed_safe(nir_function, func, node, &nir->functions) {
-			if (func->is_entrypoint)
-				func->name = ralloc_strdup(func, "main");
-			else
-				exec_node_remove(&func->node);
+		struct disk_cache *disk_cache = NULL;
+		if (!(device->instance->debug_flags & RADV_DEBUG_NO_CACHE))
+			disk_cache = device->physical_device->disk_cache;
+
+		unsigned char nir_key[20];
+		spirv_to_nir_cache_key(disk_cache, module->sha1, entrypoint_name,
+				       stage, spec_entries, num_spec_entries,
+				       &spirv_options, NULL, 0, nir_key);
+
+		nir = spirv_to_nir_cache_search(disk_cache, nir_key, &nir_options);
+		if (!nir) {
+			nir = radv_spirv_to_nir(spirv, module->size / 4,
+						spec_entries, num_spec_entries,
+						stage, entrypoint_name,
+						&spirv_options);
+			spirv_to_nir_cache_upload(disk_cache, nir_key, nir);
 		}
-		assert(exec_list_length(&nir->functions) == 1);
+		nir_validate_shader(nir, "after the NIR cache");
 
-		/* Make sure we lower constant initializers on output variables so that
-		 * nir_remove_dead_variables below sees the corresponding stores
-		 */
-		NIR_PASS_V(nir, nir_lower_constant_initializers, nir_var_shader_out);
-
-		/* Now that we've deleted all but the main function, we can go ahead and
-		 * lower the rest of the constant initializers.
-		 */
-		NIR_PASS_V(nir, nir_lower_constant_initializers, ~0);
-
-		/* Split member structs.  We do this before lower_io_to_temporaries so that
-		 * it doesn't lower system values to temporaries by accident.
-		 */
-		NIR_PASS_V(nir, nir_split_var_copies);
-		NIR_PASS_V(nir, nir_split_per_member_structs);
-
-		NIR_PASS_V(nir, nir_remove_dead_variables,
-		           nir_var_shader_in | nir_var_shader_out | nir_var_system_value);
+		free(spec_entries);
 
-		NIR_PASS_V(nir, nir_lower_system_values);
-		NIR_PASS_V(nir, nir_lower_clip_cull_distance_arrays);
 		NIR_PASS_V(nir, radv_nir_lower_ycbcr_textures, layout);
 	}
 
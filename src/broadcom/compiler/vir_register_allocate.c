@@ -62,9 +62,14 @@ vir_is_mov_uniform(struct v3d_compile *c, int temp)
         return def && def->qpu.sig.ldunif;
 }
 
-static int
-v3d_choose_spill_node(struct v3d_compile *c, struct ra_graph *g,
-                      uint32_t *temp_to_node)
+/**
+ * Sets the spill costs of the temps and returns up to \p max_nodes
+ * non-interfering nodes to spill, best first.
+ */
+static unsigned
+v3d_choose_spill_nodes(struct v3d_compile *c, struct ra_graph *g,
+                       uint32_t *temp_to_node, unsigned *nodes,
+                       unsigned max_nodes)
 {
         const float tmu_scale = 5;
         float block_scale = 1.0;
@@ -157,7 +162,7 @@ v3d_choose_spill_node(struct v3d_compile *c, struct ra_graph *g,
                         ra_set_node_spill_cost(g, node, spill_costs[i]);
         }
 
-        return ra_get_best_spill_node(g);
+        return ra_get_best_spill_nodes(g, nodes, max_nodes);
 }
 
 /* The spill offset for this thread takes a bit of setup, so do it once at
@@ -213,7 +218,7 @@ v3d_spill_reg(struct v3d_compile *c, int spill_temp)
         uint32_t spill_offset = 0;
 
         if (!is_uniform) {
-                uint32_t spill_offset = c->spill_size;
+                spill_offset = c->spill_size;
                 c->spill_size += V3D_CHANNELS * sizeof(uint32_t);
 
                 if (spill_offset == 0)
@@ -635,8 +640,8 @@ v3d_register_allocate(struct v3d_compile *c, bool *spilled)
         int force_register_spills = 0;
         if (c->spill_size <
             V3D_CHANNELS * sizeof(uint32_t) * force_register_spills) {
-                int node = v3d_choose_spill_node(c, g, temp_to_node);
-                if (node != -1) {
+                unsigned node;
+                if (v3d_choose_spill_nodes(c, g, temp_to_node, &node, 1)) {
                         v3d_spill_reg(c, map[node].temp);
                         ralloc_free(g);
                         *spilled = true;
@@ -646,18 +651,32 @@ v3d_register_allocate(struct v3d_compile *c, bool *spilled)
 
         bool ok = ra_allocate(g);
         if (!ok) {
-                int node = v3d_choose_spill_node(c, g, temp_to_node);
-
-                /* Don't emit spills using the TMU until we've dropped thread
-                 * conut first.
+                /* Each attempt rebuilds and colors the whole graph, so once
+                 * a shader has spilled a few temps, spill more per attempt,
+                 * in proportion to what has been spilled so far.  Spilling
+                 * a temp only adds complete fill/spill sequences next to
+                 * its uses and def, so the other candidates stay valid.
                  */
-                if (node != -1 &&
-                    (vir_is_mov_uniform(c, map[node].temp) ||
-                     thread_index == 0)) {
-                        v3d_spill_reg(c, map[node].temp);
+                unsigned nodes[16];
+                unsigned max_nodes =
+                        MIN2(1 + c->spill_size /
+                             (V3D_CHANNELS * sizeof(uint32_t) * 8),
+                             ARRAY_SIZE(nodes));
+                unsigned count = v3d_choose_spill_nodes(c, g, temp_to_node,
+                                                        nodes, max_nodes);
+
+                for (unsigned i = 0; i < count; i++) {
+                        int temp = map[nodes[i]].temp;
+
+                        /* Don't emit spills using the TMU until we've dropped
+                         * thread conut first.
+                         */
+                        if (vir_is_mov_uniform(c, temp) || thread_index == 0) {
+                                v3d_spill_reg(c, temp);
 
-                        /* Ask the outer loop to call back in. */
-                        *spilled = true;
+                                /* Ask the outer loop to call back in. */
+                                *spilled = true;
+                        }
                 }
 
                 ralloc_free(g);
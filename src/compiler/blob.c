@@ -186,6 +186,29 @@ blob_reserve_intptr(struct blob *blob)
    return blob_reserve_bytes(blob, sizeof(intptr_t));
 }
 
+bool
+blob_write_uint8(struct blob *blob, uint8_t value)
+{
+   return blob_write_bytes(blob, &value, sizeof(value));
+}
+
+bool
+blob_write_uleb128(struct blob *blob, uint32_t value)
+{
+   uint8_t bytes[5];
+   unsigned len = 0;
+
+   do {
+      bytes[len] = value & 0x7f;
+      value >>= 7;
+      if (value)
+         bytes[len] |= 0x80;
+      len++;
+   } while (value);
+
+   return blob_write_bytes(blob, bytes, len);
+}
+
 bool
 blob_write_uint32(struct blob *blob, uint32_t value)
 {
@@ -298,6 +321,35 @@ blob_skip_bytes(struct blob_reader *blob, size_t size)
       blob->current += size;
 }
 
+uint8_t
+blob_read_uint8(struct blob_reader *blob)
+{
+   if (! ensure_can_read(blob, 1))
+      return 0;
+
+   return *blob->current++;
+}
+
+uint32_t
+blob_read_uleb128(struct blob_reader *blob)
+{
+   uint32_t ret = 0;
+
+   for (unsigned shift = 0; shift < 35; shift += 7) {
+      if (! ensure_can_read(blob, 1))
+         return 0;
+
+      uint8_t byte = *blob->current++;
+      ret |= (uint32_t)(byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+         return ret;
+   }
+
+   /* No 32-bit value takes more than five bytes. */
+   blob->overrun = true;
+   return 0;
+}
+
 /* These next three read functions have identical form. If we add any beyond
  * these first three we should probably switch to generating these with a
  * preprocessor macro.
@@ -363,6 +415,9 @@ blob_read_string(struct blob_reader *blob)
    char *ret;
    uint8_t *nul;
 
+   if (blob->overrun)
+      return NULL;
+
    /* If we're already at the end, then this is an overrun. */
    if (blob->current >= blob->end) {
       blob->overrun = true;
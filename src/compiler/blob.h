@@ -172,6 +172,27 @@ blob_overwrite_bytes(struct blob *blob,
                      const void *bytes,
                      size_t to_write);
 
+/**
+ * Add a uint8_t to a blob.
+ *
+ * \return True unless allocation failed.
+ */
+bool
+blob_write_uint8(struct blob *blob, uint8_t value);
+
+/**
+ * Add an unsigned integer to a blob using a variable-length (ULEB128)
+ * encoding: seven bits per byte, least significant group first, with the
+ * high bit of each byte set if more bytes follow.  Values below 128 take a
+ * single byte and no value takes more than five.
+ *
+ * Unlike blob_write_uint32, this never adds any padding.
+ *
+ * \return True unless allocation failed.
+ */
+bool
+blob_write_uleb128(struct blob *blob, uint32_t value);
+
 /**
  * Add a uint32_t to a blob.
  *
@@ -300,6 +321,25 @@ blob_copy_bytes(struct blob_reader *blob, void *dest, size_t size);
 void
 blob_skip_bytes(struct blob_reader *blob, size_t size);
 
+/**
+ * Read a uint8_t from the current location, (and update the current location
+ * to just past this uint8_t).
+ *
+ * \return The uint8_t read
+ */
+uint8_t
+blob_read_uint8(struct blob_reader *blob);
+
+/**
+ * Read an unsigned integer written with blob_write_uleb128 from the current
+ * location, (and update the current location to just past it).
+ *
+ * \return The value read, or 0 if the encoding runs past the end of the blob
+ * or is longer than five bytes (in which case blob->overrun is set).
+ */
+uint32_t
+blob_read_uleb128(struct blob_reader *blob);
+
 /**
  * Read a uint32_t from the current location, (and update the current location
  * to just past this uint32_t).
@@ -41,6 +41,11 @@
  *    built-in function signatures, where they're available, what types they
  *    take, and so on.
  *
+ *    Generating the IR for every built-in up front takes a noticeable amount
+ *    of time and memory, while most shaders only use a handful of them.  So
+ *    the list is first walked once just to record the names, and each
+ *    built-in function is only generated the first time it is looked up.
+ *
  * 4. Implementations of built-in function signatures
  *
  *    A series of functions which create ir_function_signatures and emit IR
@@ -83,6 +88,7 @@
 #include <math.h>
 #include "builtin_functions.h"
 #include "util/hash_table.h"
+#include "util/set.h"
 
 #define M_PIf   ((float) M_PI)
 #define M_PI_2f ((float) M_PI_2)
@@ -818,23 +824,41 @@ public:
    void release();
    ir_function_signature *find(_mesa_glsl_parse_state *state,
                                const char *name, exec_list *actual_parameters);
+   ir_function *get_function(const char *name);
 
    /**
     * A shader to hold all the built-in signatures; created by this module.
     *
-    * This includes signatures for every built-in, regardless of version or
-    * enabled extensions.  The availability predicate associated with each
-    * signature allows matching_signature() to filter out the irrelevant ones.
+    * This includes signatures for every built-in that has been looked up so
+    * far, regardless of version or enabled extensions.  The availability
+    * predicate associated with each signature allows matching_signature() to
+    * filter out the irrelevant ones.
     */
    gl_shader *shader;
 
 private:
    void *mem_ctx;
 
+   /**
+    * Names of all built-in functions, whether they have been generated yet
+    * or not.
+    */
+   struct set *builtin_names;
+
+   /**
+    * Controls which add_function() calls in create_builtins() run, see
+    * want_function().
+    */
+   bool collecting_names;
+   const char *requested_name;
+
    void create_shader();
    void create_intrinsics();
    void create_builtins();
 
+   bool want_function(const char *name);
+   void materialize(const char *name);
+
    /**
     * IR builder helpers:
     *
@@ -1186,7 +1210,8 @@ enum image_function_flags {
  *  @{
  */
 builtin_builder::builtin_builder()
-   : shader(NULL)
+   : shader(NULL), builtin_names(NULL), collecting_names(false),
+     requested_name(NULL)
 {
    mem_ctx = NULL;
 }
@@ -1209,7 +1234,7 @@ builtin_builder::find(_mesa_glsl_parse_state *state,
     */
    state->uses_builtin_functions = true;
 
-   ir_function *f = shader->symbols->get_function(name);
+   ir_function *f = get_function(name);
    if (f == NULL)
       return NULL;
 
@@ -1221,6 +1246,17 @@ builtin_builder::find(_mesa_glsl_parse_state *state,
    return sig;
 }
 
+/**
+ * Look up a built-in function by name, generating it first if this is the
+ * first time it is asked for.
+ */
+ir_function *
+builtin_builder::get_function(const char *name)
+{
+   materialize(name);
+   return shader->symbols->get_function(name);
+}
+
 void
 builtin_builder::initialize()
 {
@@ -1231,7 +1267,15 @@ builtin_builder::initialize()
    mem_ctx = ralloc_context(NULL);
    create_shader();
    create_intrinsics();
+
+   /* Only record the names of the built-ins; they are generated on demand
+    * by materialize().
+    */
+   builtin_names = _mesa_set_create(mem_ctx, _mesa_key_hash_string,
+                                    _mesa_key_string_equal);
+   collecting_names = true;
    create_builtins();
+   collecting_names = false;
 }
 
 void
@@ -1239,11 +1283,47 @@ builtin_builder::release()
 {
    ralloc_free(mem_ctx);
    mem_ctx = NULL;
+   builtin_names = NULL;
 
    ralloc_free(shader);
    shader = NULL;
 }
 
+/**
+ * Returns whether an add_function() call for \p name should go ahead.
+ *
+ * While collecting names this only records the name and nothing gets
+ * generated.  Otherwise only the function currently being materialized is
+ * generated, or everything when no particular function was requested, which
+ * is the case for the intrinsics.
+ */
+bool
+builtin_builder::want_function(const char *name)
+{
+   if (collecting_names) {
+      _mesa_set_add(builtin_names, name);
+      return false;
+   }
+
+   return requested_name == NULL || strcmp(name, requested_name) == 0;
+}
+
+/**
+ * Generate the IR for built-in function \p name unless that already
+ * happened or there is no such built-in.
+ */
+void
+builtin_builder::materialize(const char *name)
+{
+   if (_mesa_set_search(builtin_names, name) == NULL ||
+       shader->symbols->get_function(name) != NULL)
+      return;
+
+   requested_name = name;
+   create_builtins();
+   requested_name = NULL;
+}
+
 void
 builtin_builder::create_shader()
 {
@@ -1471,6 +1551,15 @@ builtin_builder::create_intrinsics()
 void
 builtin_builder::create_builtins()
 {
+   /* Skip generating the signatures of every function but the requested
+    * one.  Note that the arguments are not evaluated at all in that case.
+    */
+#define add_function(NAME, ...)                 \
+   do {                                         \
+      if (want_function(NAME))                  \
+         add_function(NAME, __VA_ARGS__);       \
+   } while (0)
+
 #define F(NAME)                                 \
    add_function(#NAME,                          \
                 _##NAME(glsl_type::float_type), \
@@ -4218,6 +4307,7 @@ builtin_builder::create_builtins()
 #undef FIUD_VEC
 #undef FIUBD_VEC
 #undef FIU2_MIXED
+#undef add_function
 }
 
 void
@@ -4290,6 +4380,9 @@ builtin_builder::add_image_function(const char *name,
       glsl_type::uimage2DMSArray_type
    };
 
+   if (!want_function(name))
+      return;
+
    ir_function *f = new(mem_ctx) ir_function(name);
 
    for (unsigned i = 0; i < ARRAY_SIZE(types); ++i) {
@@ -7251,7 +7344,7 @@ _mesa_glsl_has_builtin_function(_mesa_glsl_parse_state *state, const char *name)
    ir_function *f;
    bool ret = false;
    mtx_lock(&builtins_lock);
-   f = builtins.shader->symbols->get_function(name);
+   f = builtins.get_function(name);
    if (f != NULL) {
       foreach_in_list(ir_function_signature, sig, &f->signatures) {
          if (sig->is_builtin_available(state)) {
@@ -7265,10 +7358,15 @@ _mesa_glsl_has_builtin_function(_mesa_glsl_parse_state *state, const char *name)
    return ret;
 }
 
-gl_shader *
-_mesa_glsl_get_builtin_function_shader()
+ir_function *
+_mesa_glsl_get_builtin_function(const char *name)
 {
-   return builtins.shader;
+   ir_function *f;
+   mtx_lock(&builtins_lock);
+   f = builtins.get_function(name);
+   mtx_unlock(&builtins_lock);
+
+   return f;
 }
 
 
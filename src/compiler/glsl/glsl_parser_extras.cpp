@@ -2041,9 +2041,18 @@ opt_shader_and_create_symbol_table(struct gl_context *ctx,
       &ctx->Const.ShaderCompilerOptions[shader->Stage];
 
    /* Do some optimization at compile time to reduce shader IR size
-    * and reduce later work if the same shader is linked multiple times
+    * and reduce later work if the same shader is linked multiple times.
+    * Drivers that optimize in NIR redo all of that after linking, so the
+    * IR is left as it is for them.  The linker still optimizes to a fixed
+    * point before the resource limit checks.
+    *
+    * EmitNoIndirectSampler relies on loops being unrolled early enough for
+    * validate_sampler_array_indexing(), so keep the usual optimizations
+    * there.
     */
-   if (ctx->Const.GLSLOptimizeConservatively) {
+   if (options->OptimizeInNIR && !options->EmitNoIndirectSampler) {
+      /* Nothing to do. */
+   } else if (ctx->Const.GLSLOptimizeConservatively) {
       /* Run it just once. */
       do_common_optimization(shader->ir, false, false, options,
                              ctx->Const.NativeIntegers);
@@ -2097,6 +2106,9 @@ void
 _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
                           bool dump_ast, bool dump_hir, bool force_recompile)
 {
+   /* Note that glCompileShader may call this from a shader compiler thread,
+    * while ctx->_Shader can be rebound at any time.
+    */
    const char *source = force_recompile && shader->FallbackSource ?
       shader->FallbackSource : shader->Source;
 
@@ -2107,7 +2119,7 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
                                 shader->sha1);
          if (disk_cache_has_key(ctx->Cache, shader->sha1)) {
             /* We've seen this shader before and know it compiles */
-            if (ctx->_Shader->Flags & GLSL_CACHE_INFO) {
+            if (ctx->Shader.Flags & GLSL_CACHE_INFO) {
                _mesa_sha1_format(buf, shader->sha1);
                fprintf(stderr, "deferring compile of shader: %s\n", buf);
             }
@@ -2194,7 +2206,7 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
    if (ctx->Cache && shader->CompileStatus == COMPILE_SUCCESS) {
       char sha1_buf[41];
       disk_cache_put_key(ctx->Cache, shader->sha1);
-      if (ctx->_Shader->Flags & GLSL_CACHE_INFO) {
+      if (ctx->Shader.Flags & GLSL_CACHE_INFO) {
          _mesa_sha1_format(sha1_buf, shader->sha1);
          fprintf(stderr, "marking shader: %s\n", sha1_buf);
       }
@@ -46,6 +46,7 @@ typedef SSIZE_T ssize_t;
 #define uint32_placeholder 0xDEADBEEF
 #define uint32_overwrite   0xA1B2C3D4
 #define uint64_test        0x1234567890ABCDEF
+#define uint8_test         0xA5
 #define string_test_str    "string_test"
 
 bool error = false;
@@ -153,6 +154,8 @@ test_write_and_read_functions (void)
 
    blob_write_string(&blob, string_test_str);
 
+   blob_write_uint8(&blob, uint8_test);
+
    /* Finally, overwrite our placeholders. */
    blob_overwrite_bytes(&blob, str_offset, overwrite_test_str,
                         sizeof(overwrite_test_str));
@@ -183,6 +186,8 @@ test_write_and_read_functions (void)
                 "blob_write/read_intptr");
    expect_equal_str(string_test_str, blob_read_string(&reader),
                     "blob_write/read_string");
+   expect_equal(uint8_test, blob_read_uint8(&reader),
+                "blob_write/read_uint8");
 
    expect_equal(reader.end - reader.data, reader.current - reader.data,
                 "read_consumes_all_bytes");
@@ -271,6 +276,73 @@ test_overrun(void)
    blob_finish(&blob);
 }
 
+/* Test that variable-length integers round-trip with the expected sizes and
+ * that truncated or over-long encodings are detected.
+ */
+static void
+test_uleb128(void)
+{
+   static const struct {
+      uint32_t value;
+      size_t size;
+   } tests[] = {
+      { 0, 1 },
+      { 1, 1 },
+      { 0x7f, 1 },
+      { 0x80, 2 },
+      { 0x3fff, 2 },
+      { 0x4000, 3 },
+      { 0x1fffff, 3 },
+      { 0x200000, 4 },
+      { 0xfffffff, 4 },
+      { 0x10000000, 5 },
+      { 0xffffffff, 5 },
+   };
+   struct blob blob;
+   struct blob_reader reader;
+   size_t i;
+
+   blob_init(&blob);
+
+   for (i = 0; i < ARRAY_SIZE(tests); i++) {
+      size_t before = blob.size;
+      blob_write_uleb128(&blob, tests[i].value);
+      expect_equal(tests[i].size, blob.size - before, "size of uleb128");
+   }
+
+   blob_reader_init(&reader, blob.data, blob.size);
+
+   for (i = 0; i < ARRAY_SIZE(tests); i++) {
+      expect_equal(tests[i].value, blob_read_uleb128(&reader),
+                   "blob_write/read_uleb128");
+   }
+
+   expect_equal(reader.end - reader.data, reader.current - reader.data,
+                "uleb128 read consumes all bytes");
+   expect_equal(false, reader.overrun, "uleb128 read does not overrun");
+
+   /* Leave off the last byte of 0xffffffff. */
+   blob_reader_init(&reader, blob.data, blob.size - 1);
+   for (i = 0; i < ARRAY_SIZE(tests) - 1; i++)
+      blob_read_uleb128(&reader);
+   expect_equal(0, blob_read_uleb128(&reader), "truncated uleb128");
+   expect_equal(true, reader.overrun, "truncated uleb128 sets overrun");
+
+   blob_finish(&blob);
+
+   /* Six continuation bytes can't be a 32-bit value. */
+   blob_init(&blob);
+   for (i = 0; i < 6; i++)
+      blob_write_uint8(&blob, 0x80);
+   blob_write_uint8(&blob, 0);
+
+   blob_reader_init(&reader, blob.data, blob.size);
+   expect_equal(0, blob_read_uleb128(&reader), "over-long uleb128");
+   expect_equal(true, reader.overrun, "over-long uleb128 sets overrun");
+
+   blob_finish(&blob);
+}
+
 /* Test that we can read and write some large objects, (exercising the code in
  * the blob_write functions to realloc blob->data.
  */
@@ -322,6 +394,7 @@ main (void)
    test_write_and_read_functions ();
    test_alignment ();
    test_overrun ();
+   test_uleb128 ();
    test_big_objects ();
 
    return error ? 1 : 0;
@@ -1178,7 +1178,10 @@ unsigned
 glsl_type::record_key_hash(const void *a)
 {
    const glsl_type *const key = (glsl_type *) a;
-   uintptr_t hash = key->length;
+   /* Include the name, or every block with the same layout collides.
+    * Modules from shader translators have thousands of those.
+    */
+   uintptr_t hash = key->length ^ _mesa_hash_string(key->name);
    unsigned retval;
 
    for (unsigned i = 0; i < key->length; i++) {
@@ -2568,8 +2571,10 @@ decode_type_from_blob(struct blob_reader *blob)
                                              (u >> 3) & 0x01,
                                              (u >> 2) & 0x01,
                                              (glsl_base_type) ((u >> 0) & 0x03));
-   case GLSL_TYPE_SUBROUTINE:
-      return glsl_type::get_subroutine_instance(blob_read_string(blob));
+   case GLSL_TYPE_SUBROUTINE: {
+      const char *name = blob_read_string(blob);
+      return name ? glsl_type::get_subroutine_instance(name) : NULL;
+   }
    case GLSL_TYPE_IMAGE:
       return glsl_type::get_image_instance((enum glsl_sampler_dim) ((u >> 3) & 0x0f),
                                              (u >> 2) & 0x01,
@@ -2579,7 +2584,10 @@ decode_type_from_blob(struct blob_reader *blob)
    case GLSL_TYPE_ARRAY: {
       unsigned length = blob_read_uint32(blob);
       unsigned explicit_stride = blob_read_uint32(blob);
-      return glsl_type::get_array_instance(decode_type_from_blob(blob),
+      const glsl_type *element_type = decode_type_from_blob(blob);
+      if (element_type == NULL)
+         return NULL;
+      return glsl_type::get_array_instance(element_type,
                                            length, explicit_stride);
    }
    case GLSL_TYPE_STRUCT:
@@ -2605,11 +2613,14 @@ decode_type_from_blob(struct blob_reader *blob)
          enum glsl_interface_packing packing =
             (glsl_interface_packing) blob_read_uint32(blob);
          bool row_major = blob_read_uint32(blob);
-         t = glsl_type::get_interface_instance(fields, num_fields, packing,
+         /* A truncated blob leaves the name and field types NULL. */
+         t = blob->overrun ? NULL :
+             glsl_type::get_interface_instance(fields, num_fields, packing,
                                                row_major, name);
       } else {
          unsigned packed = blob_read_uint32(blob);
-         t = glsl_type::get_struct_instance(fields, num_fields, name, packed);
+         t = blob->overrun ? NULL :
+             glsl_type::get_struct_instance(fields, num_fields, name, packed);
       }
 
       free(fields);
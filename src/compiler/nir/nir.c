@@ -1456,6 +1456,7 @@ nir_ssa_def_init(nir_instr *instr, nir_ssa_def *def,
    list_inithead(&def->if_uses);
    def->num_components = num_components;
    def->bit_size = bit_size;
+   def->divergent = true; /* Assume divergence until analyzed */
 
    if (instr->block) {
       nir_function_impl *impl =
@@ -556,6 +556,12 @@ typedef struct nir_ssa_def {
 
    /* The bit-size of each channel; must be one of 8, 16, 32, or 64 */
    uint8_t bit_size;
+
+   /**
+    * True if this value may differ between invocations in a subgroup.  Only
+    * meaningful while nir_metadata_divergence is valid.
+    */
+   bool divergent;
 } nir_ssa_def;
 
 struct nir_src;
@@ -689,6 +695,13 @@ nir_src_num_components(nir_src src)
    return src.is_ssa ? src.ssa->num_components : src.reg.reg->num_components;
 }
 
+/* Requires nir_metadata_divergence.  Registers are assumed to diverge. */
+static inline bool
+nir_src_is_divergent(nir_src src)
+{
+   return !src.is_ssa || src.ssa->divergent;
+}
+
 static inline bool
 nir_src_is_const(nir_src src)
 {
@@ -2080,6 +2093,7 @@ typedef enum {
    nir_metadata_live_ssa_defs = 0x4,
    nir_metadata_not_properly_reset = 0x8,
    nir_metadata_loop_analysis = 0x10,
+   nir_metadata_divergence = 0x20,
 } nir_metadata;
 
 typedef struct {
@@ -3574,6 +3588,9 @@ void nir_live_ssa_defs_impl(nir_function_impl *impl);
 void nir_loop_analyze_impl(nir_function_impl *impl,
                            nir_variable_mode indirect_mask);
 
+void nir_divergence_analysis_impl(nir_function_impl *impl);
+void nir_divergence_analysis(nir_shader *shader);
+
 bool nir_ssa_defs_interfere(nir_ssa_def *a, nir_ssa_def *b);
 
 bool nir_repair_ssa_impl(nir_function_impl *impl);
@@ -3629,6 +3646,24 @@ bool nir_opt_large_constants(nir_shader *shader,
                              glsl_type_size_align_func size_align,
                              unsigned threshold);
 
+bool nir_opt_licm(nir_shader *shader, bool hoist_loads);
+
+/** Decides whether two memory accesses may be combined into one
+ *
+ * \param align           alignment in bytes of the combined access
+ * \param num_components  number of components of the combined access
+ * \param high_offset     how many bytes after \p low \p high starts
+ */
+typedef bool (*nir_should_vectorize_mem_func)(unsigned align,
+                                              unsigned bit_size,
+                                              unsigned num_components,
+                                              unsigned high_offset,
+                                              nir_intrinsic_instr *low,
+                                              nir_intrinsic_instr *high);
+
+bool nir_opt_load_store_vectorize(nir_shader *shader, nir_variable_mode modes,
+                                  nir_should_vectorize_mem_func callback);
+
 bool nir_opt_loop_unroll(nir_shader *shader, nir_variable_mode indirect_mask);
 
 bool nir_opt_move_comparisons(nir_shader *shader);
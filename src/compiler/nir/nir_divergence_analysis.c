@@ -0,0 +1,436 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "nir.h"
+
+/**
+ * \file nir_divergence_analysis.c
+ *
+ * Works out which SSA values may differ between the invocations of a
+ * subgroup, and stores the result in nir_ssa_def::divergent.  A value that
+ * isn't divergent is the same in every invocation that computes it.
+ *
+ * Values start out uniform and get marked divergent until nothing changes,
+ * which is needed to get through loops.  Divergence comes from:
+ *
+ *  - sources: most instructions are divergent if any of their sources are,
+ *    and intrinsics that read per-invocation state always are.
+ *
+ *  - control flow: a phi after an if with a divergent condition merges
+ *    values from invocations that went different ways.  A loop that is left
+ *    or continued under divergent control flow has invocations in different
+ *    iterations, so its header phis, the phis after it and any value from
+ *    the loop used after it are divergent.
+ *
+ * NIR doesn't keep values used after a loop in phis after it, so such a
+ * value is marked divergent everywhere, including inside the loop, where it
+ * may well be uniform.
+ *
+ * The analysis is only done on SSA values; registers are assumed to
+ * diverge.
+ */
+
+struct loop_state {
+   bool divergent_break;
+   bool divergent_continue;
+};
+
+struct divergence_state {
+   /* Whether anything was marked divergent in this round */
+   bool progress;
+};
+
+static void
+mark_divergent(nir_ssa_def *def, bool divergent, struct divergence_state *state)
+{
+   if (divergent && !def->divergent) {
+      def->divergent = true;
+      state->progress = true;
+   }
+}
+
+static bool
+mark_def_divergent(nir_ssa_def *def, void *state)
+{
+   mark_divergent(def, true, state);
+   return true;
+}
+
+static bool
+src_is_uniform(nir_src *src, void *state)
+{
+   return !nir_src_is_divergent(*src);
+}
+
+static bool
+any_src_divergent(nir_instr *instr)
+{
+   /* nir_foreach_src stops at the first source that isn't uniform. */
+   return !nir_foreach_src(instr, src_is_uniform, NULL);
+}
+
+static bool
+intrinsic_is_divergent(nir_intrinsic_instr *intrin)
+{
+   switch (intrin->intrinsic) {
+   /* The same for the whole dispatch, draw or subgroup */
+   case nir_intrinsic_load_work_group_id:
+   case nir_intrinsic_load_num_work_groups:
+   case nir_intrinsic_load_local_group_size:
+   case nir_intrinsic_load_work_dim:
+   case nir_intrinsic_load_subgroup_size:
+   case nir_intrinsic_load_num_subgroups:
+   case nir_intrinsic_load_subgroup_id:
+   case nir_intrinsic_load_draw_id:
+   case nir_intrinsic_load_base_vertex:
+   case nir_intrinsic_load_first_vertex:
+   case nir_intrinsic_load_is_indexed_draw:
+   case nir_intrinsic_load_base_instance:
+   case nir_intrinsic_load_patch_vertices_in:
+   case nir_intrinsic_load_user_clip_plane:
+   case nir_intrinsic_load_alpha_ref_float:
+   case nir_intrinsic_load_viewport_x_scale:
+   case nir_intrinsic_load_viewport_y_scale:
+   case nir_intrinsic_load_viewport_z_scale:
+   case nir_intrinsic_load_viewport_z_offset:
+   case nir_intrinsic_load_viewport_scale:
+   case nir_intrinsic_load_viewport_offset:
+   case nir_intrinsic_load_blend_const_color_r_float:
+   case nir_intrinsic_load_blend_const_color_g_float:
+   case nir_intrinsic_load_blend_const_color_b_float:
+   case nir_intrinsic_load_blend_const_color_a_float:
+   case nir_intrinsic_load_blend_const_color_rgba:
+   case nir_intrinsic_load_blend_const_color_rgba8888_unorm:
+   case nir_intrinsic_load_blend_const_color_aaaa8888_unorm:
+   case nir_intrinsic_ballot:
+   case nir_intrinsic_vote_any:
+   case nir_intrinsic_vote_all:
+   case nir_intrinsic_vote_feq:
+   case nir_intrinsic_vote_ieq:
+   case nir_intrinsic_first_invocation:
+   case nir_intrinsic_read_first_invocation:
+      return false;
+
+   case nir_intrinsic_read_invocation:
+      return nir_src_is_divergent(intrin->src[1]);
+
+   case nir_intrinsic_reduce:
+      /* Clustered reductions only agree within a cluster. */
+      return nir_intrinsic_cluster_size(intrin) != 0;
+
+   /* Uniform addresses give uniform results, even for memory other
+    * invocations can write: the whole subgroup does the load at once.
+    */
+   case nir_intrinsic_load_uniform:
+   case nir_intrinsic_load_ubo:
+   case nir_intrinsic_load_push_constant:
+   case nir_intrinsic_load_constant:
+   case nir_intrinsic_load_kernel_input:
+   case nir_intrinsic_load_ssbo:
+   case nir_intrinsic_load_shared:
+   case nir_intrinsic_load_global:
+   case nir_intrinsic_get_buffer_size:
+   case nir_intrinsic_vulkan_resource_index:
+   case nir_intrinsic_vulkan_resource_reindex:
+   case nir_intrinsic_load_vulkan_descriptor:
+   case nir_intrinsic_image_deref_size:
+   case nir_intrinsic_image_deref_samples:
+   case nir_intrinsic_image_size:
+   case nir_intrinsic_image_samples:
+   case nir_intrinsic_bindless_image_size:
+   case nir_intrinsic_bindless_image_samples:
+   case nir_intrinsic_ballot_bitfield_extract:
+   case nir_intrinsic_ballot_bit_count_reduce:
+   case nir_intrinsic_ballot_find_lsb:
+   case nir_intrinsic_ballot_find_msb:
+      return any_src_divergent(&intrin->instr);
+
+   case nir_intrinsic_load_deref: {
+      nir_variable_mode mode = nir_src_as_deref(intrin->src[0])->mode;
+      if (!(mode & (nir_var_uniform | nir_var_mem_ubo)))
+         return true;
+      return any_src_divergent(&intrin->instr);
+   }
+
+   default:
+      /* Everything else may depend on the invocation: inputs, invocation
+       * IDs, atomics, shuffles, scans and so on.
+       */
+      return true;
+   }
+}
+
+static bool
+deref_is_divergent(nir_deref_instr *deref)
+{
+   /* The variable itself is the same for everyone, even for temporaries,
+    * whose values live in load_deref results.
+    */
+   if (deref->deref_type == nir_deref_type_var)
+      return false;
+
+   return any_src_divergent(&deref->instr);
+}
+
+/* Whether invocations may have gone different ways to get to this phi */
+static bool
+phi_has_divergent_cf(nir_phi_instr *phi)
+{
+   nir_cf_node *prev = nir_cf_node_prev(&phi->instr.block->cf_node);
+   if (!prev || prev->type != nir_cf_node_if)
+      return false;
+
+   return nir_src_is_divergent(nir_cf_node_as_if(prev)->condition);
+}
+
+static void
+visit_instr(nir_instr *instr, struct divergence_state *state)
+{
+   switch (instr->type) {
+   case nir_instr_type_alu: {
+      nir_alu_instr *alu = nir_instr_as_alu(instr);
+      if (alu->dest.dest.is_ssa)
+         mark_divergent(&alu->dest.dest.ssa, any_src_divergent(instr), state);
+      break;
+   }
+
+   case nir_instr_type_intrinsic: {
+      nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(instr);
+      if (nir_intrinsic_infos[intrin->intrinsic].has_dest &&
+          intrin->dest.is_ssa) {
+         mark_divergent(&intrin->dest.ssa, intrinsic_is_divergent(intrin),
+                        state);
+      }
+      break;
+   }
+
+   case nir_instr_type_tex: {
+      nir_tex_instr *tex = nir_instr_as_tex(instr);
+      if (tex->dest.is_ssa)
+         mark_divergent(&tex->dest.ssa, any_src_divergent(instr), state);
+      break;
+   }
+
+   case nir_instr_type_deref: {
+      nir_deref_instr *deref = nir_instr_as_deref(instr);
+      if (deref->dest.is_ssa)
+         mark_divergent(&deref->dest.ssa, deref_is_divergent(deref), state);
+      break;
+   }
+
+   case nir_instr_type_phi: {
+      nir_phi_instr *phi = nir_instr_as_phi(instr);
+      if (phi->dest.is_ssa) {
+         mark_divergent(&phi->dest.ssa,
+                        any_src_divergent(instr) || phi_has_divergent_cf(phi),
+                        state);
+      }
+      break;
+   }
+
+   case nir_instr_type_load_const:
+   case nir_instr_type_ssa_undef:
+   case nir_instr_type_jump:
+   case nir_instr_type_call:
+      break;
+
+   default:
+      /* Parallel copies only exist when going out of SSA. */
+      nir_foreach_ssa_def(instr, mark_def_divergent, state);
+      break;
+   }
+}
+
+static void
+mark_phis_divergent(nir_block *block, struct divergence_state *state)
+{
+   nir_foreach_instr(instr, block) {
+      if (instr->type != nir_instr_type_phi)
+         break;
+
+      nir_phi_instr *phi = nir_instr_as_phi(instr);
+      if (phi->dest.is_ssa)
+         mark_divergent(&phi->dest.ssa, true, state);
+   }
+}
+
+struct outside_use_state {
+   struct divergence_state *state;
+   unsigned first_block, last_block;
+};
+
+static bool
+block_is_outside(nir_block *block, struct outside_use_state *outside)
+{
+   return block->index < outside->first_block ||
+          block->index > outside->last_block;
+}
+
+static bool
+mark_if_used_outside(nir_ssa_def *def, void *data)
+{
+   struct outside_use_state *outside = data;
+
+   if (def->divergent)
+      return true;
+
+   nir_foreach_use(src, def) {
+      if (block_is_outside(src->parent_instr->block, outside)) {
+         mark_divergent(def, true, outside->state);
+         return true;
+      }
+   }
+
+   nir_foreach_if_use(src, def) {
+      nir_block *block =
+         nir_cf_node_as_block(nir_cf_node_prev(&src->parent_if->cf_node));
+      if (block_is_outside(block, outside)) {
+         mark_divergent(def, true, outside->state);
+         return true;
+      }
+   }
+
+   return true;
+}
+
+static void visit_cf_list(struct exec_list *list, bool divergent_cf,
+                          struct loop_state *loop,
+                          struct divergence_state *state);
+
+static void
+visit_loop(nir_loop *loop, struct divergence_state *state)
+{
+   struct loop_state loop_state = { false, false };
+   visit_cf_list(&loop->body, false, &loop_state, state);
+
+   /* Invocations that continued early get to the header with other values
+    * than the ones that made it to the end of the body.
+    */
+   if (loop_state.divergent_continue)
+      mark_phis_divergent(nir_loop_first_block(loop), state);
+
+   if (!loop_state.divergent_break)
+      return;
+
+   /* Invocations leave in different iterations, so whatever the loop
+    * computes is divergent once it is seen from outside.
+    */
+   mark_phis_divergent(nir_cf_node_as_block(nir_cf_node_next(&loop->cf_node)),
+                       state);
+
+   struct outside_use_state outside = {
+      .state = state,
+      .first_block = nir_loop_first_block(loop)->index,
+      .last_block = nir_loop_last_block(loop)->index,
+   };
+   nir_foreach_block_in_cf_node(block, &loop->cf_node) {
+      nir_foreach_instr(instr, block)
+         nir_foreach_ssa_def(instr, mark_if_used_outside, &outside);
+   }
+}
+
+static void
+visit_jump(nir_jump_instr *jump, bool divergent_cf, struct loop_state *loop)
+{
+   if (!loop)
+      return;
+
+   /* Once some invocations left the iteration early, the ones still running
+    * the body are a divergent subset.
+    */
+   divergent_cf |= loop->divergent_break || loop->divergent_continue;
+   if (!divergent_cf)
+      return;
+
+   if (jump->type == nir_jump_break)
+      loop->divergent_break = true;
+   else if (jump->type == nir_jump_continue)
+      loop->divergent_continue = true;
+}
+
+static void
+visit_cf_list(struct exec_list *list, bool divergent_cf,
+              struct loop_state *loop, struct divergence_state *state)
+{
+   foreach_list_typed(nir_cf_node, node, node, list) {
+      switch (node->type) {
+      case nir_cf_node_block:
+         nir_foreach_instr(instr, nir_cf_node_as_block(node)) {
+            if (instr->type == nir_instr_type_jump)
+               visit_jump(nir_instr_as_jump(instr), divergent_cf, loop);
+            else
+               visit_instr(instr, state);
+         }
+         break;
+
+      case nir_cf_node_if: {
+         nir_if *nif = nir_cf_node_as_if(node);
+         bool divergent = divergent_cf ||
+                          nir_src_is_divergent(nif->condition);
+         visit_cf_list(&nif->then_list, divergent, loop, state);
+         visit_cf_list(&nif->else_list, divergent, loop, state);
+         break;
+      }
+
+      case nir_cf_node_loop:
+         visit_loop(nir_cf_node_as_loop(node), state);
+         break;
+
+      default:
+         unreachable("Invalid CF node type");
+      }
+   }
+}
+
+static bool
+clear_divergent(nir_ssa_def *def, void *state)
+{
+   def->divergent = false;
+   return true;
+}
+
+void
+nir_divergence_analysis_impl(nir_function_impl *impl)
+{
+   nir_metadata_require(impl, nir_metadata_block_index);
+
+   nir_foreach_block(block, impl) {
+      nir_foreach_instr(instr, block)
+         nir_foreach_ssa_def(instr, clear_divergent, NULL);
+   }
+
+   struct divergence_state state;
+   do {
+      state.progress = false;
+      visit_cf_list(&impl->body, false, NULL, &state);
+   } while (state.progress);
+}
+
+void
+nir_divergence_analysis(nir_shader *shader)
+{
+   nir_foreach_function(function, shader) {
+      if (function->impl)
+         nir_metadata_require(function->impl, nir_metadata_divergence);
+   }
+}
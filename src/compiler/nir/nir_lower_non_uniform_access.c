@@ -65,6 +65,10 @@ lower_non_uniform_tex_access(nir_builder *b, nir_tex_instr *tex)
          continue;
       }
 
+      /* Nothing to do for handles that turn out to be uniform anyway */
+      if (!nir_src_is_divergent(tex->src[i].src))
+         continue;
+
       assert(tex->src[i].src.is_ssa);
       assert(tex->src[i].src.ssa->num_components == 1);
       assert(handle_count < 2);
@@ -100,8 +104,8 @@ lower_non_uniform_access_intrin(nir_builder *b, nir_intrinsic_instr *intrin,
    if (!(nir_intrinsic_access(intrin) & ACCESS_NON_UNIFORM))
       return false;
 
-   /* If it's constant, it's automatically uniform; don't bother. */
-   if (nir_src_is_const(intrin->src[handle_src]))
+   /* If it's uniform, e.g. because it is constant, don't bother. */
+   if (!nir_src_is_divergent(intrin->src[handle_src]))
       return false;
 
    b->cursor = nir_instr_remove(&intrin->instr);
@@ -126,6 +130,11 @@ nir_lower_non_uniform_access_impl(nir_function_impl *impl,
 {
    bool progress = false;
 
+   /* Lowering only wraps instructions in loops and doesn't change any value
+    * we look at, so the analysis stays good for the whole pass.
+    */
+   nir_metadata_require(impl, nir_metadata_divergence);
+
    nir_builder b;
    nir_builder_init(&b, impl);
 
@@ -47,6 +47,8 @@ nir_metadata_require(nir_function_impl *impl, nir_metadata required, ...)
       nir_loop_analyze_impl(impl, va_arg(ap, nir_variable_mode));
       va_end(ap);
    }
+   if (NEEDS_UPDATE(nir_metadata_divergence))
+      nir_divergence_analysis_impl(impl);
 
 #undef NEEDS_UPDATE
 
@@ -0,0 +1,179 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "nir.h"
+
+/**
+ * \file nir_opt_licm.c
+ *
+ * Loop-invariant code motion.  Instructions in a loop whose sources are all
+ * defined outside of it compute the same value on every iteration, so they
+ * get moved to the block right before the loop.
+ *
+ * Only instructions in blocks directly in the loop body are considered, not
+ * ones nested in an if: those may not run on every iteration, and hoisting
+ * them would make the common path pay for them.  Inner loops are handled
+ * first, so something invariant in both an inner and an outer loop makes it
+ * all the way out.
+ *
+ * Hoisting means an instruction may run even if the loop body wouldn't
+ * reach it, for instance when the loop exits on its first iteration.  That
+ * is fine for ALU instructions and constants.  Loads are only hoisted when
+ * the caller asks for it, and only ones that can be reordered, so the
+ * caller has to be fine with them being executed speculatively.
+ */
+
+static bool
+src_is_defined_before(nir_src *src, void *state)
+{
+   nir_block *preheader = state;
+
+   if (!src->is_ssa)
+      return false;
+
+   return nir_block_dominates(src->ssa->parent_instr->block, preheader);
+}
+
+static bool
+instr_can_be_hoisted(nir_instr *instr, bool hoist_loads)
+{
+   switch (instr->type) {
+   case nir_instr_type_load_const:
+   case nir_instr_type_ssa_undef:
+      return true;
+
+   case nir_instr_type_alu:
+      return nir_instr_as_alu(instr)->dest.dest.is_ssa;
+
+   case nir_instr_type_intrinsic: {
+      if (!hoist_loads)
+         return false;
+
+      const nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(instr);
+      const nir_intrinsic_info *info = &nir_intrinsic_infos[intrin->intrinsic];
+      return info->has_dest && intrin->dest.is_ssa &&
+             (info->flags & NIR_INTRINSIC_CAN_ELIMINATE) &&
+             (info->flags & NIR_INTRINSIC_CAN_REORDER);
+   }
+
+   default:
+      /* Phis depend on the loop by definition.  Derefs are left where they
+       * are since some passes expect them next to their uses, and texture
+       * instructions may compute derivatives, which depend on control flow.
+       */
+      return false;
+   }
+}
+
+static bool
+hoist_from_block(nir_block *block, nir_block *preheader, bool hoist_loads)
+{
+   bool progress = false;
+
+   nir_foreach_instr_safe(instr, block) {
+      if (!instr_can_be_hoisted(instr, hoist_loads))
+         continue;
+
+      if (!nir_foreach_src(instr, src_is_defined_before, preheader))
+         continue;
+
+      /* Once it is in the preheader, whatever uses it may follow. */
+      nir_instr_remove(instr);
+      nir_instr_insert_after_block(preheader, instr);
+      progress = true;
+   }
+
+   return progress;
+}
+
+static bool opt_licm_cf_list(struct exec_list *cf_list, bool hoist_loads);
+
+static bool
+opt_licm_loop(nir_loop *loop, bool hoist_loads)
+{
+   bool progress = opt_licm_cf_list(&loop->body, hoist_loads);
+
+   nir_block *preheader =
+      nir_cf_node_as_block(nir_cf_node_prev(&loop->cf_node));
+
+   foreach_list_typed(nir_cf_node, node, node, &loop->body) {
+      if (node->type == nir_cf_node_block) {
+         progress |= hoist_from_block(nir_cf_node_as_block(node), preheader,
+                                      hoist_loads);
+      }
+   }
+
+   return progress;
+}
+
+static bool
+opt_licm_cf_list(struct exec_list *cf_list, bool hoist_loads)
+{
+   bool progress = false;
+
+   foreach_list_typed(nir_cf_node, node, node, cf_list) {
+      switch (node->type) {
+      case nir_cf_node_block:
+         break;
+
+      case nir_cf_node_if: {
+         nir_if *nif = nir_cf_node_as_if(node);
+         progress |= opt_licm_cf_list(&nif->then_list, hoist_loads);
+         progress |= opt_licm_cf_list(&nif->else_list, hoist_loads);
+         break;
+      }
+
+      case nir_cf_node_loop:
+         progress |= opt_licm_loop(nir_cf_node_as_loop(node), hoist_loads);
+         break;
+
+      default:
+         unreachable("Invalid CF node type");
+      }
+   }
+
+   return progress;
+}
+
+bool
+nir_opt_licm(nir_shader *shader, bool hoist_loads)
+{
+   bool progress = false;
+
+   nir_foreach_function(function, shader) {
+      if (!function->impl)
+         continue;
+
+      nir_metadata_require(function->impl, nir_metadata_block_index |
+                                           nir_metadata_dominance);
+
+      if (opt_licm_cf_list(&function->impl->body, hoist_loads)) {
+         /* Only instructions moved, the control flow is untouched. */
+         nir_metadata_preserve(function->impl, nir_metadata_block_index |
+                                               nir_metadata_dominance);
+         progress = true;
+      }
+   }
+
+   return progress;
+}
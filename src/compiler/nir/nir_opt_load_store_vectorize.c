@@ -0,0 +1,570 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "nir.h"
+#include "nir_builder.h"
+#include "util/hash_table.h"
+#include "util/u_dynarray.h"
+
+/**
+ * \file nir_opt_load_store_vectorize.c
+ *
+ * Combines UBO, SSBO, shared and global memory accesses within a block into
+ * wider ones.  Struct and array accesses tend to end up as one scalar load
+ * or store per member, which most hardware can do in a single message.
+ *
+ * Two accesses are candidates when they use the same intrinsic, resource,
+ * access qualifiers and bit size, and their offsets only differ by a
+ * constant.  Loads are combined when they are adjacent or overlap, stores
+ * only when they are adjacent.  The driver decides whether the result is
+ * something it can actually do through the callback.
+ *
+ * The combined load is placed where the first of the two loads was and the
+ * combined store where the last of the two stores was, so one access ends up
+ * moving past whatever is in between.  That is not done if something in
+ * between may write the memory, or for stores, may read it or has other side
+ * effects.  The check is conservative: any side effect or memory barrier
+ * blocks the move.  Volatile accesses are left alone.
+ */
+
+struct intrinsic_info {
+   nir_variable_mode mode;
+   nir_intrinsic_op op;
+   bool is_store;
+   int resource_src; /* -1 if there is none */
+   int offset_src;
+   int value_src;    /* -1 for loads */
+};
+
+static const struct intrinsic_info *
+get_info(nir_intrinsic_op op)
+{
+   switch (op) {
+#define INFO(mode, op, is_store, res, offset, value)                         \
+   case nir_intrinsic_##op: {                                                \
+      static const struct intrinsic_info op##_info = {                       \
+         mode, nir_intrinsic_##op, is_store, res, offset, value              \
+      };                                                                     \
+      return &op##_info;                                                     \
+   }
+   INFO(nir_var_mem_ubo, load_ubo, false, 0, 1, -1)
+   INFO(nir_var_mem_ssbo, load_ssbo, false, 0, 1, -1)
+   INFO(nir_var_mem_ssbo, store_ssbo, true, 1, 2, 0)
+   INFO(nir_var_mem_shared, load_shared, false, -1, 0, -1)
+   INFO(nir_var_mem_shared, store_shared, true, -1, 1, 0)
+   INFO(nir_var_mem_global, load_global, false, -1, 0, -1)
+   INFO(nir_var_mem_global, store_global, true, -1, 1, 0)
+#undef INFO
+   default:
+      return NULL;
+   }
+}
+
+/* What two accesses need to have in common to be combined */
+struct entry_key {
+   nir_intrinsic_op op;
+   unsigned access;
+   unsigned bit_size;
+
+   /* Constant resource indices are compared by value, since the same index
+    * may well be a different load_const each time.
+    */
+   nir_ssa_def *resource;
+   uint64_t resource_value;
+
+   /* The non-constant part of the offset, NULL if the offset is constant */
+   nir_ssa_def *base;
+};
+
+struct entry {
+   struct entry_key key;
+
+   nir_intrinsic_instr *intrin;
+   const struct intrinsic_info *info;
+
+   /* Position in the block, for telling which of two entries comes first */
+   unsigned index;
+   unsigned group;
+
+   /* The constant part of the offset, in bytes.  For shared memory, this
+    * includes the BASE index.
+    */
+   int64_t offset;
+   unsigned offset_bit_size;
+
+   unsigned align_mul;
+   unsigned align_offset;
+};
+
+static uint32_t
+hash_entry_key(const void *key)
+{
+   return _mesa_hash_data(key, sizeof(struct entry_key));
+}
+
+static bool
+entry_key_equal(const void *a, const void *b)
+{
+   return memcmp(a, b, sizeof(struct entry_key)) == 0;
+}
+
+static int
+sort_entries(const void *a_, const void *b_)
+{
+   const struct entry *a = a_, *b = b_;
+
+   if (a->group != b->group)
+      return a->group < b->group ? -1 : 1;
+   if (a->offset != b->offset)
+      return a->offset < b->offset ? -1 : 1;
+   return a->index < b->index ? -1 : (a->index > b->index);
+}
+
+static unsigned
+get_access(nir_intrinsic_instr *intrin)
+{
+   const nir_intrinsic_info *info = &nir_intrinsic_infos[intrin->intrinsic];
+   return info->index_map[NIR_INTRINSIC_ACCESS] ? nir_intrinsic_access(intrin)
+                                                : 0;
+}
+
+/* Splits an offset into base + constant, looking through one iadd. */
+static void
+parse_offset(nir_src *src, nir_ssa_def **base, int64_t *offset)
+{
+   *base = NULL;
+   *offset = 0;
+
+   if (nir_src_is_const(*src)) {
+      *offset = nir_src_as_uint(*src);
+      return;
+   }
+
+   *base = src->ssa;
+   if (src->ssa->num_components != 1 ||
+       src->ssa->parent_instr->type != nir_instr_type_alu)
+      return;
+
+   nir_alu_instr *alu = nir_instr_as_alu(src->ssa->parent_instr);
+   if (alu->op != nir_op_iadd)
+      return;
+
+   for (unsigned i = 0; i < 2; i++) {
+      nir_alu_src *c = &alu->src[i], *other = &alu->src[1 - i];
+      if (nir_src_is_const(c->src) && other->src.is_ssa &&
+          other->src.ssa->num_components == 1) {
+         *base = other->src.ssa;
+         *offset = nir_src_comp_as_uint(c->src, c->swizzle[0]);
+         return;
+      }
+   }
+}
+
+static bool
+create_entry(struct entry *entry, nir_intrinsic_instr *intrin,
+             const struct intrinsic_info *info)
+{
+   unsigned bit_size = info->is_store ?
+      nir_src_bit_size(intrin->src[info->value_src]) : intrin->dest.ssa.bit_size;
+
+   if (info->is_store ? !intrin->src[info->value_src].is_ssa
+                      : !intrin->dest.is_ssa)
+      return false;
+   if (!intrin->src[info->offset_src].is_ssa || bit_size < 8)
+      return false;
+
+   unsigned access = get_access(intrin);
+   if (access & ACCESS_VOLATILE)
+      return false;
+
+   memset(entry, 0, sizeof(*entry));
+   entry->intrin = intrin;
+   entry->info = info;
+   entry->key.op = intrin->intrinsic;
+   entry->key.access = access;
+   entry->key.bit_size = bit_size;
+
+   if (info->resource_src >= 0) {
+      nir_src *res = &intrin->src[info->resource_src];
+      if (!res->is_ssa)
+         return false;
+      else if (nir_src_is_const(*res))
+         entry->key.resource_value = nir_src_as_uint(*res);
+      else
+         entry->key.resource = res->ssa;
+   }
+
+   nir_src *offset = &intrin->src[info->offset_src];
+   parse_offset(offset, &entry->key.base, &entry->offset);
+   entry->offset_bit_size = nir_src_bit_size(*offset);
+   if (info->mode == nir_var_mem_shared)
+      entry->offset += nir_intrinsic_base(intrin);
+
+   entry->align_mul = nir_intrinsic_align_mul(intrin);
+   entry->align_offset = nir_intrinsic_align_offset(intrin);
+   if (entry->align_mul == 0) {
+      if (entry->key.base) {
+         /* All we know is that the access is aligned to its components. */
+         entry->align_mul = bit_size / 8;
+         entry->align_offset = 0;
+      } else {
+         uint64_t low_bit = entry->offset & -entry->offset;
+         entry->align_mul = low_bit && low_bit < (1u << 30) ? low_bit
+                                                           : (1u << 30);
+         entry->align_offset = 0;
+      }
+   }
+
+   return true;
+}
+
+static unsigned
+entry_size(const struct entry *entry)
+{
+   return entry->intrin->num_components * (entry->key.bit_size / 8);
+}
+
+/* Like nir_intrinsic_align() */
+static unsigned
+entry_align(const struct entry *entry)
+{
+   return entry->align_offset ? 1 << (ffs(entry->align_offset) - 1)
+                              : entry->align_mul;
+}
+
+/* SSBOs and global memory can be the same buffer seen through different
+ * pointers, so an access to one can alias an access to the other.
+ */
+static nir_variable_mode
+alias_class(nir_variable_mode mode)
+{
+   if (mode & (nir_var_mem_ssbo | nir_var_mem_global))
+      return nir_var_mem_ssbo | nir_var_mem_global;
+   return mode;
+}
+
+/* Whether moving an access of the given mode past instr could change what
+ * the program does.
+ */
+static bool
+instr_blocks_move(nir_instr *instr, nir_variable_mode mode, bool is_store)
+{
+   if (instr->type == nir_instr_type_call)
+      return true;
+
+   if (instr->type != nir_instr_type_intrinsic)
+      return false;
+
+   nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(instr);
+   const struct intrinsic_info *info = get_info(intrin->intrinsic);
+   if (info) {
+      if (alias_class(info->mode) != alias_class(mode))
+         return false;
+      return is_store || info->is_store;
+   }
+
+   const unsigned flags = nir_intrinsic_infos[intrin->intrinsic].flags;
+   if (!(flags & NIR_INTRINSIC_CAN_ELIMINATE))
+      return true;
+
+   /* Any load that can't be reordered might read what we store. */
+   return is_store && !(flags & NIR_INTRINSIC_CAN_REORDER);
+}
+
+static bool
+can_move_across(struct entry *first, struct entry *second)
+{
+   const bool is_store = first->info->is_store;
+   const nir_variable_mode mode = first->info->mode;
+
+   /* Nothing can write these, so loads are free to move. */
+   if (!is_store && (mode == nir_var_mem_ubo ||
+                     (first->key.access & ACCESS_CAN_REORDER)))
+      return true;
+
+   for (nir_instr *instr = nir_instr_next(&first->intrin->instr);
+        instr != &second->intrin->instr; instr = nir_instr_next(instr)) {
+      if (instr_blocks_move(instr, mode, is_store))
+         return false;
+   }
+
+   return true;
+}
+
+static nir_ssa_def *
+build_offset(nir_builder *b, struct entry *entry)
+{
+   if (!entry->key.base)
+      return nir_imm_intN_t(b, entry->offset, entry->offset_bit_size);
+
+   if (entry->offset == 0)
+      return entry->key.base;
+
+   return nir_iadd(b, entry->key.base,
+                   nir_imm_intN_t(b, entry->offset, entry->key.base->bit_size));
+}
+
+/* Creates the combined access and fills out everything but the value, with
+ * resource and offset taken from the given entries.
+ */
+static nir_intrinsic_instr *
+create_combined(nir_builder *b, struct entry *low, struct entry *at,
+                unsigned num_components)
+{
+   const struct intrinsic_info *info = low->info;
+   nir_intrinsic_instr *intrin =
+      nir_intrinsic_instr_create(b->shader, info->op);
+
+   intrin->num_components = num_components;
+   memcpy(intrin->const_index, low->intrin->const_index,
+          sizeof(intrin->const_index));
+
+   /* The place we insert at is dominated by the resource of its access. */
+   if (info->resource_src >= 0) {
+      nir_src_copy(&intrin->src[info->resource_src],
+                   &at->intrin->src[info->resource_src], intrin);
+   }
+   intrin->src[info->offset_src] = nir_src_for_ssa(build_offset(b, low));
+
+   if (info->mode == nir_var_mem_shared)
+      nir_intrinsic_set_base(intrin, 0);
+   nir_intrinsic_set_align(intrin, low->align_mul, low->align_offset);
+
+   return intrin;
+}
+
+static bool
+try_combine_loads(nir_builder *b, struct entry *low, struct entry *high,
+                  nir_should_vectorize_mem_func callback)
+{
+   const unsigned bit_size = low->key.bit_size;
+   const unsigned comp_size = bit_size / 8;
+   const uint64_t diff = high->offset - low->offset;
+
+   if (diff % comp_size || diff > entry_size(low))
+      return false;
+
+   const unsigned high_start = diff / comp_size;
+   const unsigned num_components =
+      MAX2(low->intrin->num_components,
+           high_start + high->intrin->num_components);
+   if (num_components > NIR_MAX_VEC_COMPONENTS)
+      return false;
+
+   struct entry *first = low->index < high->index ? low : high;
+   struct entry *second = first == low ? high : low;
+   if (!can_move_across(first, second))
+      return false;
+
+   if (!callback(entry_align(low), bit_size, num_components, diff,
+                 low->intrin, high->intrin))
+      return false;
+
+   b->cursor = nir_before_instr(&first->intrin->instr);
+
+   nir_intrinsic_instr *load = create_combined(b, low, first, num_components);
+   nir_ssa_dest_init(&load->instr, &load->dest, num_components, bit_size,
+                     NULL);
+   nir_builder_instr_insert(b, &load->instr);
+
+   nir_component_mask_t low_mask =
+      BITFIELD_MASK(low->intrin->num_components);
+   nir_component_mask_t high_mask =
+      BITFIELD_MASK(high->intrin->num_components) << high_start;
+
+   nir_ssa_def_rewrite_uses(&low->intrin->dest.ssa,
+                            nir_src_for_ssa(nir_channels(b, &load->dest.ssa,
+                                                         low_mask)));
+   nir_ssa_def_rewrite_uses(&high->intrin->dest.ssa,
+                            nir_src_for_ssa(nir_channels(b, &load->dest.ssa,
+                                                         high_mask)));
+
+   nir_instr_remove(&low->intrin->instr);
+   nir_instr_remove(&high->intrin->instr);
+
+   low->intrin = load;
+   low->index = first->index;
+
+   return true;
+}
+
+static bool
+try_combine_stores(nir_builder *b, struct entry *low, struct entry *high,
+                   nir_should_vectorize_mem_func callback)
+{
+   const unsigned bit_size = low->key.bit_size;
+   const uint64_t diff = high->offset - low->offset;
+
+   /* Overlapping stores would need the later one to win for every
+    * component, so leave them alone.
+    */
+   if (diff != entry_size(low))
+      return false;
+
+   const unsigned low_comps = low->intrin->num_components;
+   const unsigned num_components =
+      low_comps + high->intrin->num_components;
+   if (num_components > NIR_MAX_VEC_COMPONENTS)
+      return false;
+
+   struct entry *first = low->index < high->index ? low : high;
+   struct entry *second = first == low ? high : low;
+   if (!can_move_across(first, second))
+      return false;
+
+   if (!callback(entry_align(low), bit_size, num_components, diff,
+                 low->intrin, high->intrin))
+      return false;
+
+   b->cursor = nir_before_instr(&second->intrin->instr);
+
+   const int value_src = low->info->value_src;
+   nir_ssa_def *low_value = low->intrin->src[value_src].ssa;
+   nir_ssa_def *high_value = high->intrin->src[value_src].ssa;
+
+   nir_ssa_def *comps[NIR_MAX_VEC_COMPONENTS];
+   for (unsigned i = 0; i < num_components; i++) {
+      comps[i] = i < low_comps ? nir_channel(b, low_value, i) :
+                                 nir_channel(b, high_value, i - low_comps);
+   }
+
+   nir_intrinsic_instr *store =
+      create_combined(b, low, second, num_components);
+   store->src[value_src] = nir_src_for_ssa(nir_vec(b, comps, num_components));
+   nir_intrinsic_set_write_mask(store,
+      nir_intrinsic_write_mask(low->intrin) |
+      nir_intrinsic_write_mask(high->intrin) << low_comps);
+   nir_builder_instr_insert(b, &store->instr);
+
+   nir_instr_remove(&low->intrin->instr);
+   nir_instr_remove(&high->intrin->instr);
+
+   low->intrin = store;
+   low->index = second->index;
+
+   return true;
+}
+
+static bool
+vectorize_block(nir_builder *b, nir_block *block, nir_variable_mode modes,
+                nir_should_vectorize_mem_func callback,
+                struct util_dynarray *entries, struct hash_table *groups)
+{
+   util_dynarray_clear(entries);
+   _mesa_hash_table_clear(groups, NULL);
+
+   unsigned index = 0;
+   nir_foreach_instr(instr, block) {
+      index++;
+      if (instr->type != nir_instr_type_intrinsic)
+         continue;
+
+      nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(instr);
+      const struct intrinsic_info *info = get_info(intrin->intrinsic);
+      if (!info || !(info->mode & modes))
+         continue;
+
+      struct entry entry;
+      if (!create_entry(&entry, intrin, info))
+         continue;
+
+      entry.index = index;
+      util_dynarray_append(entries, struct entry, entry);
+   }
+
+   unsigned num_entries = util_dynarray_num_elements(entries, struct entry);
+   if (num_entries < 2)
+      return false;
+
+   /* Number groups in order of appearance, so what we do doesn't depend on
+    * where things happen to be in memory.
+    */
+   struct entry *list = entries->data;
+   for (unsigned i = 0; i < num_entries; i++) {
+      struct hash_entry *he = _mesa_hash_table_search(groups, &list[i].key);
+      if (!he) {
+         he = _mesa_hash_table_insert(groups, &list[i].key,
+                                      (void *)(uintptr_t)groups->entries);
+      }
+      list[i].group = (uintptr_t)he->data;
+   }
+
+   qsort(list, num_entries, sizeof(struct entry), sort_entries);
+
+   bool progress = false;
+   struct entry *low = &list[0];
+   for (unsigned i = 1; i < num_entries; i++) {
+      struct entry *high = &list[i];
+
+      if (high->group == low->group) {
+         bool combined = low->info->is_store ?
+            try_combine_stores(b, low, high, callback) :
+            try_combine_loads(b, low, high, callback);
+         if (combined) {
+            progress = true;
+            continue;
+         }
+      }
+
+      low = high;
+   }
+
+   return progress;
+}
+
+bool
+nir_opt_load_store_vectorize(nir_shader *shader, nir_variable_mode modes,
+                             nir_should_vectorize_mem_func callback)
+{
+   bool progress = false;
+
+   struct util_dynarray entries;
+   util_dynarray_init(&entries, NULL);
+   struct hash_table *groups =
+      _mesa_hash_table_create(NULL, hash_entry_key, entry_key_equal);
+
+   nir_foreach_function(function, shader) {
+      if (!function->impl)
+         continue;
+
+      nir_builder b;
+      nir_builder_init(&b, function->impl);
+
+      bool impl_progress = false;
+      nir_foreach_block(block, function->impl) {
+         impl_progress |= vectorize_block(&b, block, modes, callback,
+                                          &entries, groups);
+      }
+
+      if (impl_progress) {
+         nir_metadata_preserve(function->impl, nir_metadata_block_index |
+                                               nir_metadata_dominance);
+         progress = true;
+      }
+   }
+
+   _mesa_hash_table_destroy(groups, NULL);
+   util_dynarray_fini(&entries);
+
+   return progress;
+}
@@ -0,0 +1,212 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "nir_pass_manager.h"
+#include "util/debug.h"
+#include "util/os_time.h"
+#include "util/u_dynarray.h"
+
+struct nir_pass_entry {
+   const char *name;
+   const char *validate_when;
+
+   nir_pass_func pass;
+   nir_pass_data_func pass_data;
+   const void *data;
+
+   unsigned reads;
+   unsigned writes;
+   unsigned flags;
+
+   /* What other passes touched since this one last ran */
+   unsigned pending;
+
+   unsigned runs;
+   unsigned skips;
+   unsigned progress;
+   int64_t time_ns;
+};
+
+struct nir_pass_manager {
+   /* Array of nir_pass_entry, in the order the passes were added */
+   struct util_dynarray passes;
+
+   bool print_stats;
+};
+
+nir_pass_manager *
+nir_pass_manager_create(void *mem_ctx)
+{
+   nir_pass_manager *pm = rzalloc(mem_ctx, nir_pass_manager);
+   util_dynarray_init(&pm->passes, pm);
+   pm->print_stats = env_var_as_boolean("NIR_PASS_STATS", false);
+   return pm;
+}
+
+void
+nir_pass_manager_destroy(nir_pass_manager *pm)
+{
+   ralloc_free(pm);
+}
+
+static struct nir_pass_entry *
+add_entry(nir_pass_manager *pm, const char *name,
+          unsigned reads, unsigned writes, unsigned flags)
+{
+   struct nir_pass_entry entry = {
+      .name = name,
+      .validate_when = ralloc_asprintf(pm, "after %s", name),
+      .reads = reads,
+      .writes = writes,
+      .flags = flags,
+   };
+
+   util_dynarray_append(&pm->passes, struct nir_pass_entry, entry);
+   return util_dynarray_top_ptr(&pm->passes, struct nir_pass_entry);
+}
+
+void
+nir_pass_manager_add(nir_pass_manager *pm, const char *name,
+                     nir_pass_func pass, unsigned reads,
+                     unsigned writes, unsigned flags)
+{
+   add_entry(pm, name, reads, writes, flags)->pass = pass;
+}
+
+void
+nir_pass_manager_add_with_data(nir_pass_manager *pm, const char *name,
+                               nir_pass_data_func pass, const void *data,
+                               unsigned reads, unsigned writes,
+                               unsigned flags)
+{
+   struct nir_pass_entry *entry = add_entry(pm, name, reads, writes, flags);
+   entry->pass_data = pass;
+   entry->data = data;
+}
+
+/* Does what NIR_PASS does around the pass itself. */
+static bool
+run_pass(nir_shader *shader, struct nir_pass_entry *entry)
+{
+   if (should_skip_nir(entry->name)) {
+      printf("skipping %s\n", entry->name);
+      return false;
+   }
+
+   nir_metadata_set_validation_flag(shader);
+   if (should_print_nir())
+      printf("%s\n", entry->name);
+
+   int64_t start = os_time_get_nano();
+   bool progress = entry->pass ? entry->pass(shader) :
+                                 entry->pass_data(shader, entry->data);
+   entry->time_ns += os_time_get_nano() - start;
+
+   if (progress) {
+      if (should_print_nir())
+         nir_print_shader(shader, stdout);
+      nir_metadata_check_validation_flag(shader);
+   }
+
+   nir_validate_shader(shader, entry->validate_when);
+   if (should_clone_nir()) {
+      nir_shader *clone = nir_shader_clone(ralloc_parent(shader), shader);
+      nir_shader_replace(shader, clone);
+   }
+   if (should_serialize_deserialize_nir())
+      nir_shader_serialize_deserialize(shader);
+
+   return progress;
+}
+
+bool
+nir_pass_manager_run(nir_pass_manager *pm, nir_shader *shader)
+{
+   struct nir_pass_entry *passes = pm->passes.data;
+   unsigned num_passes =
+      util_dynarray_num_elements(&pm->passes, struct nir_pass_entry);
+   bool any_progress = false;
+
+   if (num_passes == 0)
+      return false;
+
+   /* Nothing is known about the shader yet, so every pass gets to run. */
+   for (unsigned i = 0; i < num_passes; i++)
+      passes[i].pending = NIR_PASS_TOUCHES_ALL;
+
+   /* Walk the passes in a circle.  We are done once we have gone all the
+    * way around without anything making (counted) progress, at which point
+    * every pass has either run on the current shader or had nothing new to
+    * look at.
+    */
+   unsigned since_progress = 0;
+   for (unsigned i = 0; since_progress < num_passes;
+        i = (i + 1) % num_passes) {
+      struct nir_pass_entry *entry = &passes[i];
+      since_progress++;
+
+      if (!(entry->pending & entry->reads)) {
+         entry->skips++;
+         continue;
+      }
+
+      entry->pending = 0;
+      entry->runs++;
+
+      if (!run_pass(shader, entry))
+         continue;
+
+      entry->progress++;
+      any_progress = true;
+
+      for (unsigned j = 0; j < num_passes; j++)
+         passes[j].pending |= entry->writes;
+
+      if (!(entry->flags & NIR_PASS_IGNORE_PROGRESS))
+         since_progress = 0;
+   }
+
+   if (pm->print_stats)
+      nir_pass_manager_print_stats(pm, stderr);
+
+   return any_progress;
+}
+
+void
+nir_pass_manager_print_stats(const nir_pass_manager *pm, FILE *fp)
+{
+   unsigned runs = 0, skips = 0;
+   int64_t time_ns = 0;
+
+   fprintf(fp, "%-32s %8s %8s %8s %10s\n",
+           "pass", "runs", "skipped", "progress", "time (us)");
+   util_dynarray_foreach(&pm->passes, struct nir_pass_entry, entry) {
+      fprintf(fp, "%-32s %8u %8u %8u %10.1f\n", entry->name, entry->runs,
+              entry->skips, entry->progress, entry->time_ns / 1000.0);
+      runs += entry->runs;
+      skips += entry->skips;
+      time_ns += entry->time_ns;
+   }
+   fprintf(fp, "%-32s %8u %8u %8s %10.1f\n",
+           "total", runs, skips, "", time_ns / 1000.0);
+}
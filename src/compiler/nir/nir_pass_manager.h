@@ -0,0 +1,128 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef NIR_PASS_MANAGER_H
+#define NIR_PASS_MANAGER_H
+
+#include "nir.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \file nir_pass_manager.h
+ *
+ * Runs a list of passes over a shader until none of them makes progress,
+ * which is what the hand-written "do { ... } while (progress)" loops in the
+ * drivers do.
+ *
+ * Each pass declares which kinds of IR it looks at (reads) and which kinds
+ * it may change when it makes progress (writes).  A pass that has already
+ * run without making progress is only run again once some other pass has
+ * made progress that touched something it reads.  In particular, the loop
+ * ends as soon as every pass has had a chance to run since the last time
+ * anything changed, instead of after a whole extra iteration.
+ *
+ * The masks have to be conservative:
+ *
+ *  - reads has to cover everything the pass's decisions depend on, not only
+ *    the instructions it rewrites.  A pass that checks the uses of a value
+ *    depends on every kind of instruction that can use it.
+ *
+ *  - writes has to cover every instruction the pass may add, remove or
+ *    modify, including the users rewritten by nir_ssa_def_rewrite_uses().
+ *
+ * When in doubt, use NIR_PASS_TOUCHES_ALL.
+ *
+ * Passes are run with the same debug hooks as NIR_PASS (NIR_SKIP,
+ * NIR_PRINT, NIR_TEST_CLONE and NIR_TEST_SERIALIZE).  Setting
+ * NIR_PASS_STATS=true prints per-pass run, skip and progress counts and
+ * timings to stderr after each nir_pass_manager_run().
+ */
+
+#define NIR_PASS_TOUCHES_INSTR(type)   (1u << (type))
+#define NIR_PASS_TOUCHES_ALU           NIR_PASS_TOUCHES_INSTR(nir_instr_type_alu)
+#define NIR_PASS_TOUCHES_DEREF         NIR_PASS_TOUCHES_INSTR(nir_instr_type_deref)
+#define NIR_PASS_TOUCHES_CALL          NIR_PASS_TOUCHES_INSTR(nir_instr_type_call)
+#define NIR_PASS_TOUCHES_TEX           NIR_PASS_TOUCHES_INSTR(nir_instr_type_tex)
+#define NIR_PASS_TOUCHES_INTRINSIC     NIR_PASS_TOUCHES_INSTR(nir_instr_type_intrinsic)
+#define NIR_PASS_TOUCHES_LOAD_CONST    NIR_PASS_TOUCHES_INSTR(nir_instr_type_load_const)
+#define NIR_PASS_TOUCHES_JUMP          NIR_PASS_TOUCHES_INSTR(nir_instr_type_jump)
+#define NIR_PASS_TOUCHES_SSA_UNDEF     NIR_PASS_TOUCHES_INSTR(nir_instr_type_ssa_undef)
+#define NIR_PASS_TOUCHES_PHI           NIR_PASS_TOUCHES_INSTR(nir_instr_type_phi)
+/** The control-flow tree: ifs, loops and blocks */
+#define NIR_PASS_TOUCHES_CF            (1u << 16)
+/** Variable lists and variable data */
+#define NIR_PASS_TOUCHES_VARIABLES     (1u << 17)
+#define NIR_PASS_TOUCHES_ALL           (~0u)
+
+/** Progress of the pass does not make the manager iterate again
+ *
+ * This matches a pass that a hand-written loop calls with NIR_PASS_V.
+ * Its changes still make the passes that read them run again.
+ */
+#define NIR_PASS_IGNORE_PROGRESS       (1u << 0)
+
+typedef bool (*nir_pass_func)(nir_shader *shader);
+typedef bool (*nir_pass_data_func)(nir_shader *shader, const void *data);
+
+typedef struct nir_pass_manager nir_pass_manager;
+
+nir_pass_manager *nir_pass_manager_create(void *mem_ctx);
+void nir_pass_manager_destroy(nir_pass_manager *pm);
+
+void nir_pass_manager_add(nir_pass_manager *pm, const char *name,
+                          nir_pass_func pass, unsigned reads,
+                          unsigned writes, unsigned flags);
+
+/** Adds a pass that takes extra arguments through data
+ *
+ * data is not copied and has to outlive the pass manager.
+ */
+void nir_pass_manager_add_with_data(nir_pass_manager *pm, const char *name,
+                                    nir_pass_data_func pass, const void *data,
+                                    unsigned reads, unsigned writes,
+                                    unsigned flags);
+
+#define NIR_PM_ADD(pm, pass, reads, writes) \
+   nir_pass_manager_add(pm, #pass, pass, reads, writes, 0)
+
+#define NIR_PM_ADD_V(pm, pass, reads, writes) \
+   nir_pass_manager_add(pm, #pass, pass, reads, writes, \
+                        NIR_PASS_IGNORE_PROGRESS)
+
+/** Runs the passes in order until none of them can make progress
+ *
+ * Returns true if any pass, including ones flagged with
+ * NIR_PASS_IGNORE_PROGRESS, made progress.  A pass manager can be run on
+ * any number of shaders; statistics accumulate across runs.
+ */
+bool nir_pass_manager_run(nir_pass_manager *pm, nir_shader *shader);
+
+void nir_pass_manager_print_stats(const nir_pass_manager *pm, FILE *fp);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* NIR_PASS_MANAGER_H */
@@ -106,6 +106,12 @@ print_ssa_def(nir_ssa_def *def, print_state *state)
    FILE *fp = state->fp;
    if (def->name != NULL)
       fprintf(fp, "/* %s */ ", def->name);
+   if (def->parent_instr->block) {
+      nir_function_impl *impl =
+         nir_cf_node_get_function(&def->parent_instr->block->cf_node);
+      if (impl->valid_metadata & nir_metadata_divergence)
+         fprintf(fp, "%s ", def->divergent ? "div" : "con");
+   }
    fprintf(fp, "%s %u ssa_%u", sizes[def->num_components], def->bit_size,
            def->index);
 }
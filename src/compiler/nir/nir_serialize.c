@@ -25,6 +25,18 @@
 #include "nir_control_flow.h"
 #include "util/u_dynarray.h"
 
+#include <setjmp.h>
+
+/* "NIRS" */
+#define NIR_SERIALIZE_MAGIC 0x5352494e
+
+/* Bump this whenever the encoding below changes so that stale entries in
+ * on-disk caches get rejected instead of misread.
+ */
+#define NIR_SERIALIZE_VERSION 1
+
+#define NIR_SERIALIZE_FUNC_HAS_IMPL ((void *)(intptr_t) 1)
+
 typedef struct {
    size_t blob_offset;
    nir_ssa_def *src;
@@ -40,12 +52,22 @@ typedef struct {
    struct hash_table *remap_table;
 
    /* the next index to assign to a NIR in-memory object */
-   uintptr_t next_idx;
+   uint32_t next_idx;
 
    /* Array of write_phi_fixup structs representing phi sources that need to
     * be resolved in the second pass.
     */
    struct util_dynarray phi_fixups;
+
+   /* maps glsl_type pointer to its index in the type table */
+   struct hash_table *type_table;
+   uint32_t next_type_idx;
+
+   /* maps load_const instructions to the index of the first load_const with
+    * the same value
+    */
+   struct hash_table *const_table;
+   uint32_t next_const_idx;
 } write_ctx;
 
 typedef struct {
@@ -54,10 +76,10 @@ typedef struct {
    struct blob_reader *blob;
 
    /* the next index to assign to a NIR in-memory object */
-   uintptr_t next_idx;
+   uint32_t next_idx;
 
    /* The length of the index -> object table */
-   uintptr_t idx_table_len;
+   uint32_t idx_table_len;
 
    /* map from index to deserialized pointer */
    void **idx_table;
@@ -65,54 +87,141 @@ typedef struct {
    /* List of phi sources. */
    struct list_head phi_srcs;
 
+   /* Array of glsl_type pointers, indexed by type table index */
+   struct util_dynarray types;
+
+   /* Array of nir_load_const_instr pointers, indexed by constant index */
+   struct util_dynarray consts;
+
+   /* Where to jump when the blob turns out to be truncated or corrupt */
+   jmp_buf fail_jump;
 } read_ctx;
 
 static void
 write_add_object(write_ctx *ctx, const void *obj)
 {
-   uintptr_t index = ctx->next_idx++;
-   _mesa_hash_table_insert(ctx->remap_table, obj, (void *) index);
+   uint32_t index = ctx->next_idx++;
+   _mesa_hash_table_insert(ctx->remap_table, obj, (void *)(uintptr_t) index);
 }
 
-static uintptr_t
+static uint32_t
 write_lookup_object(write_ctx *ctx, const void *obj)
 {
    struct hash_entry *entry = _mesa_hash_table_search(ctx->remap_table, obj);
    assert(entry);
-   return (uintptr_t) entry->data;
+   return (uint32_t)(uintptr_t) entry->data;
 }
 
 static void
 write_object(write_ctx *ctx, const void *obj)
 {
-   blob_write_intptr(ctx->blob, write_lookup_object(ctx, obj));
+   blob_write_uleb128(ctx->blob, write_lookup_object(ctx, obj));
+}
+
+/* Abandon deserialization; nir_deserialize() frees what was read so far and
+ * returns NULL.
+ */
+NORETURN static void
+read_fail(read_ctx *ctx)
+{
+   longjmp(ctx->fail_jump, 1);
+}
+
+/* Once the blob has overrun, every further read returns zeros, which would
+ * otherwise be taken as real (and usually bogus) counts and indices.
+ */
+static void
+read_check(read_ctx *ctx)
+{
+   if (ctx->blob->overrun)
+      read_fail(ctx);
 }
 
 static void
 read_add_object(read_ctx *ctx, void *obj)
 {
-   assert(ctx->next_idx < ctx->idx_table_len);
+   if (ctx->next_idx >= ctx->idx_table_len)
+      read_fail(ctx);
    ctx->idx_table[ctx->next_idx++] = obj;
 }
 
 static void *
-read_lookup_object(read_ctx *ctx, uintptr_t idx)
+read_lookup_object(read_ctx *ctx, uint32_t idx)
 {
-   assert(idx < ctx->idx_table_len);
+   /* Indices past next_idx have not been read yet, so those entries are
+    * still NULL.  Source indices are relative and wrap around to large
+    * values when they are out of range.
+    */
+   read_check(ctx);
+   if (idx >= ctx->idx_table_len || ctx->idx_table[idx] == NULL)
+      read_fail(ctx);
    return ctx->idx_table[idx];
 }
 
 static void *
 read_object(read_ctx *ctx)
 {
-   return read_lookup_object(ctx, blob_read_intptr(ctx->blob));
+   return read_lookup_object(ctx, blob_read_uleb128(ctx->blob));
+}
+
+/* Types are interned, so the same pointer shows up over and over again on
+ * variables and derefs.  Each one is only encoded the first time it is seen
+ * and referenced by its index in the type table afterwards.
+ */
+static void
+write_type(write_ctx *ctx, const struct glsl_type *type)
+{
+   struct hash_entry *entry = _mesa_hash_table_search(ctx->type_table, type);
+   if (entry) {
+      blob_write_uleb128(ctx->blob, (uint32_t)(uintptr_t) entry->data);
+      return;
+   }
+
+   uint32_t index = ctx->next_type_idx++;
+   _mesa_hash_table_insert(ctx->type_table, type, (void *)(uintptr_t) index);
+   blob_write_uleb128(ctx->blob, index);
+   encode_type_to_blob(ctx->blob, type);
+}
+
+static const struct glsl_type *
+read_type(read_ctx *ctx)
+{
+   uint32_t index = blob_read_uleb128(ctx->blob);
+   unsigned num_types =
+      util_dynarray_num_elements(&ctx->types, const struct glsl_type *);
+
+   if (index < num_types)
+      return *util_dynarray_element(&ctx->types, const struct glsl_type *,
+                                    index);
+
+   if (index != num_types)
+      read_fail(ctx);
+
+   const struct glsl_type *type = decode_type_from_blob(ctx->blob);
+   read_check(ctx);
+   util_dynarray_append(&ctx->types, const struct glsl_type *, type);
+   return type;
+}
+
+/* Bit sizes are 0, 1, 8, 16, 32 or 64, which fits in three bits this way. */
+static unsigned
+encode_bit_size_3bits(unsigned bit_size)
+{
+   assert(bit_size == 0 || util_is_power_of_two_nonzero(bit_size));
+   return util_last_bit(bit_size);
+}
+
+static unsigned
+decode_bit_size_3bits(unsigned bit_size)
+{
+   return bit_size ? 1 << (bit_size - 1) : 0;
 }
 
 static void
 write_constant(write_ctx *ctx, const nir_constant *c)
 {
    blob_write_bytes(ctx->blob, c->values, sizeof(c->values));
-   blob_write_uint32(ctx->blob, c->num_elements);
+   blob_write_uleb128(ctx->blob, c->num_elements);
    for (unsigned i = 0; i < c->num_elements; i++)
       write_constant(ctx, c->elements[i]);
 }
@@ -123,7 +232,8 @@ read_constant(read_ctx *ctx, nir_variable *nvar)
    nir_constant *c = ralloc(nvar, nir_constant);
 
    blob_copy_bytes(ctx->blob, (uint8_t *)c->values, sizeof(c->values));
-   c->num_elements = blob_read_uint32(ctx->blob);
+   c->num_elements = blob_read_uleb128(ctx->blob);
+   read_check(ctx);
    c->elements = ralloc_array(nvar, nir_constant *, c->num_elements);
    for (unsigned i = 0; i < c->num_elements; i++)
       c->elements[i] = read_constant(ctx, nvar);
@@ -131,28 +241,47 @@ read_constant(read_ctx *ctx, nir_variable *nvar)
    return c;
 }
 
+union packed_var {
+   uint32_t u32;
+   struct {
+      unsigned has_name:1;
+      unsigned has_constant_initializer:1;
+      unsigned has_interface_type:1;
+      unsigned num_state_slots:13;
+      unsigned num_members:16;
+   } u;
+};
+
 static void
 write_variable(write_ctx *ctx, const nir_variable *var)
 {
    write_add_object(ctx, var);
-   encode_type_to_blob(ctx->blob, var->type);
-   blob_write_uint32(ctx->blob, !!(var->name));
+
+   assert(var->num_state_slots < (1 << 13));
+   assert(var->num_members < (1 << 16));
+
+   union packed_var flags;
+   flags.u32 = 0;
+   flags.u.has_name = !!(var->name);
+   flags.u.has_constant_initializer = !!(var->constant_initializer);
+   flags.u.has_interface_type = !!(var->interface_type);
+   flags.u.num_state_slots = var->num_state_slots;
+   flags.u.num_members = var->num_members;
+   blob_write_uleb128(ctx->blob, flags.u32);
+
+   write_type(ctx, var->type);
    if (var->name)
       blob_write_string(ctx->blob, var->name);
    blob_write_bytes(ctx->blob, (uint8_t *) &var->data, sizeof(var->data));
-   blob_write_uint32(ctx->blob, var->num_state_slots);
    for (unsigned i = 0; i < var->num_state_slots; i++) {
       for (unsigned j = 0; j < STATE_LENGTH; j++)
-         blob_write_uint32(ctx->blob, var->state_slots[i].tokens[j]);
-      blob_write_uint32(ctx->blob, var->state_slots[i].swizzle);
+         blob_write_uleb128(ctx->blob, var->state_slots[i].tokens[j]);
+      blob_write_uleb128(ctx->blob, var->state_slots[i].swizzle);
    }
-   blob_write_uint32(ctx->blob, !!(var->constant_initializer));
    if (var->constant_initializer)
       write_constant(ctx, var->constant_initializer);
-   blob_write_uint32(ctx->blob, !!(var->interface_type));
    if (var->interface_type)
-      encode_type_to_blob(ctx->blob, var->interface_type);
-   blob_write_uint32(ctx->blob, var->num_members);
+      write_type(ctx, var->interface_type);
    if (var->num_members > 0) {
       blob_write_bytes(ctx->blob, (uint8_t *) var->members,
                        var->num_members * sizeof(*var->members));
@@ -165,36 +294,36 @@ read_variable(read_ctx *ctx)
    nir_variable *var = rzalloc(ctx->nir, nir_variable);
    read_add_object(ctx, var);
 
-   var->type = decode_type_from_blob(ctx->blob);
-   bool has_name = blob_read_uint32(ctx->blob);
-   if (has_name) {
+   union packed_var flags;
+   flags.u32 = blob_read_uleb128(ctx->blob);
+
+   var->type = read_type(ctx);
+   if (flags.u.has_name) {
       const char *name = blob_read_string(ctx->blob);
       var->name = ralloc_strdup(var, name);
    } else {
       var->name = NULL;
    }
    blob_copy_bytes(ctx->blob, (uint8_t *) &var->data, sizeof(var->data));
-   var->num_state_slots = blob_read_uint32(ctx->blob);
+   var->num_state_slots = flags.u.num_state_slots;
    if (var->num_state_slots != 0) {
       var->state_slots = ralloc_array(var, nir_state_slot,
                                       var->num_state_slots);
       for (unsigned i = 0; i < var->num_state_slots; i++) {
          for (unsigned j = 0; j < STATE_LENGTH; j++)
-            var->state_slots[i].tokens[j] = blob_read_uint32(ctx->blob);
-         var->state_slots[i].swizzle = blob_read_uint32(ctx->blob);
+            var->state_slots[i].tokens[j] = blob_read_uleb128(ctx->blob);
+         var->state_slots[i].swizzle = blob_read_uleb128(ctx->blob);
       }
    }
-   bool has_const_initializer = blob_read_uint32(ctx->blob);
-   if (has_const_initializer)
+   if (flags.u.has_constant_initializer)
       var->constant_initializer = read_constant(ctx, var);
    else
       var->constant_initializer = NULL;
-   bool has_interface_type = blob_read_uint32(ctx->blob);
-   if (has_interface_type)
-      var->interface_type = decode_type_from_blob(ctx->blob);
+   if (flags.u.has_interface_type)
+      var->interface_type = read_type(ctx);
    else
       var->interface_type = NULL;
-   var->num_members = blob_read_uint32(ctx->blob);
+   var->num_members = flags.u.num_members;
    if (var->num_members > 0) {
       var->members = ralloc_array(var, struct nir_variable_data,
                                   var->num_members);
@@ -208,7 +337,7 @@ read_variable(read_ctx *ctx)
 static void
 write_var_list(write_ctx *ctx, const struct exec_list *src)
 {
-   blob_write_uint32(ctx->blob, exec_list_length(src));
+   blob_write_uleb128(ctx->blob, exec_list_length(src));
    foreach_list_typed(nir_variable, var, node, src) {
       write_variable(ctx, var);
    }
@@ -218,8 +347,9 @@ static void
 read_var_list(read_ctx *ctx, struct exec_list *dst)
 {
    exec_list_make_empty(dst);
-   unsigned num_vars = blob_read_uint32(ctx->blob);
+   unsigned num_vars = blob_read_uleb128(ctx->blob);
    for (unsigned i = 0; i < num_vars; i++) {
+      read_check(ctx);
       nir_variable *var = read_variable(ctx);
       exec_list_push_tail(dst, &var->node);
    }
@@ -229,11 +359,11 @@ static void
 write_register(write_ctx *ctx, const nir_register *reg)
 {
    write_add_object(ctx, reg);
-   blob_write_uint32(ctx->blob, reg->num_components);
-   blob_write_uint32(ctx->blob, reg->bit_size);
-   blob_write_uint32(ctx->blob, reg->num_array_elems);
-   blob_write_uint32(ctx->blob, reg->index);
-   blob_write_uint32(ctx->blob, !!(reg->name));
+   blob_write_uleb128(ctx->blob, reg->num_components);
+   blob_write_uleb128(ctx->blob, reg->bit_size);
+   blob_write_uleb128(ctx->blob, reg->num_array_elems);
+   blob_write_uleb128(ctx->blob, reg->index);
+   blob_write_uint8(ctx->blob, !!(reg->name));
    if (reg->name)
       blob_write_string(ctx->blob, reg->name);
 }
@@ -243,11 +373,11 @@ read_register(read_ctx *ctx)
 {
    nir_register *reg = ralloc(ctx->nir, nir_register);
    read_add_object(ctx, reg);
-   reg->num_components = blob_read_uint32(ctx->blob);
-   reg->bit_size = blob_read_uint32(ctx->blob);
-   reg->num_array_elems = blob_read_uint32(ctx->blob);
-   reg->index = blob_read_uint32(ctx->blob);
-   bool has_name = blob_read_uint32(ctx->blob);
+   reg->num_components = blob_read_uleb128(ctx->blob);
+   reg->bit_size = blob_read_uleb128(ctx->blob);
+   reg->num_array_elems = blob_read_uleb128(ctx->blob);
+   reg->index = blob_read_uleb128(ctx->blob);
+   bool has_name = blob_read_uint8(ctx->blob);
    if (has_name) {
       const char *name = blob_read_string(ctx->blob);
       reg->name = ralloc_strdup(reg, name);
@@ -265,7 +395,7 @@ read_register(read_ctx *ctx)
 static void
 write_reg_list(write_ctx *ctx, const struct exec_list *src)
 {
-   blob_write_uint32(ctx->blob, exec_list_length(src));
+   blob_write_uleb128(ctx->blob, exec_list_length(src));
    foreach_list_typed(nir_register, reg, node, src)
       write_register(ctx, reg);
 }
@@ -274,151 +404,296 @@ static void
 read_reg_list(read_ctx *ctx, struct exec_list *dst)
 {
    exec_list_make_empty(dst);
-   unsigned num_regs = blob_read_uint32(ctx->blob);
+   unsigned num_regs = blob_read_uleb128(ctx->blob);
    for (unsigned i = 0; i < num_regs; i++) {
+      read_check(ctx);
       nir_register *reg = read_register(ctx);
       exec_list_push_tail(dst, &reg->node);
    }
 }
 
+/* Since sources are very frequent, we try to save some space when storing
+ * them.  The value or register is stored as the distance back from the most
+ * recently added object rather than as an absolute index; SSA values are
+ * usually used shortly after they are defined, so this mostly fits in one or
+ * two bytes.  The low bits hold whether the source is SSA, whether the
+ * register has an indirect index, and num_flags bits of per-instruction-type
+ * flags.
+ */
 static void
-write_src(write_ctx *ctx, const nir_src *src)
+write_src_full(write_ctx *ctx, const nir_src *src,
+               uint32_t flags, unsigned num_flags)
 {
-   /* Since sources are very frequent, we try to save some space when storing
-    * them. In particular, we store whether the source is a register and
-    * whether the register has an indirect index in the low two bits. We can
-    * assume that the high two bits of the index are zero, since otherwise our
-    * address space would've been exhausted allocating the remap table!
-    */
+   uint32_t idx, val = src->is_ssa;
+
+   assert(flags < (1u << num_flags));
+   val |= flags << 2;
+
    if (src->is_ssa) {
-      uintptr_t idx = write_lookup_object(ctx, src->ssa) << 2;
-      idx |= 1;
-      blob_write_intptr(ctx->blob, idx);
+      idx = write_lookup_object(ctx, src->ssa);
    } else {
-      uintptr_t idx = write_lookup_object(ctx, src->reg.reg) << 2;
+      idx = write_lookup_object(ctx, src->reg.reg);
+      val |= !!(src->reg.indirect) << 1;
+   }
+
+   assert(idx < ctx->next_idx);
+   blob_write_uleb128(ctx->blob, val | (ctx->next_idx - idx) << (2 + num_flags));
+
+   if (!src->is_ssa) {
+      blob_write_uleb128(ctx->blob, src->reg.base_offset);
       if (src->reg.indirect)
-         idx |= 2;
-      blob_write_intptr(ctx->blob, idx);
-      blob_write_uint32(ctx->blob, src->reg.base_offset);
-      if (src->reg.indirect) {
-         write_src(ctx, src->reg.indirect);
-      }
+         write_src_full(ctx, src->reg.indirect, 0, 0);
    }
 }
 
 static void
-read_src(read_ctx *ctx, nir_src *src, void *mem_ctx)
+write_src(write_ctx *ctx, const nir_src *src)
 {
-   uintptr_t val = blob_read_intptr(ctx->blob);
-   uintptr_t idx = val >> 2;
+   write_src_full(ctx, src, 0, 0);
+}
+
+static uint32_t
+read_src_full(read_ctx *ctx, nir_src *src, void *mem_ctx, unsigned num_flags)
+{
+   uint32_t val = blob_read_uleb128(ctx->blob);
+   uint32_t idx = ctx->next_idx - (val >> (2 + num_flags));
    src->is_ssa = val & 0x1;
    if (src->is_ssa) {
       src->ssa = read_lookup_object(ctx, idx);
    } else {
       bool is_indirect = val & 0x2;
       src->reg.reg = read_lookup_object(ctx, idx);
-      src->reg.base_offset = blob_read_uint32(ctx->blob);
+      src->reg.base_offset = blob_read_uleb128(ctx->blob);
       if (is_indirect) {
          src->reg.indirect = ralloc(mem_ctx, nir_src);
-         read_src(ctx, src->reg.indirect, mem_ctx);
+         read_src_full(ctx, src->reg.indirect, mem_ctx, 0);
       } else {
          src->reg.indirect = NULL;
       }
    }
+
+   return (val >> 2) & ((1u << num_flags) - 1);
 }
 
 static void
-write_dest(write_ctx *ctx, const nir_dest *dst)
+read_src(read_ctx *ctx, nir_src *src, void *mem_ctx)
 {
-   uint32_t val = dst->is_ssa;
+   read_src_full(ctx, src, mem_ctx, 0);
+}
+
+/* Destinations are packed into a byte of the instruction header. */
+union packed_dest {
+   uint8_t u8;
+   struct {
+      uint8_t is_ssa:1;
+      uint8_t has_name:1;
+      uint8_t num_components:3;
+      uint8_t bit_size:3;
+   } ssa;
+   struct {
+      uint8_t is_ssa:1;
+      uint8_t is_indirect:1;
+      uint8_t _pad:6;
+   } reg;
+};
+
+union packed_instr {
+   uint32_t u32;
+   struct {
+      unsigned instr_type:4;
+      unsigned _pad:20;
+      unsigned dest:8;
+   } any;
+   struct {
+      unsigned instr_type:4;
+      unsigned exact:1;
+      unsigned no_signed_wrap:1;
+      unsigned no_unsigned_wrap:1;
+      unsigned saturate:1;
+      unsigned write_mask:4;
+      unsigned op:9;
+      unsigned _pad:3;
+      unsigned dest:8;
+   } alu;
+   struct {
+      unsigned instr_type:4;
+      unsigned deref_type:3;
+      unsigned mode:12;
+      unsigned _pad:5;
+      unsigned dest:8;
+   } deref;
+   struct {
+      unsigned instr_type:4;
+      unsigned intrinsic:9;
+      unsigned num_components:3;
+      unsigned _pad:8;
+      unsigned dest:8;
+   } intrinsic;
+   struct {
+      unsigned instr_type:4;
+      unsigned num_components:3;
+      unsigned bit_size:3;
+      unsigned is_duplicate:1;
+      unsigned _pad:21;
+   } load_const;
+   struct {
+      unsigned instr_type:4;
+      unsigned num_components:3;
+      unsigned bit_size:3;
+      unsigned _pad:22;
+   } undef;
+   struct {
+      unsigned instr_type:4;
+      unsigned num_srcs:4;
+      unsigned op:4;
+      unsigned _pad:12;
+      unsigned dest:8;
+   } tex;
+   struct {
+      unsigned instr_type:4;
+      unsigned num_srcs:20;
+      unsigned dest:8;
+   } phi;
+   struct {
+      unsigned instr_type:4;
+      unsigned type:2;
+      unsigned _pad:26;
+   } jump;
+};
+
+static void
+write_instr_header(write_ctx *ctx, union packed_instr header)
+{
+   blob_write_bytes(ctx->blob, &header.u32, sizeof(header.u32));
+}
+
+/* Packs the destination into the header and writes the header, followed by
+ * whatever the destination needs beyond that.
+ */
+static void
+write_dest(write_ctx *ctx, const nir_dest *dst, union packed_instr header)
+{
+   union packed_dest dest;
+   dest.u8 = 0;
+
+   dest.ssa.is_ssa = dst->is_ssa;
    if (dst->is_ssa) {
-      val |= !!(dst->ssa.name) << 1;
-      val |= dst->ssa.num_components << 2;
-      val |= dst->ssa.bit_size << 5;
+      dest.ssa.has_name = !!(dst->ssa.name);
+      dest.ssa.num_components = dst->ssa.num_components;
+      dest.ssa.bit_size = encode_bit_size_3bits(dst->ssa.bit_size);
    } else {
-      val |= !!(dst->reg.indirect) << 1;
+      dest.reg.is_indirect = !!(dst->reg.indirect);
    }
-   blob_write_uint32(ctx->blob, val);
+   header.any.dest = dest.u8;
+
+   write_instr_header(ctx, header);
+
    if (dst->is_ssa) {
       write_add_object(ctx, &dst->ssa);
       if (dst->ssa.name)
          blob_write_string(ctx->blob, dst->ssa.name);
    } else {
-      blob_write_intptr(ctx->blob, write_lookup_object(ctx, dst->reg.reg));
-      blob_write_uint32(ctx->blob, dst->reg.base_offset);
+      write_object(ctx, dst->reg.reg);
+      blob_write_uleb128(ctx->blob, dst->reg.base_offset);
       if (dst->reg.indirect)
          write_src(ctx, dst->reg.indirect);
    }
 }
 
 static void
-read_dest(read_ctx *ctx, nir_dest *dst, nir_instr *instr)
-{
-   uint32_t val = blob_read_uint32(ctx->blob);
-   bool is_ssa = val & 0x1;
-   if (is_ssa) {
-      bool has_name = val & 0x2;
-      unsigned num_components = (val >> 2) & 0x7;
-      unsigned bit_size = val >> 5;
-      char *name = has_name ? blob_read_string(ctx->blob) : NULL;
-      nir_ssa_dest_init(instr, dst, num_components, bit_size, name);
+read_dest(read_ctx *ctx, nir_dest *dst, nir_instr *instr,
+          union packed_instr header)
+{
+   union packed_dest dest;
+   dest.u8 = header.any.dest;
+
+   if (dest.ssa.is_ssa) {
+      unsigned bit_size = decode_bit_size_3bits(dest.ssa.bit_size);
+      char *name = dest.ssa.has_name ? blob_read_string(ctx->blob) : NULL;
+      nir_ssa_dest_init(instr, dst, dest.ssa.num_components, bit_size, name);
       read_add_object(ctx, &dst->ssa);
    } else {
-      bool is_indirect = val & 0x2;
       dst->reg.reg = read_object(ctx);
-      dst->reg.base_offset = blob_read_uint32(ctx->blob);
-      if (is_indirect) {
+      dst->reg.base_offset = blob_read_uleb128(ctx->blob);
+      if (dest.reg.is_indirect) {
          dst->reg.indirect = ralloc(instr, nir_src);
          read_src(ctx, dst->reg.indirect, instr);
       }
    }
 }
 
+static bool
+is_alu_src_swizzle_identity(const nir_alu_src *src)
+{
+   for (unsigned i = 0; i < NIR_MAX_VEC_COMPONENTS; i++) {
+      if (src->swizzle[i] != i)
+         return false;
+   }
+
+   return true;
+}
+
 static void
 write_alu(write_ctx *ctx, const nir_alu_instr *alu)
 {
-   blob_write_uint32(ctx->blob, alu->op);
-   uint32_t flags = alu->exact;
-   flags |= alu->no_signed_wrap << 1;
-   flags |= alu->no_unsigned_wrap << 2;
-   flags |= alu->dest.saturate << 3;
-   flags |= alu->dest.write_mask << 4;
-   blob_write_uint32(ctx->blob, flags);
+   union packed_instr header;
+   header.u32 = 0;
+
+   STATIC_ASSERT(nir_num_opcodes <= (1 << 9));
+   STATIC_ASSERT(NIR_MAX_VEC_COMPONENTS <= 4);
+
+   header.alu.instr_type = alu->instr.type;
+   header.alu.exact = alu->exact;
+   header.alu.no_signed_wrap = alu->no_signed_wrap;
+   header.alu.no_unsigned_wrap = alu->no_unsigned_wrap;
+   header.alu.saturate = alu->dest.saturate;
+   header.alu.write_mask = alu->dest.write_mask;
+   header.alu.op = alu->op;
 
-   write_dest(ctx, &alu->dest.dest);
+   write_dest(ctx, &alu->dest.dest, header);
 
    for (unsigned i = 0; i < nir_op_infos[alu->op].num_inputs; i++) {
-      write_src(ctx, &alu->src[i].src);
-      flags = alu->src[i].negate;
-      flags |= alu->src[i].abs << 1;
-      for (unsigned j = 0; j < 4; j++)
-         flags |= alu->src[i].swizzle[j] << (2 + 2 * j);
-      blob_write_uint32(ctx->blob, flags);
+      const nir_alu_src *src = &alu->src[i];
+      bool has_swizzle = !is_alu_src_swizzle_identity(src);
+      uint32_t flags = src->negate | src->abs << 1 | has_swizzle << 2;
+
+      write_src_full(ctx, &src->src, flags, 3);
+
+      if (has_swizzle) {
+         uint8_t swizzle = 0;
+         for (unsigned j = 0; j < NIR_MAX_VEC_COMPONENTS; j++) {
+            assert(src->swizzle[j] < 4);
+            swizzle |= src->swizzle[j] << (2 * j);
+         }
+         blob_write_uint8(ctx->blob, swizzle);
+      }
    }
 }
 
 static nir_alu_instr *
-read_alu(read_ctx *ctx)
-{
-   nir_op op = blob_read_uint32(ctx->blob);
-   nir_alu_instr *alu = nir_alu_instr_create(ctx->nir, op);
-
-   uint32_t flags = blob_read_uint32(ctx->blob);
-   alu->exact = flags & 1;
-   alu->no_signed_wrap = flags & 2;
-   alu->no_unsigned_wrap = flags & 4;
-   alu->dest.saturate = flags & 8;
-   alu->dest.write_mask = flags >> 4;
-
-   read_dest(ctx, &alu->dest.dest, &alu->instr);
-
-   for (unsigned i = 0; i < nir_op_infos[op].num_inputs; i++) {
-      read_src(ctx, &alu->src[i].src, &alu->instr);
-      flags = blob_read_uint32(ctx->blob);
-      alu->src[i].negate = flags & 1;
-      alu->src[i].abs = flags & 2;
-      for (unsigned j = 0; j < 4; j++)
-         alu->src[i].swizzle[j] = (flags >> (2 * j + 2)) & 3;
+read_alu(read_ctx *ctx, union packed_instr header)
+{
+   nir_alu_instr *alu = nir_alu_instr_create(ctx->nir, header.alu.op);
+
+   alu->exact = header.alu.exact;
+   alu->no_signed_wrap = header.alu.no_signed_wrap;
+   alu->no_unsigned_wrap = header.alu.no_unsigned_wrap;
+   alu->dest.saturate = header.alu.saturate;
+   alu->dest.write_mask = header.alu.write_mask;
+
+   read_dest(ctx, &alu->dest.dest, &alu->instr, header);
+
+   for (unsigned i = 0; i < nir_op_infos[alu->op].num_inputs; i++) {
+      nir_alu_src *src = &alu->src[i];
+      uint32_t flags = read_src_full(ctx, &src->src, &alu->instr, 3);
+
+      src->negate = flags & 1;
+      src->abs = flags & 2;
+      if (flags & 4) {
+         uint8_t swizzle = blob_read_uint8(ctx->blob);
+         for (unsigned j = 0; j < NIR_MAX_VEC_COMPONENTS; j++)
+            src->swizzle[j] = (swizzle >> (2 * j)) & 3;
+      }
    }
 
    return alu;
@@ -427,12 +702,17 @@ read_alu(read_ctx *ctx)
 static void
 write_deref(write_ctx *ctx, const nir_deref_instr *deref)
 {
-   blob_write_uint32(ctx->blob, deref->deref_type);
+   union packed_instr header;
+   header.u32 = 0;
+
+   assert(deref->mode < (1 << 12));
 
-   blob_write_uint32(ctx->blob, deref->mode);
-   encode_type_to_blob(ctx->blob, deref->type);
+   header.deref.instr_type = deref->instr.type;
+   header.deref.deref_type = deref->deref_type;
+   header.deref.mode = deref->mode;
 
-   write_dest(ctx, &deref->dest);
+   write_dest(ctx, &deref->dest, header);
+   write_type(ctx, deref->type);
 
    if (deref->deref_type == nir_deref_type_var) {
       write_object(ctx, deref->var);
@@ -443,7 +723,7 @@ write_deref(write_ctx *ctx, const nir_deref_instr *deref)
 
    switch (deref->deref_type) {
    case nir_deref_type_struct:
-      blob_write_uint32(ctx->blob, deref->strct.index);
+      blob_write_uleb128(ctx->blob, deref->strct.index);
       break;
 
    case nir_deref_type_array:
@@ -452,7 +732,7 @@ write_deref(write_ctx *ctx, const nir_deref_instr *deref)
       break;
 
    case nir_deref_type_cast:
-      blob_write_uint32(ctx->blob, deref->cast.ptr_stride);
+      blob_write_uleb128(ctx->blob, deref->cast.ptr_stride);
       break;
 
    case nir_deref_type_array_wildcard:
@@ -465,15 +745,15 @@ write_deref(write_ctx *ctx, const nir_deref_instr *deref)
 }
 
 static nir_deref_instr *
-read_deref(read_ctx *ctx)
+read_deref(read_ctx *ctx, union packed_instr header)
 {
-   nir_deref_type deref_type = blob_read_uint32(ctx->blob);
+   nir_deref_type deref_type = header.deref.deref_type;
    nir_deref_instr *deref = nir_deref_instr_create(ctx->nir, deref_type);
 
-   deref->mode = blob_read_uint32(ctx->blob);
-   deref->type = decode_type_from_blob(ctx->blob);
+   deref->mode = header.deref.mode;
 
-   read_dest(ctx, &deref->dest, &deref->instr);
+   read_dest(ctx, &deref->dest, &deref->instr, header);
+   deref->type = read_type(ctx);
 
    if (deref_type == nir_deref_type_var) {
       deref->var = read_object(ctx);
@@ -484,7 +764,7 @@ read_deref(read_ctx *ctx)
 
    switch (deref->deref_type) {
    case nir_deref_type_struct:
-      deref->strct.index = blob_read_uint32(ctx->blob);
+      deref->strct.index = blob_read_uleb128(ctx->blob);
       break;
 
    case nir_deref_type_array:
@@ -493,7 +773,7 @@ read_deref(read_ctx *ctx)
       break;
 
    case nir_deref_type_cast:
-      deref->cast.ptr_stride = blob_read_uint32(ctx->blob);
+      deref->cast.ptr_stride = blob_read_uleb128(ctx->blob);
       break;
 
    case nir_deref_type_array_wildcard:
@@ -510,66 +790,177 @@ read_deref(read_ctx *ctx)
 static void
 write_intrinsic(write_ctx *ctx, const nir_intrinsic_instr *intrin)
 {
-   blob_write_uint32(ctx->blob, intrin->intrinsic);
+   union packed_instr header;
+   header.u32 = 0;
+
+   STATIC_ASSERT(nir_num_intrinsics <= (1 << 9));
+
+   header.intrinsic.instr_type = intrin->instr.type;
+   header.intrinsic.intrinsic = intrin->intrinsic;
+   header.intrinsic.num_components = intrin->num_components;
 
    unsigned num_srcs = nir_intrinsic_infos[intrin->intrinsic].num_srcs;
    unsigned num_indices = nir_intrinsic_infos[intrin->intrinsic].num_indices;
 
-   blob_write_uint32(ctx->blob, intrin->num_components);
-
    if (nir_intrinsic_infos[intrin->intrinsic].has_dest)
-      write_dest(ctx, &intrin->dest);
+      write_dest(ctx, &intrin->dest, header);
+   else
+      write_instr_header(ctx, header);
 
    for (unsigned i = 0; i < num_srcs; i++)
       write_src(ctx, &intrin->src[i]);
 
    for (unsigned i = 0; i < num_indices; i++)
-      blob_write_uint32(ctx->blob, intrin->const_index[i]);
+      blob_write_uleb128(ctx->blob, intrin->const_index[i]);
 }
 
 static nir_intrinsic_instr *
-read_intrinsic(read_ctx *ctx)
+read_intrinsic(read_ctx *ctx, union packed_instr header)
 {
-   nir_intrinsic_op op = blob_read_uint32(ctx->blob);
-
+   nir_intrinsic_op op = header.intrinsic.intrinsic;
    nir_intrinsic_instr *intrin = nir_intrinsic_instr_create(ctx->nir, op);
 
    unsigned num_srcs = nir_intrinsic_infos[op].num_srcs;
    unsigned num_indices = nir_intrinsic_infos[op].num_indices;
 
-   intrin->num_components = blob_read_uint32(ctx->blob);
+   intrin->num_components = header.intrinsic.num_components;
 
    if (nir_intrinsic_infos[op].has_dest)
-      read_dest(ctx, &intrin->dest, &intrin->instr);
+      read_dest(ctx, &intrin->dest, &intrin->instr, header);
 
    for (unsigned i = 0; i < num_srcs; i++)
       read_src(ctx, &intrin->src[i], &intrin->instr);
 
    for (unsigned i = 0; i < num_indices; i++)
-      intrin->const_index[i] = blob_read_uint32(ctx->blob);
+      intrin->const_index[i] = blob_read_uleb128(ctx->blob);
 
    return intrin;
 }
 
+/* Only the bits that are meaningful for the bit size are stored, compared
+ * and hashed.
+ */
+static unsigned
+const_value_size(unsigned bit_size)
+{
+   return bit_size == 1 ? sizeof(bool) : bit_size / 8;
+}
+
+static const void *
+const_value_data(const nir_const_value *value, unsigned bit_size)
+{
+   switch (bit_size) {
+   case 1:  return &value->b;
+   case 8:  return &value->u8;
+   case 16: return &value->u16;
+   case 32: return &value->u32;
+   case 64: return &value->u64;
+   default:
+      unreachable("Invalid bit size");
+   }
+}
+
+static uint32_t
+hash_load_const(const void *key)
+{
+   const nir_load_const_instr *lc = key;
+   uint32_t hash = _mesa_fnv32_1a_offset_bias;
+
+   hash = _mesa_fnv32_1a_accumulate(hash, lc->def.num_components);
+   hash = _mesa_fnv32_1a_accumulate(hash, lc->def.bit_size);
+   for (unsigned i = 0; i < lc->def.num_components; i++) {
+      hash = _mesa_fnv32_1a_accumulate_block(hash,
+         const_value_data(&lc->value[i], lc->def.bit_size),
+         const_value_size(lc->def.bit_size));
+   }
+
+   return hash;
+}
+
+static bool
+load_consts_equal(const void *a, const void *b)
+{
+   const nir_load_const_instr *lc1 = a, *lc2 = b;
+
+   if (lc1->def.num_components != lc2->def.num_components ||
+       lc1->def.bit_size != lc2->def.bit_size)
+      return false;
+
+   unsigned bit_size = lc1->def.bit_size;
+   for (unsigned i = 0; i < lc1->def.num_components; i++) {
+      if (memcmp(const_value_data(&lc1->value[i], bit_size),
+                 const_value_data(&lc2->value[i], bit_size),
+                 const_value_size(bit_size)) != 0)
+         return false;
+   }
+
+   return true;
+}
+
 static void
 write_load_const(write_ctx *ctx, const nir_load_const_instr *lc)
 {
-   uint32_t val = lc->def.num_components;
-   val |= lc->def.bit_size << 3;
-   blob_write_uint32(ctx->blob, val);
-   blob_write_bytes(ctx->blob, lc->value, sizeof(*lc->value) * lc->def.num_components);
+   union packed_instr header;
+   header.u32 = 0;
+
+   header.load_const.instr_type = lc->instr.type;
+   header.load_const.num_components = lc->def.num_components;
+   header.load_const.bit_size = encode_bit_size_3bits(lc->def.bit_size);
+
+   /* Shaders tend to load the same few constants in many places, so only
+    * the first load_const of each value stores it.
+    */
+   uint32_t hash = hash_load_const(lc);
+   struct hash_entry *entry =
+      _mesa_hash_table_search_pre_hashed(ctx->const_table, hash, lc);
+
+   header.load_const.is_duplicate = entry != NULL;
+   write_instr_header(ctx, header);
+
+   if (entry) {
+      blob_write_uleb128(ctx->blob, (uint32_t)(uintptr_t) entry->data);
+   } else {
+      uint32_t index = ctx->next_const_idx++;
+      _mesa_hash_table_insert_pre_hashed(ctx->const_table, hash, lc,
+                                         (void *)(uintptr_t) index);
+
+      for (unsigned i = 0; i < lc->def.num_components; i++) {
+         blob_write_bytes(ctx->blob,
+                          const_value_data(&lc->value[i], lc->def.bit_size),
+                          const_value_size(lc->def.bit_size));
+      }
+   }
+
    write_add_object(ctx, &lc->def);
 }
 
 static nir_load_const_instr *
-read_load_const(read_ctx *ctx)
+read_load_const(read_ctx *ctx, union packed_instr header)
 {
-   uint32_t val = blob_read_uint32(ctx->blob);
-
+   unsigned bit_size = decode_bit_size_3bits(header.load_const.bit_size);
    nir_load_const_instr *lc =
-      nir_load_const_instr_create(ctx->nir, val & 0x7, val >> 3);
+      nir_load_const_instr_create(ctx->nir, header.load_const.num_components,
+                                  bit_size);
+
+   if (header.load_const.is_duplicate) {
+      uint32_t index = blob_read_uleb128(ctx->blob);
+      if (index >= util_dynarray_num_elements(&ctx->consts,
+                                              nir_load_const_instr *))
+         read_fail(ctx);
+      const nir_load_const_instr *orig =
+         *util_dynarray_element(&ctx->consts, nir_load_const_instr *, index);
+      memcpy(lc->value, orig->value,
+             sizeof(*lc->value) * lc->def.num_components);
+   } else {
+      util_dynarray_append(&ctx->consts, nir_load_const_instr *, lc);
+
+      for (unsigned i = 0; i < lc->def.num_components; i++) {
+         blob_copy_bytes(ctx->blob,
+                         (void *)const_value_data(&lc->value[i], bit_size),
+                         const_value_size(bit_size));
+      }
+   }
 
-   blob_copy_bytes(ctx->blob, lc->value, sizeof(*lc->value) * lc->def.num_components);
    read_add_object(ctx, &lc->def);
    return lc;
 }
@@ -577,19 +968,23 @@ read_load_const(read_ctx *ctx)
 static void
 write_ssa_undef(write_ctx *ctx, const nir_ssa_undef_instr *undef)
 {
-   uint32_t val = undef->def.num_components;
-   val |= undef->def.bit_size << 3;
-   blob_write_uint32(ctx->blob, val);
+   union packed_instr header;
+   header.u32 = 0;
+
+   header.undef.instr_type = undef->instr.type;
+   header.undef.num_components = undef->def.num_components;
+   header.undef.bit_size = encode_bit_size_3bits(undef->def.bit_size);
+   write_instr_header(ctx, header);
+
    write_add_object(ctx, &undef->def);
 }
 
 static nir_ssa_undef_instr *
-read_ssa_undef(read_ctx *ctx)
+read_ssa_undef(read_ctx *ctx, union packed_instr header)
 {
-   uint32_t val = blob_read_uint32(ctx->blob);
-
    nir_ssa_undef_instr *undef =
-      nir_ssa_undef_instr_create(ctx->nir, val & 0x7, val >> 3);
+      nir_ssa_undef_instr_create(ctx->nir, header.undef.num_components,
+                                 decode_bit_size_3bits(header.undef.bit_size));
 
    read_add_object(ctx, &undef->def);
    return undef;
@@ -612,12 +1007,23 @@ union packed_tex_data {
 static void
 write_tex(write_ctx *ctx, const nir_tex_instr *tex)
 {
-   blob_write_uint32(ctx->blob, tex->num_srcs);
-   blob_write_uint32(ctx->blob, tex->op);
-   blob_write_uint32(ctx->blob, tex->texture_index);
-   blob_write_uint32(ctx->blob, tex->texture_array_size);
-   blob_write_uint32(ctx->blob, tex->sampler_index);
-   blob_write_bytes(ctx->blob, tex->tg4_offsets, sizeof(tex->tg4_offsets));
+   union packed_instr header;
+   header.u32 = 0;
+
+   assert(tex->num_srcs < (1 << 4));
+   STATIC_ASSERT(nir_texop_samples_identical < (1 << 4));
+
+   header.tex.instr_type = tex->instr.type;
+   header.tex.num_srcs = tex->num_srcs;
+   header.tex.op = tex->op;
+
+   write_dest(ctx, &tex->dest, header);
+
+   blob_write_uleb128(ctx->blob, tex->texture_index);
+   blob_write_uleb128(ctx->blob, tex->texture_array_size);
+   blob_write_uleb128(ctx->blob, tex->sampler_index);
+   if (tex->op == nir_texop_tg4)
+      blob_write_bytes(ctx->blob, tex->tg4_offsets, sizeof(tex->tg4_offsets));
 
    STATIC_ASSERT(sizeof(union packed_tex_data) == sizeof(uint32_t));
    union packed_tex_data packed = {
@@ -629,29 +1035,31 @@ write_tex(write_ctx *ctx, const nir_tex_instr *tex)
       .u.is_new_style_shadow = tex->is_new_style_shadow,
       .u.component = tex->component,
    };
-   blob_write_uint32(ctx->blob, packed.u32);
+   blob_write_bytes(ctx->blob, &packed.u32, sizeof(packed.u32));
 
-   write_dest(ctx, &tex->dest);
    for (unsigned i = 0; i < tex->num_srcs; i++) {
-      blob_write_uint32(ctx->blob, tex->src[i].src_type);
+      blob_write_uint8(ctx->blob, tex->src[i].src_type);
       write_src(ctx, &tex->src[i].src);
    }
 }
 
 static nir_tex_instr *
-read_tex(read_ctx *ctx)
+read_tex(read_ctx *ctx, union packed_instr header)
 {
-   unsigned num_srcs = blob_read_uint32(ctx->blob);
-   nir_tex_instr *tex = nir_tex_instr_create(ctx->nir, num_srcs);
+   nir_tex_instr *tex = nir_tex_instr_create(ctx->nir, header.tex.num_srcs);
+
+   tex->op = header.tex.op;
 
-   tex->op = blob_read_uint32(ctx->blob);
-   tex->texture_index = blob_read_uint32(ctx->blob);
-   tex->texture_array_size = blob_read_uint32(ctx->blob);
-   tex->sampler_index = blob_read_uint32(ctx->blob);
-   blob_copy_bytes(ctx->blob, tex->tg4_offsets, sizeof(tex->tg4_offsets));
+   read_dest(ctx, &tex->dest, &tex->instr, header);
+
+   tex->texture_index = blob_read_uleb128(ctx->blob);
+   tex->texture_array_size = blob_read_uleb128(ctx->blob);
+   tex->sampler_index = blob_read_uleb128(ctx->blob);
+   if (tex->op == nir_texop_tg4)
+      blob_copy_bytes(ctx->blob, tex->tg4_offsets, sizeof(tex->tg4_offsets));
 
    union packed_tex_data packed;
-   packed.u32 = blob_read_uint32(ctx->blob);
+   blob_copy_bytes(ctx->blob, &packed.u32, sizeof(packed.u32));
    tex->sampler_dim = packed.u.sampler_dim;
    tex->dest_type = packed.u.dest_type;
    tex->coord_components = packed.u.coord_components;
@@ -660,9 +1068,8 @@ read_tex(read_ctx *ctx)
    tex->is_new_style_shadow = packed.u.is_new_style_shadow;
    tex->component = packed.u.component;
 
-   read_dest(ctx, &tex->dest, &tex->instr);
    for (unsigned i = 0; i < tex->num_srcs; i++) {
-      tex->src[i].src_type = blob_read_uint32(ctx->blob);
+      tex->src[i].src_type = blob_read_uint8(ctx->blob);
       read_src(ctx, &tex->src[i].src, &tex->instr);
    }
 
@@ -672,20 +1079,22 @@ read_tex(read_ctx *ctx)
 static void
 write_phi(write_ctx *ctx, const nir_phi_instr *phi)
 {
+   union packed_instr header;
+   header.u32 = 0;
+
+   header.phi.instr_type = phi->instr.type;
+   header.phi.num_srcs = exec_list_length(&phi->srcs);
+
    /* Phi nodes are special, since they may reference SSA definitions and
-    * basic blocks that don't exist yet. We leave two empty uintptr_t's here,
+    * basic blocks that don't exist yet. We leave two empty uint32_t's here,
     * and then store enough information so that a later fixup pass can fill
     * them in correctly.
     */
-   write_dest(ctx, &phi->dest);
-
-   blob_write_uint32(ctx->blob, exec_list_length(&phi->srcs));
+   write_dest(ctx, &phi->dest, header);
 
    nir_foreach_phi_src(src, phi) {
       assert(src->src.is_ssa);
-      size_t blob_offset = blob_reserve_intptr(ctx->blob);
-      MAYBE_UNUSED size_t blob_offset2 = blob_reserve_intptr(ctx->blob);
-      assert(blob_offset + sizeof(uintptr_t) == blob_offset2);
+      size_t blob_offset = blob_reserve_bytes(ctx->blob, 2 * sizeof(uint32_t));
       write_phi_fixup fixup = {
          .blob_offset = blob_offset,
          .src = src->src.ssa,
@@ -699,22 +1108,22 @@ static void
 write_fixup_phis(write_ctx *ctx)
 {
    util_dynarray_foreach(&ctx->phi_fixups, write_phi_fixup, fixup) {
-      uintptr_t *blob_ptr = (uintptr_t *)(ctx->blob->data + fixup->blob_offset);
-      blob_ptr[0] = write_lookup_object(ctx, fixup->src);
-      blob_ptr[1] = write_lookup_object(ctx, fixup->block);
+      uint32_t vals[2] = {
+         write_lookup_object(ctx, fixup->src),
+         write_lookup_object(ctx, fixup->block),
+      };
+      blob_overwrite_bytes(ctx->blob, fixup->blob_offset, vals, sizeof(vals));
    }
 
    util_dynarray_clear(&ctx->phi_fixups);
 }
 
 static nir_phi_instr *
-read_phi(read_ctx *ctx, nir_block *blk)
+read_phi(read_ctx *ctx, nir_block *blk, union packed_instr header)
 {
    nir_phi_instr *phi = nir_phi_instr_create(ctx->nir);
 
-   read_dest(ctx, &phi->dest, &phi->instr);
-
-   unsigned num_srcs = blob_read_uint32(ctx->blob);
+   read_dest(ctx, &phi->dest, &phi->instr, header);
 
    /* For similar reasons as before, we just store the index directly into the
     * pointer, and let a later pass resolve the phi sources.
@@ -726,12 +1135,16 @@ read_phi(read_ctx *ctx, nir_block *blk)
     */
    nir_instr_insert_after_block(blk, &phi->instr);
 
-   for (unsigned i = 0; i < num_srcs; i++) {
+   for (unsigned i = 0; i < header.phi.num_srcs; i++) {
       nir_phi_src *src = ralloc(phi, nir_phi_src);
+      uint32_t vals[2];
+
+      blob_copy_bytes(ctx->blob, vals, sizeof(vals));
+      read_check(ctx);
 
       src->src.is_ssa = true;
-      src->src.ssa = (nir_ssa_def *) blob_read_intptr(ctx->blob);
-      src->pred = (nir_block *) blob_read_intptr(ctx->blob);
+      src->src.ssa = (nir_ssa_def *)(uintptr_t) vals[0];
+      src->pred = (nir_block *)(uintptr_t) vals[1];
 
       /* Since we're not letting nir_insert_instr handle use/def stuff for us,
        * we have to set the parent_instr manually.  It doesn't really matter
@@ -768,21 +1181,31 @@ read_fixup_phis(read_ctx *ctx)
 static void
 write_jump(write_ctx *ctx, const nir_jump_instr *jmp)
 {
-   blob_write_uint32(ctx->blob, jmp->type);
+   union packed_instr header;
+   header.u32 = 0;
+
+   header.jump.instr_type = jmp->instr.type;
+   header.jump.type = jmp->type;
+   write_instr_header(ctx, header);
 }
 
 static nir_jump_instr *
-read_jump(read_ctx *ctx)
+read_jump(read_ctx *ctx, union packed_instr header)
 {
-   nir_jump_type type = blob_read_uint32(ctx->blob);
-   nir_jump_instr *jmp = nir_jump_instr_create(ctx->nir, type);
+   nir_jump_instr *jmp = nir_jump_instr_create(ctx->nir, header.jump.type);
    return jmp;
 }
 
 static void
 write_call(write_ctx *ctx, const nir_call_instr *call)
 {
-   blob_write_intptr(ctx->blob, write_lookup_object(ctx, call->callee));
+   union packed_instr header;
+   header.u32 = 0;
+
+   header.any.instr_type = call->instr.type;
+   write_instr_header(ctx, header);
+
+   write_object(ctx, call->callee);
 
    for (unsigned i = 0; i < call->num_params; i++)
       write_src(ctx, &call->params[i]);
@@ -803,7 +1226,9 @@ read_call(read_ctx *ctx)
 static void
 write_instr(write_ctx *ctx, const nir_instr *instr)
 {
-   blob_write_uint32(ctx->blob, instr->type);
+   /* Every instruction starts with a 32-bit header holding its type, most
+    * of its fields and its destination, if any.
+    */
    switch (instr->type) {
    case nir_instr_type_alu:
       write_alu(ctx, nir_instr_as_alu(instr));
@@ -842,26 +1267,29 @@ write_instr(write_ctx *ctx, const nir_instr *instr)
 static void
 read_instr(read_ctx *ctx, nir_block *block)
 {
-   nir_instr_type type = blob_read_uint32(ctx->blob);
+   union packed_instr header;
+   blob_copy_bytes(ctx->blob, &header.u32, sizeof(header.u32));
+   read_check(ctx);
+
    nir_instr *instr;
-   switch (type) {
+   switch (header.any.instr_type) {
    case nir_instr_type_alu:
-      instr = &read_alu(ctx)->instr;
+      instr = &read_alu(ctx, header)->instr;
       break;
    case nir_instr_type_deref:
-      instr = &read_deref(ctx)->instr;
+      instr = &read_deref(ctx, header)->instr;
       break;
    case nir_instr_type_intrinsic:
-      instr = &read_intrinsic(ctx)->instr;
+      instr = &read_intrinsic(ctx, header)->instr;
       break;
    case nir_instr_type_load_const:
-      instr = &read_load_const(ctx)->instr;
+      instr = &read_load_const(ctx, header)->instr;
       break;
    case nir_instr_type_ssa_undef:
-      instr = &read_ssa_undef(ctx)->instr;
+      instr = &read_ssa_undef(ctx, header)->instr;
       break;
    case nir_instr_type_tex:
-      instr = &read_tex(ctx)->instr;
+      instr = &read_tex(ctx, header)->instr;
       break;
    case nir_instr_type_phi:
       /* Phi instructions are a bit of a special case when reading because we
@@ -869,18 +1297,17 @@ read_instr(read_ctx *ctx, nir_block *block)
        * for us.  Instead, we need to wait until all the blocks/instructions
        * are read so that we can set their sources up.
        */
-      read_phi(ctx, block);
+      read_phi(ctx, block, header);
       return;
    case nir_instr_type_jump:
-      instr = &read_jump(ctx)->instr;
+      instr = &read_jump(ctx, header)->instr;
       break;
    case nir_instr_type_call:
       instr = &read_call(ctx)->instr;
       break;
-   case nir_instr_type_parallel_copy:
-      unreachable("Cannot read parallel copies");
    default:
-      unreachable("bad instr type");
+      /* Parallel copies are never serialized. */
+      read_fail(ctx);
    }
 
    nir_instr_insert_after_block(block, instr);
@@ -890,7 +1317,7 @@ static void
 write_block(write_ctx *ctx, const nir_block *block)
 {
    write_add_object(ctx, block);
-   blob_write_uint32(ctx->blob, exec_list_length(&block->instr_list));
+   blob_write_uleb128(ctx->blob, exec_list_length(&block->instr_list));
    nir_foreach_instr(instr, block)
       write_instr(ctx, instr);
 }
@@ -906,7 +1333,7 @@ read_block(read_ctx *ctx, struct exec_list *cf_list)
       exec_node_data(nir_block, exec_list_get_tail(cf_list), cf_node.node);
 
    read_add_object(ctx, block);
-   unsigned num_instrs = blob_read_uint32(ctx->blob);
+   unsigned num_instrs = blob_read_uleb128(ctx->blob);
    for (unsigned i = 0; i < num_instrs; i++) {
       read_instr(ctx, block);
    }
@@ -959,7 +1386,7 @@ read_loop(read_ctx *ctx, struct exec_list *cf_list)
 static void
 write_cf_node(write_ctx *ctx, nir_cf_node *cf)
 {
-   blob_write_uint32(ctx->blob, cf->type);
+   blob_write_uint8(ctx->blob, cf->type);
 
    switch (cf->type) {
    case nir_cf_node_block:
@@ -979,7 +1406,8 @@ write_cf_node(write_ctx *ctx, nir_cf_node *cf)
 static void
 read_cf_node(read_ctx *ctx, struct exec_list *list)
 {
-   nir_cf_node_type type = blob_read_uint32(ctx->blob);
+   nir_cf_node_type type = blob_read_uint8(ctx->blob);
+   read_check(ctx);
 
    switch (type) {
    case nir_cf_node_block:
@@ -992,14 +1420,14 @@ read_cf_node(read_ctx *ctx, struct exec_list *list)
       read_loop(ctx, list);
       break;
    default:
-      unreachable("bad cf type");
+      read_fail(ctx);
    }
 }
 
 static void
 write_cf_list(write_ctx *ctx, const struct exec_list *cf_list)
 {
-   blob_write_uint32(ctx->blob, exec_list_length(cf_list));
+   blob_write_uleb128(ctx->blob, exec_list_length(cf_list));
    foreach_list_typed(nir_cf_node, cf, node, cf_list) {
       write_cf_node(ctx, cf);
    }
@@ -1008,7 +1436,7 @@ write_cf_list(write_ctx *ctx, const struct exec_list *cf_list)
 static void
 read_cf_list(read_ctx *ctx, struct exec_list *cf_list)
 {
-   uint32_t num_cf_nodes = blob_read_uint32(ctx->blob);
+   uint32_t num_cf_nodes = blob_read_uleb128(ctx->blob);
    for (unsigned i = 0; i < num_cf_nodes; i++)
       read_cf_node(ctx, cf_list);
 }
@@ -1018,7 +1446,7 @@ write_function_impl(write_ctx *ctx, const nir_function_impl *fi)
 {
    write_var_list(ctx, &fi->locals);
    write_reg_list(ctx, &fi->registers);
-   blob_write_uint32(ctx->blob, fi->reg_alloc);
+   blob_write_uleb128(ctx->blob, fi->reg_alloc);
 
    write_cf_list(ctx, &fi->body);
    write_fixup_phis(ctx);
@@ -1032,7 +1460,7 @@ read_function_impl(read_ctx *ctx, nir_function *fxn)
 
    read_var_list(ctx, &fi->locals);
    read_reg_list(ctx, &fi->registers);
-   fi->reg_alloc = blob_read_uint32(ctx->blob);
+   fi->reg_alloc = blob_read_uleb128(ctx->blob);
 
    read_cf_list(ctx, &fi->body);
    read_fixup_phis(ctx);
@@ -1045,22 +1473,21 @@ read_function_impl(read_ctx *ctx, nir_function *fxn)
 static void
 write_function(write_ctx *ctx, const nir_function *fxn)
 {
-   blob_write_uint32(ctx->blob, !!(fxn->name));
+   uint8_t flags = (fxn->name != NULL) |
+                   (fxn->is_entrypoint << 1) |
+                   ((fxn->impl != NULL) << 2);
+   blob_write_uint8(ctx->blob, flags);
    if (fxn->name)
       blob_write_string(ctx->blob, fxn->name);
 
    write_add_object(ctx, fxn);
 
-   blob_write_uint32(ctx->blob, fxn->num_params);
+   blob_write_uleb128(ctx->blob, fxn->num_params);
    for (unsigned i = 0; i < fxn->num_params; i++) {
-      uint32_t val =
-         ((uint32_t)fxn->params[i].num_components) |
-         ((uint32_t)fxn->params[i].bit_size) << 8;
-      blob_write_uint32(ctx->blob, val);
+      blob_write_uint8(ctx->blob, fxn->params[i].num_components);
+      blob_write_uint8(ctx->blob, fxn->params[i].bit_size);
    }
 
-   blob_write_uint32(ctx->blob, fxn->is_entrypoint);
-
    /* At first glance, it looks like we should write the function_impl here.
     * However, call instructions need to be able to reference at least the
     * function and those will get processed as we write the function_impls.
@@ -1071,24 +1498,39 @@ write_function(write_ctx *ctx, const nir_function *fxn)
 static void
 read_function(read_ctx *ctx)
 {
-   bool has_name = blob_read_uint32(ctx->blob);
-   char *name = has_name ? blob_read_string(ctx->blob) : NULL;
+   uint8_t flags = blob_read_uint8(ctx->blob);
+   char *name = (flags & 0x1) ? blob_read_string(ctx->blob) : NULL;
 
    nir_function *fxn = nir_function_create(ctx->nir, name);
 
    read_add_object(ctx, fxn);
 
-   fxn->num_params = blob_read_uint32(ctx->blob);
+   fxn->num_params = blob_read_uleb128(ctx->blob);
+   read_check(ctx);
    fxn->params = ralloc_array(fxn, nir_parameter, fxn->num_params);
    for (unsigned i = 0; i < fxn->num_params; i++) {
-      uint32_t val = blob_read_uint32(ctx->blob);
-      fxn->params[i].num_components = val & 0xff;
-      fxn->params[i].bit_size = (val >> 8) & 0xff;
+      fxn->params[i].num_components = blob_read_uint8(ctx->blob);
+      fxn->params[i].bit_size = blob_read_uint8(ctx->blob);
    }
 
-   fxn->is_entrypoint = blob_read_uint32(ctx->blob);
+   fxn->is_entrypoint = flags & 0x2;
+
+   /* Functions with an impl get a non-NULL placeholder so that the second
+    * pass knows which ones to read.
+    */
+   if (flags & 0x4)
+      fxn->impl = NIR_SERIALIZE_FUNC_HAS_IMPL;
 }
 
+/**
+ * Serialize NIR into a compact binary blob.
+ *
+ * The blob starts with a magic number and a format version, followed by the
+ * number of objects (variables, registers, SSA values, blocks and functions)
+ * that the deserializer needs to allocate its index table for.  Instructions
+ * are stored as a 32-bit header plus variable-length integers; see
+ * write_instr().
+ */
 void
 nir_serialize(struct blob *blob, const nir_shader *nir)
 {
@@ -1098,8 +1540,15 @@ nir_serialize(struct blob *blob, const nir_shader *nir)
    ctx.blob = blob;
    ctx.nir = nir;
    util_dynarray_init(&ctx.phi_fixups, NULL);
+   ctx.type_table = _mesa_pointer_hash_table_create(NULL);
+   ctx.next_type_idx = 0;
+   ctx.const_table = _mesa_hash_table_create(NULL, hash_load_const,
+                                             load_consts_equal);
+   ctx.next_const_idx = 0;
 
-   size_t idx_size_offset = blob_reserve_intptr(blob);
+   blob_write_uint32(blob, NIR_SERIALIZE_MAGIC);
+   blob_write_uint32(blob, NIR_SERIALIZE_VERSION);
+   size_t idx_size_offset = blob_reserve_uint32(blob);
 
    struct shader_info info = nir->info;
    uint32_t strings = 0;
@@ -1107,7 +1556,7 @@ nir_serialize(struct blob *blob, const nir_shader *nir)
       strings |= 0x1;
    if (info.label)
       strings |= 0x2;
-   blob_write_uint32(blob, strings);
+   blob_write_uint8(blob, strings);
    if (info.name)
       blob_write_string(blob, info.name);
    if (info.label)
@@ -1122,28 +1571,31 @@ nir_serialize(struct blob *blob, const nir_shader *nir)
    write_var_list(&ctx, &nir->globals);
    write_var_list(&ctx, &nir->system_values);
 
-   blob_write_uint32(blob, nir->num_inputs);
-   blob_write_uint32(blob, nir->num_uniforms);
-   blob_write_uint32(blob, nir->num_outputs);
-   blob_write_uint32(blob, nir->num_shared);
-   blob_write_uint32(blob, nir->scratch_size);
+   blob_write_uleb128(blob, nir->num_inputs);
+   blob_write_uleb128(blob, nir->num_uniforms);
+   blob_write_uleb128(blob, nir->num_outputs);
+   blob_write_uleb128(blob, nir->num_shared);
+   blob_write_uleb128(blob, nir->scratch_size);
 
-   blob_write_uint32(blob, exec_list_length(&nir->functions));
+   blob_write_uleb128(blob, exec_list_length(&nir->functions));
    nir_foreach_function(fxn, nir) {
       write_function(&ctx, fxn);
    }
 
    nir_foreach_function(fxn, nir) {
-      write_function_impl(&ctx, fxn->impl);
+      if (fxn->impl)
+         write_function_impl(&ctx, fxn->impl);
    }
 
-   blob_write_uint32(blob, nir->constant_data_size);
+   blob_write_uleb128(blob, nir->constant_data_size);
    if (nir->constant_data_size > 0)
       blob_write_bytes(blob, nir->constant_data, nir->constant_data_size);
 
-   *(uintptr_t *)(blob->data + idx_size_offset) = ctx.next_idx;
+   blob_overwrite_uint32(blob, idx_size_offset, ctx.next_idx);
 
    _mesa_hash_table_destroy(ctx.remap_table, NULL);
+   _mesa_hash_table_destroy(ctx.type_table, NULL);
+   _mesa_hash_table_destroy(ctx.const_table, NULL);
    util_dynarray_fini(&ctx.phi_fixups);
 }
 
@@ -1153,21 +1605,49 @@ nir_deserialize(void *mem_ctx,
                 struct blob_reader *blob)
 {
    read_ctx ctx;
+
+   if (blob_read_uint32(blob) != NIR_SERIALIZE_MAGIC ||
+       blob_read_uint32(blob) != NIR_SERIALIZE_VERSION)
+      return NULL;
+
    ctx.blob = blob;
    list_inithead(&ctx.phi_srcs);
-   ctx.idx_table_len = blob_read_intptr(blob);
-   ctx.idx_table = calloc(ctx.idx_table_len, sizeof(uintptr_t));
+   ctx.idx_table_len = blob_read_uint32(blob);
    ctx.next_idx = 0;
 
-   uint32_t strings = blob_read_uint32(blob);
+   uint32_t strings = blob_read_uint8(blob);
    char *name = (strings & 0x1) ? blob_read_string(blob) : NULL;
    char *label = (strings & 0x2) ? blob_read_string(blob) : NULL;
 
    struct shader_info info;
    blob_copy_bytes(blob, (uint8_t *) &info, sizeof(info));
+   if (blob->overrun)
+      return NULL;
+
+   /* Every indexed object takes at least one byte of what is left, so a
+    * larger table can only come from a corrupt blob.
+    */
+   if (ctx.idx_table_len > (uintptr_t) (blob->end - blob->current))
+      return NULL;
+
+   ctx.idx_table = calloc(ctx.idx_table_len, sizeof(uintptr_t));
+   if (ctx.idx_table == NULL && ctx.idx_table_len > 0)
+      return NULL;
 
    ctx.nir = nir_shader_create(mem_ctx, info.stage, options, NULL);
 
+   /* Allocate the tables out of the shader so that bailing out below only
+    * has to free the shader and the index table.
+    */
+   util_dynarray_init(&ctx.types, ctx.nir);
+   util_dynarray_init(&ctx.consts, ctx.nir);
+
+   if (setjmp(ctx.fail_jump)) {
+      free(ctx.idx_table);
+      ralloc_free(ctx.nir);
+      return NULL;
+   }
+
    info.name = name ? ralloc_strdup(ctx.nir, name) : NULL;
    info.label = label ? ralloc_strdup(ctx.nir, label) : NULL;
 
@@ -1180,20 +1660,24 @@ nir_deserialize(void *mem_ctx,
    read_var_list(&ctx, &ctx.nir->globals);
    read_var_list(&ctx, &ctx.nir->system_values);
 
-   ctx.nir->num_inputs = blob_read_uint32(blob);
-   ctx.nir->num_uniforms = blob_read_uint32(blob);
-   ctx.nir->num_outputs = blob_read_uint32(blob);
-   ctx.nir->num_shared = blob_read_uint32(blob);
-   ctx.nir->scratch_size = blob_read_uint32(blob);
+   ctx.nir->num_inputs = blob_read_uleb128(blob);
+   ctx.nir->num_uniforms = blob_read_uleb128(blob);
+   ctx.nir->num_outputs = blob_read_uleb128(blob);
+   ctx.nir->num_shared = blob_read_uleb128(blob);
+   ctx.nir->scratch_size = blob_read_uleb128(blob);
 
-   unsigned num_functions = blob_read_uint32(blob);
-   for (unsigned i = 0; i < num_functions; i++)
+   unsigned num_functions = blob_read_uleb128(blob);
+   for (unsigned i = 0; i < num_functions; i++) {
+      read_check(&ctx);
       read_function(&ctx);
+   }
 
-   nir_foreach_function(fxn, ctx.nir)
-      fxn->impl = read_function_impl(&ctx, fxn);
+   nir_foreach_function(fxn, ctx.nir) {
+      if (fxn->impl == NIR_SERIALIZE_FUNC_HAS_IMPL)
+         fxn->impl = read_function_impl(&ctx, fxn);
+   }
 
-   ctx.nir->constant_data_size = blob_read_uint32(blob);
+   ctx.nir->constant_data_size = blob_read_uleb128(blob);
    if (ctx.nir->constant_data_size > 0) {
       ctx.nir->constant_data =
          ralloc_size(ctx.nir, ctx.nir->constant_data_size);
@@ -1202,6 +1686,13 @@ nir_deserialize(void *mem_ctx,
    }
 
    free(ctx.idx_table);
+   util_dynarray_fini(&ctx.types);
+   util_dynarray_fini(&ctx.consts);
+
+   if (blob->overrun) {
+      ralloc_free(ctx.nir);
+      return NULL;
+   }
 
    return ctx.nir;
 }
@@ -1225,6 +1716,7 @@ nir_shader_serialize_deserialize(nir_shader *shader)
    struct blob_reader reader;
    blob_reader_init(&reader, writer.data, writer.size);
    nir_shader *copy = nir_deserialize(dead_ctx, options, &reader);
+   assert(copy);
 
    blob_finish(&writer);
 
@@ -32,6 +32,11 @@ extern "C" {
 #endif
 
 void nir_serialize(struct blob *blob, const nir_shader *nir);
+
+/**
+ * Returns NULL if the blob was written by a different version of the
+ * serializer, is truncated or refers to objects it does not contain.
+ */
 nir_shader *nir_deserialize(void *mem_ctx,
                             const struct nir_shader_compiler_options *options,
                             struct blob_reader *blob);
@@ -0,0 +1,247 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include "nir.h"
+#include "nir_builder.h"
+
+namespace {
+
+class nir_divergence_test : public ::testing::Test {
+protected:
+   nir_divergence_test();
+   ~nir_divergence_test();
+
+   /* Returns a copy of x that survives nir_lower_vars_to_ssa */
+   nir_ssa_def *keep(nir_ssa_def *x) {
+      return nir_iadd(b, x, nir_imm_int(b, 0));
+   }
+
+   nir_ssa_def *read_first_invocation(nir_ssa_def *x);
+
+   void run();
+
+   void *mem_ctx;
+   nir_builder *b;
+
+   nir_ssa_def *uniform;
+   nir_ssa_def *divergent;
+
+   nir_variable *out;
+   nir_variable *var;
+};
+
+nir_divergence_test::nir_divergence_test()
+{
+   mem_ctx = ralloc_context(NULL);
+   static const nir_shader_compiler_options options = { };
+   b = rzalloc(mem_ctx, nir_builder);
+   nir_builder_init_simple_shader(b, mem_ctx, MESA_SHADER_COMPUTE, &options);
+
+   uniform = nir_channel(b, nir_load_work_group_id(b), 0);
+   divergent = nir_load_local_invocation_index(b);
+
+   out = nir_variable_create(b->shader, nir_var_shader_out,
+                             glsl_int_type(), "out");
+   var = nir_local_variable_create(b->impl, glsl_int_type(), "var");
+}
+
+nir_divergence_test::~nir_divergence_test()
+{
+   if (HasFailure()) {
+      printf("\nShader from the failed test:\n\n");
+      nir_print_shader(b->shader, stdout);
+   }
+
+   ralloc_free(mem_ctx);
+}
+
+nir_ssa_def *
+nir_divergence_test::read_first_invocation(nir_ssa_def *x)
+{
+   nir_intrinsic_instr *first =
+      nir_intrinsic_instr_create(b->shader,
+                                 nir_intrinsic_read_first_invocation);
+   first->num_components = x->num_components;
+   first->src[0] = nir_src_for_ssa(x);
+   nir_ssa_dest_init(&first->instr, &first->dest,
+                     x->num_components, x->bit_size, NULL);
+   nir_builder_instr_insert(b, &first->instr);
+   return &first->dest.ssa;
+}
+
+void
+nir_divergence_test::run()
+{
+   nir_lower_vars_to_ssa(b->shader);
+   nir_validate_shader(b->shader, "before divergence analysis");
+   nir_divergence_analysis(b->shader);
+}
+
+} /* namespace */
+
+TEST_F(nir_divergence_test, sources)
+{
+   nir_ssa_def *sum = nir_iadd(b, uniform, nir_imm_int(b, 1));
+   nir_ssa_def *mixed = nir_iadd(b, sum, divergent);
+   nir_ssa_def *first = read_first_invocation(mixed);
+   nir_ssa_def *undef = nir_ssa_undef(b, 1, 32);
+
+   run();
+
+   EXPECT_FALSE(uniform->divergent);
+   EXPECT_FALSE(sum->divergent);
+   EXPECT_TRUE(divergent->divergent);
+   EXPECT_TRUE(mixed->divergent);
+   EXPECT_FALSE(first->divergent);
+   EXPECT_FALSE(undef->divergent);
+}
+
+TEST_F(nir_divergence_test, if_phis)
+{
+   nir_push_if(b, nir_ieq(b, uniform, nir_imm_int(b, 0)));
+   nir_store_var(b, var, nir_imm_int(b, 1), 0x1);
+   nir_push_else(b, NULL);
+   nir_store_var(b, var, nir_imm_int(b, 2), 0x1);
+   nir_pop_if(b, NULL);
+   nir_ssa_def *after_uniform_if = keep(nir_load_var(b, var));
+
+   nir_push_if(b, nir_ieq(b, divergent, nir_imm_int(b, 0)));
+   nir_store_var(b, var, nir_imm_int(b, 3), 0x1);
+   nir_pop_if(b, NULL);
+   nir_ssa_def *after_divergent_if = keep(nir_load_var(b, var));
+
+   run();
+
+   EXPECT_FALSE(after_uniform_if->divergent);
+   EXPECT_TRUE(after_divergent_if->divergent);
+}
+
+TEST_F(nir_divergence_test, uniform_loop)
+{
+   nir_store_var(b, var, nir_imm_int(b, 0), 0x1);
+   nir_push_loop(b);
+   nir_ssa_def *i = keep(nir_load_var(b, var));
+   nir_push_if(b, nir_ige(b, i, uniform));
+   nir_jump(b, nir_jump_break);
+   nir_pop_if(b, NULL);
+   nir_store_var(b, var, nir_iadd(b, i, nir_imm_int(b, 1)), 0x1);
+   nir_pop_loop(b, NULL);
+   nir_ssa_def *after = keep(nir_load_var(b, var));
+
+   run();
+
+   EXPECT_FALSE(i->divergent);
+   EXPECT_FALSE(after->divergent);
+}
+
+TEST_F(nir_divergence_test, divergent_break)
+{
+   nir_store_var(b, var, nir_imm_int(b, 0), 0x1);
+   nir_push_loop(b);
+   nir_ssa_def *i = nir_load_var(b, var);
+   nir_ssa_def *inside = nir_imul(b, uniform, nir_imm_int(b, 2));
+   nir_store_var(b, out, inside, 0x1);
+   nir_push_if(b, nir_ige(b, i, divergent));
+   nir_jump(b, nir_jump_break);
+   nir_pop_if(b, NULL);
+   nir_store_var(b, var, nir_iadd(b, i, nir_imm_int(b, 1)), 0x1);
+   nir_pop_loop(b, NULL);
+   nir_ssa_def *after = keep(nir_load_var(b, var));
+
+   run();
+
+   /* Invocations leave with different counter values.  Values that aren't
+    * used after the loop are not affected.
+    */
+   EXPECT_TRUE(after->divergent);
+   EXPECT_FALSE(inside->divergent);
+}
+
+TEST_F(nir_divergence_test, divergent_continue)
+{
+   nir_store_var(b, var, nir_imm_int(b, 0), 0x1);
+   nir_push_loop(b);
+   nir_ssa_def *i = keep(nir_load_var(b, var));
+   nir_push_if(b, nir_ige(b, i, nir_imm_int(b, 8)));
+   nir_jump(b, nir_jump_break);
+   nir_pop_if(b, NULL);
+
+   nir_store_var(b, var, nir_iadd(b, i, nir_imm_int(b, 1)), 0x1);
+   nir_push_if(b, nir_ieq(b, i, divergent));
+   nir_jump(b, nir_jump_continue);
+   nir_pop_if(b, NULL);
+   nir_store_var(b, var, nir_iadd(b, i, nir_imm_int(b, 2)), 0x1);
+   nir_pop_loop(b, NULL);
+
+   run();
+
+   EXPECT_TRUE(i->divergent);
+}
+
+TEST_F(nir_divergence_test, metadata)
+{
+   nir_ssa_def *sum = nir_iadd(b, uniform, nir_imm_int(b, 1));
+
+   run();
+   EXPECT_TRUE(b->impl->valid_metadata & nir_metadata_divergence);
+   EXPECT_FALSE(sum->divergent);
+
+   /* New values are divergent until analyzed again. */
+   b->cursor = nir_after_instr(sum->parent_instr);
+   nir_ssa_def *more = nir_iadd(b, sum, sum);
+   EXPECT_TRUE(more->divergent);
+
+   nir_metadata_preserve(b->impl, nir_metadata_divergence);
+   nir_metadata_require(b->impl, nir_metadata_divergence);
+   EXPECT_TRUE(more->divergent);
+
+   nir_metadata_preserve(b->impl, nir_metadata_none);
+   nir_metadata_require(b->impl, nir_metadata_divergence);
+   EXPECT_FALSE(more->divergent);
+}
+
+TEST_F(nir_divergence_test, lower_non_uniform_access)
+{
+   nir_ssa_def *handles[] = { uniform, divergent };
+   for (unsigned i = 0; i < 2; i++) {
+      nir_intrinsic_instr *load =
+         nir_intrinsic_instr_create(b->shader, nir_intrinsic_load_ubo);
+      load->num_components = 1;
+      load->src[0] = nir_src_for_ssa(handles[i]);
+      load->src[1] = nir_src_for_ssa(nir_imm_int(b, 0));
+      nir_intrinsic_set_access(load, ACCESS_NON_UNIFORM);
+      nir_ssa_dest_init(&load->instr, &load->dest, 1, 32, NULL);
+      nir_builder_instr_insert(b, &load->instr);
+   }
+
+   EXPECT_TRUE(nir_lower_non_uniform_access(b->shader,
+                                            nir_lower_non_uniform_ubo_access));
+
+   /* Only the load with a divergent index gets a loop. */
+   unsigned loops = 0;
+   foreach_list_typed(nir_cf_node, node, node, &b->impl->body)
+      loops += node->type == nir_cf_node_loop;
+   EXPECT_EQ(loops, 1u);
+}
@@ -0,0 +1,239 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include "nir.h"
+#include "nir_builder.h"
+
+namespace {
+
+class nir_opt_licm_test : public ::testing::Test {
+protected:
+   nir_opt_licm_test();
+   ~nir_opt_licm_test();
+
+   /* Starts "loop { if (i >= 8) break; ... }" and returns i. */
+   nir_ssa_def *begin_counted_loop();
+   void end_counted_loop();
+
+   nir_ssa_def *load(nir_intrinsic_op op);
+
+   /* Run the pass the way a driver would see the shader: in SSA form. */
+   bool run(bool hoist_loads = false);
+
+   static nir_block *preheader(nir_loop *loop) {
+      return nir_cf_node_as_block(nir_cf_node_prev(&loop->cf_node));
+   }
+
+   static nir_block *block_of(nir_ssa_def *def) {
+      return def->parent_instr->block;
+   }
+
+   void *mem_ctx;
+   nir_builder *b;
+
+   nir_variable *in;
+   nir_variable *out;
+   nir_variable *counter;
+   nir_loop *loop;
+};
+
+nir_opt_licm_test::nir_opt_licm_test()
+{
+   mem_ctx = ralloc_context(NULL);
+   static const nir_shader_compiler_options options = { };
+   b = rzalloc(mem_ctx, nir_builder);
+   nir_builder_init_simple_shader(b, mem_ctx, MESA_SHADER_FRAGMENT, &options);
+
+   in = nir_variable_create(b->shader, nir_var_shader_in,
+                            glsl_float_type(), "in");
+   out = nir_variable_create(b->shader, nir_var_shader_out,
+                             glsl_float_type(), "out");
+   counter = nir_local_variable_create(b->impl, glsl_int_type(), "i");
+   loop = NULL;
+}
+
+nir_opt_licm_test::~nir_opt_licm_test()
+{
+   if (HasFailure()) {
+      printf("\nShader from the failed test:\n\n");
+      nir_print_shader(b->shader, stdout);
+   }
+
+   ralloc_free(mem_ctx);
+}
+
+nir_ssa_def *
+nir_opt_licm_test::begin_counted_loop()
+{
+   nir_store_var(b, counter, nir_imm_int(b, 0), 0x1);
+
+   loop = nir_push_loop(b);
+
+   nir_ssa_def *i = nir_load_var(b, counter);
+   nir_push_if(b, nir_ige(b, i, nir_imm_int(b, 8)));
+   nir_jump(b, nir_jump_break);
+   nir_pop_if(b, NULL);
+
+   return i;
+}
+
+void
+nir_opt_licm_test::end_counted_loop()
+{
+   nir_ssa_def *i = nir_load_var(b, counter);
+   nir_store_var(b, counter, nir_iadd(b, i, nir_imm_int(b, 1)), 0x1);
+   nir_pop_loop(b, loop);
+}
+
+nir_ssa_def *
+nir_opt_licm_test::load(nir_intrinsic_op op)
+{
+   nir_intrinsic_instr *intrin = nir_intrinsic_instr_create(b->shader, op);
+   intrin->num_components = 1;
+
+   for (unsigned i = 0; i < nir_intrinsic_infos[op].num_srcs; i++)
+      intrin->src[i] = nir_src_for_ssa(nir_imm_int(b, 0));
+
+   nir_ssa_dest_init(&intrin->instr, &intrin->dest, 1, 32, NULL);
+   nir_builder_instr_insert(b, &intrin->instr);
+   return &intrin->dest.ssa;
+}
+
+bool
+nir_opt_licm_test::run(bool hoist_loads)
+{
+   nir_lower_vars_to_ssa(b->shader);
+   nir_validate_shader(b->shader, "before nir_opt_licm");
+
+   bool progress = nir_opt_licm(b->shader, hoist_loads);
+   nir_validate_shader(b->shader, "after nir_opt_licm");
+
+   return progress;
+}
+
+} /* namespace */
+
+TEST_F(nir_opt_licm_test, no_loop)
+{
+   nir_ssa_def *x = nir_fmul(b, nir_load_var(b, in), nir_imm_float(b, 2.0));
+   nir_store_var(b, out, x, 0x1);
+
+   EXPECT_FALSE(run());
+}
+
+TEST_F(nir_opt_licm_test, hoists_invariant_alu)
+{
+   nir_ssa_def *v = nir_load_var(b, in);
+
+   nir_ssa_def *i = begin_counted_loop();
+   nir_ssa_def *two = nir_imm_float(b, 2.0);
+   nir_ssa_def *x = nir_fmul(b, v, two);
+   nir_ssa_def *y = nir_fadd(b, x, nir_fneg(b, x));
+   nir_ssa_def *z = nir_fadd(b, y, nir_i2f32(b, i));
+   nir_store_var(b, out, z, 0x1);
+   end_counted_loop();
+
+   EXPECT_TRUE(run());
+
+   nir_block *pre = preheader(loop);
+   EXPECT_EQ(block_of(two), pre);
+   EXPECT_EQ(block_of(x), pre);
+   EXPECT_EQ(block_of(y), pre);
+
+   /* This one depends on the loop counter. */
+   EXPECT_NE(block_of(z), pre);
+   EXPECT_EQ(block_of(z)->cf_node.parent, &loop->cf_node);
+
+   EXPECT_FALSE(nir_opt_licm(b->shader, false));
+}
+
+TEST_F(nir_opt_licm_test, ignores_instructions_in_ifs)
+{
+   nir_ssa_def *v = nir_load_var(b, in);
+
+   nir_ssa_def *i = begin_counted_loop();
+   nir_push_if(b, nir_ieq(b, i, nir_imm_int(b, 3)));
+   nir_ssa_def *x = nir_fmul(b, v, v);
+   nir_store_var(b, out, x, 0x1);
+   nir_pop_if(b, NULL);
+   end_counted_loop();
+
+   run();
+
+   EXPECT_NE(block_of(x), preheader(loop));
+}
+
+TEST_F(nir_opt_licm_test, nested_loops)
+{
+   nir_variable *counter2 =
+      nir_local_variable_create(b->impl, glsl_int_type(), "j");
+   nir_ssa_def *v = nir_load_var(b, in);
+
+   nir_ssa_def *i = begin_counted_loop();
+   nir_loop *outer = loop;
+
+   nir_store_var(b, counter2, nir_imm_int(b, 0), 0x1);
+   nir_loop *inner = nir_push_loop(b);
+
+   nir_ssa_def *j = nir_load_var(b, counter2);
+   nir_push_if(b, nir_ige(b, j, nir_imm_int(b, 4)));
+   nir_jump(b, nir_jump_break);
+   nir_pop_if(b, NULL);
+
+   nir_ssa_def *invariant = nir_fmul(b, v, v);
+   nir_ssa_def *outer_only = nir_fadd(b, v, nir_i2f32(b, i));
+   nir_ssa_def *neither = nir_fadd(b, outer_only, nir_i2f32(b, j));
+   nir_store_var(b, out, nir_fadd(b, invariant, neither), 0x1);
+   nir_store_var(b, counter2, nir_iadd(b, j, nir_imm_int(b, 1)), 0x1);
+
+   nir_pop_loop(b, inner);
+   end_counted_loop();
+
+   EXPECT_TRUE(run());
+
+   EXPECT_EQ(block_of(invariant), preheader(outer));
+   EXPECT_EQ(block_of(outer_only), preheader(inner));
+   EXPECT_EQ(block_of(neither)->cf_node.parent,
+             &inner->cf_node);
+}
+
+TEST_F(nir_opt_licm_test, loads)
+{
+   begin_counted_loop();
+   nir_ssa_def *uniform = load(nir_intrinsic_load_uniform);
+   nir_ssa_def *ssbo = load(nir_intrinsic_load_ssbo);
+   nir_store_var(b, out, nir_fadd(b, uniform, ssbo), 0x1);
+   end_counted_loop();
+
+   /* Without hoist_loads only the constant offsets move. */
+   run(false);
+   EXPECT_NE(block_of(uniform), preheader(loop));
+
+   EXPECT_TRUE(nir_opt_licm(b->shader, true));
+   EXPECT_EQ(block_of(uniform), preheader(loop));
+
+   /* SSBOs can be written, so the load has to stay in the loop. */
+   EXPECT_NE(block_of(ssbo), preheader(loop));
+}
@@ -0,0 +1,403 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include "nir.h"
+#include "nir_builder.h"
+
+namespace {
+
+class nir_load_store_vectorize_test : public ::testing::Test {
+protected:
+   nir_load_store_vectorize_test();
+   ~nir_load_store_vectorize_test();
+
+   nir_intrinsic_instr *load(nir_intrinsic_op op, nir_ssa_def *offset,
+                             unsigned num_components, unsigned access = 0);
+   nir_intrinsic_instr *store(nir_intrinsic_op op, nir_ssa_def *offset,
+                              nir_ssa_def *value, unsigned access = 0);
+
+   bool run(nir_variable_mode modes);
+
+   unsigned count_intrinsics(nir_intrinsic_op op);
+   nir_intrinsic_instr *get_intrinsic(nir_intrinsic_op op, unsigned index);
+
+   /* Which component of which def src reads, looking through movs */
+   static nir_ssa_def *chased_def(nir_alu_src *src, unsigned *comp);
+
+   static bool allow(unsigned align, unsigned bit_size,
+                     unsigned num_components, unsigned high_offset,
+                     nir_intrinsic_instr *low, nir_intrinsic_instr *high);
+
+   static unsigned max_components;
+   static unsigned calls;
+   static unsigned last_high_offset;
+
+   void *mem_ctx;
+   nir_builder *b;
+   nir_ssa_def *index;
+};
+
+unsigned nir_load_store_vectorize_test::max_components;
+unsigned nir_load_store_vectorize_test::calls;
+unsigned nir_load_store_vectorize_test::last_high_offset;
+
+nir_load_store_vectorize_test::nir_load_store_vectorize_test()
+{
+   mem_ctx = ralloc_context(NULL);
+   static const nir_shader_compiler_options options = { };
+   b = rzalloc(mem_ctx, nir_builder);
+   nir_builder_init_simple_shader(b, mem_ctx, MESA_SHADER_COMPUTE, &options);
+
+   /* Something non-constant to use for indirect offsets */
+   index = nir_imul(b, nir_load_local_invocation_index(b),
+                    nir_imm_int(b, 16));
+
+   max_components = 4;
+   calls = 0;
+   last_high_offset = 0;
+}
+
+nir_load_store_vectorize_test::~nir_load_store_vectorize_test()
+{
+   if (HasFailure()) {
+      printf("\nShader from the failed test:\n\n");
+      nir_print_shader(b->shader, stdout);
+   }
+
+   ralloc_free(mem_ctx);
+}
+
+static void
+init_srcs(nir_builder *b, nir_intrinsic_instr *intrin, nir_ssa_def *value,
+          nir_ssa_def *offset, unsigned access)
+{
+   unsigned s = 0;
+   if (value)
+      intrin->src[s++] = nir_src_for_ssa(value);
+
+   if (intrin->intrinsic == nir_intrinsic_load_ubo ||
+       intrin->intrinsic == nir_intrinsic_load_ssbo ||
+       intrin->intrinsic == nir_intrinsic_store_ssbo)
+      intrin->src[s++] = nir_src_for_ssa(nir_imm_int(b, 0));
+
+   intrin->src[s] = nir_src_for_ssa(offset);
+
+   if (nir_intrinsic_infos[intrin->intrinsic].index_map[NIR_INTRINSIC_ACCESS])
+      nir_intrinsic_set_access(intrin, (gl_access_qualifier) access);
+}
+
+nir_intrinsic_instr *
+nir_load_store_vectorize_test::load(nir_intrinsic_op op, nir_ssa_def *offset,
+                                    unsigned num_components, unsigned access)
+{
+   nir_intrinsic_instr *intrin = nir_intrinsic_instr_create(b->shader, op);
+   intrin->num_components = num_components;
+   init_srcs(b, intrin, NULL, offset, access);
+
+   nir_ssa_dest_init(&intrin->instr, &intrin->dest, num_components, 32, NULL);
+   nir_builder_instr_insert(b, &intrin->instr);
+   return intrin;
+}
+
+nir_intrinsic_instr *
+nir_load_store_vectorize_test::store(nir_intrinsic_op op, nir_ssa_def *offset,
+                                     nir_ssa_def *value, unsigned access)
+{
+   nir_intrinsic_instr *intrin = nir_intrinsic_instr_create(b->shader, op);
+   intrin->num_components = value->num_components;
+   init_srcs(b, intrin, value, offset, access);
+   nir_intrinsic_set_write_mask(intrin, BITFIELD_MASK(value->num_components));
+
+   nir_builder_instr_insert(b, &intrin->instr);
+   return intrin;
+}
+
+bool
+nir_load_store_vectorize_test::allow(unsigned align, unsigned bit_size,
+                                     unsigned num_components,
+                                     unsigned high_offset,
+                                     nir_intrinsic_instr *low,
+                                     nir_intrinsic_instr *high)
+{
+   calls++;
+   last_high_offset = high_offset;
+   return num_components <= max_components;
+}
+
+bool
+nir_load_store_vectorize_test::run(nir_variable_mode modes)
+{
+   nir_validate_shader(b->shader, "before nir_opt_load_store_vectorize");
+   bool progress = nir_opt_load_store_vectorize(b->shader, modes, allow);
+   nir_validate_shader(b->shader, "after nir_opt_load_store_vectorize");
+   return progress;
+}
+
+unsigned
+nir_load_store_vectorize_test::count_intrinsics(nir_intrinsic_op op)
+{
+   unsigned count = 0;
+   nir_foreach_instr(instr, nir_start_block(b->impl)) {
+      if (instr->type == nir_instr_type_intrinsic &&
+          nir_instr_as_intrinsic(instr)->intrinsic == op)
+         count++;
+   }
+   return count;
+}
+
+nir_intrinsic_instr *
+nir_load_store_vectorize_test::get_intrinsic(nir_intrinsic_op op,
+                                             unsigned index)
+{
+   nir_foreach_instr(instr, nir_start_block(b->impl)) {
+      if (instr->type != nir_instr_type_intrinsic)
+         continue;
+
+      nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(instr);
+      if (intrin->intrinsic == op && index-- == 0)
+         return intrin;
+   }
+   return NULL;
+}
+
+nir_ssa_def *
+nir_load_store_vectorize_test::chased_def(nir_alu_src *src, unsigned *comp)
+{
+   nir_ssa_def *def = src->src.ssa;
+   *comp = src->swizzle[0];
+
+   while (def->parent_instr->type == nir_instr_type_alu) {
+      nir_alu_instr *mov = nir_instr_as_alu(def->parent_instr);
+      if (mov->op != nir_op_mov)
+         break;
+
+      *comp = mov->src[0].swizzle[*comp];
+      def = mov->src[0].src.ssa;
+   }
+
+   return def;
+}
+
+} /* namespace */
+
+TEST_F(nir_load_store_vectorize_test, ubo_scalars)
+{
+   /* Out of order, the way a struct might be read */
+   nir_ssa_def *z = &load(nir_intrinsic_load_ubo, nir_imm_int(b, 8), 1)->dest.ssa;
+   nir_ssa_def *x = &load(nir_intrinsic_load_ubo, nir_imm_int(b, 0), 1)->dest.ssa;
+   nir_ssa_def *w = &load(nir_intrinsic_load_ubo, nir_imm_int(b, 12), 1)->dest.ssa;
+   nir_ssa_def *y = &load(nir_intrinsic_load_ubo, nir_imm_int(b, 4), 1)->dest.ssa;
+   nir_alu_instr *vec = nir_instr_as_alu(
+      nir_vec4(b, x, y, z, w)->parent_instr);
+
+   EXPECT_TRUE(run(nir_var_mem_ubo));
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_load_ubo), 1u);
+
+   nir_intrinsic_instr *combined = get_intrinsic(nir_intrinsic_load_ubo, 0);
+   EXPECT_EQ(combined->num_components, 4u);
+   EXPECT_EQ(nir_src_as_uint(combined->src[1]), 0u);
+
+   for (unsigned i = 0; i < 4; i++) {
+      unsigned comp;
+      EXPECT_EQ(chased_def(&vec->src[i], &comp), &combined->dest.ssa);
+      EXPECT_EQ(comp, i);
+   }
+}
+
+TEST_F(nir_load_store_vectorize_test, ubo_overlapping)
+{
+   load(nir_intrinsic_load_ubo, nir_imm_int(b, 0), 2);
+   load(nir_intrinsic_load_ubo, nir_imm_int(b, 4), 2);
+
+   EXPECT_TRUE(run(nir_var_mem_ubo));
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_load_ubo), 1u);
+   EXPECT_EQ(get_intrinsic(nir_intrinsic_load_ubo, 0)->num_components, 3u);
+   EXPECT_EQ(last_high_offset, 4u);
+}
+
+TEST_F(nir_load_store_vectorize_test, indirect_offsets)
+{
+   nir_ssa_def *other = nir_iadd(b, index, nir_imm_int(b, 1));
+
+   load(nir_intrinsic_load_ssbo, nir_iadd(b, index, nir_imm_int(b, 4)), 1);
+   load(nir_intrinsic_load_ssbo, nir_iadd(b, index, nir_imm_int(b, 8)), 1);
+   load(nir_intrinsic_load_ssbo, nir_iadd(b, other, nir_imm_int(b, 12)), 1);
+
+   EXPECT_TRUE(run(nir_var_mem_ssbo));
+
+   /* The one with a different base is left alone. */
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 2u);
+   EXPECT_EQ(get_intrinsic(nir_intrinsic_load_ssbo, 0)->num_components, 2u);
+   EXPECT_EQ(get_intrinsic(nir_intrinsic_load_ssbo, 1)->num_components, 1u);
+}
+
+TEST_F(nir_load_store_vectorize_test, other_modes_untouched)
+{
+   load(nir_intrinsic_load_ubo, nir_imm_int(b, 0), 1);
+   load(nir_intrinsic_load_ubo, nir_imm_int(b, 4), 1);
+
+   EXPECT_FALSE(run(nir_var_mem_ssbo));
+   EXPECT_EQ(calls, 0u);
+}
+
+TEST_F(nir_load_store_vectorize_test, callback_limits_size)
+{
+   for (unsigned i = 0; i < 4; i++)
+      load(nir_intrinsic_load_ubo, nir_imm_int(b, i * 4), 1);
+
+   max_components = 2;
+   EXPECT_TRUE(run(nir_var_mem_ubo));
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_load_ubo), 2u);
+   EXPECT_EQ(get_intrinsic(nir_intrinsic_load_ubo, 0)->num_components, 2u);
+   EXPECT_EQ(get_intrinsic(nir_intrinsic_load_ubo, 1)->num_components, 2u);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_stores)
+{
+   nir_ssa_def *x = nir_imm_int(b, 1), *y = nir_imm_int(b, 2);
+   store(nir_intrinsic_store_ssbo, nir_imm_int(b, 4), y);
+   store(nir_intrinsic_store_ssbo, nir_imm_int(b, 0), x);
+
+   EXPECT_TRUE(run(nir_var_mem_ssbo));
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_store_ssbo), 1u);
+
+   nir_intrinsic_instr *store = get_intrinsic(nir_intrinsic_store_ssbo, 0);
+   EXPECT_EQ(store->num_components, 2u);
+   EXPECT_EQ(nir_intrinsic_write_mask(store), 0x3u);
+   EXPECT_EQ(nir_src_as_uint(store->src[2]), 0u);
+
+   nir_alu_instr *vec = nir_instr_as_alu(store->src[0].ssa->parent_instr);
+   EXPECT_EQ(vec->op, nir_op_vec2);
+   EXPECT_EQ(vec->src[0].src.ssa, x);
+   EXPECT_EQ(vec->src[1].src.ssa, y);
+}
+
+TEST_F(nir_load_store_vectorize_test, overlapping_stores)
+{
+   store(nir_intrinsic_store_ssbo, nir_imm_int(b, 0), nir_imm_ivec2(b, 1, 2));
+   store(nir_intrinsic_store_ssbo, nir_imm_int(b, 4), nir_imm_int(b, 3));
+
+   EXPECT_FALSE(run(nir_var_mem_ssbo));
+}
+
+TEST_F(nir_load_store_vectorize_test, load_between_stores)
+{
+   store(nir_intrinsic_store_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 1));
+   load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0), 1);
+   store(nir_intrinsic_store_ssbo, nir_imm_int(b, 4), nir_imm_int(b, 2));
+
+   EXPECT_FALSE(run(nir_var_mem_ssbo));
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_store_ssbo), 2u);
+}
+
+TEST_F(nir_load_store_vectorize_test, store_between_loads)
+{
+   load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0), 1);
+   store(nir_intrinsic_store_ssbo, nir_imm_int(b, 4), nir_imm_int(b, 1));
+   load(nir_intrinsic_load_ssbo, nir_imm_int(b, 4), 1);
+
+   EXPECT_FALSE(run(nir_var_mem_ssbo));
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 2u);
+}
+
+TEST_F(nir_load_store_vectorize_test, global_store_between_ssbo_loads)
+{
+   /* The global address may point into the SSBO. */
+   load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0), 1);
+   store(nir_intrinsic_store_global, nir_imm_int64(b, 0x1004),
+         nir_imm_int(b, 1));
+   load(nir_intrinsic_load_ssbo, nir_imm_int(b, 4), 1);
+
+   EXPECT_FALSE(run((nir_variable_mode) (nir_var_mem_ssbo |
+                                         nir_var_mem_global)));
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 2u);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_store_between_global_loads)
+{
+   load(nir_intrinsic_load_global, nir_imm_int64(b, 0x1000), 1);
+   store(nir_intrinsic_store_ssbo, nir_imm_int(b, 4), nir_imm_int(b, 1));
+   load(nir_intrinsic_load_global, nir_imm_int64(b, 0x1004), 1);
+
+   EXPECT_FALSE(run((nir_variable_mode) (nir_var_mem_ssbo |
+                                         nir_var_mem_global)));
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_load_global), 2u);
+}
+
+TEST_F(nir_load_store_vectorize_test, barrier_between_loads)
+{
+   load(nir_intrinsic_load_shared, nir_imm_int(b, 0), 1);
+   nir_intrinsic_instr *barrier =
+      nir_intrinsic_instr_create(b->shader, nir_intrinsic_barrier);
+   nir_builder_instr_insert(b, &barrier->instr);
+   load(nir_intrinsic_load_shared, nir_imm_int(b, 4), 1);
+
+   EXPECT_FALSE(run(nir_var_mem_shared));
+}
+
+TEST_F(nir_load_store_vectorize_test, reorderable_loads)
+{
+   load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0), 1, ACCESS_CAN_REORDER);
+   store(nir_intrinsic_store_ssbo, nir_imm_int(b, 16), nir_imm_int(b, 1));
+   load(nir_intrinsic_load_ssbo, nir_imm_int(b, 4), 1, ACCESS_CAN_REORDER);
+
+   EXPECT_TRUE(run(nir_var_mem_ssbo));
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 1u);
+}
+
+TEST_F(nir_load_store_vectorize_test, access_qualifiers)
+{
+   /* Volatile accesses stay as they are, and accesses with different
+    * qualifiers aren't combined.
+    */
+   load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0), 1, ACCESS_VOLATILE);
+   load(nir_intrinsic_load_ssbo, nir_imm_int(b, 4), 1, ACCESS_VOLATILE);
+   load(nir_intrinsic_load_ssbo, nir_imm_int(b, 8), 1, ACCESS_COHERENT);
+   load(nir_intrinsic_load_ssbo, nir_imm_int(b, 12), 1);
+
+   EXPECT_FALSE(run(nir_var_mem_ssbo));
+   EXPECT_EQ(calls, 0u);
+}
+
+TEST_F(nir_load_store_vectorize_test, shared_base)
+{
+   nir_intrinsic_instr *a =
+      load(nir_intrinsic_load_shared, nir_iadd(b, index, nir_imm_int(b, 4)), 1);
+   nir_intrinsic_set_base(a, 16);
+   load(nir_intrinsic_load_shared, nir_iadd(b, index, nir_imm_int(b, 24)), 1);
+
+   EXPECT_TRUE(run(nir_var_mem_shared));
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_load_shared), 1u);
+
+   /* The BASE is folded into the offset. */
+   nir_intrinsic_instr *combined = get_intrinsic(nir_intrinsic_load_shared, 0);
+   EXPECT_EQ(combined->num_components, 2u);
+   EXPECT_EQ(nir_intrinsic_base(combined), 0);
+
+   nir_alu_instr *offset = nir_instr_as_alu(combined->src[0].ssa->parent_instr);
+   EXPECT_EQ(offset->op, nir_op_iadd);
+   EXPECT_EQ(offset->src[0].src.ssa, index);
+   EXPECT_EQ(nir_src_as_uint(offset->src[1].src), 20u);
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include "nir.h"
+#include "nir_pass_manager.h"
+
+/* The passes in these tests don't touch the shader.  Each one makes
+ * progress as many times as its budget says and counts how often it ran.
+ */
+struct fake_pass {
+   unsigned budget;
+   unsigned calls;
+};
+
+static bool
+run_fake_pass(nir_shader *shader, const void *data)
+{
+   fake_pass *pass = (fake_pass *) data;
+
+   pass->calls++;
+   if (pass->budget == 0)
+      return false;
+
+   pass->budget--;
+   return true;
+}
+
+class nir_pass_manager_test : public ::testing::Test {
+protected:
+   nir_pass_manager_test();
+   ~nir_pass_manager_test();
+
+   void add(fake_pass *pass, unsigned reads, unsigned writes,
+            unsigned flags = 0);
+
+   void *mem_ctx;
+   nir_shader *shader;
+   nir_pass_manager *pm;
+};
+
+nir_pass_manager_test::nir_pass_manager_test()
+{
+   static const nir_shader_compiler_options options = { };
+   mem_ctx = ralloc_context(NULL);
+   shader = nir_shader_create(mem_ctx, MESA_SHADER_VERTEX, &options, NULL);
+   pm = nir_pass_manager_create(mem_ctx);
+}
+
+nir_pass_manager_test::~nir_pass_manager_test()
+{
+   ralloc_free(mem_ctx);
+}
+
+void
+nir_pass_manager_test::add(fake_pass *pass, unsigned reads, unsigned writes,
+                           unsigned flags)
+{
+   nir_pass_manager_add_with_data(pm, "fake", run_fake_pass, pass,
+                                  reads, writes, flags);
+}
+
+TEST_F(nir_pass_manager_test, no_passes)
+{
+   EXPECT_FALSE(nir_pass_manager_run(pm, shader));
+}
+
+TEST_F(nir_pass_manager_test, stops_once_everything_ran_since_progress)
+{
+   fake_pass a = { 2, 0 }, b = { 0, 0 };
+   add(&a, NIR_PASS_TOUCHES_ALL, NIR_PASS_TOUCHES_ALL);
+   add(&b, NIR_PASS_TOUCHES_ALL, NIR_PASS_TOUCHES_ALL);
+
+   EXPECT_TRUE(nir_pass_manager_run(pm, shader));
+
+   /* A do/while loop would run both passes three times.  After the last
+    * progress from a, b has already run and a has nothing left to do, so
+    * the last round of b is not needed.
+    */
+   EXPECT_EQ(a.calls, 3u);
+   EXPECT_EQ(b.calls, 2u);
+}
+
+TEST_F(nir_pass_manager_test, progress_reruns_earlier_passes)
+{
+   fake_pass a = { 0, 0 }, b = { 1, 0 };
+   add(&a, NIR_PASS_TOUCHES_ALL, NIR_PASS_TOUCHES_ALL);
+   add(&b, NIR_PASS_TOUCHES_ALL, NIR_PASS_TOUCHES_ALL);
+
+   EXPECT_TRUE(nir_pass_manager_run(pm, shader));
+   EXPECT_EQ(a.calls, 2u);
+   EXPECT_EQ(b.calls, 2u);
+}
+
+TEST_F(nir_pass_manager_test, skips_passes_with_untouched_inputs)
+{
+   fake_pass alu = { 0, 0 }, intrin = { 3, 0 }, all = { 0, 0 };
+   add(&alu, NIR_PASS_TOUCHES_ALU, NIR_PASS_TOUCHES_ALL);
+   add(&intrin, NIR_PASS_TOUCHES_INTRINSIC, NIR_PASS_TOUCHES_INTRINSIC);
+   add(&all, NIR_PASS_TOUCHES_ALL, NIR_PASS_TOUCHES_ALL);
+
+   EXPECT_TRUE(nir_pass_manager_run(pm, shader));
+
+   /* The ALU pass only runs in the first round.  The last pass runs after
+    * each bit of intrinsic progress, and the intrinsic pass runs once more
+    * to find out it is done.
+    */
+   EXPECT_EQ(alu.calls, 1u);
+   EXPECT_EQ(intrin.calls, 4u);
+   EXPECT_EQ(all.calls, 3u);
+}
+
+TEST_F(nir_pass_manager_test, ignored_progress_does_not_loop)
+{
+   fake_pass lower = { 1000, 0 }, opt = { 1, 0 };
+   add(&lower, NIR_PASS_TOUCHES_ALL, NIR_PASS_TOUCHES_ALL,
+       NIR_PASS_IGNORE_PROGRESS);
+   add(&opt, NIR_PASS_TOUCHES_ALL, NIR_PASS_TOUCHES_ALL);
+
+   EXPECT_TRUE(nir_pass_manager_run(pm, shader));
+   EXPECT_EQ(lower.calls, 2u);
+   EXPECT_EQ(opt.calls, 2u);
+}
+
+TEST_F(nir_pass_manager_test, runs_are_independent)
+{
+   fake_pass a = { 1, 0 };
+   add(&a, NIR_PASS_TOUCHES_ALU, NIR_PASS_TOUCHES_INTRINSIC);
+
+   EXPECT_TRUE(nir_pass_manager_run(pm, shader));
+   EXPECT_EQ(a.calls, 1u);
+
+   /* A new run starts from scratch, so the pass runs again even though
+    * nothing it reads was touched.
+    */
+   EXPECT_FALSE(nir_pass_manager_run(pm, shader));
+   EXPECT_EQ(a.calls, 2u);
+}
@@ -0,0 +1,325 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Measures the size of serialized NIR and the time it takes to serialize
+ * and deserialize it, and checks that every shader survives the round trip.
+ *
+ * Usage: nir_serialize_bench [file.{vert,tesc,tese,geom,frag,comp}.spv ...]
+ *
+ * Each SPIR-V file is converted with spirv_to_nir using the "main" entry
+ * point and the stage given by its extension.  Without arguments, a set of
+ * generated shaders of increasing size is used instead.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "nir.h"
+#include "nir_builder.h"
+#include "nir_serialize.h"
+#include "spirv/nir_spirv.h"
+#include "util/os_time.h"
+
+#define ITERATIONS 100
+#define NUM_GENERATED_SHADERS 32
+
+static const nir_shader_compiler_options options = { 0 };
+
+struct bench_totals {
+   unsigned shaders;
+   unsigned instrs;
+   size_t size;
+   int64_t serialize_ns;
+   int64_t deserialize_ns;
+   unsigned failures;
+};
+
+static gl_shader_stage
+stage_from_filename(const char *filename)
+{
+   static const struct {
+      const char *ext;
+      gl_shader_stage stage;
+   } exts[] = {
+      { ".vert", MESA_SHADER_VERTEX },
+      { ".tesc", MESA_SHADER_TESS_CTRL },
+      { ".tese", MESA_SHADER_TESS_EVAL },
+      { ".geom", MESA_SHADER_GEOMETRY },
+      { ".frag", MESA_SHADER_FRAGMENT },
+      { ".comp", MESA_SHADER_COMPUTE },
+   };
+
+   for (unsigned i = 0; i < ARRAY_SIZE(exts); i++) {
+      if (strstr(filename, exts[i].ext))
+         return exts[i].stage;
+   }
+
+   return MESA_SHADER_FRAGMENT;
+}
+
+static nir_shader *
+load_spirv(void *mem_ctx, const char *filename)
+{
+   int fd = open(filename, O_RDONLY);
+   if (fd < 0) {
+      fprintf(stderr, "Failed to open %s\n", filename);
+      return NULL;
+   }
+
+   off_t len = lseek(fd, 0, SEEK_END);
+   if (len <= 0 || len % 4 != 0) {
+      fprintf(stderr, "%s is not a SPIR-V binary\n", filename);
+      close(fd);
+      return NULL;
+   }
+
+   const void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd);
+   if (map == MAP_FAILED) {
+      fprintf(stderr, "Failed to mmap %s: errno=%d, %s\n",
+              filename, errno, strerror(errno));
+      return NULL;
+   }
+
+   struct spirv_to_nir_options spirv_opts = { 0 };
+   nir_shader *nir = spirv_to_nir(map, len / 4, NULL, 0,
+                                  stage_from_filename(filename), "main",
+                                  &spirv_opts, &options);
+   munmap((void *)map, len);
+
+   if (nir)
+      ralloc_steal(mem_ctx, nir);
+
+   return nir;
+}
+
+/* Builds a fragment shader roughly shaped like a lighting loop: a uniform
+ * array of lights, a few varyings, a texture lookup and an accumulator that
+ * goes through a loop and an if.  The size scales with complexity.
+ */
+static nir_shader *
+generate_shader(void *mem_ctx, unsigned complexity)
+{
+   nir_builder b;
+   nir_builder_init_simple_shader(&b, mem_ctx, MESA_SHADER_FRAGMENT,
+                                  &options);
+
+   const struct glsl_type *vec4 = glsl_vec4_type();
+   nir_variable *in_pos =
+      nir_variable_create(b.shader, nir_var_shader_in, vec4, "in_pos");
+   nir_variable *in_normal =
+      nir_variable_create(b.shader, nir_var_shader_in, vec4, "in_normal");
+   nir_variable *lights =
+      nir_variable_create(b.shader, nir_var_uniform,
+                          glsl_array_type(vec4, 8, 0), "lights");
+   nir_variable *tex =
+      nir_variable_create(b.shader, nir_var_uniform,
+                          glsl_sampler_type(GLSL_SAMPLER_DIM_2D, false, false,
+                                            GLSL_TYPE_FLOAT), "tex");
+   nir_variable *color =
+      nir_variable_create(b.shader, nir_var_shader_out, vec4, "color");
+   nir_variable *acc =
+      nir_local_variable_create(b.impl, vec4, "acc");
+   nir_variable *i_var =
+      nir_local_variable_create(b.impl, glsl_int_type(), "i");
+
+   nir_ssa_def *pos = nir_load_var(&b, in_pos);
+   nir_ssa_def *normal = nir_load_var(&b, in_normal);
+
+   nir_tex_instr *t = nir_tex_instr_create(b.shader, 3);
+   t->op = nir_texop_tex;
+   t->sampler_dim = GLSL_SAMPLER_DIM_2D;
+   t->coord_components = 2;
+   t->dest_type = nir_type_float;
+   nir_deref_instr *tex_deref = nir_build_deref_var(&b, tex);
+   t->src[0].src_type = nir_tex_src_coord;
+   t->src[0].src = nir_src_for_ssa(nir_channels(&b, pos, 0x3));
+   t->src[1].src_type = nir_tex_src_texture_deref;
+   t->src[1].src = nir_src_for_ssa(&tex_deref->dest.ssa);
+   t->src[2].src_type = nir_tex_src_sampler_deref;
+   t->src[2].src = nir_src_for_ssa(&tex_deref->dest.ssa);
+   nir_ssa_dest_init(&t->instr, &t->dest, 4, 32, NULL);
+   nir_builder_instr_insert(&b, &t->instr);
+
+   nir_store_var(&b, acc, &t->dest.ssa, 0xf);
+   nir_store_var(&b, i_var, nir_imm_int(&b, 0), 0x1);
+
+   nir_loop *loop = nir_push_loop(&b);
+   {
+      nir_ssa_def *i = nir_load_var(&b, i_var);
+      nir_push_if(&b, nir_ige(&b, i, nir_imm_int(&b, 8)));
+      nir_jump(&b, nir_jump_break);
+      nir_pop_if(&b, NULL);
+
+      nir_deref_instr *light_deref =
+         nir_build_deref_array(&b, nir_build_deref_var(&b, lights), i);
+      nir_ssa_def *light = nir_load_deref(&b, light_deref);
+      nir_ssa_def *sum = nir_load_var(&b, acc);
+      for (unsigned j = 0; j < complexity; j++) {
+         nir_ssa_def *dir = nir_fsub(&b, light, pos);
+         nir_ssa_def *ndotl =
+            nir_fmax(&b, nir_fdot4(&b, normal, dir), nir_imm_float(&b, 0.0));
+         nir_ssa_def *scaled =
+            nir_fmul(&b, ndotl, nir_imm_float(&b, 1.0f / (j + 1)));
+         static const unsigned wzyx[] = { 3, 2, 1, 0 };
+         sum = nir_ffma(&b, nir_swizzle(&b, light, wzyx, 4), scaled, sum);
+         if (j % 4 == 3) {
+            nir_push_if(&b, nir_flt(&b, ndotl, nir_imm_float(&b, 0.5)));
+            nir_store_var(&b, acc, nir_fmul(&b, sum, nir_imm_float(&b, 0.5)),
+                          0xf);
+            nir_push_else(&b, NULL);
+            nir_store_var(&b, acc, nir_fsat(&b, sum), 0xf);
+            nir_pop_if(&b, NULL);
+            sum = nir_load_var(&b, acc);
+         }
+      }
+      nir_store_var(&b, acc, sum, 0xf);
+      nir_store_var(&b, i_var, nir_iadd(&b, i, nir_imm_int(&b, 1)), 0x1);
+   }
+   nir_pop_loop(&b, loop);
+
+   nir_store_var(&b, color, nir_load_var(&b, acc), 0xf);
+
+   /* Drivers cache shaders in SSA form, so get it into roughly that shape. */
+   nir_lower_vars_to_ssa(b.shader);
+   nir_copy_prop(b.shader);
+   nir_opt_dce(b.shader);
+   nir_opt_cse(b.shader);
+   nir_opt_dce(b.shader);
+
+   return b.shader;
+}
+
+static unsigned
+count_instrs(nir_shader *nir)
+{
+   unsigned count = 0;
+   nir_foreach_function(func, nir) {
+      if (!func->impl)
+         continue;
+      nir_foreach_block(block, func->impl) {
+         nir_foreach_instr(instr, block)
+            count++;
+      }
+   }
+   return count;
+}
+
+static void
+bench_shader(const char *name, nir_shader *nir, struct bench_totals *totals)
+{
+   struct blob blob;
+   int64_t start, end;
+
+   blob_init(&blob);
+   start = os_time_get_nano();
+   for (unsigned i = 0; i < ITERATIONS; i++) {
+      blob_finish(&blob);
+      blob_init(&blob);
+      nir_serialize(&blob, nir);
+   }
+   end = os_time_get_nano();
+   int64_t serialize_ns = (end - start) / ITERATIONS;
+
+   void *mem_ctx = ralloc_context(NULL);
+   nir_shader *copy = NULL;
+   start = os_time_get_nano();
+   for (unsigned i = 0; i < ITERATIONS; i++) {
+      struct blob_reader reader;
+      blob_reader_init(&reader, blob.data, blob.size);
+      ralloc_free(copy);
+      copy = nir_deserialize(mem_ctx, &options, &reader);
+   }
+   end = os_time_get_nano();
+   int64_t deserialize_ns = (end - start) / ITERATIONS;
+
+   /* The copy has to serialize to exactly the same bytes. */
+   bool ok = copy != NULL;
+   if (ok) {
+      struct blob check;
+      blob_init(&check);
+      nir_serialize(&check, copy);
+      ok = check.size == blob.size &&
+           memcmp(check.data, blob.data, blob.size) == 0;
+      blob_finish(&check);
+   }
+
+   unsigned instrs = count_instrs(nir);
+   printf("%-40s %6u instrs %8zu bytes %8.2f us ser %8.2f us deser%s\n",
+          name, instrs, blob.size, serialize_ns / 1000.0,
+          deserialize_ns / 1000.0, ok ? "" : "  ROUND TRIP FAILED");
+
+   totals->shaders++;
+   totals->instrs += instrs;
+   totals->size += blob.size;
+   totals->serialize_ns += serialize_ns;
+   totals->deserialize_ns += deserialize_ns;
+   totals->failures += !ok;
+
+   ralloc_free(mem_ctx);
+   blob_finish(&blob);
+}
+
+int
+main(int argc, char **argv)
+{
+   struct bench_totals totals = { 0 };
+
+   glsl_type_singleton_init_or_ref();
+
+   if (argc > 1) {
+      for (int i = 1; i < argc; i++) {
+         void *mem_ctx = ralloc_context(NULL);
+         nir_shader *nir = load_spirv(mem_ctx, argv[i]);
+         if (nir)
+            bench_shader(argv[i], nir, &totals);
+         else
+            totals.failures++;
+         ralloc_free(mem_ctx);
+      }
+   } else {
+      for (unsigned i = 0; i < NUM_GENERATED_SHADERS; i++) {
+         void *mem_ctx = ralloc_context(NULL);
+         char name[32];
+         snprintf(name, sizeof(name), "generated-%u", i);
+         bench_shader(name, generate_shader(mem_ctx, 1 + i * 2), &totals);
+         ralloc_free(mem_ctx);
+      }
+   }
+
+   printf("\n%u shaders, %u instrs, %zu bytes (%.2f bytes/instr), "
+          "%.2f ms serialize, %.2f ms deserialize\n",
+          totals.shaders, totals.instrs, totals.size,
+          totals.instrs ? (double)totals.size / totals.instrs : 0.0,
+          totals.serialize_ns / 1e6, totals.deserialize_ns / 1e6);
+
+   glsl_type_singleton_decref();
+
+   return totals.failures ? 1 : 0;
+}
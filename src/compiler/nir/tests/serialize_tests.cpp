@@ -0,0 +1,500 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "nir.h"
+#include "nir_builder.h"
+#include "nir_serialize.h"
+
+namespace {
+
+class nir_serialize_test : public ::testing::Test {
+protected:
+   nir_serialize_test();
+   ~nir_serialize_test();
+
+   void serialize();
+   nir_shader *deserialize(const void *data, size_t size);
+   void expect_round_trip();
+
+   nir_variable *create_var(nir_variable_mode mode, const glsl_type *type,
+                            const char *name) {
+      if (mode == nir_var_function_temp)
+         return nir_local_variable_create(b->impl, type, name);
+      else
+         return nir_variable_create(b->shader, mode, type, name);
+   }
+
+   nir_alu_instr *build_alu(nir_op op, nir_ssa_def *src0, nir_ssa_def *src1);
+
+   void *mem_ctx;
+   nir_builder *b;
+
+   struct blob blob;
+   nir_shader *copy;
+};
+
+nir_serialize_test::nir_serialize_test()
+{
+   mem_ctx = ralloc_context(NULL);
+   static const nir_shader_compiler_options options = { };
+   b = rzalloc(mem_ctx, nir_builder);
+   nir_builder_init_simple_shader(b, mem_ctx, MESA_SHADER_FRAGMENT, &options);
+   blob_init(&blob);
+   copy = NULL;
+}
+
+nir_serialize_test::~nir_serialize_test()
+{
+   if (HasFailure()) {
+      printf("\nShader from the failed test:\n\n");
+      nir_print_shader(b->shader, stdout);
+      if (copy) {
+         printf("\nDeserialized shader:\n\n");
+         nir_print_shader(copy, stdout);
+      }
+   }
+
+   blob_finish(&blob);
+   ralloc_free(mem_ctx);
+}
+
+void
+nir_serialize_test::serialize()
+{
+   nir_validate_shader(b->shader, "before serialization");
+
+   blob_finish(&blob);
+   blob_init(&blob);
+   nir_serialize(&blob, b->shader);
+   ASSERT_FALSE(blob.out_of_memory);
+}
+
+nir_shader *
+nir_serialize_test::deserialize(const void *data, size_t size)
+{
+   struct blob_reader reader;
+   blob_reader_init(&reader, data, size);
+   return nir_deserialize(mem_ctx, b->shader->options, &reader);
+}
+
+static std::string
+print_shader(nir_shader *shader)
+{
+   nir_foreach_function(func, shader) {
+      if (func->impl) {
+         nir_index_blocks(func->impl);
+         nir_index_ssa_defs(func->impl);
+      }
+   }
+
+   FILE *f = tmpfile();
+   nir_print_shader(shader, f);
+   long size = ftell(f);
+   rewind(f);
+
+   std::string str(size, '\0');
+   size_t read = fread(&str[0], 1, size, f);
+   fclose(f);
+   str.resize(read);
+
+   return str;
+}
+
+void
+nir_serialize_test::expect_round_trip()
+{
+   serialize();
+
+   copy = deserialize(blob.data, blob.size);
+   ASSERT_NE(copy, nullptr);
+   nir_validate_shader(copy, "after deserialization");
+
+   EXPECT_EQ(print_shader(b->shader), print_shader(copy));
+
+   /* Serializing the copy has to give back exactly the same bytes. */
+   struct blob blob2;
+   blob_init(&blob2);
+   nir_serialize(&blob2, copy);
+   ASSERT_EQ(blob.size, blob2.size);
+   EXPECT_EQ(0, memcmp(blob.data, blob2.data, blob.size));
+   blob_finish(&blob2);
+}
+
+nir_alu_instr *
+nir_serialize_test::build_alu(nir_op op, nir_ssa_def *src0, nir_ssa_def *src1)
+{
+   nir_alu_instr *alu = nir_alu_instr_create(b->shader, op);
+   alu->src[0].src = nir_src_for_ssa(src0);
+   if (src1)
+      alu->src[1].src = nir_src_for_ssa(src1);
+   nir_ssa_dest_init(&alu->instr, &alu->dest.dest, 4, 32, NULL);
+   alu->dest.write_mask = 0xf;
+   nir_builder_instr_insert(b, &alu->instr);
+   return alu;
+}
+
+static void
+add_phi_src(nir_phi_instr *phi, nir_block *pred, nir_ssa_def *def)
+{
+   nir_phi_src *src = ralloc(phi, nir_phi_src);
+   src->pred = pred;
+   src->src = nir_src_for_ssa(def);
+   exec_list_push_tail(&phi->srcs, &src->node);
+}
+
+} // namespace
+
+TEST_F(nir_serialize_test, alu)
+{
+   nir_variable *in = create_var(nir_var_shader_in, glsl_vec4_type(), "in");
+   nir_variable *out = create_var(nir_var_shader_out, glsl_vec4_type(), "out");
+
+   nir_ssa_def *v = nir_load_var(b, in);
+
+   nir_alu_instr *add = build_alu(nir_op_fadd, v, v);
+   add->src[0].negate = true;
+   add->src[1].abs = true;
+   for (unsigned i = 0; i < 4; i++)
+      add->src[1].swizzle[i] = 3 - i;
+   add->exact = true;
+
+   nir_alu_instr *sat = build_alu(nir_op_fabs, &add->dest.dest.ssa, NULL);
+   sat->dest.saturate = true;
+   sat->src[0].swizzle[0] = 2;
+
+   nir_ssa_def *cmp = nir_ult(b, nir_channel(b, v, 1), nir_imm_int(b, 7));
+   nir_ssa_def *sel = nir_bcsel(b, cmp, &sat->dest.dest.ssa, v);
+   nir_ssa_def *i = nir_iadd(b, nir_f2i32(b, sel), nir_imm_ivec4(b, 1, 2, 3, 4));
+   nir_instr_as_alu(i->parent_instr)->no_signed_wrap = true;
+   nir_instr_as_alu(i->parent_instr)->no_unsigned_wrap = true;
+
+   nir_store_var(b, out, nir_i2f32(b, i), 0xb);
+
+   expect_round_trip();
+}
+
+TEST_F(nir_serialize_test, constants)
+{
+   nir_imm_bool(b, true);
+   nir_imm_intN_t(b, -3, 8);
+   nir_imm_intN_t(b, 0x1234, 16);
+   nir_imm_float16(b, 1.5f);
+   nir_imm_vec4(b, 1.0f, 2.0f, 3.0f, 4.0f);
+   nir_imm_int64(b, 0x123456789abcdefll);
+   nir_imm_double(b, 3.25);
+   nir_imm_vec4(b, 1.0f, 2.0f, 3.0f, 4.0f);
+   nir_imm_float(b, 1.0f);
+   nir_ssa_undef(b, 3, 16);
+
+   expect_round_trip();
+}
+
+TEST_F(nir_serialize_test, constants_are_deduplicated)
+{
+   nir_variable *out = create_var(nir_var_shader_out, glsl_vec4_type(), "out");
+
+   for (unsigned i = 0; i < 16; i++)
+      nir_store_var(b, out, nir_imm_vec4(b, 1.0f, 2.0f, 3.0f, 4.0f), 0xf);
+
+   serialize();
+   size_t same_size = blob.size;
+
+   copy = deserialize(blob.data, blob.size);
+   ASSERT_NE(copy, nullptr);
+   EXPECT_EQ(print_shader(b->shader), print_shader(copy));
+
+   ralloc_free(b->shader);
+   static const nir_shader_compiler_options options = { };
+   nir_builder_init_simple_shader(b, mem_ctx, MESA_SHADER_FRAGMENT, &options);
+   out = create_var(nir_var_shader_out, glsl_vec4_type(), "out");
+
+   for (unsigned i = 0; i < 16; i++)
+      nir_store_var(b, out, nir_imm_vec4(b, i, 2.0f, 3.0f, 4.0f), 0xf);
+
+   serialize();
+
+   /* A repeated constant is a one-byte index instead of 16 bytes of data. */
+   EXPECT_LE(same_size + 15 * 15, blob.size);
+}
+
+TEST_F(nir_serialize_test, derefs_and_variables)
+{
+   glsl_struct_field fields[2];
+   fields[0] = glsl_struct_field(glsl_vec4_type(), "color");
+   fields[1] = glsl_struct_field(glsl_array_type(glsl_int_type(), 3, 0),
+                                 "idx");
+   const glsl_type *s = glsl_struct_type(fields, 2, "S", false);
+
+   nir_variable *u = create_var(nir_var_uniform, glsl_array_type(s, 4, 0),
+                                "u");
+   u->data.location = 3;
+   u->num_state_slots = 1;
+   u->state_slots = ralloc_array(u, nir_state_slot, 1);
+   memset(u->state_slots, 0, sizeof(*u->state_slots));
+   u->state_slots[0].tokens[0] = 5;
+   u->state_slots[0].swizzle = 0x688;
+
+   nir_variable *t = create_var(nir_var_function_temp, glsl_int_type(), "t");
+   t->constant_initializer = rzalloc(t, nir_constant);
+   t->constant_initializer->values[0].i32 = 42;
+
+   nir_variable *unnamed = create_var(nir_var_shader_out, glsl_vec4_type(),
+                                      NULL);
+
+   nir_ssa_def *index = nir_load_var(b, t);
+   nir_deref_instr *deref = nir_build_deref_var(b, u);
+   deref = nir_build_deref_array(b, deref, index);
+   nir_ssa_def *color = nir_load_deref(b, nir_build_deref_struct(b, deref, 0));
+   nir_deref_instr *idx = nir_build_deref_struct(b, deref, 1);
+   nir_ssa_def *i = nir_load_deref(b, nir_build_deref_array_imm(b, idx, 2));
+
+   nir_store_var(b, unnamed, nir_fmul(b, color, nir_i2f32(b, i)), 0xf);
+
+   expect_round_trip();
+}
+
+TEST_F(nir_serialize_test, control_flow_and_phis)
+{
+   nir_ssa_def *zero = nir_imm_int(b, 0);
+   nir_block *pre_loop = nir_cursor_current_block(b->cursor);
+
+   nir_loop *loop = nir_push_loop(b);
+
+   nir_phi_instr *phi = nir_phi_instr_create(b->shader);
+   nir_ssa_dest_init(&phi->instr, &phi->dest, 1, 32, "counter");
+   nir_ssa_def *c = &phi->dest.ssa;
+
+   nir_push_if(b, nir_ige(b, c, nir_imm_int(b, 10)));
+   nir_jump(b, nir_jump_break);
+   nir_pop_if(b, NULL);
+
+   nir_push_if(b, nir_ieq(b, nir_iand(b, c, nir_imm_int(b, 1)),
+                          nir_imm_int(b, 0)));
+   nir_ssa_def *then_val = nir_iadd(b, c, nir_imm_int(b, 3));
+   nir_block *then_block = nir_cursor_current_block(b->cursor);
+   nir_push_else(b, NULL);
+   nir_ssa_def *else_val = nir_iadd(b, c, nir_imm_int(b, 1));
+   nir_block *else_block = nir_cursor_current_block(b->cursor);
+   nir_pop_if(b, NULL);
+
+   nir_phi_instr *merge = nir_phi_instr_create(b->shader);
+   nir_ssa_dest_init(&merge->instr, &merge->dest, 1, 32, NULL);
+   add_phi_src(merge, then_block, then_val);
+   add_phi_src(merge, else_block, else_val);
+   nir_builder_instr_insert(b, &merge->instr);
+   nir_block *continue_block = nir_cursor_current_block(b->cursor);
+
+   nir_pop_loop(b, loop);
+
+   /* The loop header phi references a value defined later in the loop. */
+   add_phi_src(phi, pre_loop, zero);
+   add_phi_src(phi, continue_block, &merge->dest.ssa);
+   nir_instr_insert(nir_before_block(nir_loop_first_block(loop)), &phi->instr);
+
+   /* No derefs, so that we can go out of SSA below. */
+   nir_intrinsic_instr *store =
+      nir_intrinsic_instr_create(b->shader, nir_intrinsic_store_output);
+   store->num_components = 1;
+   store->src[0] = nir_src_for_ssa(c);
+   store->src[1] = nir_src_for_ssa(nir_imm_int(b, 0));
+   nir_intrinsic_set_base(store, 2);
+   nir_intrinsic_set_write_mask(store, 0x1);
+   nir_builder_instr_insert(b, &store->instr);
+
+   expect_round_trip();
+
+   /* Now the same shader with registers instead of SSA values. */
+   nir_convert_from_ssa(b->shader, false);
+   expect_round_trip();
+}
+
+TEST_F(nir_serialize_test, registers)
+{
+   nir_register *reg = nir_local_reg_create(b->impl);
+   reg->num_components = 2;
+   reg->num_array_elems = 4;
+   reg->name = ralloc_strdup(reg, "r");
+
+   nir_ssa_def *index = nir_imm_int(b, 1);
+
+   nir_alu_instr *mov = nir_alu_instr_create(b->shader, nir_op_mov);
+   mov->src[0].src = nir_src_for_ssa(nir_imm_ivec2(b, 5, 6));
+   mov->dest.dest = nir_dest_for_reg(reg);
+   mov->dest.dest.reg.base_offset = 1;
+   mov->dest.dest.reg.indirect = ralloc(mov, nir_src);
+   *mov->dest.dest.reg.indirect = nir_src_for_ssa(index);
+   mov->dest.write_mask = 0x2;
+   nir_builder_instr_insert(b, &mov->instr);
+
+   nir_alu_instr *read = nir_alu_instr_create(b->shader, nir_op_mov);
+   read->src[0].src = nir_src_for_reg(reg);
+   read->src[0].src.reg.base_offset = 2;
+   read->src[0].swizzle[0] = 1;
+   read->src[0].swizzle[1] = 1;
+   nir_ssa_dest_init(&read->instr, &read->dest.dest, 2, 32, "read");
+   read->dest.write_mask = 0x3;
+   nir_builder_instr_insert(b, &read->instr);
+
+   expect_round_trip();
+}
+
+TEST_F(nir_serialize_test, tex)
+{
+   nir_variable *tex_var = create_var(nir_var_uniform,
+                                      glsl_sampler_type(GLSL_SAMPLER_DIM_2D,
+                                                        false, false,
+                                                        GLSL_TYPE_FLOAT),
+                                      "tex");
+   tex_var->data.binding = 2;
+
+   nir_deref_instr *deref = nir_build_deref_var(b, tex_var);
+   nir_ssa_def *coord = nir_imm_vec2(b, 0.5f, 0.25f);
+
+   nir_tex_instr *tex = nir_tex_instr_create(b->shader, 3);
+   tex->op = nir_texop_tg4;
+   tex->sampler_dim = GLSL_SAMPLER_DIM_2D;
+   tex->dest_type = nir_type_float;
+   tex->coord_components = 2;
+   tex->is_array = false;
+   tex->component = 2;
+   tex->texture_index = 1;
+   tex->sampler_index = 3;
+   tex->tg4_offsets[1][0] = -2;
+   tex->tg4_offsets[3][1] = 7;
+   tex->src[0].src_type = nir_tex_src_coord;
+   tex->src[0].src = nir_src_for_ssa(coord);
+   tex->src[1].src_type = nir_tex_src_texture_deref;
+   tex->src[1].src = nir_src_for_ssa(&deref->dest.ssa);
+   tex->src[2].src_type = nir_tex_src_sampler_deref;
+   tex->src[2].src = nir_src_for_ssa(&deref->dest.ssa);
+   nir_ssa_dest_init(&tex->instr, &tex->dest, 4, 32, NULL);
+   nir_builder_instr_insert(b, &tex->instr);
+
+   expect_round_trip();
+}
+
+TEST_F(nir_serialize_test, functions_and_calls)
+{
+   nir_function *helper = nir_function_create(b->shader, "helper");
+   helper->num_params = 2;
+   helper->params = ralloc_array(helper, nir_parameter, 2);
+   helper->params[0].num_components = 1;
+   helper->params[0].bit_size = 32;
+   helper->params[1].num_components = 1;
+   helper->params[1].bit_size = 64;
+   helper->impl = nir_function_impl_create(helper);
+
+   nir_call_instr *call = nir_call_instr_create(b->shader, helper);
+   call->params[0] = nir_src_for_ssa(nir_imm_int(b, 1));
+   call->params[1] = nir_src_for_ssa(nir_imm_int64(b, 2));
+   nir_builder_instr_insert(b, &call->instr);
+
+   nir_jump(b, nir_jump_return);
+
+   expect_round_trip();
+}
+
+TEST_F(nir_serialize_test, shader_info_and_constant_data)
+{
+   b->shader->info.name = ralloc_strdup(b->shader, "name");
+   b->shader->info.label = ralloc_strdup(b->shader, "label");
+   b->shader->info.inputs_read = 0x123;
+   b->shader->num_uniforms = 17;
+   b->shader->scratch_size = 64;
+   b->shader->constant_data_size = 8;
+   b->shader->constant_data = ralloc_size(b->shader, 8);
+   memcpy(b->shader->constant_data, "abcdefgh", 8);
+
+   serialize();
+   copy = deserialize(blob.data, blob.size);
+   ASSERT_NE(copy, nullptr);
+
+   EXPECT_STREQ("name", copy->info.name);
+   EXPECT_STREQ("label", copy->info.label);
+   EXPECT_EQ(0x123u, copy->info.inputs_read);
+   EXPECT_EQ(17u, copy->num_uniforms);
+   EXPECT_EQ(64u, copy->scratch_size);
+   ASSERT_EQ(8u, copy->constant_data_size);
+   EXPECT_EQ(0, memcmp(copy->constant_data, "abcdefgh", 8));
+}
+
+TEST_F(nir_serialize_test, rejects_other_versions)
+{
+   glsl_struct_field fields[2];
+   fields[0] = glsl_struct_field(glsl_vec4_type(), "scale");
+   fields[1] = glsl_struct_field(glsl_int_type(), "flags");
+   const glsl_type *s = glsl_struct_type(fields, 2, "S", false);
+
+   nir_variable *u = create_var(nir_var_uniform, s, "u");
+   nir_variable *in = create_var(nir_var_shader_in, glsl_vec4_type(), "in");
+   nir_variable *out = create_var(nir_var_shader_out, glsl_vec4_type(), "out");
+
+   /* Give the blob a struct type, control flow, a phi and repeated constants
+    * so that every kind of record gets cut off somewhere below.
+    */
+   nir_deref_instr *scale =
+      nir_build_deref_struct(b, nir_build_deref_var(b, u), 0);
+   nir_ssa_def *val = nir_fmul(b, nir_load_var(b, in), nir_load_deref(b, scale));
+   nir_push_if(b, nir_flt(b, nir_channel(b, val, 0), nir_imm_float(b, 0.0f)));
+   nir_ssa_def *then_val = nir_fneg(b, val);
+   nir_push_else(b, NULL);
+   nir_ssa_def *else_val = nir_fadd(b, val, nir_imm_vec4(b, 1.0f, 2.0f,
+                                                         3.0f, 4.0f));
+   nir_pop_if(b, NULL);
+   nir_ssa_def *res = nir_if_phi(b, then_val, else_val);
+   nir_store_var(b, out, nir_fmul(b, res, nir_imm_vec4(b, 1.0f, 2.0f,
+                                                       3.0f, 4.0f)), 0xf);
+
+   serialize();
+
+   /* The second word of the header is the format version. */
+   uint8_t *data = (uint8_t *)malloc(blob.size);
+   memcpy(data, blob.data, blob.size);
+   uint32_t version;
+   memcpy(&version, data + 4, 4);
+   version++;
+   memcpy(data + 4, &version, 4);
+   EXPECT_EQ(nullptr, deserialize(data, blob.size));
+
+   /* A different magic number, e.g. an entry from before the header existed,
+    * is rejected too.
+    */
+   memcpy(data, blob.data, blob.size);
+   data[0] ^= 0xff;
+   EXPECT_EQ(nullptr, deserialize(data, blob.size));
+
+   /* An index table larger than the rest of the blob is never allocated. */
+   memcpy(data, blob.data, blob.size);
+   memset(data + 8, 0xff, 4);
+   EXPECT_EQ(nullptr, deserialize(data, blob.size));
+   free(data);
+
+   /* So is a blob truncated anywhere. */
+   for (size_t size = 0; size < blob.size; size++)
+      EXPECT_EQ(nullptr, deserialize(blob.data, size)) << "size " << size;
+
+   EXPECT_NE(nullptr, deserialize(blob.data, blob.size));
+}
@@ -101,6 +101,38 @@ nir_shader *spirv_to_nir(const uint32_t *words, size_t word_count,
                          const struct spirv_to_nir_options *options,
                          const nir_shader_compiler_options *nir_options);
 
+struct disk_cache;
+
+/**
+ * Computes the disk cache key for the NIR made from a SPIR-V module.
+ *
+ * Everything spirv_to_nir() takes is part of the key, except for the module
+ * itself, which is represented by its SHA-1, and nir_options, which are
+ * expected to follow from the driver and stage.  The union in each
+ * specialization is hashed as a whole, so unused bits must be zero.
+ *
+ * If the driver lowers the shader before putting it in the cache, anything
+ * that lowering depends on beyond the driver build goes in driver_data.
+ */
+void spirv_to_nir_cache_key(struct disk_cache *cache,
+                            const unsigned char module_sha1[20],
+                            const char *entry_point_name,
+                            gl_shader_stage stage,
+                            const struct nir_spirv_specialization *spec,
+                            unsigned num_spec,
+                            const struct spirv_to_nir_options *options,
+                            const void *driver_data, size_t driver_data_size,
+                            unsigned char key[20]);
+
+/** Returns NULL on a miss or without a cache. */
+nir_shader *spirv_to_nir_cache_search(struct disk_cache *cache,
+                                      const unsigned char key[20],
+                                      const nir_shader_compiler_options *nir_options);
+
+void spirv_to_nir_cache_upload(struct disk_cache *cache,
+                               const unsigned char key[20],
+                               const nir_shader *nir);
+
 #ifdef __cplusplus
 }
 #endif
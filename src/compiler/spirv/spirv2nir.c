@@ -38,17 +38,190 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <errno.h>
 #include <string.h>
+#include <getopt.h>
+
+#include "util/disk_cache.h"
+#include "util/mesa-sha1.h"
+#include "util/os_time.h"
 
 #define WORD_SIZE 4
 
+static void
+print_usage(const char *argv0)
+{
+   fprintf(stderr,
+           "Usage: %s [-s stage] [-e entry point] [-b iterations] file.spv\n"
+           "\n"
+           "  -s  vert, tesc, tese, geom, frag (default) or comp\n"
+           "  -e  entry point name, \"main\" by default\n"
+           "  -b  instead of printing the NIR, time converting the shader the\n"
+           "      given number of times, with and without the NIR cache\n",
+           argv0);
+}
+
+static bool
+parse_stage(const char *name, gl_shader_stage *stage)
+{
+   static const struct {
+      const char *name;
+      gl_shader_stage stage;
+   } stages[] = {
+      { "vert", MESA_SHADER_VERTEX },
+      { "tesc", MESA_SHADER_TESS_CTRL },
+      { "tese", MESA_SHADER_TESS_EVAL },
+      { "geom", MESA_SHADER_GEOMETRY },
+      { "frag", MESA_SHADER_FRAGMENT },
+      { "comp", MESA_SHADER_COMPUTE },
+   };
+
+   for (unsigned i = 0; i < ARRAY_SIZE(stages); i++) {
+      if (strcmp(name, stages[i].name) == 0) {
+         *stage = stages[i].stage;
+         return true;
+      }
+   }
+
+   return false;
+}
+
+static const nir_shader_compiler_options nir_options = { 0 };
+
+/* Roughly what Vulkan drivers do with the shader before anything depends on
+ * the rest of the pipeline, which is what makes sense to cache.
+ */
+static nir_shader *
+compile(const uint32_t *words, size_t word_count, gl_shader_stage stage,
+        const char *entry_point, const struct spirv_to_nir_options *opts)
+{
+   nir_shader *nir = spirv_to_nir(words, word_count, NULL, 0, stage,
+                                  entry_point, opts, &nir_options);
+
+   nir_lower_constant_initializers(nir, nir_var_function_temp);
+   nir_lower_returns(nir);
+   nir_inline_functions(nir);
+   nir_opt_deref(nir);
+
+   foreach_list_typed_safe(nir_function, func, node, &nir->functions) {
+      if (!func->is_entrypoint)
+         exec_node_remove(&func->node);
+   }
+
+   nir_lower_constant_initializers(nir, ~0);
+   nir_split_var_copies(nir);
+   nir_lower_var_copies(nir);
+   nir_lower_vars_to_ssa(nir);
+
+   bool progress;
+   do {
+      progress = false;
+      progress |= nir_copy_prop(nir);
+      progress |= nir_opt_dce(nir);
+      progress |= nir_opt_cse(nir);
+      progress |= nir_opt_algebraic(nir);
+      progress |= nir_opt_constant_folding(nir);
+   } while (progress);
+
+   return nir;
+}
+
+static int
+bench(const uint32_t *words, size_t word_count, gl_shader_stage stage,
+      const char *entry_point, const struct spirv_to_nir_options *opts,
+      unsigned iterations)
+{
+   struct disk_cache *cache = disk_cache_create("spirv2nir", "bench", 0);
+   if (!cache) {
+      fprintf(stderr, "The disk cache is disabled\n");
+      return 1;
+   }
+
+   int64_t start = os_time_get_nano();
+   for (unsigned i = 0; i < iterations; i++)
+      ralloc_free(compile(words, word_count, stage, entry_point, opts));
+   int64_t uncached_ns = os_time_get_nano() - start;
+
+   /* Drivers hash the module once, when it is created. */
+   unsigned char module_sha1[20];
+   _mesa_sha1_compute(words, word_count * WORD_SIZE, module_sha1);
+
+   unsigned char key[20];
+   spirv_to_nir_cache_key(cache, module_sha1, entry_point, stage, NULL, 0,
+                          opts, NULL, 0, key);
+
+   nir_shader *nir = spirv_to_nir_cache_search(cache, key, &nir_options);
+   if (!nir) {
+      nir = compile(words, word_count, stage, entry_point, opts);
+      spirv_to_nir_cache_upload(cache, key, nir);
+      disk_cache_wait_for_idle(cache);
+   }
+   ralloc_free(nir);
+
+   unsigned misses = 0;
+   start = os_time_get_nano();
+   for (unsigned i = 0; i < iterations; i++) {
+      spirv_to_nir_cache_key(cache, module_sha1, entry_point, stage, NULL, 0,
+                             opts, NULL, 0, key);
+      nir = spirv_to_nir_cache_search(cache, key, &nir_options);
+      if (!nir) {
+         misses++;
+         nir = compile(words, word_count, stage, entry_point, opts);
+      }
+      ralloc_free(nir);
+   }
+   int64_t cached_ns = os_time_get_nano() - start;
+
+   disk_cache_destroy(cache);
+
+   printf("spirv_to_nir + lowering: %10.1f us per shader\n",
+          uncached_ns / 1000.0 / iterations);
+   printf("from the NIR cache:      %10.1f us per shader (%.1fx)\n",
+          cached_ns / 1000.0 / iterations,
+          (double) uncached_ns / MAX2(cached_ns, 1));
+   if (misses)
+      printf("%u of %u lookups missed\n", misses, iterations);
+
+   return 0;
+}
+
 int main(int argc, char **argv)
 {
-   int fd = open(argv[1], O_RDONLY);
+   gl_shader_stage stage = MESA_SHADER_FRAGMENT;
+   const char *entry_point = "main";
+   unsigned iterations = 0;
+   int opt;
+
+   while ((opt = getopt(argc, argv, "s:e:b:")) != -1) {
+      switch (opt) {
+      case 's':
+         if (!parse_stage(optarg, &stage)) {
+            print_usage(argv[0]);
+            return 1;
+         }
+         break;
+      case 'e':
+         entry_point = optarg;
+         break;
+      case 'b':
+         iterations = strtoul(optarg, NULL, 10);
+         break;
+      default:
+         print_usage(argv[0]);
+         return 1;
+      }
+   }
+
+   if (optind != argc - 1) {
+      print_usage(argv[0]);
+      return 1;
+   }
+
+   int fd = open(argv[optind], O_RDONLY);
    if (fd < 0)
    {
-      fprintf(stderr, "Failed to open %s\n", argv[1]);
+      fprintf(stderr, "Failed to open %s\n", argv[optind]);
       return 1;
    }
 
@@ -74,8 +247,12 @@ int main(int argc, char **argv)
 
    struct spirv_to_nir_options spirv_opts = {};
 
+   if (iterations)
+      return bench(map, word_count, stage, entry_point, &spirv_opts,
+                   iterations);
+
    nir_shader *nir = spirv_to_nir(map, word_count, NULL, 0,
-                                  MESA_SHADER_FRAGMENT, "main",
+                                  stage, entry_point,
                                   &spirv_opts, NULL);
    nir_print_shader(nir, stderr);
 
@@ -417,7 +417,13 @@ _foreach_decoration_helper(struct vtn_builder *b,
                            struct vtn_value *value,
                            vtn_decoration_foreach_cb cb, void *data)
 {
-   for (struct vtn_decoration *dec = value->decoration; dec; dec = dec->next) {
+   const uint32_t id = value - b->values;
+   const struct vtn_decoration *first =
+      &b->decorations[b->decoration_start[id]];
+
+   /* Last one in the module first, like they were handed out before */
+   for (unsigned i = b->decoration_count[id]; i-- > 0;) {
+      const struct vtn_decoration *dec = &first[i];
       int member;
       if (dec->scope == VTN_DEC_DECORATION) {
          member = parent_member;
@@ -468,7 +474,11 @@ void
 vtn_foreach_execution_mode(struct vtn_builder *b, struct vtn_value *value,
                            vtn_execution_mode_foreach_cb cb, void *data)
 {
-   for (struct vtn_decoration *dec = value->decoration; dec; dec = dec->next) {
+   const uint32_t id = value - b->values;
+   const struct vtn_decoration *first =
+      &b->decorations[b->decoration_start[id]];
+   for (unsigned i = b->decoration_count[id]; i-- > 0;) {
+      const struct vtn_decoration *dec = &first[i];
       if (dec->scope != VTN_DEC_EXECUTION_MODE)
          continue;
 
@@ -477,6 +487,83 @@ vtn_foreach_execution_mode(struct vtn_builder *b, struct vtn_value *value,
    }
 }
 
+/* Counts the decorations and execution modes on each id so that they can all
+ * live in one array.  This runs before there is anywhere for vtn_fail() to
+ * jump to, so it only skips what it can't make sense of and leaves reporting
+ * it to the passes that handle those instructions.
+ */
+static void
+vtn_index_decorations(struct vtn_builder *b, const uint32_t *w,
+                      const uint32_t *end)
+{
+   const unsigned bound = b->value_id_bound;
+   uint32_t *start = rzalloc_array(b, uint32_t, bound + 1);
+
+   while (w < end) {
+      SpvOp opcode = w[0] & SpvOpCodeMask;
+      unsigned count = w[0] >> SpvWordCountShift;
+      if (count < 1 || w + count > end)
+         break;
+
+      /* Nothing from here on can be a decoration. */
+      if (opcode == SpvOpFunction)
+         break;
+
+      switch (opcode) {
+      case SpvOpDecorate:
+      case SpvOpDecorateId:
+      case SpvOpMemberDecorate:
+      case SpvOpDecorateString:
+      case SpvOpMemberDecorateString:
+      case SpvOpExecutionMode:
+      case SpvOpExecutionModeId:
+         if (count > 1 && w[1] < bound)
+            start[w[1]]++;
+         break;
+
+      case SpvOpGroupDecorate:
+      case SpvOpGroupMemberDecorate: {
+         const unsigned step = opcode == SpvOpGroupDecorate ? 1 : 2;
+         for (unsigned i = 2; i < count; i += step) {
+            if (w[i] < bound)
+               start[w[i]]++;
+         }
+         break;
+      }
+
+      default:
+         break;
+      }
+
+      w += count;
+   }
+
+   /* Turn the counts into offsets, so that the slots for id i are
+    * start[i] through start[i + 1] - 1.
+    */
+   uint32_t total = 0;
+   for (unsigned i = 0; i <= bound; i++) {
+      uint32_t id_count = start[i];
+      start[i] = total;
+      total += id_count;
+   }
+
+   b->decorations = rzalloc_array(b, struct vtn_decoration, total);
+   b->decoration_start = start;
+   b->decoration_count = rzalloc_array(b, uint32_t, bound);
+}
+
+static struct vtn_decoration *
+vtn_alloc_decoration(struct vtn_builder *b, uint32_t id)
+{
+   const uint32_t slot = b->decoration_start[id] + b->decoration_count[id];
+   vtn_fail_if(slot >= b->decoration_start[id + 1],
+               "SPIR-V id %u has more decorations than expected", id);
+
+   b->decoration_count[id]++;
+   return &b->decorations[slot];
+}
+
 void
 vtn_handle_decoration(struct vtn_builder *b, SpvOp opcode,
                       const uint32_t *w, unsigned count)
@@ -497,9 +584,9 @@ vtn_handle_decoration(struct vtn_builder *b, SpvOp opcode,
    case SpvOpMemberDecorateString:
    case SpvOpExecutionMode:
    case SpvOpExecutionModeId: {
-      struct vtn_value *val = vtn_untyped_value(b, target);
+      vtn_untyped_value(b, target);
 
-      struct vtn_decoration *dec = rzalloc(b, struct vtn_decoration);
+      struct vtn_decoration *dec = vtn_alloc_decoration(b, target);
       switch (opcode) {
       case SpvOpDecorate:
       case SpvOpDecorateId:
@@ -521,10 +608,6 @@ vtn_handle_decoration(struct vtn_builder *b, SpvOp opcode,
       }
       dec->decoration = *(w++);
       dec->operands = w;
-
-      /* Link into the list */
-      dec->next = val->decoration;
-      val->decoration = dec;
       break;
    }
 
@@ -534,8 +617,8 @@ vtn_handle_decoration(struct vtn_builder *b, SpvOp opcode,
          vtn_value(b, target, vtn_value_type_decoration_group);
 
       for (; w < w_end; w++) {
-         struct vtn_value *val = vtn_untyped_value(b, *w);
-         struct vtn_decoration *dec = rzalloc(b, struct vtn_decoration);
+         vtn_untyped_value(b, *w);
+         struct vtn_decoration *dec = vtn_alloc_decoration(b, *w);
 
          dec->group = group;
          if (opcode == SpvOpGroupDecorate) {
@@ -545,10 +628,6 @@ vtn_handle_decoration(struct vtn_builder *b, SpvOp opcode,
             vtn_fail_if(dec->scope < 0, /* Check for overflow */
                         "Member argument of OpGroupMemberDecorate too large");
          }
-
-         /* Link into the list */
-         dec->next = val->decoration;
-         val->decoration = dec;
       }
       break;
    }
@@ -4593,6 +4672,8 @@ vtn_create_builder(const uint32_t *words, size_t word_count,
    b->value_id_bound = value_id_bound;
    b->values = rzalloc_array(b, struct vtn_value, value_id_bound);
 
+   vtn_index_decorations(b, words + 5, words + word_count);
+
    return b;
  fail:
    ralloc_free(b);
@@ -4725,9 +4806,7 @@ spirv_to_nir(const uint32_t *words, size_t word_count,
       b->shader->info.cs.local_size[2] = const_size[2].u32;
    }
 
-   /* Set types on all vtn_values */
-   vtn_foreach_instruction(b, words, word_end, vtn_set_instruction_result_type);
-
+   /* This also sets the types on all vtn_values */
    vtn_build_cfg(b, words, word_end);
 
    assert(b->entry_point->value_type == vtn_value_type_function);
@@ -0,0 +1,134 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Caching of spirv_to_nir results, and whatever lowering the driver does
+ * right after it, in the disk cache.
+ *
+ * Pipelines that share a shader module and entry point but differ in other
+ * state all go through the same front end work, which can take as long as
+ * the back end.  The driver looks up the NIR under a key from
+ * spirv_to_nir_cache_key() and only runs spirv_to_nir on a miss.
+ */
+
+#include "nir_spirv.h"
+#include "nir/nir_serialize.h"
+#include "util/disk_cache.h"
+#include "util/mesa-sha1.h"
+
+/* Bump this when something changes what a given set of inputs turns into
+ * without changing the build, like a different key layout.
+ */
+#define SPIRV_TO_NIR_CACHE_VERSION 1
+
+void
+spirv_to_nir_cache_key(struct disk_cache *cache,
+                       const unsigned char module_sha1[20],
+                       const char *entry_point_name, gl_shader_stage stage,
+                       const struct nir_spirv_specialization *spec,
+                       unsigned num_spec,
+                       const struct spirv_to_nir_options *options,
+                       const void *driver_data, size_t driver_data_size,
+                       unsigned char key[20])
+{
+   struct blob blob;
+   blob_init(&blob);
+
+   blob_write_string(&blob, "spirv_to_nir");
+   blob_write_uint32(&blob, SPIRV_TO_NIR_CACHE_VERSION);
+
+   blob_write_bytes(&blob, module_sha1, 20);
+   blob_write_string(&blob, entry_point_name);
+   blob_write_uint32(&blob, stage);
+
+   blob_write_uint32(&blob, num_spec);
+   for (unsigned i = 0; i < num_spec; i++) {
+      blob_write_uint32(&blob, spec[i].id);
+      blob_write_uint64(&blob, spec[i].data64);
+   }
+
+   /* Field by field, to stay clear of padding and the debug callback */
+   blob_write_uint32(&blob, options->environment);
+   blob_write_uint8(&blob, options->lower_workgroup_access_to_offsets);
+   blob_write_uint8(&blob, options->lower_ubo_ssbo_access_to_offsets);
+   blob_write_bytes(&blob, &options->caps, sizeof(options->caps));
+   blob_write_uint32(&blob, options->ubo_addr_format);
+   blob_write_uint32(&blob, options->ssbo_addr_format);
+   blob_write_uint32(&blob, options->phys_ssbo_addr_format);
+   blob_write_uint32(&blob, options->push_const_addr_format);
+   blob_write_uint32(&blob, options->shared_addr_format);
+   blob_write_uint32(&blob, options->global_addr_format);
+   blob_write_uint32(&blob, options->temp_addr_format);
+
+   if (driver_data_size)
+      blob_write_bytes(&blob, driver_data, driver_data_size);
+
+   /* The disk cache adds what identifies the driver build. */
+   if (cache)
+      disk_cache_compute_key(cache, blob.data, blob.size, key);
+   else
+      _mesa_sha1_compute(blob.data, blob.size, key);
+
+   blob_finish(&blob);
+}
+
+nir_shader *
+spirv_to_nir_cache_search(struct disk_cache *cache,
+                          const unsigned char key[20],
+                          const nir_shader_compiler_options *nir_options)
+{
+   if (!cache)
+      return NULL;
+
+   size_t size;
+   void *data = disk_cache_get(cache, key, &size);
+   if (!data)
+      return NULL;
+
+   struct blob_reader blob;
+   blob_reader_init(&blob, data, size);
+
+   /* Entries from another version of the serializer just miss. */
+   nir_shader *nir = nir_deserialize(NULL, nir_options, &blob);
+   free(data);
+
+   return nir;
+}
+
+void
+spirv_to_nir_cache_upload(struct disk_cache *cache,
+                          const unsigned char key[20],
+                          const nir_shader *nir)
+{
+   if (!cache)
+      return;
+
+   struct blob blob;
+   blob_init(&blob);
+
+   nir_serialize(&blob, nir);
+   if (!blob.out_of_memory)
+      disk_cache_put(cache, key, blob.data, blob.size, NULL);
+
+   blob_finish(&blob);
+}
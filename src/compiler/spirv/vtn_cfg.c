@@ -240,6 +240,12 @@ static bool
 vtn_cfg_handle_prepass_instruction(struct vtn_builder *b, SpvOp opcode,
                                    const uint32_t *w, unsigned count)
 {
+   /* Types have to be known for forward references by the time functions
+    * are emitted.  Setting them here saves a separate walk over all the
+    * function bodies.
+    */
+   vtn_set_instruction_result_type(b, opcode, w, count);
+
    switch (opcode) {
    case SpvOpFunction: {
       vtn_assert(b->func == NULL);
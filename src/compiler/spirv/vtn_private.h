@@ -539,7 +539,6 @@ struct vtn_sampled_image {
 struct vtn_value {
    enum vtn_value_type value_type;
    const char *name;
-   struct vtn_decoration *decoration;
    struct vtn_type *type;
    union {
       void *ptr;
@@ -560,8 +559,6 @@ struct vtn_value {
 #define VTN_DEC_STRUCT_MEMBER0 0
 
 struct vtn_decoration {
-   struct vtn_decoration *next;
-
    /* Specifies how to apply this decoration.  Negative values represent a
     * decoration or execution mode. (See the VTN_DEC_ #defines above.)
     * Non-negative values specify that it applies to a structure member.
@@ -617,6 +614,15 @@ struct vtn_builder {
    unsigned value_id_bound;
    struct vtn_value *values;
 
+   /* Decorations and execution modes, grouped by the id they apply to.
+    * vtn_index_decorations() counts them up front so that the ones on id i
+    * get the slots from decorations[decoration_start[i]] on, of which the
+    * first decoration_count[i] are filled in.
+    */
+   struct vtn_decoration *decorations;
+   uint32_t *decoration_start;
+   uint32_t *decoration_count;
+
    /* True if we should watch out for GLSLang issue #179 */
    bool wa_glslang_179;
 
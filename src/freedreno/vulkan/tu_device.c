@@ -353,6 +353,7 @@ static const struct debug_control tu_debug_options[] = {
    { "startup", TU_DEBUG_STARTUP },
    { "nir", TU_DEBUG_NIR },
    { "ir3", TU_DEBUG_IR3 },
+   { "nocache", TU_DEBUG_NOCACHE },
    { NULL, 0 }
 };
 
@@ -30,6 +30,8 @@
 
 static nir_shader *
 tu_spirv_to_nir(struct ir3_compiler *compiler,
+                struct disk_cache *disk_cache,
+                const unsigned char *module_sha1,
                 const uint32_t *words,
                 size_t word_count,
                 gl_shader_stage stage,
@@ -49,7 +51,10 @@ tu_spirv_to_nir(struct ir3_compiler *compiler,
    struct nir_spirv_specialization *spec = NULL;
    uint32_t num_spec = 0;
    if (spec_info && spec_info->mapEntryCount) {
-      spec = malloc(sizeof(*spec) * spec_info->mapEntryCount);
+      /* Zeroed, so that the cache key doesn't depend on the unused half of
+       * 32-bit values.
+       */
+      spec = calloc(spec_info->mapEntryCount, sizeof(*spec));
       if (!spec)
          return NULL;
 
@@ -68,9 +73,20 @@ tu_spirv_to_nir(struct ir3_compiler *compiler,
       num_spec = spec_info->mapEntryCount;
    }
 
+   /* Only the output of spirv_to_nir is cached; everything done to it in
+    * tu_shader_create is cheap by comparison.
+    */
+   unsigned char nir_key[20];
+   spirv_to_nir_cache_key(disk_cache, module_sha1, entry_point_name, stage,
+                          spec, num_spec, &spirv_options, NULL, 0, nir_key);
+
    nir_shader *nir =
-      spirv_to_nir(words, word_count, spec, num_spec, stage, entry_point_name,
-                   &spirv_options, nir_options);
+      spirv_to_nir_cache_search(disk_cache, nir_key, nir_options);
+   if (!nir) {
+      nir = spirv_to_nir(words, word_count, spec, num_spec, stage,
+                         entry_point_name, &spirv_options, nir_options);
+      spirv_to_nir_cache_upload(disk_cache, nir_key, nir);
+   }
 
    free(spec);
 
@@ -126,11 +142,16 @@ tu_shader_create(struct tu_device *dev,
    if (!shader)
       return NULL;
 
+   struct disk_cache *disk_cache = NULL;
+   if (!(dev->physical_device->instance->debug_flags & TU_DEBUG_NOCACHE))
+      disk_cache = dev->physical_device->disk_cache;
+
    /* translate SPIR-V to NIR */
    assert(module->code_size % 4 == 0);
    nir_shader *nir = tu_spirv_to_nir(
-      dev->compiler, (const uint32_t *) module->code, module->code_size / 4,
-      stage, stage_info->pName, stage_info->pSpecializationInfo);
+      dev->compiler, disk_cache, module->sha1, (const uint32_t *) module->code,
+      module->code_size / 4, stage, stage_info->pName,
+      stage_info->pSpecializationInfo);
    if (!nir) {
       vk_free2(&dev->alloc, alloc, shader);
       return NULL;
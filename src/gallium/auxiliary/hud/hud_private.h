@@ -37,6 +37,8 @@ enum hud_counter {
    HUD_COUNTER_OFFLOADED,
    HUD_COUNTER_DIRECT,
    HUD_COUNTER_SYNCS,
+   HUD_COUNTER_BATCHES,
+   HUD_COUNTER_SYNC_WAIT,
 };
 
 struct hud_context {
@@ -417,6 +417,7 @@ public:
       spill_vgrf_ip = NULL;
       spill_vgrf_ip_alloc = 0;
       spill_node_count = 0;
+      spilled_reg_count = 0;
    }
 
    ~fs_reg_alloc()
@@ -436,6 +437,7 @@ private:
 
    void set_spill_costs();
    int choose_spill_reg();
+   unsigned choose_spill_regs(unsigned *regs, unsigned max_regs);
    fs_reg alloc_spill_reg(unsigned size, int ip);
    void spill_reg(unsigned spill_reg);
 
@@ -463,6 +465,9 @@ private:
    int *spill_vgrf_ip;
    int spill_vgrf_ip_alloc;
    int spill_node_count;
+
+   /* Number of VGRFs spilled so far because allocation failed */
+   unsigned spilled_reg_count;
 };
 
 /**
@@ -963,6 +968,21 @@ fs_reg_alloc::choose_spill_reg()
    return node - first_vgrf_node;
 }
 
+unsigned
+fs_reg_alloc::choose_spill_regs(unsigned *regs, unsigned max_regs)
+{
+   if (!have_spill_costs)
+      set_spill_costs();
+
+   unsigned count = ra_get_best_spill_nodes(g, regs, max_regs);
+   for (unsigned i = 0; i < count; i++) {
+      assert(regs[i] >= (unsigned)first_vgrf_node);
+      regs[i] -= first_vgrf_node;
+   }
+
+   return count;
+}
+
 fs_reg
 fs_reg_alloc::alloc_spill_reg(unsigned size, int ip)
 {
@@ -1165,11 +1185,19 @@ fs_reg_alloc::assign_regs(bool allow_spilling, bool spill_all)
       if (!allow_spilling)
          return false;
 
-      /* Failed to allocate registers.  Spill a reg, and the caller will
-       * loop back into here to try again.
+      /* Failed to allocate registers.  Spill some regs and try again.
+       *
+       * Each attempt costs a full allocation, so shaders needing lots of
+       * spills would go quadratic if we spilled one reg at a time.  Once a
+       * shader has spilled a few regs, spill a number of regs proportional
+       * to what we have spilled so far, which bounds the extra spilling to
+       * about an eighth.
        */
-      int reg = choose_spill_reg();
-      if (reg == -1)
+      unsigned spill_regs[16];
+      unsigned max_spills = MIN2(1 + spilled_reg_count / 8,
+                                 ARRAY_SIZE(spill_regs));
+      unsigned spill_count = choose_spill_regs(spill_regs, max_spills);
+      if (spill_count == 0)
          return false;
 
       /* If we're going to spill but we've never spilled before, we need to
@@ -1182,7 +1210,9 @@ fs_reg_alloc::assign_regs(bool allow_spilling, bool spill_all)
 
       spilled = true;
 
-      spill_reg(reg);
+      for (unsigned i = 0; i < spill_count; i++)
+         spill_reg(spill_regs[i]);
+      spilled_reg_count += spill_count;
    }
 
    if (spilled)
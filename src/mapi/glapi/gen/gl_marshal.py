@@ -87,9 +87,14 @@ class PrintCode(gl_XML.gl_print_base):
         else:
             out('return {0};'.format(call))
 
+    def print_call_after(self, func):
+        if func.marshal_call_after:
+            out('{0};'.format(func.marshal_call_after))
+
     def print_sync_dispatch(self, func):
         out('debug_print_sync_fallback("{0}");'.format(func.name))
         self.print_sync_call(func)
+        self.print_call_after(func)
 
     def print_sync_body(self, func):
         out('/* {0}: marshalled synchronously */'.format(func.name))
@@ -98,9 +103,10 @@ class PrintCode(gl_XML.gl_print_base):
         out('{')
         with indent():
             out('GET_CURRENT_CONTEXT(ctx);')
-            out('_mesa_glthread_finish(ctx);')
+            out('_mesa_glthread_finish_before(ctx, "{0}");'.format(func.name))
             out('debug_print_sync("{0}");'.format(func.name))
             self.print_sync_call(func)
+            self.print_call_after(func)
         out('}')
         out('')
         out('')
@@ -248,15 +254,24 @@ class PrintCode(gl_XML.gl_print_base):
             if func.marshal_fail:
                 out('if ({0}) {{'.format(func.marshal_fail))
                 with indent():
-                    out('_mesa_glthread_finish(ctx);')
+                    out('_mesa_glthread_finish_before(ctx, "{0}");'.format(func.name))
                     out('_mesa_glthread_restore_dispatch(ctx, __func__);')
                     self.print_sync_dispatch(func)
                     out('return;')
                 out('}')
 
+            if func.marshal_sync:
+                out('if ({0}) {{'.format(func.marshal_sync))
+                with indent():
+                    out('_mesa_glthread_finish_before(ctx, "{0}");'.format(func.name))
+                    self.print_sync_dispatch(func)
+                    out('return;')
+                out('}')
+
             out('if (cmd_size <= MARSHAL_MAX_CMD_SIZE) {')
             with indent():
                 self.print_async_dispatch(func)
+                self.print_call_after(func)
                 out('return;')
             out('}')
 
@@ -264,7 +279,7 @@ class PrintCode(gl_XML.gl_print_base):
         if need_fallback_sync:
             out('fallback_to_sync:')
         with indent():
-            out('_mesa_glthread_finish(ctx);')
+            out('_mesa_glthread_finish_before(ctx, "{0}");'.format(func.name))
             self.print_sync_dispatch(func)
 
         out('}')
@@ -287,7 +302,7 @@ class PrintCode(gl_XML.gl_print_base):
             out('switch (cmd_base->cmd_id) {')
             for func in api.functionIterateAll():
                 flavor = func.marshal_flavor()
-                if flavor in ('skip', 'sync'):
+                if flavor in ('skip', 'sync', 'custom_sync'):
                     continue
                 out('case DISPATCH_CMD_{0}:'.format(func.name))
                 with indent():
@@ -332,7 +347,7 @@ class PrintCode(gl_XML.gl_print_base):
         async_funcs = []
         for func in api.functionIterateAll():
             flavor = func.marshal_flavor()
-            if flavor in ('skip', 'custom'):
+            if flavor in ('skip', 'custom', 'custom_sync'):
                 continue
             elif flavor == 'async':
                 self.print_async_body(func)
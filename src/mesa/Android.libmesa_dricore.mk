@@ -51,6 +51,13 @@ LOCAL_CFLAGS := \
        -DUSE_SSE41
 endif
 
+ifeq ($(ARCH_X86_HAVE_AVX2),true)
+LOCAL_WHOLE_STATIC_LIBRARIES += \
+	libmesa_avx2
+LOCAL_CFLAGS += \
+	-DUSE_AVX2
+endif
+
 LOCAL_C_INCLUDES := \
 	$(MESA_TOP)/src/mapi \
 	$(MESA_TOP)/src/mesa/main \
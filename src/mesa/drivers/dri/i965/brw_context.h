@@ -1585,13 +1585,13 @@ brw_get_program_binary_driver_sha1(struct gl_context *ctx, uint8_t *sha1);
 void brw_serialize_program_binary(struct gl_context *ctx,
                                   struct gl_shader_program *sh_prog,
                                   struct gl_program *prog);
-extern void
+extern bool
 brw_deserialize_program_binary(struct gl_context *ctx,
                                struct gl_shader_program *shProg,
                                struct gl_program *prog);
 void
 brw_program_serialize_nir(struct gl_context *ctx, struct gl_program *prog);
-void
+bool
 brw_program_deserialize_driver_blob(struct gl_context *ctx,
                                     struct gl_program *prog,
                                     gl_shader_stage stage);
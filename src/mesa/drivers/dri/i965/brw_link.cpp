@@ -229,8 +229,20 @@ brw_link_shader(struct gl_context *ctx, struct gl_shader_program *shProg)
    unsigned int stage;
    struct shader_info *infos[MESA_SHADER_STAGES] = { 0, };
 
-   if (shProg->data->LinkStatus == LINKING_SKIPPED)
+   if (shProg->data->LinkStatus == LINKING_SKIPPED) {
+      /* Read the NIR from the cache item now rather than when the gen
+       * program turns out to be missing at draw time: an unreadable item
+       * fails the link here, and the core relinks from source.
+       */
+      for (stage = 0; stage < ARRAY_SIZE(shProg->_LinkedShaders); stage++) {
+         struct gl_linked_shader *shader = shProg->_LinkedShaders[stage];
+         if (shader &&
+             !brw_program_deserialize_driver_blob(ctx, shader->Program,
+                                                  (gl_shader_stage) stage))
+            return GL_FALSE;
+      }
       return GL_TRUE;
+   }
 
    for (stage = 0; stage < ARRAY_SIZE(shProg->_LinkedShaders); stage++) {
       struct gl_linked_shader *shader = shProg->_LinkedShaders[stage];
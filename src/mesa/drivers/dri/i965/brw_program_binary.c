@@ -188,13 +188,13 @@ deserialize_gen_program(struct blob_reader *reader, struct gl_context *ctx,
    return true;
 }
 
-void
+bool
 brw_program_deserialize_driver_blob(struct gl_context *ctx,
                                     struct gl_program *prog,
                                     gl_shader_stage stage)
 {
    if (!prog->driver_cache_blob)
-      return;
+      return true;
 
    struct blob_reader reader;
    blob_reader_init(&reader, prog->driver_cache_blob,
@@ -219,6 +219,8 @@ brw_program_deserialize_driver_blob(struct gl_context *ctx,
          const struct nir_shader_compiler_options *options =
             ctx->Const.ShaderCompilerOptions[stage].NirOptions;
          prog->nir = nir_deserialize(NULL, options, &reader);
+         if (!prog->nir)
+            return false;
          break;
       }
       default:
@@ -230,17 +232,19 @@ brw_program_deserialize_driver_blob(struct gl_context *ctx,
    ralloc_free(prog->driver_cache_blob);
    prog->driver_cache_blob = NULL;
    prog->driver_cache_blob_size = 0;
+
+   return true;
 }
 
 /* This is just a wrapper around brw_program_deserialize_nir() as i965
  * doesn't need gl_shader_program like other drivers do.
  */
-void
+bool
 brw_deserialize_program_binary(struct gl_context *ctx,
                                struct gl_shader_program *shProg,
                                struct gl_program *prog)
 {
-   brw_program_deserialize_driver_blob(ctx, prog, prog->info.stage);
+   return brw_program_deserialize_driver_blob(ctx, prog, prog->info.stage);
 }
 
 static void
@@ -1825,7 +1825,7 @@ buffer_storage(struct gl_context *ctx, struct gl_buffer_object *bufObj,
 
    bufObj->Written = GL_TRUE;
    bufObj->Immutable = GL_TRUE;
-   bufObj->MinMaxCacheDirty = true;
+   _mesa_buffer_minmax_cache_dirty(bufObj, 0, size);
 
    if (memObj) {
       assert(ctx->Driver.BufferDataMem);
@@ -2072,7 +2072,7 @@ buffer_data(struct gl_context *ctx, struct gl_buffer_object *bufObj,
    FLUSH_VERTICES(ctx, 0);
 
    bufObj->Written = GL_TRUE;
-   bufObj->MinMaxCacheDirty = true;
+   _mesa_buffer_minmax_cache_dirty(bufObj, 0, size);
 
 #ifdef VBO_DEBUG
    printf("glBufferDataARB(%u, sz %ld, from %p, usage 0x%x)\n",
@@ -2261,7 +2261,7 @@ _mesa_buffer_sub_data(struct gl_context *ctx, struct gl_buffer_object *bufObj,
 
    bufObj->NumSubDataCalls++;
    bufObj->Written = GL_TRUE;
-   bufObj->MinMaxCacheDirty = true;
+   _mesa_buffer_minmax_cache_dirty(bufObj, offset, size);
 
    assert(ctx->Driver.BufferSubData);
    ctx->Driver.BufferSubData(ctx, offset, size, data, bufObj);
@@ -2443,7 +2443,7 @@ clear_buffer_sub_data(struct gl_context *ctx, struct gl_buffer_object *bufObj,
    if (size == 0)
       return;
 
-   bufObj->MinMaxCacheDirty = true;
+   _mesa_buffer_minmax_cache_dirty(bufObj, offset, size);
 
    if (data == NULL) {
       /* clear to zeros, per the spec */
@@ -2969,7 +2969,7 @@ copy_buffer_sub_data(struct gl_context *ctx, struct gl_buffer_object *src,
       }
    }
 
-   dst->MinMaxCacheDirty = true;
+   _mesa_buffer_minmax_cache_dirty(dst, writeOffset, size);
 
    ctx->Driver.CopyBufferSubData(ctx, src, dst, readOffset, writeOffset, size);
 }
@@ -2987,7 +2987,7 @@ _mesa_CopyBufferSubData_no_error(GLenum readTarget, GLenum writeTarget,
    struct gl_buffer_object **dst_ptr = get_buffer_target(ctx, writeTarget);
    struct gl_buffer_object *dst = *dst_ptr;
 
-   dst->MinMaxCacheDirty = true;
+   _mesa_buffer_minmax_cache_dirty(dst, writeOffset, size);
    ctx->Driver.CopyBufferSubData(ctx, src, dst, readOffset, writeOffset,
                                  size);
 }
@@ -3024,7 +3024,7 @@ _mesa_CopyNamedBufferSubData_no_error(GLuint readBuffer, GLuint writeBuffer,
    struct gl_buffer_object *src = _mesa_lookup_bufferobj(ctx, readBuffer);
    struct gl_buffer_object *dst = _mesa_lookup_bufferobj(ctx, writeBuffer);
 
-   dst->MinMaxCacheDirty = true;
+   _mesa_buffer_minmax_cache_dirty(dst, writeOffset, size);
    ctx->Driver.CopyBufferSubData(ctx, src, dst, readOffset, writeOffset,
                                  size);
 }
@@ -3217,7 +3217,7 @@ map_buffer_range(struct gl_context *ctx, struct gl_buffer_object *bufObj,
 
    if (access & GL_MAP_WRITE_BIT) {
       bufObj->Written = GL_TRUE;
-      bufObj->MinMaxCacheDirty = true;
+      _mesa_buffer_minmax_cache_dirty(bufObj, offset, length);
    }
 
 #ifdef VBO_DEBUG
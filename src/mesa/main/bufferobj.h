@@ -60,6 +60,26 @@ _mesa_check_disallowed_mapping(const struct gl_buffer_object *obj)
             GL_MAP_PERSISTENT_BIT);
 }
 
+/**
+ * Record that [offset, offset + size) of the buffer was written, so that
+ * the min/max index cache drops what it knows about that range before it
+ * is used again.
+ */
+static inline void
+_mesa_buffer_minmax_cache_dirty(struct gl_buffer_object *obj,
+                                GLintptr offset, GLsizeiptr size)
+{
+   if (obj->MinMaxCacheDirty) {
+      obj->MinMaxCacheDirtyStart = MIN2(obj->MinMaxCacheDirtyStart, offset);
+      obj->MinMaxCacheDirtyEnd = MAX2(obj->MinMaxCacheDirtyEnd,
+                                      offset + size);
+   } else {
+      obj->MinMaxCacheDirtyStart = offset;
+      obj->MinMaxCacheDirtyEnd = offset + size;
+      obj->MinMaxCacheDirty = true;
+   }
+}
+
 /**
  * Is the given buffer object a user-created buffer object?
  * Mesa uses default buffer objects in several places.  Default buffers
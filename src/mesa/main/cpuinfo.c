@@ -25,6 +25,7 @@
 
 #include "main/imports.h"
 #include "main/cpuinfo.h"
+#include "util/u_cpu_detect.h"
 
 
 /**
@@ -37,6 +38,7 @@ _mesa_get_cpu_features(void)
 #if defined USE_X86_ASM || defined USE_X86_64_ASM
    _mesa_get_x86_features();
 #endif
+   util_cpu_detect();
 }
 
 
@@ -1221,7 +1221,11 @@ struct dd_function_table {
                                             struct gl_shader_program *shProg,
                                             struct gl_program *prog);
 
-   void (*ProgramBinaryDeserializeDriverBlob)(struct gl_context *ctx,
+   /**
+    * Returns false if the driver's part of the blob could not be read back,
+    * in which case the binary is rejected.
+    */
+   bool (*ProgramBinaryDeserializeDriverBlob)(struct gl_context *ctx,
                                               struct gl_shader_program *shProg,
                                               struct gl_program *prog);
    /*@}*/
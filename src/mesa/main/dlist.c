@@ -1425,6 +1425,81 @@ memdup(const void *src, GLsizei bytes)
 }
 
 
+/**
+ * Does executing the instruction twice in a row with the same parameters
+ * leave the context in the same state as executing it once?  These only
+ * have 4-byte parameters that the save_* function always sets, so the
+ * payloads can be compared with memcmp().
+ */
+static bool
+is_idempotent_state_opcode(OpCode opcode)
+{
+   switch (opcode) {
+   case OPCODE_ACTIVE_TEXTURE:
+   case OPCODE_ALPHA_FUNC:
+   case OPCODE_BIND_TEXTURE:
+   case OPCODE_BLEND_COLOR:
+   case OPCODE_BLEND_EQUATION:
+   case OPCODE_BLEND_EQUATION_SEPARATE:
+   case OPCODE_BLEND_FUNC_SEPARATE:
+   case OPCODE_CLEAR_COLOR:
+   case OPCODE_CLEAR_DEPTH:
+   case OPCODE_CLEAR_STENCIL:
+   case OPCODE_CULL_FACE:
+   case OPCODE_DEPTH_FUNC:
+   case OPCODE_DEPTH_RANGE:
+   case OPCODE_DISABLE:
+   case OPCODE_ENABLE:
+   case OPCODE_FRONT_FACE:
+   case OPCODE_HINT:
+   case OPCODE_INDEX_MASK:
+   case OPCODE_LINE_WIDTH:
+   case OPCODE_LOGIC_OP:
+   case OPCODE_MATRIX_MODE:
+   case OPCODE_POINT_SIZE:
+   case OPCODE_POLYGON_MODE:
+   case OPCODE_POLYGON_OFFSET:
+   case OPCODE_SCISSOR:
+   case OPCODE_SHADE_MODEL:
+   case OPCODE_STENCIL_FUNC:
+   case OPCODE_STENCIL_MASK:
+   case OPCODE_STENCIL_OP:
+   case OPCODE_VIEWPORT:
+      return true;
+   default:
+      return false;
+   }
+}
+
+
+/**
+ * Drop the last instruction if it repeats the one before it, as when an
+ * app calls glEnable(GL_BLEND) twice in a row.  This is done when the next
+ * instruction is allocated, once the save_* function has filled in the
+ * parameters of the last one.
+ */
+static void
+drop_repeated_state(struct gl_context *ctx)
+{
+   struct gl_dlist_state *list = &ctx->ListState;
+   Node *prev = list->PrevInstruction;
+   Node *last = list->LastInstruction;
+
+   if (!prev || prev[0].opcode != last[0].opcode ||
+       !is_idempotent_state_opcode(last[0].opcode))
+      return;
+
+   const GLuint size = InstSize[last[0].opcode];
+   if (last != prev + size ||
+       memcmp(&prev[1], &last[1], (size - 1) * sizeof(Node)) != 0)
+      return;
+
+   list->CurrentPos = last - list->CurrentBlock;
+   list->LastInstruction = prev;
+   list->PrevInstruction = NULL;
+}
+
+
 /**
  * Allocate space for a display list instruction (opcode + payload space).
  * \param opcode  the instruction opcode (OPCODE_* value)
@@ -1443,6 +1518,8 @@ dlist_alloc(struct gl_context *ctx, OpCode opcode, GLuint bytes, bool align8)
 
    assert(bytes <= BLOCK_SIZE * sizeof(Node));
 
+   drop_repeated_state(ctx);
+
    if (opcode < OPCODE_EXT_0) {
       if (InstSize[opcode] == 0) {
          /* save instruction size now */
@@ -1484,6 +1561,7 @@ dlist_alloc(struct gl_context *ctx, OpCode opcode, GLuint bytes, bool align8)
       save_pointer(&n[1], newblock);
       ctx->ListState.CurrentBlock = newblock;
       ctx->ListState.CurrentPos = 0;
+      ctx->ListState.LastInstruction = NULL;
 
       /* Display list nodes are always 4 bytes.  If we need 8-byte alignment
        * we have to insert a NOP so that the payload of the real opcode lands
@@ -1508,6 +1586,9 @@ dlist_alloc(struct gl_context *ctx, OpCode opcode, GLuint bytes, bool align8)
 
    n[0].opcode = opcode;
 
+   ctx->ListState.PrevInstruction = ctx->ListState.LastInstruction;
+   ctx->ListState.LastInstruction = n;
+
    return n;
 }
 
@@ -11383,6 +11464,8 @@ _mesa_NewList(GLuint name, GLenum mode)
    ctx->ListState.CurrentList = make_list(name, BLOCK_SIZE);
    ctx->ListState.CurrentBlock = ctx->ListState.CurrentList->Head;
    ctx->ListState.CurrentPos = 0;
+   ctx->ListState.LastInstruction = NULL;
+   ctx->ListState.PrevInstruction = NULL;
 
    vbo_save_NewList(ctx, name, mode);
 
@@ -11442,6 +11525,8 @@ _mesa_EndList(void)
    ctx->ListState.CurrentList = NULL;
    ctx->ListState.CurrentBlock = NULL;
    ctx->ListState.CurrentPos = 0;
+   ctx->ListState.LastInstruction = NULL;
+   ctx->ListState.PrevInstruction = NULL;
    ctx->ExecuteFlag = GL_TRUE;
    ctx->CompileFlag = GL_FALSE;
 
@@ -12653,6 +12738,8 @@ _mesa_init_display_list(struct gl_context *ctx)
    ctx->CompileFlag = GL_FALSE;
    ctx->ListState.CurrentBlock = NULL;
    ctx->ListState.CurrentPos = 0;
+   ctx->ListState.LastInstruction = NULL;
+   ctx->ListState.PrevInstruction = NULL;
 
    /* Display List group */
    ctx->List.ListBase = 0;
@@ -29,6 +29,9 @@
 
 #include "formats.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 /** Pack a GLubyte rgba[4] color to dest address */
 typedef void (*gl_pack_ubyte_rgba_func)(const GLubyte src[4], void *dst);
@@ -105,4 +108,8 @@ _mesa_pack_uint_24_8_depth_stencil_row(mesa_format format, GLuint n,
 extern void
 _mesa_pack_colormask(mesa_format format, const GLubyte colorMask[4], void *dst);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -51,6 +51,11 @@ string = """/*
 #include "util/format_rgb9e5.h"
 #include "util/format_r11g11b10f.h"
 #include "util/format_srgb.h"
+#include "util/u_cpu_detect.h"
+
+#if defined(USE_SSE41)
+#include "sse_swizzle.h"
+#endif
 
 #define UNPACK(SRC, OFFSET, BITS) (((SRC) >> (OFFSET)) & MAX_UINT(BITS))
 #define PACK(SRC, OFFSET, BITS) (((SRC) & MAX_UINT(BITS)) << (OFFSET))
@@ -68,6 +73,19 @@ for f in formats:
       continue
 
    rgb_formats.append(f)
+
+def sse41_pack_unorm8(f):
+   # Unused channels of array formats are left alone by the scalar code,
+   # the kernels would write 0.
+   return f.is_sse41_unorm8() and not (f.layout == parser.ARRAY and
+                                       any(c.type == parser.VOID
+                                           for c in f.channels))
+
+def sse41_pack_half(f):
+   return f.is_sse41_half() and list(f.swizzle) == [0, 1, 2, 3]
+
+def map_init(swizzle):
+   return '{ ' + ', '.join(str(s) for s in swizzle.inverse()) + ' }'
 %>
 
 /* ubyte packing functions */
@@ -354,7 +372,20 @@ _mesa_pack_ubyte_rgba_row(mesa_format format, GLuint n,
    %endif
 
    case ${f.name}:
+   %if sse41_pack_unorm8(f):
+      i = 0;
+#if defined(USE_SSE41)
+      if (util_cpu_caps.has_sse4_1) {
+         static const uint8_t map[4] = ${map_init(f.swizzle)};
+         i = _mesa_swizzle_ubyte_sse41(d, ${len(f.channels)}, src[0], 4,
+                                       map, 0, n);
+         d += i * ${f.block_size() // 8};
+      }
+#endif
+      for (; i < n; ++i) {
+   %else:
       for (i = 0; i < n; ++i) {
+   %endif
          pack_ubyte_${f.short_name()}(src[i], d);
          d += ${f.block_size() // 8};
       }
@@ -416,7 +447,27 @@ _mesa_pack_float_rgba_row(mesa_format format, GLuint n,
    %endif
 
    case ${f.name}:
+   %if sse41_pack_half(f):
+#if defined(USE_SSE41)
+      if (util_cpu_caps.has_sse4_1) {
+         _mesa_float_to_half_sse41((uint16_t *)d, src[0], n * 4);
+         break;
+      }
+#endif
+      for (i = 0; i < n; ++i) {
+   %elif sse41_pack_unorm8(f):
+      i = 0;
+#if defined(USE_SSE41)
+      if (util_cpu_caps.has_sse4_1) {
+         static const uint8_t map[4] = ${map_init(f.swizzle)};
+         i = _mesa_pack_unorm8_row_sse41(d, src, ${len(f.channels)}, map, n);
+         d += i * ${f.block_size() // 8};
+      }
+#endif
+      for (; i < n; ++i) {
+   %else:
       for (i = 0; i < n; ++i) {
+   %endif
          pack_float_${f.short_name()}(src[i], d);
          d += ${f.block_size() // 8};
       }
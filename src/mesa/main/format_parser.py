@@ -489,6 +489,32 @@ class Format:
       else:
          return _get_datatype(self.channel_type(), self.channel_size())
 
+   def is_sse41_unorm8(self):
+      """Returns true if this format has 8-bit unorm row kernels in
+      sse_swizzle.c.
+
+      These are linear array formats of 8-bit unsigned normalized channels.
+      """
+      if self.colorspace != RGB or self.is_compressed() or not self.is_array():
+         return False
+      c = self.array_element()
+      return (c.type == UNSIGNED and c.norm and c.size == 8 and
+              self.block_size() == 8 * len(self.channels))
+
+   def is_sse41_half(self):
+      """Returns true if this format has half-float row kernels in
+      sse_swizzle.c.
+
+      These are linear RGBA or RGBX formats of 16-bit floats.
+      """
+      if self.colorspace != RGB or self.is_compressed() or not self.is_array():
+         return False
+      c = self.array_element()
+      return (c.type == FLOAT and c.size == 16 and
+              len(self.channels) == 4 and self.block_size() == 64 and
+              all(self.swizzle[i] in (i, Swizzle.SWIZZLE_ZERO,
+                                      Swizzle.SWIZZLE_ONE) for i in range(4)))
+
 def _get_datatype(type, size):
    if type == FLOAT:
       if size == 32:
@@ -27,6 +27,10 @@
 
 #include "formats.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 extern void
 _mesa_unpack_rgba_row(mesa_format format, GLuint n,
                       const void *src, GLfloat dst[][4]);
@@ -71,4 +75,9 @@ void
 _mesa_unpack_depth_stencil_row(mesa_format format, GLuint n,
                               const void *src, GLenum type,
                               GLuint *dst);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* FORMAT_UNPACK_H */
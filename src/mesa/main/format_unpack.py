@@ -50,6 +50,11 @@ string = """/*
 #include "util/format_rgb9e5.h"
 #include "util/format_r11g11b10f.h"
 #include "util/format_srgb.h"
+#include "util/u_cpu_detect.h"
+
+#if defined(USE_SSE41)
+#include "sse_swizzle.h"
+#endif
 
 #define UNPACK(SRC, OFFSET, BITS) (((SRC) >> (OFFSET)) & MAX_UINT(BITS))
 
@@ -66,6 +71,9 @@ for f in formats:
       continue
 
    rgb_formats.append(f)
+
+def swizzle_init(swizzle):
+   return '{ ' + ', '.join(str(s) for s in swizzle) + ' }'
 %>
 
 /* float unpacking functions */
@@ -320,7 +328,23 @@ _mesa_unpack_rgba_row(mesa_format format, GLuint n,
       <% continue %>
    %endif
    case ${f.name}:
+   %if f.is_sse41_unorm8() or f.is_sse41_half():
+      i = 0;
+#if defined(USE_SSE41)
+      if (util_cpu_caps.has_sse4_1) {
+         static const uint8_t swizzle[4] = ${swizzle_init(f.swizzle)};
+      %if f.is_sse41_unorm8():
+         i = _mesa_unpack_unorm8_row_sse41(dst, s, ${len(f.channels)}, swizzle, n);
+      %else:
+         i = _mesa_unpack_half_row_sse41(dst, (const uint16_t *)s, swizzle, n);
+      %endif
+         s += i * ${f.block_size() // 8};
+      }
+#endif
+      for (; i < n; ++i) {
+   %else:
       for (i = 0; i < n; ++i) {
+   %endif
          unpack_float_${f.short_name()}(s, dst[i]);
          s += ${f.block_size() // 8};
       }
@@ -353,7 +377,20 @@ _mesa_unpack_ubyte_rgba_row(mesa_format format, GLuint n,
    %endif
 
    case ${f.name}:
+   %if f.is_sse41_unorm8():
+      i = 0;
+#if defined(USE_SSE41)
+      if (util_cpu_caps.has_sse4_1) {
+         static const uint8_t swizzle[4] = ${swizzle_init(f.swizzle)};
+         i = _mesa_swizzle_ubyte_sse41(dst[0], 4, s, ${len(f.channels)},
+                                       swizzle, 0xff, n);
+         s += i * ${f.block_size() // 8};
+      }
+#endif
+      for (; i < n; ++i) {
+   %else:
       for (i = 0; i < n; ++i) {
+   %endif
          unpack_ubyte_${f.short_name()}(s, dst[i]);
          s += ${f.block_size() // 8};
       }
@@ -27,6 +27,8 @@
 #include "glformats.h"
 #include "format_pack.h"
 #include "format_unpack.h"
+#include "sse_swizzle.h"
+#include "util/u_cpu_detect.h"
 
 const mesa_array_format RGBA32_FLOAT =
    MESA_ARRAY_FORMAT(4, 1, 1, 1, 4, 0, 1, 2, 3);
@@ -359,9 +361,15 @@ _mesa_format_convert(void *void_dst, uint32_t dst_format, size_t dst_stride,
          }
       }
 
-      /* Handle the cases where we can directly pack */
+      /* Handle the cases where we can directly pack.  Half float formats
+       * are left to _mesa_swizzle_and_convert, which has a faster path for
+       * them.
+       */
       if (!dst_format_is_mesa_array_format) {
-         if (src_array_format == RGBA32_FLOAT) {
+         if (src_array_format == RGBA32_FLOAT &&
+             !(dst_array_format &&
+               _mesa_array_format_get_datatype(dst_array_format) ==
+               MESA_ARRAY_FORMAT_TYPE_HALF)) {
             for (row = 0; row < height; ++row) {
                _mesa_pack_float_rgba_row(dst_format, width,
                                          (const float (*)[4])src, dst);
@@ -792,6 +800,51 @@ swizzle_convert_try_memcpy(void *dst,
    return true;
 }
 
+#if defined(USE_SSE41)
+/**
+ * Does what it can of a swizzle-and-convert operation with the SSE4.1
+ * kernels: 8-bit swizzles, and float to half float without a swizzle.
+ *
+ * \return  the number of pixels converted
+ */
+static int
+swizzle_convert_sse41(void *dst, enum mesa_array_format_datatype dst_type,
+                      int num_dst_channels,
+                      const void *src, enum mesa_array_format_datatype src_type,
+                      int num_src_channels,
+                      const uint8_t swizzle[4], bool normalized, int count)
+{
+   int i;
+
+   if (dst_type == MESA_ARRAY_FORMAT_TYPE_UBYTE &&
+       src_type == MESA_ARRAY_FORMAT_TYPE_UBYTE) {
+      const uint8_t *s = src;
+      uint8_t *d = dst;
+
+      if (d + count * num_dst_channels > s &&
+          s + count * num_src_channels > d)
+         return 0;
+
+      return _mesa_swizzle_ubyte_sse41(d, num_dst_channels,
+                                       s, num_src_channels, swizzle,
+                                       normalized ? UINT8_MAX : 1, count);
+   }
+
+   if (dst_type == MESA_ARRAY_FORMAT_TYPE_HALF &&
+       src_type == MESA_ARRAY_FORMAT_TYPE_FLOAT &&
+       num_dst_channels == num_src_channels) {
+      for (i = 0; i < num_dst_channels; ++i)
+         if (swizzle[i] != i)
+            return 0;
+
+      _mesa_float_to_half_sse41(dst, src, count * num_dst_channels);
+      return count;
+   }
+
+   return 0;
+}
+#endif
+
 /**
  * Represents a single instance of the standard swizzle-and-convert loop
  *
@@ -1511,6 +1564,22 @@ _mesa_swizzle_and_convert(void *void_dst, enum mesa_array_format_datatype dst_ty
                                   swizzle, normalized, count))
       return;
 
+#if defined(USE_SSE41)
+   if (util_cpu_caps.has_sse4_1) {
+      int done = swizzle_convert_sse41(void_dst, dst_type, num_dst_channels,
+                                       void_src, src_type, num_src_channels,
+                                       swizzle, normalized, count);
+      if (done == count)
+         return;
+
+      void_dst = (uint8_t *) void_dst + done * num_dst_channels *
+                 _mesa_array_format_datatype_get_size(dst_type);
+      void_src = (const uint8_t *) void_src + done * num_src_channels *
+                 _mesa_array_format_datatype_get_size(src_type);
+      count -= done;
+   }
+#endif
+
    switch (dst_type) {
    case MESA_ARRAY_FORMAT_TYPE_FLOAT:
       convert_float(void_dst, num_dst_channels, void_src, src_type,
@@ -86,6 +86,8 @@ _mesa_spirv_shader_binary(struct gl_context *ctx,
    for (int i = 0; i < n; ++i) {
       struct gl_shader *sh = shaders[i];
 
+      _mesa_wait_shader_compile(sh);
+
       spirv_data = rzalloc(NULL, struct gl_shader_spirv_data);
       _mesa_shader_spirv_data_reference(&sh->spirv_data, spirv_data);
       _mesa_spirv_module_reference(&spirv_data->SpirVModule, module);
@@ -288,6 +290,8 @@ _mesa_SpecializeShaderARB(GLuint shader,
    if (!sh)
       return;
 
+   _mesa_wait_shader_compile(sh);
+
    if (!sh->spirv_data) {
       _mesa_error(ctx, GL_INVALID_OPERATION,
                   "glSpecializeShaderARB(not SPIR-V)");
@@ -36,6 +36,8 @@
 #include "main/glthread.h"
 #include "main/marshal.h"
 #include "main/marshal_generated.h"
+#include "util/os_time.h"
+#include "util/set.h"
 #include "util/u_atomic.h"
 #include "util/u_thread.h"
 
@@ -73,8 +75,19 @@ _mesa_glthread_init(struct gl_context *ctx)
    if (!glthread)
       return;
 
+   glthread->buffer_names = _mesa_pointer_set_create(NULL);
+   glthread->vertex_array_names = _mesa_pointer_set_create(NULL);
+   if (!glthread->buffer_names || !glthread->vertex_array_names) {
+      _mesa_set_destroy(glthread->buffer_names, NULL);
+      _mesa_set_destroy(glthread->vertex_array_names, NULL);
+      free(glthread);
+      return;
+   }
+
    if (!util_queue_init(&glthread->queue, "gl", MARSHAL_MAX_BATCHES - 2,
                         1, 0)) {
+      _mesa_set_destroy(glthread->buffer_names, NULL);
+      _mesa_set_destroy(glthread->vertex_array_names, NULL);
       free(glthread);
       return;
    }
@@ -82,6 +95,8 @@ _mesa_glthread_init(struct gl_context *ctx)
    ctx->MarshalExec = _mesa_create_marshal_table(ctx);
    if (!ctx->MarshalExec) {
       util_queue_destroy(&glthread->queue);
+      _mesa_set_destroy(glthread->buffer_names, NULL);
+      _mesa_set_destroy(glthread->vertex_array_names, NULL);
       free(glthread);
       return;
    }
@@ -94,6 +109,8 @@ _mesa_glthread_init(struct gl_context *ctx)
    glthread->stats.queue = &glthread->queue;
    ctx->CurrentClientDispatch = ctx->MarshalExec;
    ctx->GLThread = glthread;
+   _mesa_glthread_reset_shadow(ctx);
+   _mesa_glthread_init_stats(ctx);
 
    /* Execute the thread initialization function in the thread. */
    struct util_queue_fence fence;
@@ -113,11 +130,14 @@ _mesa_glthread_destroy(struct gl_context *ctx)
       return;
 
    _mesa_glthread_finish(ctx);
+   _mesa_glthread_destroy_stats(ctx);
    util_queue_destroy(&glthread->queue);
 
    for (unsigned i = 0; i < MARSHAL_MAX_BATCHES; i++)
       util_queue_fence_destroy(&glthread->batches[i].fence);
 
+   _mesa_set_destroy(glthread->buffer_names, NULL);
+   _mesa_set_destroy(glthread->vertex_array_names, NULL);
    free(glthread);
    ctx->GLThread = NULL;
 
@@ -133,6 +153,9 @@ _mesa_glthread_restore_dispatch(struct gl_context *ctx, const char *func)
     * Typically glxMakeCurrent will bind a new context (install new table) then
     * old context might be deleted.
     */
+   if (ctx->GLThread)
+      ctx->GLThread->disabled = true;
+
    if (_glapi_get_dispatch() == ctx->MarshalExec) {
        ctx->CurrentClientDispatch = ctx->CurrentServerDispatch;
        _glapi_set_dispatch(ctx->CurrentClientDispatch);
@@ -165,6 +188,7 @@ _mesa_glthread_flush_batch(struct gl_context *ctx)
    }
 
    p_atomic_add(&glthread->stats.num_offloaded_items, next->used);
+   p_atomic_inc(&glthread->stats.num_batches);
 
    util_queue_add_job(&glthread->queue, next, &next->fence,
                       glthread_unmarshal_batch, NULL);
@@ -172,14 +196,8 @@ _mesa_glthread_flush_batch(struct gl_context *ctx)
    glthread->next = (glthread->next + 1) % MARSHAL_MAX_BATCHES;
 }
 
-/**
- * Waits for all pending batches have been unmarshaled.
- *
- * This can be used by the main thread to synchronize access to the context,
- * since the worker thread will be idle after this.
- */
-void
-_mesa_glthread_finish(struct gl_context *ctx)
+static void
+glthread_finish(struct gl_context *ctx, const char *func)
 {
    struct glthread_state *glthread = ctx->GLThread;
    if (!glthread)
@@ -195,14 +213,20 @@ _mesa_glthread_finish(struct gl_context *ctx)
 
    struct glthread_batch *last = &glthread->batches[glthread->last];
    struct glthread_batch *next = &glthread->batches[glthread->next];
+   size_t direct_bytes = next->used;
    bool synced = false;
+   int64_t start = 0;
 
    if (!util_queue_fence_is_signalled(&last->fence)) {
+      start = os_time_get_nano();
       util_queue_fence_wait(&last->fence);
       synced = true;
    }
 
    if (next->used) {
+      if (!synced)
+         start = os_time_get_nano();
+
       p_atomic_add(&glthread->stats.num_direct_items, next->used);
 
       /* Since glthread_unmarshal_batch changes the dispatch to direct,
@@ -218,6 +242,36 @@ _mesa_glthread_finish(struct gl_context *ctx)
       synced = true;
    }
 
-   if (synced)
+   if (synced) {
+      int64_t wait_ns = os_time_get_nano() - start;
+
       p_atomic_inc(&glthread->stats.num_syncs);
+      p_atomic_add(&glthread->stats.sync_wait_time_us, wait_ns / 1000);
+
+      if (func)
+         _mesa_glthread_record_sync(ctx, func, wait_ns, direct_bytes);
+   }
+}
+
+/**
+ * Waits for all pending batches have been unmarshaled.
+ *
+ * This can be used by the main thread to synchronize access to the context,
+ * since the worker thread will be idle after this.
+ */
+void
+_mesa_glthread_finish(struct gl_context *ctx)
+{
+   glthread_finish(ctx, NULL);
+}
+
+/**
+ * _mesa_glthread_finish() for the GL function \p func, which has to be
+ * executed synchronously.  This is what the sync statistics and the
+ * adaptive mode count.
+ */
+void
+_mesa_glthread_finish_before(struct gl_context *ctx, const char *func)
+{
+   glthread_finish(ctx, func);
 }
@@ -46,9 +46,133 @@
 #include <inttypes.h>
 #include <stdbool.h>
 #include "util/u_queue.h"
+#include "compiler/shader_enums.h"
+#include "main/config.h"
 
 enum marshal_dispatch_cmd_id;
 struct gl_context;
+struct hash_table;
+
+/** Sync statistics of one GL function, see glthread_stats.c. */
+struct glthread_call_stats
+{
+   const char *name;
+
+   /** Number of calls that had to wait for the server thread. */
+   unsigned syncs;
+
+   /** Time spent waiting, in nanoseconds. */
+   uint64_t wait_ns;
+
+   /** Size of the partial batches these calls executed, in bytes. */
+   uint64_t direct_bytes;
+};
+
+/**
+ * One vertex array of the default vertex array object, as last specified by
+ * the app on the main thread.
+ */
+struct glthread_attrib
+{
+   /** User pointer, or offset into the VBO if user_pointer is false. */
+   const void *pointer;
+
+   /** Size of one element in bytes. */
+   unsigned element_size;
+
+   /** Stride in bytes, never 0. */
+   unsigned stride;
+
+   /** Instance divisor, 0 for per-vertex data. */
+   unsigned divisor;
+
+   /** Whether pointer is in client memory. */
+   bool user_pointer;
+};
+
+/**
+ * The vertex array state that decides whether a draw call reads client
+ * memory, and how much of it.
+ *
+ * Only the default vertex array object is tracked, because binding any other
+ * one on a compat context disables threading.
+ */
+struct glthread_vao
+{
+   struct glthread_attrib attrib[VERT_ATTRIB_MAX];
+
+   /** Enabled arrays, VERT_BIT_*. */
+   uint32_t enabled;
+
+   /** Arrays with user_pointer set, VERT_BIT_*. */
+   uint32_t user_pointer_mask;
+};
+
+/** A glPushClientAttrib entry. */
+struct glthread_client_attrib
+{
+   /** Whether GL_CLIENT_VERTEX_ARRAY_BIT was pushed. */
+   bool valid;
+
+   struct glthread_vao vao;
+   unsigned client_active_texture;
+   bool primitive_restart;
+   bool primitive_restart_fixed_index;
+   unsigned restart_index;
+   unsigned array_buffer;
+   unsigned element_array_buffer;
+};
+
+/** Buffer and vertex array bindings in glthread_state::bindings_known. */
+enum glthread_binding
+{
+   GLTHREAD_BINDING_ARRAY_BUFFER        = 1 << 0,
+   GLTHREAD_BINDING_PIXEL_PACK_BUFFER   = 1 << 1,
+   GLTHREAD_BINDING_PIXEL_UNPACK_BUFFER = 1 << 2,
+   GLTHREAD_BINDING_DRAW_INDIRECT       = 1 << 3,
+   GLTHREAD_BINDING_VERTEX_ARRAY        = 1 << 4,
+};
+
+/** Server state answered by glthread_get.c, GLTHREAD_KNOWN_*. */
+enum glthread_known_state
+{
+   GLTHREAD_KNOWN_MATRIX_MODE    = 1 << 0,
+   GLTHREAD_KNOWN_ACTIVE_TEXTURE = 1 << 1,
+   GLTHREAD_KNOWN_VIEWPORT       = 1 << 2,
+   GLTHREAD_KNOWN_ATTRIB_STACK   = 1 << 3,
+};
+
+/**
+ * The part of the server state that glGet* is commonly asked about while
+ * rendering, mirrored on the main thread.
+ *
+ * Unlike the vertex arrays, none of it is needed for correct rendering, so
+ * whatever is hard to follow (display lists, indexed viewports, errors that
+ * depend on other state) just makes it unknown, and queries about it sync.
+ */
+struct glthread_shadow
+{
+   /** GLTHREAD_KNOWN_* bits of the fields below that are up to date. */
+   unsigned known;
+
+   /** Capabilities in glthread_enable_caps, by index. */
+   uint32_t enables;
+   uint32_t enables_known;
+
+   unsigned matrix_mode;
+
+   /** glActiveTexture unit, 0-based. */
+   unsigned active_texture;
+
+   float viewport[4];
+};
+
+/** A glPushAttrib entry. */
+struct glthread_attrib_node
+{
+   unsigned mask;
+   struct glthread_shadow shadow;
+};
 
 /** A single batch of commands queued up for execution. */
 struct glthread_batch
@@ -84,16 +208,79 @@ struct glthread_state
    unsigned next;
 
    /**
-    * Tracks on the main thread side whether the current vertex array binding
-    * is in a VBO.
+    * Buffer bindings as seen from the main thread, which decide among other
+    * things whether a vertex or index array is in client memory.
+    */
+   unsigned array_buffer;
+   unsigned element_array_buffer;
+   unsigned pixel_pack_buffer;
+   unsigned pixel_unpack_buffer;
+   unsigned draw_indirect_buffer;
+
+   /** glBindVertexArray binding, only tracked in core contexts. */
+   unsigned vertex_array;
+
+   /**
+    * GLTHREAD_BINDING_* bits of the bindings above that glGet* can answer.
+    * In a core context, binding a name that glGen* or glCreate* didn't
+    * return fails on the server thread, so the binding becomes unknown.
     */
-   bool vertex_array_is_vbo;
+   unsigned bindings_known;
 
    /**
-    * Tracks on the main thread side whether the current element array (index
-    * buffer) binding is in a VBO.
+    * Buffer and vertex array object names returned by glGen* and glCreate*
+    * since threading was last turned on, and not deleted since.
     */
-   bool element_array_is_vbo;
+   struct set *buffer_names;
+   struct set *vertex_array_names;
+
+   /** The default vertex array object seen from the main thread. */
+   struct glthread_vao vao;
+
+   /** glClientActiveTexture unit, 0-based. */
+   unsigned client_active_texture;
+
+   /** Primitive restart state, which decides which indices to skip. */
+   bool primitive_restart;
+   bool primitive_restart_fixed_index;
+   unsigned restart_index;
+
+   /** glPushClientAttrib stack. */
+   struct glthread_client_attrib
+      client_attrib_stack[MAX_CLIENT_ATTRIB_STACK_DEPTH];
+   unsigned client_attrib_stack_depth;
+
+   /** Server state mirrored for glGet*, see glthread_get.c. */
+   struct glthread_shadow shadow;
+
+   /** Whether glBegin was called without a matching glEnd yet. */
+   bool inside_begin_end;
+
+   /** glPushAttrib stack, valid if GLTHREAD_KNOWN_ATTRIB_STACK is set. */
+   struct glthread_attrib_node attrib_stack[MAX_ATTRIB_STACK_DEPTH];
+   unsigned attrib_stack_depth;
+
+   /** Whether threading was turned off for good by restore_dispatch. */
+   bool disabled;
+
+   /** Per-function sync statistics, NULL unless MESA_GLTHREAD_STATS is set. */
+   struct hash_table *call_stats;
+   struct list_head stats_link;
+   unsigned num_frames;
+
+   /**
+    * Adaptive mode, see glthread_stats.c.  max_frame_syncs is 0 if it's off.
+    */
+   unsigned max_frame_syncs;
+   unsigned frame_syncs;
+
+   /** Whether the adaptive mode turned threading off for now. */
+   bool paused;
+   unsigned paused_frames;
+   unsigned pause_frames;
+
+   /** Whether threading was turned back on in the last frame. */
+   bool probing;
 };
 
 void _mesa_glthread_init(struct gl_context *ctx);
@@ -102,5 +289,12 @@ void _mesa_glthread_destroy(struct gl_context *ctx);
 void _mesa_glthread_restore_dispatch(struct gl_context *ctx, const char *func);
 void _mesa_glthread_flush_batch(struct gl_context *ctx);
 void _mesa_glthread_finish(struct gl_context *ctx);
+void _mesa_glthread_finish_before(struct gl_context *ctx, const char *func);
+
+void _mesa_glthread_init_stats(struct gl_context *ctx);
+void _mesa_glthread_destroy_stats(struct gl_context *ctx);
+void _mesa_glthread_record_sync(struct gl_context *ctx, const char *func,
+                                int64_t wait_ns, size_t direct_bytes);
+void _mesa_glthread_end_of_frame(struct gl_context *ctx);
 
 #endif /* _GLTHREAD_H*/
@@ -0,0 +1,689 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file glthread_draw.c
+ *
+ * Draw calls that read vertex arrays or indices from client memory.
+ *
+ * The app may change that memory as soon as the call returns, so the client
+ * thread copies the part the draw call reads and the server thread points
+ * the arrays at the copy for the duration of the call.  Copies that fit go
+ * into the batch, bigger ones into memory that the server thread frees.
+ *
+ * Draw calls that only use buffer objects are queued as they are.  The ones
+ * where the client thread can't tell which vertices are read, which is when
+ * the indices are in a buffer object and no range was given, are executed
+ * synchronously.
+ */
+
+#include "main/mtypes.h"
+#include "main/glthread.h"
+#include "main/marshal.h"
+#include "main/dispatch.h"
+#include "main/marshal_generated.h"
+#include "main/varray.h"
+#include "util/bitscan.h"
+
+/** A client-memory array that the draw call reads from a copy. */
+struct marshal_draw_array
+{
+   /** The array pointer that the app set. */
+   const GLubyte *pointer;
+
+   /** The pointer that gives the same vertices in the copy. */
+   const GLubyte *copy;
+};
+
+/** glDrawArrays, glDrawElements and their instanced and ranged variants */
+struct marshal_cmd_Draw
+{
+   struct marshal_cmd_base cmd_base;
+   GLenum mode;
+   GLenum type;
+   GLint first;
+   GLsizei count;
+   GLsizei instance_count;
+   GLint basevertex;
+   GLuint start;
+   GLuint end;
+   const GLvoid *indices;
+
+   /** Copies that didn't fit into the batch, freed after the draw. */
+   void *upload;
+
+   /**
+    * Arrays read from a copy, VERT_BIT_*.  One struct marshal_draw_array
+    * per bit follows the command, and then the copies that fit into the
+    * batch.
+    */
+   GLbitfield user_arrays;
+};
+
+/** Byte range of client memory copied for one or more arrays. */
+struct draw_copy
+{
+   const GLubyte *start;
+   const GLubyte *end;
+   unsigned stride;
+   unsigned min_index;
+   unsigned max_index;
+   size_t offset;
+};
+
+static unsigned
+index_size(GLenum type)
+{
+   switch (type) {
+   case GL_UNSIGNED_BYTE:
+      return 1;
+   case GL_UNSIGNED_SHORT:
+      return 2;
+   case GL_UNSIGNED_INT:
+      return 4;
+   default:
+      return 0;
+   }
+}
+
+#define SCAN_INDICES(T)                                      \
+   do {                                                      \
+      const T *ind = (const T *) indices;                    \
+      for (GLsizei i = 0; i < count; i++) {                  \
+         if (ind[i] == restart_index && restart)             \
+            continue;                                        \
+         if (ind[i] < min)                                   \
+            min = ind[i];                                    \
+         if (ind[i] > max)                                   \
+            max = ind[i];                                    \
+      }                                                      \
+   } while (0)
+
+/**
+ * Returns the smallest and the largest index in client memory, skipping the
+ * primitive restart index.  Returns false if there are no other indices.
+ */
+static bool
+get_index_range(const struct glthread_state *glthread, const GLvoid *indices,
+                GLenum type, GLsizei count, unsigned *min_index,
+                unsigned *max_index)
+{
+   const bool restart = glthread->primitive_restart ||
+                        glthread->primitive_restart_fixed_index;
+   unsigned restart_index = glthread->restart_index;
+   unsigned min = ~0u, max = 0;
+
+   switch (type) {
+   case GL_UNSIGNED_BYTE:
+      if (glthread->primitive_restart_fixed_index)
+         restart_index = 0xff;
+      SCAN_INDICES(GLubyte);
+      break;
+   case GL_UNSIGNED_SHORT:
+      if (glthread->primitive_restart_fixed_index)
+         restart_index = 0xffff;
+      SCAN_INDICES(GLushort);
+      break;
+   case GL_UNSIGNED_INT:
+      if (glthread->primitive_restart_fixed_index)
+         restart_index = 0xffffffff;
+      SCAN_INDICES(GLuint);
+      break;
+   }
+
+   if (min > max)
+      return false;
+
+   *min_index = min;
+   *max_index = max;
+   return true;
+}
+
+#undef SCAN_INDICES
+
+/**
+ * Queues the draw call described by \p draw, copying the client memory it
+ * reads.  Returns false if the call has to be executed synchronously.
+ */
+static bool
+marshal_draw(struct gl_context *ctx, uint16_t cmd_id,
+             const struct marshal_cmd_Draw *draw, bool has_range)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   struct marshal_cmd_Draw *cmd;
+   GLbitfield user_arrays = 0;
+   bool user_indices = false;
+
+   if (ctx->API != API_OPENGL_CORE) {
+      user_arrays = glthread->vao.enabled & glthread->vao.user_pointer_mask;
+      user_indices = draw->type && glthread->element_array_buffer == 0;
+   }
+
+   /* Nothing is read, or nothing will be drawn. */
+   if ((!user_arrays && !user_indices) ||
+       draw->count <= 0 || draw->instance_count <= 0) {
+      cmd = _mesa_glthread_allocate_command(ctx, cmd_id, sizeof(*cmd));
+      struct marshal_cmd_base cmd_base = cmd->cmd_base;
+      *cmd = *draw;
+      cmd->cmd_base = cmd_base;
+      _mesa_post_marshal_hook(ctx);
+      return true;
+   }
+
+   const unsigned ib_size = index_size(draw->type);
+   if (draw->type && !ib_size)
+      return false;
+
+   /* The range of vertices read from per-vertex arrays. */
+   int64_t min_vertex = 0, max_vertex = -1;
+   GLbitfield per_vertex = 0;
+
+   GLbitfield mask = user_arrays;
+   while (mask) {
+      const unsigned i = u_bit_scan(&mask);
+      if (!glthread->vao.attrib[i].divisor)
+         per_vertex |= 1u << i;
+   }
+
+   if (per_vertex) {
+      if (!draw->type) {
+         min_vertex = draw->first;
+         max_vertex = (int64_t) draw->first + draw->count - 1;
+      } else {
+         unsigned min, max;
+
+         if (has_range) {
+            min = draw->start;
+            max = draw->end;
+         } else if (!user_indices) {
+            return false;
+         } else if (!get_index_range(glthread, draw->indices, draw->type,
+                                     draw->count, &min, &max)) {
+            /* Only restart indices, so no vertices are read. */
+            min = 1;
+            max = 0;
+         }
+
+         if (min <= max) {
+            min_vertex = (int64_t) min + draw->basevertex;
+            max_vertex = (int64_t) max + draw->basevertex;
+         }
+      }
+
+      if (min_vertex < 0 || max_vertex > UINT32_MAX)
+         return false;
+   }
+
+   /* Group the arrays by the memory they read, so that interleaved arrays
+    * are copied once.
+    */
+   struct draw_copy copies[VERT_ATTRIB_MAX];
+   uint8_t copy_of_array[VERT_ATTRIB_MAX];
+   unsigned num_copies = 0;
+   GLbitfield copied_arrays = 0;
+   uint64_t total_size = 0;
+
+   mask = user_arrays;
+   while (mask) {
+      const unsigned i = u_bit_scan(&mask);
+      const struct glthread_attrib *attrib = &glthread->vao.attrib[i];
+      unsigned min_index, max_index;
+
+      if (attrib->divisor) {
+         min_index = 0;
+         max_index = (draw->instance_count - 1) / attrib->divisor;
+      } else if (min_vertex <= max_vertex) {
+         min_index = min_vertex;
+         max_index = max_vertex;
+      } else {
+         continue;
+      }
+
+      const GLubyte *start = (const GLubyte *) attrib->pointer +
+                             (uint64_t) min_index * attrib->stride;
+      const uint64_t size = (uint64_t) (max_index - min_index) *
+                            attrib->stride + attrib->element_size;
+      if (size > INT32_MAX)
+         return false;
+
+      unsigned c;
+      for (c = 0; c < num_copies; c++) {
+         struct draw_copy *copy = &copies[c];
+
+         if (copy->stride == attrib->stride &&
+             copy->min_index == min_index && copy->max_index == max_index &&
+             start + attrib->stride > copy->start &&
+             start < copy->start + attrib->stride) {
+            copy->start = MIN2(copy->start, start);
+            copy->end = MAX2(copy->end, start + size);
+            break;
+         }
+      }
+
+      if (c == num_copies) {
+         copies[c].start = start;
+         copies[c].end = start + size;
+         copies[c].stride = attrib->stride;
+         copies[c].min_index = min_index;
+         copies[c].max_index = max_index;
+         num_copies++;
+      }
+
+      copy_of_array[i] = c;
+      copied_arrays |= 1u << i;
+   }
+
+   for (unsigned c = 0; c < num_copies; c++) {
+      copies[c].offset = total_size;
+      total_size += ALIGN(copies[c].end - copies[c].start, 8);
+   }
+
+   const size_t indices_offset = total_size;
+   if (user_indices)
+      total_size += (uint64_t) draw->count * ib_size;
+
+   const size_t header_size = sizeof(*cmd) +
+      util_bitcount(copied_arrays) * sizeof(struct marshal_draw_array);
+   const bool inline_copy = header_size + total_size <= MARSHAL_MAX_CMD_SIZE;
+   GLubyte *upload = NULL;
+
+   if (!inline_copy) {
+      if (total_size > SIZE_MAX)
+         return false;
+
+      upload = malloc(total_size);
+      if (!upload)
+         return false;
+   }
+
+   cmd = _mesa_glthread_allocate_command(ctx, cmd_id,
+                                         header_size +
+                                         (inline_copy ? total_size : 0));
+   struct marshal_cmd_base cmd_base = cmd->cmd_base;
+   *cmd = *draw;
+   cmd->cmd_base = cmd_base;
+   cmd->user_arrays = copied_arrays;
+   cmd->upload = upload;
+
+   struct marshal_draw_array *arrays = (struct marshal_draw_array *) (cmd + 1);
+   GLubyte *data = inline_copy ? (GLubyte *) cmd + header_size : upload;
+
+   for (unsigned c = 0; c < num_copies; c++) {
+      memcpy(data + copies[c].offset, copies[c].start,
+             copies[c].end - copies[c].start);
+   }
+
+   mask = copied_arrays;
+   while (mask) {
+      const unsigned i = u_bit_scan(&mask);
+      const struct glthread_attrib *attrib = &glthread->vao.attrib[i];
+      const struct draw_copy *copy = &copies[copy_of_array[i]];
+
+      /* The copy starts at min_index, but the draw call indexes the array
+       * from 0 as before, so the pointer can end up before the start of
+       * the copy.  Forming it with pointer arithmetic would be undefined;
+       * compute the offset on integers and add it to the base once.
+       */
+      const uintptr_t offset = copy->offset +
+         ((uintptr_t) attrib->pointer - (uintptr_t) copy->start);
+      arrays->pointer = attrib->pointer;
+      arrays->copy = (const GLubyte *) ((uintptr_t) data + offset);
+      arrays++;
+   }
+
+   if (user_indices) {
+      memcpy(data + indices_offset, draw->indices,
+             (size_t) draw->count * ib_size);
+      cmd->indices = data + indices_offset;
+   }
+
+   _mesa_post_marshal_hook(ctx);
+   return true;
+}
+
+static void
+unmarshal_draw(struct gl_context *ctx, const struct marshal_cmd_Draw *cmd)
+{
+   const struct marshal_draw_array *arrays =
+      (const struct marshal_draw_array *) (cmd + 1);
+   GLbitfield swapped = 0;
+
+   GLbitfield mask = cmd->user_arrays;
+   for (unsigned n = 0; mask; n++) {
+      const unsigned i = u_bit_scan(&mask);
+
+      if (_mesa_replace_user_array_pointer(ctx, i, arrays[n].pointer,
+                                           arrays[n].copy))
+         swapped |= 1u << i;
+   }
+
+   switch (cmd->cmd_base.cmd_id) {
+   case DISPATCH_CMD_DrawArrays:
+      CALL_DrawArrays(ctx->CurrentServerDispatch,
+                      (cmd->mode, cmd->first, cmd->count));
+      break;
+   case DISPATCH_CMD_DrawArraysInstancedARB:
+      CALL_DrawArraysInstancedARB(ctx->CurrentServerDispatch,
+                                  (cmd->mode, cmd->first, cmd->count,
+                                   cmd->instance_count));
+      break;
+   case DISPATCH_CMD_DrawElements:
+      CALL_DrawElements(ctx->CurrentServerDispatch,
+                        (cmd->mode, cmd->count, cmd->type, cmd->indices));
+      break;
+   case DISPATCH_CMD_DrawRangeElements:
+      CALL_DrawRangeElements(ctx->CurrentServerDispatch,
+                             (cmd->mode, cmd->start, cmd->end, cmd->count,
+                              cmd->type, cmd->indices));
+      break;
+   case DISPATCH_CMD_DrawElementsBaseVertex:
+      CALL_DrawElementsBaseVertex(ctx->CurrentServerDispatch,
+                                  (cmd->mode, cmd->count, cmd->type,
+                                   cmd->indices, cmd->basevertex));
+      break;
+   case DISPATCH_CMD_DrawRangeElementsBaseVertex:
+      CALL_DrawRangeElementsBaseVertex(ctx->CurrentServerDispatch,
+                                       (cmd->mode, cmd->start, cmd->end,
+                                        cmd->count, cmd->type, cmd->indices,
+                                        cmd->basevertex));
+      break;
+   case DISPATCH_CMD_DrawElementsInstancedARB:
+      CALL_DrawElementsInstancedARB(ctx->CurrentServerDispatch,
+                                    (cmd->mode, cmd->count, cmd->type,
+                                     cmd->indices, cmd->instance_count));
+      break;
+   case DISPATCH_CMD_DrawElementsInstancedBaseVertex:
+      CALL_DrawElementsInstancedBaseVertex(ctx->CurrentServerDispatch,
+                                           (cmd->mode, cmd->count, cmd->type,
+                                            cmd->indices, cmd->instance_count,
+                                            cmd->basevertex));
+      break;
+   default:
+      unreachable("not a draw command");
+   }
+
+   /* The app's pointers are what it reads back with glGetPointerv. */
+   mask = cmd->user_arrays;
+   for (unsigned n = 0; mask; n++) {
+      const unsigned i = u_bit_scan(&mask);
+
+      if (swapped & (1u << i))
+         _mesa_replace_user_array_pointer(ctx, i, arrays[n].copy,
+                                          arrays[n].pointer);
+   }
+
+   free(cmd->upload);
+}
+
+void
+_mesa_unmarshal_DrawArrays(struct gl_context *ctx,
+                           const struct marshal_cmd_Draw *cmd)
+{
+   unmarshal_draw(ctx, cmd);
+}
+
+void
+_mesa_unmarshal_DrawArraysInstancedARB(struct gl_context *ctx,
+                                       const struct marshal_cmd_Draw *cmd)
+{
+   unmarshal_draw(ctx, cmd);
+}
+
+void
+_mesa_unmarshal_DrawElements(struct gl_context *ctx,
+                             const struct marshal_cmd_Draw *cmd)
+{
+   unmarshal_draw(ctx, cmd);
+}
+
+void
+_mesa_unmarshal_DrawRangeElements(struct gl_context *ctx,
+                                  const struct marshal_cmd_Draw *cmd)
+{
+   unmarshal_draw(ctx, cmd);
+}
+
+void
+_mesa_unmarshal_DrawElementsBaseVertex(struct gl_context *ctx,
+                                       const struct marshal_cmd_Draw *cmd)
+{
+   unmarshal_draw(ctx, cmd);
+}
+
+void
+_mesa_unmarshal_DrawRangeElementsBaseVertex(struct gl_context *ctx,
+                                            const struct marshal_cmd_Draw *cmd)
+{
+   unmarshal_draw(ctx, cmd);
+}
+
+void
+_mesa_unmarshal_DrawElementsInstancedARB(struct gl_context *ctx,
+                                         const struct marshal_cmd_Draw *cmd)
+{
+   unmarshal_draw(ctx, cmd);
+}
+
+void
+_mesa_unmarshal_DrawElementsInstancedBaseVertex(struct gl_context *ctx,
+                                                const struct marshal_cmd_Draw *cmd)
+{
+   unmarshal_draw(ctx, cmd);
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   const struct marshal_cmd_Draw draw = {
+      .mode = mode,
+      .first = first,
+      .count = count,
+      .instance_count = 1,
+   };
+
+   debug_print_marshal("DrawArrays");
+   if (marshal_draw(ctx, DISPATCH_CMD_DrawArrays, &draw, false))
+      return;
+
+   _mesa_glthread_finish_before(ctx, "DrawArrays");
+   debug_print_sync_fallback("DrawArrays");
+   CALL_DrawArrays(ctx->CurrentServerDispatch, (mode, first, count));
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawArraysInstancedARB(GLenum mode, GLint first, GLsizei count,
+                                     GLsizei primcount)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   const struct marshal_cmd_Draw draw = {
+      .mode = mode,
+      .first = first,
+      .count = count,
+      .instance_count = primcount,
+   };
+
+   debug_print_marshal("DrawArraysInstancedARB");
+   if (marshal_draw(ctx, DISPATCH_CMD_DrawArraysInstancedARB, &draw, false))
+      return;
+
+   _mesa_glthread_finish_before(ctx, "DrawArraysInstancedARB");
+   debug_print_sync_fallback("DrawArraysInstancedARB");
+   CALL_DrawArraysInstancedARB(ctx->CurrentServerDispatch,
+                               (mode, first, count, primcount));
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawElements(GLenum mode, GLsizei count, GLenum type,
+                           const GLvoid *indices)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   const struct marshal_cmd_Draw draw = {
+      .mode = mode,
+      .type = type,
+      .count = count,
+      .instance_count = 1,
+      .indices = indices,
+   };
+
+   debug_print_marshal("DrawElements");
+   if (marshal_draw(ctx, DISPATCH_CMD_DrawElements, &draw, false))
+      return;
+
+   _mesa_glthread_finish_before(ctx, "DrawElements");
+   debug_print_sync_fallback("DrawElements");
+   CALL_DrawElements(ctx->CurrentServerDispatch,
+                     (mode, count, type, indices));
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawRangeElements(GLenum mode, GLuint start, GLuint end,
+                                GLsizei count, GLenum type,
+                                const GLvoid *indices)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   const struct marshal_cmd_Draw draw = {
+      .mode = mode,
+      .type = type,
+      .count = count,
+      .instance_count = 1,
+      .start = start,
+      .end = end,
+      .indices = indices,
+   };
+
+   debug_print_marshal("DrawRangeElements");
+   if (marshal_draw(ctx, DISPATCH_CMD_DrawRangeElements, &draw, true))
+      return;
+
+   _mesa_glthread_finish_before(ctx, "DrawRangeElements");
+   debug_print_sync_fallback("DrawRangeElements");
+   CALL_DrawRangeElements(ctx->CurrentServerDispatch,
+                          (mode, start, end, count, type, indices));
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type,
+                                     const GLvoid *indices, GLint basevertex)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   const struct marshal_cmd_Draw draw = {
+      .mode = mode,
+      .type = type,
+      .count = count,
+      .instance_count = 1,
+      .basevertex = basevertex,
+      .indices = indices,
+   };
+
+   debug_print_marshal("DrawElementsBaseVertex");
+   if (marshal_draw(ctx, DISPATCH_CMD_DrawElementsBaseVertex, &draw, false))
+      return;
+
+   _mesa_glthread_finish_before(ctx, "DrawElementsBaseVertex");
+   debug_print_sync_fallback("DrawElementsBaseVertex");
+   CALL_DrawElementsBaseVertex(ctx->CurrentServerDispatch,
+                               (mode, count, type, indices, basevertex));
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawRangeElementsBaseVertex(GLenum mode, GLuint start,
+                                          GLuint end, GLsizei count,
+                                          GLenum type, const GLvoid *indices,
+                                          GLint basevertex)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   const struct marshal_cmd_Draw draw = {
+      .mode = mode,
+      .type = type,
+      .count = count,
+      .instance_count = 1,
+      .basevertex = basevertex,
+      .start = start,
+      .end = end,
+      .indices = indices,
+   };
+
+   debug_print_marshal("DrawRangeElementsBaseVertex");
+   if (marshal_draw(ctx, DISPATCH_CMD_DrawRangeElementsBaseVertex, &draw,
+                    true))
+      return;
+
+   _mesa_glthread_finish_before(ctx, "DrawRangeElementsBaseVertex");
+   debug_print_sync_fallback("DrawRangeElementsBaseVertex");
+   CALL_DrawRangeElementsBaseVertex(ctx->CurrentServerDispatch,
+                                    (mode, start, end, count, type, indices,
+                                     basevertex));
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsInstancedARB(GLenum mode, GLsizei count,
+                                       GLenum type, const GLvoid *indices,
+                                       GLsizei primcount)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   const struct marshal_cmd_Draw draw = {
+      .mode = mode,
+      .type = type,
+      .count = count,
+      .instance_count = primcount,
+      .indices = indices,
+   };
+
+   debug_print_marshal("DrawElementsInstancedARB");
+   if (marshal_draw(ctx, DISPATCH_CMD_DrawElementsInstancedARB, &draw, false))
+      return;
+
+   _mesa_glthread_finish_before(ctx, "DrawElementsInstancedARB");
+   debug_print_sync_fallback("DrawElementsInstancedARB");
+   CALL_DrawElementsInstancedARB(ctx->CurrentServerDispatch,
+                                 (mode, count, type, indices, primcount));
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsInstancedBaseVertex(GLenum mode, GLsizei count,
+                                              GLenum type,
+                                              const GLvoid *indices,
+                                              GLsizei primcount,
+                                              GLint basevertex)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   const struct marshal_cmd_Draw draw = {
+      .mode = mode,
+      .type = type,
+      .count = count,
+      .instance_count = primcount,
+      .basevertex = basevertex,
+      .indices = indices,
+   };
+
+   debug_print_marshal("DrawElementsInstancedBaseVertex");
+   if (marshal_draw(ctx, DISPATCH_CMD_DrawElementsInstancedBaseVertex, &draw,
+                    false))
+      return;
+
+   _mesa_glthread_finish_before(ctx, "DrawElementsInstancedBaseVertex");
+   debug_print_sync_fallback("DrawElementsInstancedBaseVertex");
+   CALL_DrawElementsInstancedBaseVertex(ctx->CurrentServerDispatch,
+                                        (mode, count, type, indices,
+                                         primcount, basevertex));
+}
@@ -0,0 +1,576 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file glthread_get.c
+ *
+ * glGet* and glIsEnabled for state that the main thread can follow on its
+ * own, so that apps that query it every frame don't wait for the server
+ * thread to go idle each time.
+ *
+ * Only desktop GL queries are answered, and only when nothing else can make
+ * them fail: a pname whose value isn't known, or which isn't valid in the
+ * context, syncs and goes to the server thread as before, so it gets the
+ * same value or error as without glthread.  glGetError always syncs, since
+ * errors are raised by the server thread.
+ */
+
+#include "main/mtypes.h"
+#include "main/glthread.h"
+#include "main/macros.h"
+#include "main/texstate.h"
+#include "util/set.h"
+#include "marshal.h"
+#include "dispatch.h"
+
+/**
+ * The capabilities that glthread_shadow::enables tracks, and the
+ * glPushAttrib group that saves each of them besides GL_ENABLE_BIT.
+ */
+static const struct {
+   GLenum cap;
+   GLbitfield group;
+   bool compat_only;
+} glthread_enable_caps[] = {
+   { GL_BLEND,               GL_COLOR_BUFFER_BIT,   false },
+   { GL_CULL_FACE,           GL_POLYGON_BIT,        false },
+   { GL_DEPTH_TEST,          GL_DEPTH_BUFFER_BIT,   false },
+   { GL_DITHER,              GL_COLOR_BUFFER_BIT,   false },
+   { GL_LIGHTING,            GL_LIGHTING_BIT,       true  },
+   { GL_POLYGON_OFFSET_FILL, GL_POLYGON_BIT,        false },
+   { GL_SCISSOR_TEST,        GL_SCISSOR_BIT,        false },
+   { GL_STENCIL_TEST,        GL_STENCIL_BUFFER_BIT, false },
+};
+
+/** Returns the index of \p cap in glthread_enable_caps, or -1. */
+static int
+enable_cap_index(const struct gl_context *ctx, GLenum cap)
+{
+   for (unsigned i = 0; i < ARRAY_SIZE(glthread_enable_caps); i++) {
+      if (glthread_enable_caps[i].cap == cap) {
+         if (glthread_enable_caps[i].compat_only &&
+             ctx->API != API_OPENGL_COMPAT)
+            return -1;
+         return i;
+      }
+   }
+   return -1;
+}
+
+static bool
+server_enable(const struct gl_context *ctx, GLenum cap)
+{
+   switch (cap) {
+   case GL_BLEND:
+      return ctx->Color.BlendEnabled & 1;
+   case GL_CULL_FACE:
+      return ctx->Polygon.CullFlag;
+   case GL_DEPTH_TEST:
+      return ctx->Depth.Test;
+   case GL_DITHER:
+      return ctx->Color.DitherFlag;
+   case GL_LIGHTING:
+      return ctx->Light.Enabled;
+   case GL_POLYGON_OFFSET_FILL:
+      return ctx->Polygon.OffsetFill;
+   case GL_SCISSOR_TEST:
+      return ctx->Scissor.EnableFlags & 1;
+   case GL_STENCIL_TEST:
+      return ctx->Stencil.Enabled;
+   default:
+      unreachable("not a tracked capability");
+   }
+}
+
+/**
+ * Copies the mirrored state from the server thread, which must be idle.
+ */
+void
+_mesa_glthread_reset_shadow(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   struct glthread_shadow *shadow = &glthread->shadow;
+
+   glthread->array_buffer = ctx->Array.ArrayBufferObj->Name;
+   glthread->element_array_buffer = ctx->Array.VAO->IndexBufferObj->Name;
+   glthread->pixel_pack_buffer = ctx->Pack.BufferObj->Name;
+   glthread->pixel_unpack_buffer = ctx->Unpack.BufferObj->Name;
+   glthread->draw_indirect_buffer = ctx->DrawIndirectBuffer->Name;
+   glthread->vertex_array = ctx->Array.VAO->Name;
+   glthread->inside_begin_end = false;
+   glthread->bindings_known = GLTHREAD_BINDING_ARRAY_BUFFER |
+                              GLTHREAD_BINDING_PIXEL_PACK_BUFFER |
+                              GLTHREAD_BINDING_PIXEL_UNPACK_BUFFER |
+                              GLTHREAD_BINDING_DRAW_INDIRECT |
+                              GLTHREAD_BINDING_VERTEX_ARRAY;
+
+   /* Names may have been created and deleted while we weren't looking. */
+   _mesa_set_clear(glthread->buffer_names, NULL);
+   _mesa_set_clear(glthread->vertex_array_names, NULL);
+
+   shadow->enables = 0;
+   shadow->enables_known = 0;
+   for (unsigned i = 0; i < ARRAY_SIZE(glthread_enable_caps); i++) {
+      if (server_enable(ctx, glthread_enable_caps[i].cap))
+         shadow->enables |= 1u << i;
+      shadow->enables_known |= 1u << i;
+   }
+
+   shadow->matrix_mode = ctx->Transform.MatrixMode;
+   shadow->active_texture = ctx->Texture.CurrentUnit;
+   shadow->viewport[0] = ctx->ViewportArray[0].X;
+   shadow->viewport[1] = ctx->ViewportArray[0].Y;
+   shadow->viewport[2] = ctx->ViewportArray[0].Width;
+   shadow->viewport[3] = ctx->ViewportArray[0].Height;
+   shadow->known = GLTHREAD_KNOWN_MATRIX_MODE |
+                   GLTHREAD_KNOWN_ACTIVE_TEXTURE |
+                   GLTHREAD_KNOWN_VIEWPORT;
+
+   /* The saved state itself can't be read back. */
+   glthread->attrib_stack_depth = 0;
+   if (ctx->AttribStackDepth == 0)
+      shadow->known |= GLTHREAD_KNOWN_ATTRIB_STACK;
+}
+
+/**
+ * Forgets everything that glthread_shadow and the glPushAttrib stack hold,
+ * for calls that change state in ways the main thread doesn't follow.
+ */
+void
+_mesa_glthread_invalidate_shadow(struct gl_context *ctx)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   shadow->known = 0;
+   shadow->enables_known = 0;
+}
+
+/**
+ * glEnable/glDisable.  The client array caps are forwarded to
+ * _mesa_glthread_ClientState().
+ */
+void
+_mesa_glthread_Enable(struct gl_context *ctx, GLenum cap, bool enable)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+   int i = enable_cap_index(ctx, cap);
+
+   if (i < 0) {
+      _mesa_glthread_ClientState(ctx, cap, enable);
+      return;
+   }
+
+   if (enable)
+      shadow->enables |= 1u << i;
+   else
+      shadow->enables &= ~(1u << i);
+}
+
+/**
+ * glEnablei/glDisablei.  Index 0 of the per-buffer and per-viewport caps is
+ * what glIsEnabled returns, and is valid whenever the cap is.
+ */
+void
+_mesa_glthread_Enablei(struct gl_context *ctx, GLenum cap, GLuint index,
+                       bool enable)
+{
+   if (index == 0 && (cap == GL_BLEND || cap == GL_SCISSOR_TEST))
+      _mesa_glthread_Enable(ctx, cap, enable);
+}
+
+void
+_mesa_glthread_MatrixMode(struct gl_context *ctx, GLenum mode)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   switch (mode) {
+   case GL_MODELVIEW:
+   case GL_PROJECTION:
+   case GL_TEXTURE:
+      shadow->matrix_mode = mode;
+      shadow->known |= GLTHREAD_KNOWN_MATRIX_MODE;
+      break;
+   default:
+      /* The other modes depend on extensions and limits. */
+      shadow->known &= ~GLTHREAD_KNOWN_MATRIX_MODE;
+      break;
+   }
+}
+
+void
+_mesa_glthread_ActiveTexture(struct gl_context *ctx, GLenum texture)
+{
+   if (texture >= GL_TEXTURE0 &&
+       texture < GL_TEXTURE0 + _mesa_max_tex_unit(ctx))
+      ctx->GLThread->shadow.active_texture = texture - GL_TEXTURE0;
+}
+
+/** glViewport, clamped the same way as in viewport.c. */
+void
+_mesa_glthread_Viewport(struct gl_context *ctx, GLint x, GLint y,
+                        GLsizei width, GLsizei height)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   if (width < 0 || height < 0)
+      return;
+
+   float fx = x, fy = y;
+
+   if (_mesa_has_ARB_viewport_array(ctx) ||
+       _mesa_has_OES_viewport_array(ctx)) {
+      fx = CLAMP(fx, ctx->Const.ViewportBounds.Min,
+                 ctx->Const.ViewportBounds.Max);
+      fy = CLAMP(fy, ctx->Const.ViewportBounds.Min,
+                 ctx->Const.ViewportBounds.Max);
+   }
+
+   shadow->viewport[0] = fx;
+   shadow->viewport[1] = fy;
+   shadow->viewport[2] = MIN2(width, (GLfloat) ctx->Const.MaxViewportWidth);
+   shadow->viewport[3] = MIN2(height, (GLfloat) ctx->Const.MaxViewportHeight);
+   shadow->known |= GLTHREAD_KNOWN_VIEWPORT;
+}
+
+/** glViewportIndexed* and glViewportArrayv, which can set viewport 0. */
+void
+_mesa_glthread_invalidate_viewport(struct gl_context *ctx)
+{
+   ctx->GLThread->shadow.known &= ~GLTHREAD_KNOWN_VIEWPORT;
+}
+
+void
+_mesa_glthread_PushAttrib(struct gl_context *ctx, GLbitfield mask)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (ctx->API != API_OPENGL_COMPAT ||
+       !(glthread->shadow.known & GLTHREAD_KNOWN_ATTRIB_STACK) ||
+       glthread->attrib_stack_depth >= MAX_ATTRIB_STACK_DEPTH)
+      return;
+
+   struct glthread_attrib_node *node =
+      &glthread->attrib_stack[glthread->attrib_stack_depth++];
+
+   node->mask = mask;
+   node->shadow = glthread->shadow;
+}
+
+static void
+restore_known(struct glthread_shadow *dst, const struct glthread_shadow *src,
+              unsigned bit)
+{
+   dst->known = (dst->known & ~bit) | (src->known & bit);
+}
+
+void
+_mesa_glthread_PopAttrib(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   struct glthread_shadow *shadow = &glthread->shadow;
+
+   if (ctx->API != API_OPENGL_COMPAT)
+      return;
+
+   if (!(shadow->known & GLTHREAD_KNOWN_ATTRIB_STACK)) {
+      /* We don't know what is restored. */
+      _mesa_glthread_invalidate_shadow(ctx);
+      return;
+   }
+
+   if (glthread->attrib_stack_depth == 0)
+      return;
+
+   const struct glthread_attrib_node *node =
+      &glthread->attrib_stack[--glthread->attrib_stack_depth];
+   const struct glthread_shadow *saved = &node->shadow;
+
+   uint32_t enables = 0;
+   for (unsigned i = 0; i < ARRAY_SIZE(glthread_enable_caps); i++) {
+      if (node->mask & (glthread_enable_caps[i].group | GL_ENABLE_BIT))
+         enables |= 1u << i;
+   }
+   shadow->enables = (shadow->enables & ~enables) | (saved->enables & enables);
+   shadow->enables_known = (shadow->enables_known & ~enables) |
+                           (saved->enables_known & enables);
+
+   if (node->mask & GL_TRANSFORM_BIT) {
+      shadow->matrix_mode = saved->matrix_mode;
+      restore_known(shadow, saved, GLTHREAD_KNOWN_MATRIX_MODE);
+   }
+
+   if (node->mask & GL_TEXTURE_BIT) {
+      shadow->active_texture = saved->active_texture;
+      restore_known(shadow, saved, GLTHREAD_KNOWN_ACTIVE_TEXTURE);
+   }
+
+   if (node->mask & GL_VIEWPORT_BIT) {
+      memcpy(shadow->viewport, saved->viewport, sizeof(shadow->viewport));
+      restore_known(shadow, saved, GLTHREAD_KNOWN_VIEWPORT);
+   }
+}
+
+/**
+ * Looks up \p cap, returning false if the server thread has to answer.
+ */
+static bool
+get_enable(struct gl_context *ctx, GLenum cap, bool *enabled)
+{
+   const struct glthread_state *glthread = ctx->GLThread;
+   int i = enable_cap_index(ctx, cap);
+
+   if (i >= 0) {
+      if (!(glthread->shadow.enables_known & (1u << i)))
+         return false;
+
+      *enabled = (glthread->shadow.enables >> i) & 1;
+      return true;
+   }
+
+   if (ctx->API != API_OPENGL_COMPAT)
+      return false;
+
+   unsigned attrib;
+   switch (cap) {
+   case GL_VERTEX_ARRAY:
+      attrib = VERT_ATTRIB_POS;
+      break;
+   case GL_NORMAL_ARRAY:
+      attrib = VERT_ATTRIB_NORMAL;
+      break;
+   case GL_COLOR_ARRAY:
+      attrib = VERT_ATTRIB_COLOR0;
+      break;
+   case GL_INDEX_ARRAY:
+      attrib = VERT_ATTRIB_COLOR_INDEX;
+      break;
+   case GL_TEXTURE_COORD_ARRAY:
+      attrib = VERT_ATTRIB_TEX(glthread->client_active_texture);
+      break;
+   case GL_EDGE_FLAG_ARRAY:
+      attrib = VERT_ATTRIB_EDGEFLAG;
+      break;
+   default:
+      return false;
+   }
+
+   *enabled = (glthread->vao.enabled & VERT_BIT(attrib)) != 0;
+   return true;
+}
+
+/**
+ * Looks up \p pname, returning the number of values written to \p v, or 0
+ * if the server thread has to answer.
+ */
+static unsigned
+get_values(struct gl_context *ctx, GLenum pname, double v[4])
+{
+   const struct glthread_state *glthread = ctx->GLThread;
+   const struct glthread_shadow *shadow = &glthread->shadow;
+   bool compat = ctx->API == API_OPENGL_COMPAT;
+   bool enabled;
+
+   switch (pname) {
+   case GL_ACTIVE_TEXTURE:
+      if (!(shadow->known & GLTHREAD_KNOWN_ACTIVE_TEXTURE))
+         return 0;
+      v[0] = GL_TEXTURE0 + shadow->active_texture;
+      return 1;
+
+   case GL_VIEWPORT:
+      if (!(shadow->known & GLTHREAD_KNOWN_VIEWPORT))
+         return 0;
+      for (unsigned i = 0; i < 4; i++)
+         v[i] = shadow->viewport[i];
+      return 4;
+
+   case GL_MATRIX_MODE:
+      if (!compat || !(shadow->known & GLTHREAD_KNOWN_MATRIX_MODE))
+         return 0;
+      v[0] = shadow->matrix_mode;
+      return 1;
+
+   case GL_ATTRIB_STACK_DEPTH:
+      if (!compat || !(shadow->known & GLTHREAD_KNOWN_ATTRIB_STACK))
+         return 0;
+      v[0] = glthread->attrib_stack_depth;
+      return 1;
+
+   case GL_CLIENT_ACTIVE_TEXTURE:
+      if (!compat)
+         return 0;
+      v[0] = GL_TEXTURE0 + glthread->client_active_texture;
+      return 1;
+
+   case GL_CLIENT_ATTRIB_STACK_DEPTH:
+      if (!compat)
+         return 0;
+      v[0] = glthread->client_attrib_stack_depth;
+      return 1;
+
+   case GL_ARRAY_BUFFER_BINDING:
+      if (!(glthread->bindings_known & GLTHREAD_BINDING_ARRAY_BUFFER))
+         return 0;
+      v[0] = glthread->array_buffer;
+      return 1;
+
+   case GL_ELEMENT_ARRAY_BUFFER_BINDING:
+      /* Part of the vertex array object, which is only followed in compat. */
+      if (!compat)
+         return 0;
+      v[0] = glthread->element_array_buffer;
+      return 1;
+
+   case GL_PIXEL_PACK_BUFFER_BINDING:
+      if (!_mesa_has_EXT_pixel_buffer_object(ctx) ||
+          !(glthread->bindings_known & GLTHREAD_BINDING_PIXEL_PACK_BUFFER))
+         return 0;
+      v[0] = glthread->pixel_pack_buffer;
+      return 1;
+
+   case GL_PIXEL_UNPACK_BUFFER_BINDING:
+      if (!_mesa_has_EXT_pixel_buffer_object(ctx) ||
+          !(glthread->bindings_known & GLTHREAD_BINDING_PIXEL_UNPACK_BUFFER))
+         return 0;
+      v[0] = glthread->pixel_unpack_buffer;
+      return 1;
+
+   case GL_DRAW_INDIRECT_BUFFER_BINDING:
+      if (!_mesa_has_ARB_draw_indirect(ctx) ||
+          !(glthread->bindings_known & GLTHREAD_BINDING_DRAW_INDIRECT))
+         return 0;
+      v[0] = glthread->draw_indirect_buffer;
+      return 1;
+
+   case GL_VERTEX_ARRAY_BINDING:
+      if (compat ||
+          !(glthread->bindings_known & GLTHREAD_BINDING_VERTEX_ARRAY))
+         return 0;
+      v[0] = glthread->vertex_array;
+      return 1;
+
+   default:
+      if (!get_enable(ctx, pname, &enabled))
+         return 0;
+      v[0] = enabled;
+      return 1;
+   }
+}
+
+/**
+ * Whether glGet* and glIsEnabled can be answered here.  Between glBegin and
+ * glEnd they raise GL_INVALID_OPERATION, which only the server thread can
+ * do.
+ */
+static bool
+can_answer(const struct gl_context *ctx)
+{
+   return (ctx->API == API_OPENGL_COMPAT || ctx->API == API_OPENGL_CORE) &&
+          !ctx->GLThread->inside_begin_end;
+}
+
+void GLAPIENTRY
+_mesa_marshal_GetBooleanv(GLenum pname, GLboolean *params)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   double v[4];
+   unsigned n = can_answer(ctx) ? get_values(ctx, pname, v) : 0;
+
+   if (n) {
+      for (unsigned i = 0; i < n; i++)
+         params[i] = v[i] != 0.0;
+      return;
+   }
+
+   _mesa_glthread_finish_before(ctx, "GetBooleanv");
+   debug_print_sync("GetBooleanv");
+   CALL_GetBooleanv(ctx->CurrentServerDispatch, (pname, params));
+}
+
+void GLAPIENTRY
+_mesa_marshal_GetIntegerv(GLenum pname, GLint *params)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   double v[4];
+   unsigned n = can_answer(ctx) ? get_values(ctx, pname, v) : 0;
+
+   if (n) {
+      /* Float state is rounded like in get.c. */
+      for (unsigned i = 0; i < n; i++)
+         params[i] = IROUND(v[i]);
+      return;
+   }
+
+   _mesa_glthread_finish_before(ctx, "GetIntegerv");
+   debug_print_sync("GetIntegerv");
+   CALL_GetIntegerv(ctx->CurrentServerDispatch, (pname, params));
+}
+
+void GLAPIENTRY
+_mesa_marshal_GetFloatv(GLenum pname, GLfloat *params)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   double v[4];
+   unsigned n = can_answer(ctx) ? get_values(ctx, pname, v) : 0;
+
+   if (n) {
+      for (unsigned i = 0; i < n; i++)
+         params[i] = v[i];
+      return;
+   }
+
+   _mesa_glthread_finish_before(ctx, "GetFloatv");
+   debug_print_sync("GetFloatv");
+   CALL_GetFloatv(ctx->CurrentServerDispatch, (pname, params));
+}
+
+void GLAPIENTRY
+_mesa_marshal_GetDoublev(GLenum pname, GLdouble *params)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   double v[4];
+   unsigned n = can_answer(ctx) ? get_values(ctx, pname, v) : 0;
+
+   if (n) {
+      for (unsigned i = 0; i < n; i++)
+         params[i] = v[i];
+      return;
+   }
+
+   _mesa_glthread_finish_before(ctx, "GetDoublev");
+   debug_print_sync("GetDoublev");
+   CALL_GetDoublev(ctx->CurrentServerDispatch, (pname, params));
+}
+
+GLboolean GLAPIENTRY
+_mesa_marshal_IsEnabled(GLenum cap)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   bool enabled;
+
+   if (can_answer(ctx) && get_enable(ctx, cap, &enabled))
+      return enabled;
+
+   _mesa_glthread_finish_before(ctx, "IsEnabled");
+   debug_print_sync("IsEnabled");
+   return CALL_IsEnabled(ctx->CurrentServerDispatch, (cap));
+}
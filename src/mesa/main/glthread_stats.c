@@ -0,0 +1,310 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file glthread_stats.c
+ *
+ * Which GL calls make glthread sync, and what to do about it.
+ *
+ * With MESA_GLTHREAD_STATS=true, every call that has to wait for the server
+ * thread is counted per GL function, along with the time it waited and the
+ * size of the batch it had to execute, and a report is printed when the
+ * context is destroyed or the process exits.
+ *
+ * With MESA_GLTHREAD_ADAPTIVE=n, a context that syncs more than n times in
+ * a frame is switched to direct dispatch, which is faster than a thread that
+ * is idle half of the time.  Whether the app still syncs that much can't be
+ * seen without the thread, so it is turned back on after a while to find
+ * out, and then left off for twice as long each time the app is still
+ * syncing too much.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "main/mtypes.h"
+#include "main/debug_output.h"
+#include "main/glthread.h"
+#include "main/marshal.h"
+#include "util/debug.h"
+#include "util/hash_table.h"
+#include "util/ralloc.h"
+
+#include "c11/threads.h"
+
+/* How many frames the adaptive mode leaves threading off at first, and at
+ * most.
+ */
+#define GLTHREAD_MIN_PAUSE_FRAMES 64
+#define GLTHREAD_MAX_PAUSE_FRAMES 4096
+
+/* Contexts whose statistics are printed at exit, unless they are destroyed
+ * before that.
+ */
+static once_flag atexit_once_flag = ONCE_FLAG_INIT;
+static struct list_head stats_list;
+static mtx_t stats_mutex = _MTX_INITIALIZER_NP;
+
+static int
+compare_wait_time(const void *a, const void *b)
+{
+   const struct glthread_call_stats *sa =
+      *(const struct glthread_call_stats **)a;
+   const struct glthread_call_stats *sb =
+      *(const struct glthread_call_stats **)b;
+
+   if (sa->wait_ns != sb->wait_ns)
+      return sa->wait_ns < sb->wait_ns ? 1 : -1;
+   return strcmp(sa->name, sb->name);
+}
+
+static void
+print_stats(struct glthread_state *glthread)
+{
+   const struct util_queue_monitoring *mon = &glthread->stats;
+   unsigned frames = MAX2(glthread->num_frames, 1);
+
+   fprintf(stderr, "glthread: %u frames, %u batches of %u bytes on average, "
+           "%u syncs (%.1f per frame), %.3f ms waiting\n",
+           glthread->num_frames, mon->num_batches,
+           mon->num_batches ? mon->num_offloaded_items / mon->num_batches : 0,
+           mon->num_syncs, (double) mon->num_syncs / frames,
+           mon->sync_wait_time_us / 1000.0);
+
+   unsigned count = glthread->call_stats->entries;
+   if (!count)
+      return;
+
+   struct glthread_call_stats **calls = malloc(count * sizeof(*calls));
+   if (!calls)
+      return;
+
+   unsigned i = 0;
+   hash_table_foreach(glthread->call_stats, entry)
+      calls[i++] = entry->data;
+   qsort(calls, count, sizeof(*calls), compare_wait_time);
+
+   fprintf(stderr, "glthread: %10s %12s %14s  %s\n",
+           "syncs", "wait (ms)", "direct bytes", "function");
+   for (i = 0; i < count; i++) {
+      fprintf(stderr, "glthread: %10u %12.3f %14"PRIu64"  gl%s\n",
+              calls[i]->syncs, calls[i]->wait_ns / 1000000.0,
+              calls[i]->direct_bytes, calls[i]->name);
+   }
+
+   free(calls);
+}
+
+static void
+atexit_handler(void)
+{
+   struct glthread_state *glthread;
+
+   mtx_lock(&stats_mutex);
+   LIST_FOR_EACH_ENTRY(glthread, &stats_list, stats_link)
+      print_stats(glthread);
+   mtx_unlock(&stats_mutex);
+}
+
+static void
+global_init(void)
+{
+   LIST_INITHEAD(&stats_list);
+   atexit(atexit_handler);
+}
+
+void
+_mesa_glthread_init_stats(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   glthread->max_frame_syncs = env_var_as_unsigned("MESA_GLTHREAD_ADAPTIVE", 0);
+   glthread->pause_frames = GLTHREAD_MIN_PAUSE_FRAMES;
+
+   if (!env_var_as_boolean("MESA_GLTHREAD_STATS", false))
+      return;
+
+   glthread->call_stats = _mesa_hash_table_create(NULL, _mesa_key_hash_string,
+                                                  _mesa_key_string_equal);
+   if (!glthread->call_stats)
+      return;
+
+   call_once(&atexit_once_flag, global_init);
+
+   mtx_lock(&stats_mutex);
+   LIST_ADD(&glthread->stats_link, &stats_list);
+   mtx_unlock(&stats_mutex);
+}
+
+void
+_mesa_glthread_destroy_stats(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (!glthread->call_stats)
+      return;
+
+   mtx_lock(&stats_mutex);
+   LIST_DEL(&glthread->stats_link);
+   mtx_unlock(&stats_mutex);
+
+   print_stats(glthread);
+   _mesa_hash_table_destroy(glthread->call_stats, NULL);
+   glthread->call_stats = NULL;
+}
+
+/**
+ * Called by _mesa_glthread_finish_before() when \p func had to wait for the
+ * server thread.
+ */
+void
+_mesa_glthread_record_sync(struct gl_context *ctx, const char *func,
+                           int64_t wait_ns, size_t direct_bytes)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   glthread->frame_syncs++;
+
+   if (!glthread->call_stats)
+      return;
+
+   struct glthread_call_stats *call;
+   struct hash_entry *entry =
+      _mesa_hash_table_search(glthread->call_stats, func);
+
+   if (entry) {
+      call = entry->data;
+   } else {
+      call = rzalloc(glthread->call_stats, struct glthread_call_stats);
+      if (!call)
+         return;
+      call->name = func;
+      _mesa_hash_table_insert(glthread->call_stats, func, call);
+   }
+
+   call->syncs++;
+   call->wait_ns += wait_ns;
+   call->direct_bytes += direct_bytes;
+}
+
+/** Switches to direct dispatch without giving up the glthread state. */
+static void
+pause_glthread(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (_glapi_get_dispatch() != ctx->MarshalExec)
+      return;
+
+   _mesa_glthread_finish(ctx);
+   ctx->CurrentClientDispatch = ctx->CurrentServerDispatch;
+   _glapi_set_dispatch(ctx->CurrentClientDispatch);
+
+   glthread->paused = true;
+   glthread->paused_frames = 0;
+}
+
+/**
+ * Whether the state that the main thread tracks can be read back from the
+ * server thread.  This is everything that doesn't disable threading for
+ * good when glthread sees it.
+ */
+static bool
+can_resume(struct gl_context *ctx)
+{
+   if (_glapi_get_dispatch() != ctx->OutsideBeginEnd ||
+       ctx->CurrentServerDispatch != ctx->OutsideBeginEnd ||
+       ctx->ListState.CurrentList)
+      return false;
+
+   if (ctx->API != API_OPENGL_CORE &&
+       ctx->Array.VAO != ctx->Array.DefaultVAO)
+      return false;
+
+   /* The glPushClientAttrib stack can't be read back. */
+   if (ctx->ClientAttribStackDepth)
+      return false;
+
+   if (ctx->Debug &&
+       _mesa_get_debug_state_int(ctx, GL_DEBUG_OUTPUT_SYNCHRONOUS_ARB))
+      return false;
+
+   return _mesa_glthread_reset_vertex_arrays(ctx);
+}
+
+static void
+resume_glthread(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   glthread->paused_frames = 0;
+
+   if (!can_resume(ctx))
+      return;
+
+   _mesa_glthread_reset_shadow(ctx);
+
+   ctx->CurrentClientDispatch = ctx->MarshalExec;
+   _glapi_set_dispatch(ctx->CurrentClientDispatch);
+
+   glthread->paused = false;
+   glthread->probing = true;
+   glthread->frame_syncs = 0;
+}
+
+/**
+ * Called when the app presents a frame, with the server thread idle.
+ */
+void
+_mesa_glthread_end_of_frame(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (!glthread || glthread->disabled)
+      return;
+
+   glthread->num_frames++;
+
+   if (!glthread->max_frame_syncs)
+      return;
+
+   if (glthread->paused) {
+      if (++glthread->paused_frames >= glthread->pause_frames)
+         resume_glthread(ctx);
+      return;
+   }
+
+   if (glthread->frame_syncs > glthread->max_frame_syncs) {
+      /* Back off if turning it back on didn't help. */
+      if (glthread->probing) {
+         glthread->pause_frames = MIN2(glthread->pause_frames * 2,
+                                       GLTHREAD_MAX_PAUSE_FRAMES);
+      }
+      pause_glthread(ctx);
+   } else {
+      glthread->pause_frames = GLTHREAD_MIN_PAUSE_FRAMES;
+   }
+
+   glthread->probing = false;
+   glthread->frame_syncs = 0;
+}
@@ -0,0 +1,431 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file glthread_varray.c
+ *
+ * Vertex array state tracked on the client thread, so that draw calls can
+ * find out which client memory they read without syncing with the server
+ * thread (see glthread_draw.c).
+ *
+ * These run after the corresponding call has been queued.  Calls that the
+ * server thread would reject are ignored where that is cheap to tell; the
+ * remaining mismatches are caught when the draw call is executed, because
+ * arrays are only redirected to their copies if the server still points at
+ * the same memory.
+ */
+
+#include "main/mtypes.h"
+#include "main/bufferobj.h"
+#include "main/glformats.h"
+#include "main/glthread.h"
+#include "main/marshal.h"
+#include "util/set.h"
+
+void
+_mesa_glthread_AttribPointer(struct gl_context *ctx, unsigned attrib,
+                             GLint size, GLenum type, GLsizei stride,
+                             const GLvoid *pointer)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (attrib >= VERT_ATTRIB_MAX || stride < 0)
+      return;
+
+   if (size == GL_BGRA)
+      size = 4;
+   else if (size < 1 || size > 4)
+      return;
+
+   int element_size = _mesa_bytes_per_vertex_attrib(size, type);
+   if (element_size <= 0)
+      return;
+
+   struct glthread_attrib *array = &glthread->vao.attrib[attrib];
+   array->pointer = pointer;
+   array->element_size = element_size;
+   array->stride = stride ? stride : element_size;
+   array->user_pointer = glthread->array_buffer == 0;
+
+   if (array->user_pointer)
+      glthread->vao.user_pointer_mask |= VERT_BIT(attrib);
+   else
+      glthread->vao.user_pointer_mask &= ~VERT_BIT(attrib);
+}
+
+void
+_mesa_glthread_EnableAttrib(struct gl_context *ctx, unsigned attrib,
+                            bool enable)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (attrib >= VERT_ATTRIB_MAX)
+      return;
+
+   if (enable)
+      glthread->vao.enabled |= VERT_BIT(attrib);
+   else
+      glthread->vao.enabled &= ~VERT_BIT(attrib);
+}
+
+void
+_mesa_glthread_AttribDivisor(struct gl_context *ctx, unsigned attrib,
+                             GLuint divisor)
+{
+   if (attrib >= VERT_ATTRIB_MAX)
+      return;
+
+   ctx->GLThread->vao.attrib[attrib].divisor = divisor;
+}
+
+/**
+ * glEnableClientState/glDisableClientState, and glEnable/glDisable, which
+ * accept the same arrays on compat contexts.
+ */
+void
+_mesa_glthread_ClientState(struct gl_context *ctx, GLenum cap, bool enable)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   switch (cap) {
+   case GL_VERTEX_ARRAY:
+      _mesa_glthread_EnableAttrib(ctx, VERT_ATTRIB_POS, enable);
+      break;
+   case GL_NORMAL_ARRAY:
+      _mesa_glthread_EnableAttrib(ctx, VERT_ATTRIB_NORMAL, enable);
+      break;
+   case GL_COLOR_ARRAY:
+      _mesa_glthread_EnableAttrib(ctx, VERT_ATTRIB_COLOR0, enable);
+      break;
+   case GL_INDEX_ARRAY:
+      _mesa_glthread_EnableAttrib(ctx, VERT_ATTRIB_COLOR_INDEX, enable);
+      break;
+   case GL_TEXTURE_COORD_ARRAY:
+      _mesa_glthread_EnableAttrib(ctx,
+                                  VERT_ATTRIB_TEX(glthread->client_active_texture),
+                                  enable);
+      break;
+   case GL_EDGE_FLAG_ARRAY:
+      _mesa_glthread_EnableAttrib(ctx, VERT_ATTRIB_EDGEFLAG, enable);
+      break;
+   case GL_FOG_COORDINATE_ARRAY:
+      _mesa_glthread_EnableAttrib(ctx, VERT_ATTRIB_FOG, enable);
+      break;
+   case GL_SECONDARY_COLOR_ARRAY:
+      _mesa_glthread_EnableAttrib(ctx, VERT_ATTRIB_COLOR1, enable);
+      break;
+   case GL_POINT_SIZE_ARRAY_OES:
+      _mesa_glthread_EnableAttrib(ctx, VERT_ATTRIB_POINT_SIZE, enable);
+      break;
+   case GL_PRIMITIVE_RESTART:
+   case GL_PRIMITIVE_RESTART_NV:
+      glthread->primitive_restart = enable;
+      break;
+   case GL_PRIMITIVE_RESTART_FIXED_INDEX:
+      glthread->primitive_restart_fixed_index = enable;
+      break;
+   }
+}
+
+void
+_mesa_glthread_ClientActiveTexture(struct gl_context *ctx, GLenum texture)
+{
+   if (texture >= GL_TEXTURE0 &&
+       texture < GL_TEXTURE0 + VERT_ATTRIB_TEX_MAX)
+      ctx->GLThread->client_active_texture = texture - GL_TEXTURE0;
+}
+
+void
+_mesa_glthread_PrimitiveRestartIndex(struct gl_context *ctx, GLuint index)
+{
+   ctx->GLThread->restart_index = index;
+}
+
+void
+_mesa_glthread_PushClientAttrib(struct gl_context *ctx, GLbitfield mask)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (glthread->client_attrib_stack_depth >= MAX_CLIENT_ATTRIB_STACK_DEPTH)
+      return;
+
+   struct glthread_client_attrib *top =
+      &glthread->client_attrib_stack[glthread->client_attrib_stack_depth++];
+
+   top->valid = (mask & GL_CLIENT_VERTEX_ARRAY_BIT) != 0;
+   if (!top->valid)
+      return;
+
+   top->vao = glthread->vao;
+   top->client_active_texture = glthread->client_active_texture;
+   top->primitive_restart = glthread->primitive_restart;
+   top->primitive_restart_fixed_index = glthread->primitive_restart_fixed_index;
+   top->restart_index = glthread->restart_index;
+   top->array_buffer = glthread->array_buffer;
+   top->element_array_buffer = glthread->element_array_buffer;
+}
+
+void
+_mesa_glthread_PopClientAttrib(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (glthread->client_attrib_stack_depth == 0)
+      return;
+
+   const struct glthread_client_attrib *top =
+      &glthread->client_attrib_stack[--glthread->client_attrib_stack_depth];
+
+   if (!top->valid)
+      return;
+
+   glthread->vao = top->vao;
+   glthread->client_active_texture = top->client_active_texture;
+   glthread->primitive_restart = top->primitive_restart;
+   glthread->primitive_restart_fixed_index = top->primitive_restart_fixed_index;
+   glthread->restart_index = top->restart_index;
+   glthread->array_buffer = top->array_buffer;
+   glthread->element_array_buffer = top->element_array_buffer;
+}
+
+static void
+add_names(struct set *names, GLsizei n, const GLuint *ids)
+{
+   if (n < 0 || !ids)
+      return;
+
+   for (GLsizei i = 0; i < n; i++) {
+      if (ids[i] != 0)
+         _mesa_set_add(names, (void *)(uintptr_t) ids[i]);
+   }
+}
+
+/**
+ * Whether binding \p id doesn't fail.  Compatibility contexts create
+ * objects on first bind, but core contexts only take names returned by
+ * glGen* or glCreate*.  Names from before threading was turned on, or from
+ * another context, are not in \p names and conservatively count as invalid.
+ */
+static bool
+is_valid_name(const struct gl_context *ctx, const struct set *names,
+              GLuint id)
+{
+   return id == 0 || ctx->API != API_OPENGL_CORE ||
+          _mesa_set_search(names, (void *)(uintptr_t) id);
+}
+
+static void
+set_binding_known(struct glthread_state *glthread, unsigned bit, bool known)
+{
+   if (known)
+      glthread->bindings_known |= bit;
+   else
+      glthread->bindings_known &= ~bit;
+}
+
+/** glGenBuffers and glCreateBuffers */
+void
+_mesa_glthread_GenBuffers(struct gl_context *ctx, GLsizei n,
+                          const GLuint *buffers)
+{
+   add_names(ctx->GLThread->buffer_names, n, buffers);
+}
+
+/**
+ * glBindBuffer for the targets whose binding glGet* answers.  If the bind
+ * may fail, glGet* asks the server thread until the next valid bind.
+ */
+void
+_mesa_glthread_BindBuffer(struct gl_context *ctx, GLenum target,
+                          GLuint buffer)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   unsigned bit;
+
+   switch (target) {
+   case GL_ARRAY_BUFFER:
+      bit = GLTHREAD_BINDING_ARRAY_BUFFER;
+      break;
+   case GL_PIXEL_PACK_BUFFER:
+      bit = GLTHREAD_BINDING_PIXEL_PACK_BUFFER;
+      break;
+   case GL_PIXEL_UNPACK_BUFFER:
+      bit = GLTHREAD_BINDING_PIXEL_UNPACK_BUFFER;
+      break;
+   case GL_DRAW_INDIRECT_BUFFER:
+      bit = GLTHREAD_BINDING_DRAW_INDIRECT;
+      break;
+   default:
+      return;
+   }
+
+   set_binding_known(glthread, bit,
+                     is_valid_name(ctx, glthread->buffer_names, buffer));
+}
+
+/**
+ * Deleting a buffer unbinds it from the context.  (It also unbinds it from
+ * the vertex arrays, which then read from a bogus user pointer; copying that
+ * isn't any more useful than not doing it, so we don't follow that.)
+ */
+void
+_mesa_glthread_DeleteBuffers(struct gl_context *ctx, GLsizei n,
+                             const GLuint *buffers)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (n < 0 || !buffers)
+      return;
+
+   for (GLsizei i = 0; i < n; i++) {
+      GLuint id = buffers[i];
+
+      if (id == 0)
+         continue;
+
+      _mesa_set_remove_key(glthread->buffer_names, (void *)(uintptr_t) id);
+
+      if (id == glthread->array_buffer)
+         glthread->array_buffer = 0;
+      if (id == glthread->element_array_buffer)
+         glthread->element_array_buffer = 0;
+      if (id == glthread->pixel_pack_buffer)
+         glthread->pixel_pack_buffer = 0;
+      if (id == glthread->pixel_unpack_buffer)
+         glthread->pixel_unpack_buffer = 0;
+      if (id == glthread->draw_indirect_buffer)
+         glthread->draw_indirect_buffer = 0;
+   }
+}
+
+/** glGenVertexArrays and glCreateVertexArrays */
+void
+_mesa_glthread_GenVertexArrays(struct gl_context *ctx, GLsizei n,
+                               const GLuint *ids)
+{
+   add_names(ctx->GLThread->vertex_array_names, n, ids);
+}
+
+/**
+ * glBindVertexArray, which disables threading in compat contexts, so this
+ * only keeps the name for glGet.  The index buffer binding, which is part of
+ * the vertex array object, becomes unknown to the main thread.
+ */
+void
+_mesa_glthread_BindVertexArray(struct gl_context *ctx, GLuint id)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   glthread->vertex_array = id;
+   set_binding_known(glthread, GLTHREAD_BINDING_VERTEX_ARRAY,
+                     is_valid_name(ctx, glthread->vertex_array_names, id));
+}
+
+void
+_mesa_glthread_DeleteVertexArrays(struct gl_context *ctx, GLsizei n,
+                                  const GLuint *ids)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (n < 0 || !ids)
+      return;
+
+   for (GLsizei i = 0; i < n; i++) {
+      if (ids[i] == 0)
+         continue;
+
+      _mesa_set_remove_key(glthread->vertex_array_names,
+                           (void *)(uintptr_t) ids[i]);
+
+      if (ids[i] == glthread->vertex_array)
+         glthread->vertex_array = 0;
+   }
+}
+
+static void
+read_back_vao(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   const struct gl_vertex_array_object *vao = ctx->Array.VAO;
+
+   glthread->vao.enabled = vao->Enabled;
+   glthread->vao.user_pointer_mask = 0;
+
+   for (unsigned i = 0; i < VERT_ATTRIB_MAX; i++) {
+      const struct gl_array_attributes *array = &vao->VertexAttrib[i];
+      const struct gl_vertex_buffer_binding *binding =
+         &vao->BufferBinding[array->BufferBindingIndex];
+      struct glthread_attrib *attrib = &glthread->vao.attrib[i];
+
+      attrib->pointer = array->Ptr;
+      attrib->element_size = array->Format._ElementSize;
+      attrib->stride = binding->Stride;
+      attrib->divisor = binding->InstanceDivisor;
+      attrib->user_pointer = !_mesa_is_bufferobj(binding->BufferObj);
+
+      if (attrib->user_pointer)
+         glthread->vao.user_pointer_mask |= VERT_BIT(i);
+   }
+}
+
+/**
+ * glInterleavedArrays is executed synchronously, so instead of decoding the
+ * format again, read back what it did to the vertex arrays.
+ */
+void
+_mesa_glthread_InterleavedArrays(struct gl_context *ctx)
+{
+   read_back_vao(ctx);
+}
+
+/**
+ * Reads back all of the vertex array state from the server thread, which
+ * must be idle, when glthread is turned back on with an empty client attrib
+ * stack.  Returns false if the vertex arrays use something that glthread
+ * doesn't follow.
+ */
+bool
+_mesa_glthread_reset_vertex_arrays(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   /* glthread assumes that each array has its own binding, as set up by
+    * gl*Pointer.
+    */
+   if (ctx->API != API_OPENGL_CORE) {
+      const struct gl_vertex_array_object *vao = ctx->Array.VAO;
+
+      for (unsigned i = 0; i < VERT_ATTRIB_MAX; i++) {
+         if (vao->VertexAttrib[i].BufferBindingIndex != i)
+            return false;
+      }
+   }
+
+   read_back_vao(ctx);
+   glthread->client_active_texture = ctx->Array.ActiveTexture;
+   glthread->primitive_restart = ctx->Array.PrimitiveRestart;
+   glthread->primitive_restart_fixed_index =
+      ctx->Array.PrimitiveRestartFixedIndex;
+   glthread->restart_index = ctx->Array.RestartIndex;
+   glthread->client_attrib_stack_depth = 0;
+   return true;
+}
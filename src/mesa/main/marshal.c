@@ -88,17 +88,18 @@ _mesa_marshal_Enable(GLenum cap)
    debug_print_marshal("Enable");
 
    if (cap == GL_DEBUG_OUTPUT_SYNCHRONOUS_ARB) {
-      _mesa_glthread_finish(ctx);
+      _mesa_glthread_finish_before(ctx, "Enable");
       _mesa_glthread_restore_dispatch(ctx, "Enable(DEBUG_OUTPUT_SYNCHRONOUS)");
    } else {
       cmd = _mesa_glthread_allocate_command(ctx, DISPATCH_CMD_Enable,
                                             sizeof(*cmd));
       cmd->cap = cap;
       _mesa_post_marshal_hook(ctx);
+      _mesa_glthread_Enable(ctx, cap, true);
       return;
    }
 
-   _mesa_glthread_finish(ctx);
+   _mesa_glthread_finish_before(ctx, "Enable");
    debug_print_sync_fallback("Enable");
    CALL_Enable(ctx->CurrentServerDispatch, (cap));
 }
@@ -187,7 +188,7 @@ _mesa_marshal_ShaderSource(GLuint shader, GLsizei count,
       }
       _mesa_post_marshal_hook(ctx);
    } else {
-      _mesa_glthread_finish(ctx);
+      _mesa_glthread_finish_before(ctx, "ShaderSource");
       CALL_ShaderSource(ctx->CurrentServerDispatch,
                         (shader, count, string, length_tmp));
    }
@@ -204,7 +205,8 @@ struct marshal_cmd_BindBufferBase
    GLuint buffer;
 };
 
-/** Tracks the current bindings for the vertex array and index array buffers.
+/** Tracks the current bindings for the vertex array and index array buffers,
+ * and the other buffer bindings that glthread_get.c answers queries about.
  *
  * This is part of what we need to enable glthread on compat-GL contexts that
  * happen to use VBOs, without also supporting the full tracking of VBO vs
@@ -217,7 +219,9 @@ struct marshal_cmd_BindBufferBase
  * However, in GL core the draw call would throw an error as well, so we don't
  * really care if our tracking is wrong for this case -- we never need to
  * marshal user data for draw calls, and the unmarshal will just generate an
- * error or not as appropriate.
+ * error or not as appropriate.  glGet* would return the wrong binding,
+ * though, so _mesa_glthread_BindBuffer() makes it unknown when the name
+ * wasn't returned by glGenBuffers or glCreateBuffers.
  *
  * For compatibility GL, we do need to accurately know whether the draw call
  * on the unmarshal side will dereference a user pointer or load data from a
@@ -234,16 +238,27 @@ track_vbo_binding(struct gl_context *ctx, GLenum target, GLuint buffer)
 
    switch (target) {
    case GL_ARRAY_BUFFER:
-      glthread->vertex_array_is_vbo = (buffer != 0);
+      glthread->array_buffer = buffer;
       break;
    case GL_ELEMENT_ARRAY_BUFFER:
       /* The current element array buffer binding is actually tracked in the
        * vertex array object instead of the context, so this would need to
        * change on vertex array object updates.
        */
-      glthread->element_array_is_vbo = (buffer != 0);
+      glthread->element_array_buffer = buffer;
+      break;
+   case GL_PIXEL_PACK_BUFFER:
+      glthread->pixel_pack_buffer = buffer;
+      break;
+   case GL_PIXEL_UNPACK_BUFFER:
+      glthread->pixel_unpack_buffer = buffer;
+      break;
+   case GL_DRAW_INDIRECT_BUFFER:
+      glthread->draw_indirect_buffer = buffer;
       break;
    }
+
+   _mesa_glthread_BindBuffer(ctx, target, buffer);
 }
 
 
@@ -283,7 +298,7 @@ _mesa_marshal_BindBuffer(GLenum target, GLuint buffer)
       cmd->buffer = buffer;
       _mesa_post_marshal_hook(ctx);
    } else {
-      _mesa_glthread_finish(ctx);
+      _mesa_glthread_finish_before(ctx, "BindBuffer");
       CALL_BindBuffer(ctx->CurrentServerDispatch, (target, buffer));
    }
 }
@@ -326,7 +341,7 @@ _mesa_marshal_BufferData(GLenum target, GLsizeiptr size, const GLvoid * data,
    debug_print_marshal("BufferData");
 
    if (unlikely(size < 0)) {
-      _mesa_glthread_finish(ctx);
+      _mesa_glthread_finish_before(ctx, "BufferData");
       _mesa_error(ctx, GL_INVALID_VALUE, "BufferData(size < 0)");
       return;
    }
@@ -347,7 +362,7 @@ _mesa_marshal_BufferData(GLenum target, GLsizeiptr size, const GLvoid * data,
       }
       _mesa_post_marshal_hook(ctx);
    } else {
-      _mesa_glthread_finish(ctx);
+      _mesa_glthread_finish_before(ctx, "BufferData");
       CALL_BufferData(ctx->CurrentServerDispatch,
                       (target, size, data, usage));
    }
@@ -385,7 +400,7 @@ _mesa_marshal_BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size,
 
    debug_print_marshal("BufferSubData");
    if (unlikely(size < 0)) {
-      _mesa_glthread_finish(ctx);
+      _mesa_glthread_finish_before(ctx, "BufferSubData");
       _mesa_error(ctx, GL_INVALID_VALUE, "BufferSubData(size < 0)");
       return;
    }
@@ -402,7 +417,7 @@ _mesa_marshal_BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size,
       memcpy(variable_data, data, size);
       _mesa_post_marshal_hook(ctx);
    } else {
-      _mesa_glthread_finish(ctx);
+      _mesa_glthread_finish_before(ctx, "BufferSubData");
       CALL_BufferSubData(ctx->CurrentServerDispatch,
                          (target, offset, size, data));
    }
@@ -446,7 +461,7 @@ _mesa_marshal_NamedBufferData(GLuint buffer, GLsizeiptr size,
 
    debug_print_marshal("NamedBufferData");
    if (unlikely(size < 0)) {
-      _mesa_glthread_finish(ctx);
+      _mesa_glthread_finish_before(ctx, "NamedBufferData");
       _mesa_error(ctx, GL_INVALID_VALUE, "NamedBufferData(size < 0)");
       return;
    }
@@ -465,7 +480,7 @@ _mesa_marshal_NamedBufferData(GLuint buffer, GLsizeiptr size,
       }
       _mesa_post_marshal_hook(ctx);
    } else {
-      _mesa_glthread_finish(ctx);
+      _mesa_glthread_finish_before(ctx, "NamedBufferData");
       CALL_NamedBufferData(ctx->CurrentServerDispatch,
                            (buffer, size, data, usage));
    }
@@ -503,7 +518,7 @@ _mesa_marshal_NamedBufferSubData(GLuint buffer, GLintptr offset,
 
    debug_print_marshal("NamedBufferSubData");
    if (unlikely(size < 0)) {
-      _mesa_glthread_finish(ctx);
+      _mesa_glthread_finish_before(ctx, "NamedBufferSubData");
       _mesa_error(ctx, GL_INVALID_VALUE, "NamedBufferSubData(size < 0)");
       return;
    }
@@ -519,7 +534,7 @@ _mesa_marshal_NamedBufferSubData(GLuint buffer, GLintptr offset,
       memcpy(variable_data, data, size);
       _mesa_post_marshal_hook(ctx);
    } else {
-      _mesa_glthread_finish(ctx);
+      _mesa_glthread_finish_before(ctx, "NamedBufferSubData");
       CALL_NamedBufferSubData(ctx->CurrentServerDispatch,
                               (buffer, offset, size, data));
    }
@@ -635,7 +650,7 @@ _mesa_marshal_ClearBufferfv(GLenum buffer, GLint drawbuffer,
    debug_print_marshal("ClearBufferfv");
 
    if (!(buffer == GL_DEPTH || buffer == GL_COLOR)) {
-      _mesa_glthread_finish(ctx);
+      _mesa_glthread_finish_before(ctx, "ClearBufferfv");
 
       /* Page 498 of the PDF, section '17.4.3.1 Clearing Individual Buffers'
        * of the OpenGL 4.5 spec states:
@@ -651,7 +666,7 @@ _mesa_marshal_ClearBufferfv(GLenum buffer, GLint drawbuffer,
    if (!clear_buffer_add_command(ctx, DISPATCH_CMD_ClearBufferfv, buffer,
                                  drawbuffer, (GLuint *)value, size)) {
       debug_print_sync("ClearBufferfv");
-      _mesa_glthread_finish(ctx);
+      _mesa_glthread_finish_before(ctx, "ClearBufferfv");
       CALL_ClearBufferfv(ctx->CurrentServerDispatch,
                          (buffer, drawbuffer, value));
    }
@@ -665,7 +680,7 @@ _mesa_marshal_ClearBufferiv(GLenum buffer, GLint drawbuffer,
    debug_print_marshal("ClearBufferiv");
 
    if (!(buffer == GL_STENCIL || buffer == GL_COLOR)) {
-      _mesa_glthread_finish(ctx);
+      _mesa_glthread_finish_before(ctx, "ClearBufferiv");
 
       /* Page 498 of the PDF, section '17.4.3.1 Clearing Individual Buffers'
        * of the OpenGL 4.5 spec states:
@@ -681,7 +696,7 @@ _mesa_marshal_ClearBufferiv(GLenum buffer, GLint drawbuffer,
    if (!clear_buffer_add_command(ctx, DISPATCH_CMD_ClearBufferiv, buffer,
                                  drawbuffer, (GLuint *)value, size)) {
       debug_print_sync("ClearBufferiv");
-      _mesa_glthread_finish(ctx);
+      _mesa_glthread_finish_before(ctx, "ClearBufferiv");
       CALL_ClearBufferiv(ctx->CurrentServerDispatch,
                          (buffer, drawbuffer, value));
    }
@@ -695,7 +710,7 @@ _mesa_marshal_ClearBufferuiv(GLenum buffer, GLint drawbuffer,
    debug_print_marshal("ClearBufferuiv");
 
    if (buffer != GL_COLOR) {
-      _mesa_glthread_finish(ctx);
+      _mesa_glthread_finish_before(ctx, "ClearBufferuiv");
 
       /* Page 498 of the PDF, section '17.4.3.1 Clearing Individual Buffers'
        * of the OpenGL 4.5 spec states:
@@ -710,7 +725,7 @@ _mesa_marshal_ClearBufferuiv(GLenum buffer, GLint drawbuffer,
    if (!clear_buffer_add_command(ctx, DISPATCH_CMD_ClearBufferuiv, buffer,
                                  drawbuffer, (GLuint *)value, 4)) {
       debug_print_sync("ClearBufferuiv");
-      _mesa_glthread_finish(ctx);
+      _mesa_glthread_finish_before(ctx, "ClearBufferuiv");
       CALL_ClearBufferuiv(ctx->CurrentServerDispatch,
                          (buffer, drawbuffer, value));
    }
@@ -724,7 +739,7 @@ _mesa_marshal_ClearBufferfi(GLenum buffer, GLint drawbuffer,
    debug_print_marshal("ClearBufferfi");
 
    if (buffer != GL_DEPTH_STENCIL) {
-      _mesa_glthread_finish(ctx);
+      _mesa_glthread_finish_before(ctx, "ClearBufferfi");
 
       /* Page 498 of the PDF, section '17.4.3.1 Clearing Individual Buffers'
        * of the OpenGL 4.5 spec states:
@@ -742,7 +757,7 @@ _mesa_marshal_ClearBufferfi(GLenum buffer, GLint drawbuffer,
    if (!clear_buffer_add_command(ctx, DISPATCH_CMD_ClearBufferfi, buffer,
                                  drawbuffer, (GLuint *)value, 2)) {
       debug_print_sync("ClearBufferfi");
-      _mesa_glthread_finish(ctx);
+      _mesa_glthread_finish_before(ctx, "ClearBufferfi");
       CALL_ClearBufferfi(ctx->CurrentServerDispatch,
                          (buffer, drawbuffer, depth, stencil));
    }
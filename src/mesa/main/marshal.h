@@ -70,30 +70,111 @@ _mesa_glthread_allocate_command(struct gl_context *ctx,
 }
 
 /**
- * Instead of conditionally handling marshaling previously-bound user vertex
- * array data in draw calls (deprecated and removed in GL core), we just
- * disable threading at the point where the user sets a user vertex array.
+ * Whether the next draw call reads vertex data from client memory.
+ *
+ * Draw calls that know their vertex range copy that data into the batch (see
+ * glthread_draw.c), the rest of them use this to fall back to a sync.
  */
 static inline bool
-_mesa_glthread_is_non_vbo_vertex_attrib_pointer(const struct gl_context *ctx)
+_mesa_glthread_has_non_vbo_vertices(const struct gl_context *ctx)
 {
-   struct glthread_state *glthread = ctx->GLThread;
+   const struct glthread_state *glthread = ctx->GLThread;
 
-   return ctx->API != API_OPENGL_CORE && !glthread->vertex_array_is_vbo;
+   return ctx->API != API_OPENGL_CORE &&
+          (glthread->vao.enabled & glthread->vao.user_pointer_mask);
 }
 
 /**
- * Instead of conditionally handling marshaling immediate index data in draw
- * calls (deprecated and removed in GL core), we just disable threading.
+ * Like _mesa_glthread_has_non_vbo_vertices(), but also true for client-memory
+ * indices.
  */
 static inline bool
-_mesa_glthread_is_non_vbo_draw_elements(const struct gl_context *ctx)
+_mesa_glthread_has_non_vbo_vertices_or_indices(const struct gl_context *ctx)
 {
-   struct glthread_state *glthread = ctx->GLThread;
+   const struct glthread_state *glthread = ctx->GLThread;
+
+   return ctx->API != API_OPENGL_CORE &&
+          (glthread->element_array_buffer == 0 ||
+           (glthread->vao.enabled & glthread->vao.user_pointer_mask));
+}
 
-   return ctx->API != API_OPENGL_CORE && !glthread->element_array_is_vbo;
+/**
+ * Returns the vertex attribute of generic array \p index, or VERT_ATTRIB_MAX
+ * if the index is out of range, in which case the GL call fails and glthread
+ * ignores it.
+ */
+static inline unsigned
+_mesa_glthread_generic_attrib(GLuint index)
+{
+   return index < VERT_ATTRIB_GENERIC_MAX ? VERT_ATTRIB_GENERIC(index)
+                                          : VERT_ATTRIB_MAX;
 }
 
+void
+_mesa_glthread_AttribPointer(struct gl_context *ctx, unsigned attrib,
+                             GLint size, GLenum type, GLsizei stride,
+                             const GLvoid *pointer);
+void
+_mesa_glthread_EnableAttrib(struct gl_context *ctx, unsigned attrib,
+                            bool enable);
+void
+_mesa_glthread_AttribDivisor(struct gl_context *ctx, unsigned attrib,
+                             GLuint divisor);
+void
+_mesa_glthread_ClientState(struct gl_context *ctx, GLenum cap, bool enable);
+void
+_mesa_glthread_ClientActiveTexture(struct gl_context *ctx, GLenum texture);
+void
+_mesa_glthread_PrimitiveRestartIndex(struct gl_context *ctx, GLuint index);
+void
+_mesa_glthread_PushClientAttrib(struct gl_context *ctx, GLbitfield mask);
+void
+_mesa_glthread_PopClientAttrib(struct gl_context *ctx);
+void
+_mesa_glthread_InterleavedArrays(struct gl_context *ctx);
+bool
+_mesa_glthread_reset_vertex_arrays(struct gl_context *ctx);
+void
+_mesa_glthread_GenBuffers(struct gl_context *ctx, GLsizei n,
+                          const GLuint *buffers);
+void
+_mesa_glthread_BindBuffer(struct gl_context *ctx, GLenum target,
+                          GLuint buffer);
+void
+_mesa_glthread_DeleteBuffers(struct gl_context *ctx, GLsizei n,
+                             const GLuint *buffers);
+void
+_mesa_glthread_GenVertexArrays(struct gl_context *ctx, GLsizei n,
+                               const GLuint *ids);
+void
+_mesa_glthread_BindVertexArray(struct gl_context *ctx, GLuint id);
+void
+_mesa_glthread_DeleteVertexArrays(struct gl_context *ctx, GLsizei n,
+                                  const GLuint *ids);
+
+void
+_mesa_glthread_reset_shadow(struct gl_context *ctx);
+void
+_mesa_glthread_invalidate_shadow(struct gl_context *ctx);
+void
+_mesa_glthread_Enable(struct gl_context *ctx, GLenum cap, bool enable);
+void
+_mesa_glthread_Enablei(struct gl_context *ctx, GLenum cap, GLuint index,
+                       bool enable);
+void
+_mesa_glthread_MatrixMode(struct gl_context *ctx, GLenum mode);
+void
+_mesa_glthread_ActiveTexture(struct gl_context *ctx, GLenum texture);
+void
+_mesa_glthread_Viewport(struct gl_context *ctx, GLint x, GLint y,
+                        GLsizei width, GLsizei height);
+void
+_mesa_glthread_invalidate_viewport(struct gl_context *ctx);
+void
+_mesa_glthread_PushAttrib(struct gl_context *ctx, GLbitfield mask);
+void
+_mesa_glthread_PopAttrib(struct gl_context *ctx);
+
 #define DEBUG_MARSHAL_PRINT_CALLS 0
 
 /**
@@ -167,6 +248,10 @@ _mesa_post_marshal_hook(struct gl_context *ctx)
  * Instead, just punt for now and disable threading on apps using vertex
  * arrays and compat contexts.  Apps using vertex arrays can probably use a
  * core context.
+ *
+ * The same goes for ARB_vertex_attrib_binding calls, which would otherwise
+ * make the default vertex array object differ from what the client thread
+ * tracks for client-memory arrays.
  */
 static inline bool
 _mesa_glthread_is_compat_bind_vertex_array(const struct gl_context *ctx)
@@ -183,10 +268,19 @@ struct marshal_cmd_BufferSubData;
 struct marshal_cmd_NamedBufferData;
 struct marshal_cmd_NamedBufferSubData;
 struct marshal_cmd_ClearBuffer;
+struct marshal_cmd_Draw;
 #define marshal_cmd_ClearBufferfv   marshal_cmd_ClearBuffer
 #define marshal_cmd_ClearBufferiv   marshal_cmd_ClearBuffer
 #define marshal_cmd_ClearBufferuiv  marshal_cmd_ClearBuffer
 #define marshal_cmd_ClearBufferfi   marshal_cmd_ClearBuffer
+#define marshal_cmd_DrawArrays                      marshal_cmd_Draw
+#define marshal_cmd_DrawArraysInstancedARB          marshal_cmd_Draw
+#define marshal_cmd_DrawElements                    marshal_cmd_Draw
+#define marshal_cmd_DrawRangeElements               marshal_cmd_Draw
+#define marshal_cmd_DrawElementsBaseVertex          marshal_cmd_Draw
+#define marshal_cmd_DrawRangeElementsBaseVertex     marshal_cmd_Draw
+#define marshal_cmd_DrawElementsInstancedARB        marshal_cmd_Draw
+#define marshal_cmd_DrawElementsInstancedBaseVertex marshal_cmd_Draw
 
 void
 _mesa_unmarshal_Enable(struct gl_context *ctx,
@@ -281,4 +375,89 @@ void GLAPIENTRY
 _mesa_marshal_ClearBufferfi(GLenum buffer, GLint drawbuffer,
                             const GLfloat depth, const GLint stencil);
 
+void GLAPIENTRY
+_mesa_marshal_DrawArrays(GLenum mode, GLint first, GLsizei count);
+
+void
+_mesa_unmarshal_DrawArrays(struct gl_context *ctx,
+                           const struct marshal_cmd_Draw *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_DrawArraysInstancedARB(GLenum mode, GLint first, GLsizei count,
+                                     GLsizei primcount);
+
+void
+_mesa_unmarshal_DrawArraysInstancedARB(struct gl_context *ctx,
+                                       const struct marshal_cmd_Draw *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_DrawElements(GLenum mode, GLsizei count, GLenum type,
+                           const GLvoid *indices);
+
+void
+_mesa_unmarshal_DrawElements(struct gl_context *ctx,
+                             const struct marshal_cmd_Draw *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_DrawRangeElements(GLenum mode, GLuint start, GLuint end,
+                                GLsizei count, GLenum type,
+                                const GLvoid *indices);
+
+void
+_mesa_unmarshal_DrawRangeElements(struct gl_context *ctx,
+                                  const struct marshal_cmd_Draw *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type,
+                                     const GLvoid *indices, GLint basevertex);
+
+void
+_mesa_unmarshal_DrawElementsBaseVertex(struct gl_context *ctx,
+                                       const struct marshal_cmd_Draw *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_DrawRangeElementsBaseVertex(GLenum mode, GLuint start,
+                                          GLuint end, GLsizei count,
+                                          GLenum type, const GLvoid *indices,
+                                          GLint basevertex);
+
+void
+_mesa_unmarshal_DrawRangeElementsBaseVertex(struct gl_context *ctx,
+                                            const struct marshal_cmd_Draw *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsInstancedARB(GLenum mode, GLsizei count,
+                                       GLenum type, const GLvoid *indices,
+                                       GLsizei primcount);
+
+void
+_mesa_unmarshal_DrawElementsInstancedARB(struct gl_context *ctx,
+                                         const struct marshal_cmd_Draw *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsInstancedBaseVertex(GLenum mode, GLsizei count,
+                                              GLenum type,
+                                              const GLvoid *indices,
+                                              GLsizei primcount,
+                                              GLint basevertex);
+
+void
+_mesa_unmarshal_DrawElementsInstancedBaseVertex(struct gl_context *ctx,
+                                                const struct marshal_cmd_Draw *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_GetBooleanv(GLenum pname, GLboolean *params);
+
+void GLAPIENTRY
+_mesa_marshal_GetIntegerv(GLenum pname, GLint *params);
+
+void GLAPIENTRY
+_mesa_marshal_GetFloatv(GLenum pname, GLfloat *params);
+
+void GLAPIENTRY
+_mesa_marshal_GetDoublev(GLenum pname, GLdouble *params);
+
+GLboolean GLAPIENTRY
+_mesa_marshal_IsEnabled(GLenum cap);
+
 #endif /* MARSHAL_H */
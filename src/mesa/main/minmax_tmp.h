@@ -0,0 +1,105 @@
+/*
+ * Copyright © 2014 Timothy Arceri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Index array min/max template, shared by sse_minmax.c and avx2_minmax.c.
+ *
+ * The including file defines MINMAX_VEC (the vector type) and the
+ * MINMAX_LOADU, MINMAX_STOREU, MINMAX_OR and MINMAX_ANDNOT operations on it,
+ * plus MINMAX_SET1_<bits>, MINMAX_MIN_<bits>, MINMAX_MAX_<bits> and
+ * MINMAX_CMPEQ_<bits> for 8, 16 and 32-bit unsigned lanes.  MINMAX_FUNC()
+ * then expands to a function with the prototype of _mesa_uint_array_min_max.
+ *
+ * Restart indices are taken out of the running minimum by OR'ing them with
+ * the all-ones compare mask and out of the maximum by masking them to zero,
+ * so the loop stays branch free.
+ */
+
+#define MINMAX_FUNC(NAME, TYPE, BITS)                                        \
+void                                                                         \
+NAME(const TYPE *indices, unsigned count, bool restart,                      \
+     unsigned restart_index, unsigned *min_index, unsigned *max_index)       \
+{                                                                            \
+   const unsigned lanes = sizeof(MINMAX_VEC) / sizeof(TYPE);                 \
+   TYPE min = (TYPE) ~0u, max = 0;                                           \
+   unsigned i = 0;                                                           \
+                                                                             \
+   /* A restart index that doesn't fit the type never matches. */            \
+   if (restart_index > (TYPE) ~0u)                                           \
+      restart = false;                                                       \
+                                                                             \
+   if (count >= 2 * lanes) {                                                 \
+      TYPE min_arr[sizeof(MINMAX_VEC) / sizeof(TYPE)];                       \
+      TYPE max_arr[sizeof(MINMAX_VEC) / sizeof(TYPE)];                       \
+      MINMAX_VEC vmin = MINMAX_SET1_##BITS((TYPE) ~0u);                      \
+      MINMAX_VEC vmax = MINMAX_SET1_##BITS(0);                               \
+      const unsigned vec_count = count & ~(lanes - 1);                       \
+                                                                             \
+      if (restart) {                                                         \
+         const MINMAX_VEC vrestart = MINMAX_SET1_##BITS((TYPE) restart_index);\
+                                                                             \
+         for (; i < vec_count; i += lanes) {                                 \
+            const MINMAX_VEC v = MINMAX_LOADU(&indices[i]);                  \
+            const MINMAX_VEC is_restart = MINMAX_CMPEQ_##BITS(v, vrestart);  \
+                                                                             \
+            vmin = MINMAX_MIN_##BITS(vmin, MINMAX_OR(v, is_restart));        \
+            vmax = MINMAX_MAX_##BITS(vmax, MINMAX_ANDNOT(is_restart, v));    \
+         }                                                                   \
+      } else {                                                               \
+         for (; i < vec_count; i += lanes) {                                 \
+            const MINMAX_VEC v = MINMAX_LOADU(&indices[i]);                  \
+                                                                             \
+            vmin = MINMAX_MIN_##BITS(vmin, v);                               \
+            vmax = MINMAX_MAX_##BITS(vmax, v);                               \
+         }                                                                   \
+      }                                                                      \
+                                                                             \
+      MINMAX_STOREU(min_arr, vmin);                                          \
+      MINMAX_STOREU(max_arr, vmax);                                          \
+                                                                             \
+      for (unsigned j = 0; j < lanes; j++) {                                 \
+         if (min_arr[j] < min)                                               \
+            min = min_arr[j];                                                \
+         if (max_arr[j] > max)                                               \
+            max = max_arr[j];                                                \
+      }                                                                      \
+   }                                                                         \
+                                                                             \
+   for (; i < count; i++) {                                                  \
+      if (restart && indices[i] == restart_index)                            \
+         continue;                                                           \
+      if (indices[i] < min)                                                  \
+         min = indices[i];                                                   \
+      if (indices[i] > max)                                                  \
+         max = indices[i];                                                   \
+   }                                                                         \
+                                                                             \
+   /* min > max only if every index was a restart index. */                 \
+   if (min > max) {                                                          \
+      *min_index = ~0u;                                                      \
+      *max_index = 0;                                                        \
+   } else {                                                                  \
+      *min_index = min;                                                      \
+      *max_index = max;                                                      \
+   }                                                                         \
+}
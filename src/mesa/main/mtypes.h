@@ -49,6 +49,7 @@
 #include "compiler/glsl/list.h"
 #include "util/simple_mtx.h"
 #include "util/u_dynarray.h"
+#include "util/u_queue.h"
 
 
 #ifdef __cplusplus
@@ -1370,12 +1371,13 @@ struct gl_buffer_object
 
    struct gl_buffer_mapping Mappings[MAP_COUNT];
 
-   /** Memoization of min/max index computations for static index buffers */
+   /** Memoization of min/max index computations for index buffers */
    simple_mtx_t MinMaxCacheMutex;
    struct hash_table *MinMaxCache;
-   unsigned MinMaxCacheHitIndices;
-   unsigned MinMaxCacheMissIndices;
+   struct vbo_minmax_tree *MinMaxTree[3]; /**< per index size, see vbo */
    bool MinMaxCacheDirty;
+   /** Byte range written since the cache was last used */
+   GLintptr MinMaxCacheDirtyStart, MinMaxCacheDirtyEnd;
 
    bool HandleAllocated; /**< GL_ARB_bindless_texture */
 };
@@ -2669,6 +2671,12 @@ struct gl_shader
 
    /* ARB_gl_spirv related data */
    struct gl_shader_spirv_data *spirv_data;
+
+   /**
+    * Signalled when no glCompileShader job is running for this shader on
+    * gl_context::ShaderCompilerQueue.  See _mesa_wait_shader_compile().
+    */
+   struct util_queue_fence CompileFence;
 };
 
 
@@ -3098,6 +3106,7 @@ struct gl_shader_program
 #define GLSL_DUMP_ON_ERROR 0x80 /**< Dump shaders to stderr on compile error */
 #define GLSL_CACHE_INFO 0x100 /**< Print debug information about shader cache */
 #define GLSL_CACHE_FALLBACK 0x200 /**< Force shader cache fallback paths */
+#define GLSL_SYNC_COMPILE 0x400 /**< Compile shaders on the calling thread */
 
 
 /**
@@ -3198,6 +3207,15 @@ struct gl_shader_compiler_options
    /** Clamp UBO and SSBO block indices so they don't go out-of-bounds. */
    GLboolean ClampBlockIndicesToArrayBounds;
 
+   /**
+    * The driver translates the linked GLSL IR to NIR and optimizes it there.
+    *
+    * Skip GLSL IR optimizations at compile time, unless EmitNoIndirectSampler
+    * is set.  Link time optimization is unchanged, so dead varyings and
+    * uniforms are still eliminated before the resource limits are checked.
+    */
+   GLboolean OptimizeInNIR;
+
    const struct nir_shader_compiler_options *NirOptions;
 };
 
@@ -4516,6 +4534,8 @@ struct gl_dlist_state
    struct gl_display_list *CurrentList; /**< List currently being compiled */
    union gl_dlist_node *CurrentBlock; /**< Pointer to current block of nodes */
    GLuint CurrentPos;		/**< Index into current block of nodes */
+   /** Last two instructions compiled into CurrentBlock, if any */
+   union gl_dlist_node *LastInstruction, *PrevInstruction;
    GLuint CallDepth;		/**< Current recursion calling depth */
 
    GLvertexformat ListVtxfmt;
@@ -4970,6 +4990,12 @@ struct gl_context
     */
    struct gl_pipeline_object *_Shader;
 
+   /**
+    * Worker threads running the GLSL front-end for glCompileShader.
+    * Created on first use, see _mesa_CompileShader().
+    */
+   struct util_queue ShaderCompilerQueue;
+
    struct gl_query_state Query;  /**< occlusion, timer queries */
 
    struct gl_transform_feedback_state TransformFeedback;
@@ -204,8 +204,9 @@ read_program_payload(struct gl_context *ctx, struct blob_reader *blob,
       if (!shader)
          continue;
 
-      ctx->Driver.ProgramBinaryDeserializeDriverBlob(ctx, sh_prog,
-                                                     shader->Program);
+      if (!ctx->Driver.ProgramBinaryDeserializeDriverBlob(ctx, sh_prog,
+                                                          shader->Program))
+         return false;
    }
 
    return true;
@@ -41,6 +41,7 @@
 #include <c99_alloca.h>
 #include "main/glheader.h"
 #include "main/context.h"
+#include "main/debug_output.h"
 #include "main/enums.h"
 #include "main/glspirv.h"
 #include "main/hash.h"
@@ -63,6 +64,7 @@
 #include "util/hash_table.h"
 #include "util/mesa-sha1.h"
 #include "util/crc32.h"
+#include "util/u_cpu_detect.h"
 
 /**
  * Return mask of GLSL_x flags by examining the MESA_GLSL env var.
@@ -94,6 +96,8 @@ _mesa_get_shader_flags(void)
          flags |= GLSL_USE_PROG;
       if (strstr(env, "errors"))
          flags |= GLSL_REPORT_ERRORS;
+      if (strstr(env, "sync_compile"))
+         flags |= GLSL_SYNC_COMPILE;
    }
 
    return flags;
@@ -157,6 +161,12 @@ _mesa_init_shader_state(struct gl_context *ctx)
 void
 _mesa_free_shader_state(struct gl_context *ctx)
 {
+   /* Compile jobs still reference the context. */
+   if (util_queue_is_initialized(&ctx->ShaderCompilerQueue)) {
+      util_queue_finish(&ctx->ShaderCompilerQueue);
+      util_queue_destroy(&ctx->ShaderCompilerQueue);
+   }
+
    for (int i = 0; i < MESA_SHADER_STAGES; i++) {
       _mesa_reference_program(ctx, &ctx->Shader.CurrentProgram[i], NULL);
       _mesa_reference_shader_program(ctx,
@@ -967,13 +977,14 @@ get_shaderiv(struct gl_context *ctx, GLuint name, GLenum pname, GLint *params)
       *params = shader->DeletePending;
       break;
    case GL_COMPLETION_STATUS_ARB:
-      /* _mesa_glsl_compile_shader is not offloaded to other threads. */
-      *params = GL_TRUE;
+      *params = util_queue_fence_is_signalled(&shader->CompileFence);
       return;
    case GL_COMPILE_STATUS:
+      _mesa_wait_shader_compile(shader);
       *params = shader->CompileStatus ? GL_TRUE : GL_FALSE;
       break;
    case GL_INFO_LOG_LENGTH:
+      _mesa_wait_shader_compile(shader);
       *params = (shader->InfoLog && shader->InfoLog[0] != '\0') ?
          strlen(shader->InfoLog) + 1 : 0;
       break;
@@ -1039,6 +1050,7 @@ get_shader_info_log(struct gl_context *ctx, GLuint shader, GLsizei bufSize,
       return;
    }
 
+   _mesa_wait_shader_compile(sh);
    _mesa_copy_string(infoLog, bufSize, length, sh->InfoLog);
 }
 
@@ -1074,6 +1086,8 @@ set_shader_source(struct gl_shader *sh, const GLchar *source)
 {
    assert(sh);
 
+   _mesa_wait_shader_compile(sh);
+
    /* The GL_ARB_gl_spirv spec adds the following to the end of the description
     * of ShaderSource:
     *
@@ -1103,33 +1117,23 @@ set_shader_source(struct gl_shader *sh, const GLchar *source)
 
 
 /**
- * Compile a shader.
+ * Run the GLSL front-end on a shader's source.
+ *
+ * This may run on one of the shader compiler threads, so apart from the
+ * shader it must only look at context state that doesn't change after the
+ * context is created.  That is also why it looks at ctx->Shader rather than
+ * ctx->_Shader for the GLSL_x flags.
  */
-void
-_mesa_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
+static void
+compile_shader(struct gl_context *ctx, struct gl_shader *sh)
 {
-   if (!sh)
-      return;
-
-   /* The GL_ARB_gl_spirv spec says:
-    *
-    *    "Add a new error for the CompileShader command:
-    *
-    *      An INVALID_OPERATION error is generated if the SPIR_V_BINARY_ARB
-    *      state of <shader> is TRUE."
-    */
-   if (sh->spirv_data) {
-      _mesa_error(ctx, GL_INVALID_OPERATION, "glCompileShader(SPIR-V)");
-      return;
-   }
-
    if (!sh->Source) {
       /* If the user called glCompileShader without first calling
        * glShaderSource, we should fail to compile, but not raise a GL_ERROR.
        */
       sh->CompileStatus = COMPILE_FAILURE;
    } else {
-      if (ctx->_Shader->Flags & GLSL_DUMP) {
+      if (ctx->Shader.Flags & GLSL_DUMP) {
          _mesa_log("GLSL source for %s shader %d:\n",
                  _mesa_shader_stage_to_string(sh->Stage), sh->Name);
          _mesa_log("%s\n", sh->Source);
@@ -1140,11 +1144,11 @@ _mesa_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
        */
       _mesa_glsl_compile_shader(ctx, sh, false, false, false);
 
-      if (ctx->_Shader->Flags & GLSL_LOG) {
+      if (ctx->Shader.Flags & GLSL_LOG) {
          _mesa_write_shader_to_file(sh);
       }
 
-      if (ctx->_Shader->Flags & GLSL_DUMP) {
+      if (ctx->Shader.Flags & GLSL_DUMP) {
          if (sh->CompileStatus) {
             if (sh->ir) {
                _mesa_log("GLSL IR for shader %d:\n", sh->Name);
@@ -1165,14 +1169,14 @@ _mesa_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
    }
 
    if (!sh->CompileStatus) {
-      if (ctx->_Shader->Flags & GLSL_DUMP_ON_ERROR) {
+      if (ctx->Shader.Flags & GLSL_DUMP_ON_ERROR) {
          _mesa_log("GLSL source for %s shader %d:\n",
                  _mesa_shader_stage_to_string(sh->Stage), sh->Name);
          _mesa_log("%s\n", sh->Source);
          _mesa_log("Info Log:\n%s\n", sh->InfoLog);
       }
 
-      if (ctx->_Shader->Flags & GLSL_REPORT_ERRORS) {
+      if (ctx->Shader.Flags & GLSL_REPORT_ERRORS) {
          _mesa_debug(ctx, "Error compiling shader %u:\n%s\n",
                      sh->Name, sh->InfoLog);
       }
@@ -1180,6 +1184,131 @@ _mesa_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
 }
 
 
+
+/**
+ * Compile a shader.
+ */
+void
+_mesa_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
+{
+   if (!sh)
+      return;
+
+   /* The GL_ARB_gl_spirv spec says:
+    *
+    *    "Add a new error for the CompileShader command:
+    *
+    *      An INVALID_OPERATION error is generated if the SPIR_V_BINARY_ARB
+    *      state of <shader> is TRUE."
+    */
+   if (sh->spirv_data) {
+      _mesa_error(ctx, GL_INVALID_OPERATION, "glCompileShader(SPIR-V)");
+      return;
+   }
+
+   _mesa_wait_shader_compile(sh);
+   compile_shader(ctx, sh);
+}
+
+
+struct compile_shader_job {
+   struct gl_context *ctx;
+   struct gl_shader *sh;
+};
+
+static void
+compile_shader_job_execute(void *data, int thread_index)
+{
+   struct compile_shader_job *job = data;
+
+   compile_shader(job->ctx, job->sh);
+}
+
+static void
+compile_shader_job_cleanup(void *data, int thread_index)
+{
+   free(data);
+}
+
+
+/**
+ * Return the queue glCompileShader should hand the GLSL front-end to, or
+ * NULL if the shader has to be compiled on the calling thread.
+ */
+static struct util_queue *
+get_shader_compiler_queue(struct gl_context *ctx)
+{
+   struct util_queue *queue = &ctx->ShaderCompilerQueue;
+   unsigned num_threads;
+
+   /* Keep the dumps of different shaders apart. */
+   if (ctx->Shader.Flags & (GLSL_DUMP | GLSL_DUMP_ON_ERROR | GLSL_SYNC_COMPILE))
+      return NULL;
+
+   /* Compile errors are reported through KHR_debug, whose callback may only
+    * be called from another thread if DEBUG_OUTPUT_SYNCHRONOUS is disabled.
+    */
+   if (ctx->Debug &&
+       _mesa_get_debug_state_int(ctx, GL_DEBUG_OUTPUT_SYNCHRONOUS))
+      return NULL;
+
+   util_cpu_detect();
+   num_threads = MIN2(ctx->Hint.MaxShaderCompilerThreads,
+                      util_cpu_caps.nr_cpus);
+   if (num_threads == 0 || util_cpu_caps.nr_cpus < 2)
+      return NULL;
+
+   if (!util_queue_is_initialized(queue) &&
+       !util_queue_init(queue, "glsl", 32, util_cpu_caps.nr_cpus,
+                        UTIL_QUEUE_INIT_RESIZE_IF_FULL))
+      return NULL;
+
+   /* GL_KHR_parallel_shader_compile */
+   if (queue->num_threads != num_threads)
+      util_queue_adjust_num_threads(queue, num_threads);
+
+   return queue;
+}
+
+
+/**
+ * Compile a shader for glCompileShader.
+ *
+ * The compile runs on one of the shader compiler threads if possible, in
+ * which case the shader's CompileFence is signalled once it is done.
+ * Everything looking at the results has to call _mesa_wait_shader_compile()
+ * first.
+ */
+static void
+queue_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
+{
+   struct util_queue *queue;
+   struct compile_shader_job *job;
+
+   if (!sh)
+      return;
+
+   queue = get_shader_compiler_queue(ctx);
+   if (!queue || !sh->Source || sh->spirv_data) {
+      _mesa_compile_shader(ctx, sh);
+      return;
+   }
+
+   job = malloc(sizeof(*job));
+   if (!job) {
+      _mesa_compile_shader(ctx, sh);
+      return;
+   }
+
+   job->ctx = ctx;
+   job->sh = sh;
+
+   _mesa_wait_shader_compile(sh);
+   util_queue_add_job(queue, job, &sh->CompileFence,
+                      compile_shader_job_execute, compile_shader_job_cleanup);
+}
+
+
 /**
  * Link a program's shaders.
  */
@@ -1212,6 +1341,9 @@ link_program(struct gl_context *ctx, struct gl_shader_program *shProg,
          }
    }
 
+   for (unsigned i = 0; i < shProg->NumShaders; i++)
+      _mesa_wait_shader_compile(shProg->Shaders[i]);
+
    FLUSH_VERTICES(ctx, 0);
    _mesa_glsl_link_shader(ctx, shProg);
 
@@ -1504,7 +1636,7 @@ _mesa_CompileShader(GLuint shaderObj)
    GET_CURRENT_CONTEXT(ctx);
    if (MESA_VERBOSE & VERBOSE_API)
       _mesa_debug(ctx, "glCompileShader %u\n", shaderObj);
-   _mesa_compile_shader(ctx, _mesa_lookup_shader_err(ctx, shaderObj,
+   queue_compile_shader(ctx, _mesa_lookup_shader_err(ctx, shaderObj,
                                                      "glCompileShader"));
 }
 
@@ -94,6 +94,7 @@ _mesa_init_shader(struct gl_shader *shader)
    shader->info.Geom.VerticesOut = -1;
    shader->info.Geom.InputType = GL_TRIANGLES;
    shader->info.Geom.OutputType = GL_TRIANGLE_STRIP;
+   util_queue_fence_init(&shader->CompileFence);
 }
 
 /**
@@ -122,6 +123,9 @@ _mesa_new_shader(GLuint name, gl_shader_stage stage)
 void
 _mesa_delete_shader(struct gl_context *ctx, struct gl_shader *sh)
 {
+   _mesa_wait_shader_compile(sh);
+   util_queue_fence_destroy(&sh->CompileFence);
+
    _mesa_shader_spirv_data_reference(&sh->spirv_data, NULL);
    free((void *)sh->Source);
    free((void *)sh->FallbackSource);
@@ -130,6 +134,18 @@ _mesa_delete_shader(struct gl_context *ctx, struct gl_shader *sh)
 }
 
 
+/**
+ * Wait for a glCompileShader job of the shader that may still be running on
+ * another thread.  Anything but the shader's name, type, label and source
+ * may only be looked at after this.
+ */
+void
+_mesa_wait_shader_compile(struct gl_shader *sh)
+{
+   util_queue_fence_wait(&sh->CompileFence);
+}
+
+
 /**
  * Delete a shader object.
  */
@@ -28,8 +28,42 @@
 #ifndef SSE_MINMAX_H
 #define SSE_MINMAX_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Minimum and maximum of an index array, skipping \p restart_index if
+ * \p restart is set.  Returns ~0 and 0 if there are no indices left.
+ */
+void
+_mesa_uint_array_min_max(const uint32_t *indices, unsigned count,
+                         bool restart, unsigned restart_index,
+                         unsigned *min_index, unsigned *max_index);
+
+void
+_mesa_ushort_array_min_max(const uint16_t *indices, unsigned count,
+                           bool restart, unsigned restart_index,
+                           unsigned *min_index, unsigned *max_index);
+
+void
+_mesa_ubyte_array_min_max(const uint8_t *indices, unsigned count,
+                          bool restart, unsigned restart_index,
+                          unsigned *min_index, unsigned *max_index);
+
+/* The same, built with -mavx2 (avx2_minmax.c). */
+void
+_mesa_uint_array_min_max_avx2(const uint32_t *indices, unsigned count,
+                              bool restart, unsigned restart_index,
+                              unsigned *min_index, unsigned *max_index);
+
+void
+_mesa_ushort_array_min_max_avx2(const uint16_t *indices, unsigned count,
+                                bool restart, unsigned restart_index,
+                                unsigned *min_index, unsigned *max_index);
+
 void
-_mesa_uint_array_min_max(const unsigned *ui_indices, unsigned *min_index,
-                         unsigned *max_index, const unsigned count);
+_mesa_ubyte_array_min_max_avx2(const uint8_t *indices, unsigned count,
+                               bool restart, unsigned restart_index,
+                               unsigned *min_index, unsigned *max_index);
 
 #endif /* SSE_MINMAX_H */
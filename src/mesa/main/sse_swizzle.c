@@ -0,0 +1,309 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * SSE4.1 versions of the most common _mesa_swizzle_and_convert() cases:
+ * 8-bit channel swizzles (RGB <-> RGBA, BGRA <-> RGBA and the like) and
+ * float to half float.  Also the row unpack/pack kernels that the generated
+ * format_unpack.c and format_pack.c use for 8-bit unorm and half float
+ * formats.
+ */
+
+#include "main/sse_swizzle.h"
+#include "main/formats.h"
+#include "util/half_float.h"
+#include "util/macros.h"
+#include <assert.h>
+#include <string.h>
+#include <smmintrin.h>
+
+int
+_mesa_swizzle_ubyte_sse41(uint8_t *dst, int num_dst_channels,
+                          const uint8_t *src, int num_src_channels,
+                          const uint8_t swizzle[4], uint8_t one, int count)
+{
+   /* Pixels per 16-byte vector, and how many have to be left to read and
+    * write a whole vector.
+    */
+   const int pixels = 16 / MAX2(num_src_channels, num_dst_channels);
+   const int needed = MAX2(DIV_ROUND_UP(16, num_src_channels),
+                           DIV_ROUND_UP(16, num_dst_channels));
+   uint8_t shuffle[16], ones[16];
+   int i;
+
+   for (i = 0; i < 16; i++) {
+      const int p = i / num_dst_channels, c = i % num_dst_channels;
+      const uint8_t s = swizzle[c];
+
+      shuffle[i] = 0x80;
+      ones[i] = 0;
+      if (p >= pixels)
+         continue;
+
+      if (s < num_src_channels)
+         shuffle[i] = p * num_src_channels + s;
+      else if (s == MESA_FORMAT_SWIZZLE_ONE)
+         ones[i] = one;
+   }
+
+   const __m128i vshuffle = _mm_loadu_si128((const __m128i *)shuffle);
+   const __m128i vones = _mm_loadu_si128((const __m128i *)ones);
+
+   for (i = 0; count - i >= needed; i += pixels) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(src + i * num_src_channels));
+
+      v = _mm_or_si128(_mm_shuffle_epi8(v, vshuffle), vones);
+      _mm_storeu_si128((__m128i *)(dst + i * num_dst_channels), v);
+   }
+
+   return i;
+}
+
+/* Round-to-nearest-even float to half conversion as in _mesa_float_to_half()
+ * of four values, returned in the low 16 bits of each lane.  Results that
+ * are denormal in half precision are rounded by a float add that shifts the
+ * mantissa into place, everything else by integer arithmetic on the bits.
+ */
+static inline __m128i
+float_to_half4(__m128i f)
+{
+   const __m128i sign_mask = _mm_set1_epi32(0x80000000);
+   const __m128i f32_inf = _mm_set1_epi32(255 << 23);
+   const __m128i f16_max = _mm_set1_epi32(((127 + 16) << 23) - 1);
+   const __m128i f16_min_normal = _mm_set1_epi32((127 - 14) << 23);
+   const __m128i denorm_magic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+   const __m128i rebias = _mm_set1_epi32(-((127 - 15) << 23) + 0xfff);
+   const __m128i one = _mm_set1_epi32(1);
+   const __m128i half_inf = _mm_set1_epi32(0x7c00);
+   const __m128i half_nan = _mm_set1_epi32(0x7c01);
+   const __m128i sign = _mm_and_si128(f, sign_mask);
+
+   f = _mm_xor_si128(f, sign);
+
+   /* half denormals and zero */
+   const __m128i denorm =
+      _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(f),
+                                                _mm_castsi128_ps(denorm_magic))),
+                    denorm_magic);
+
+   /* half normals */
+   const __m128i odd = _mm_and_si128(_mm_srli_epi32(f, 13), one);
+   const __m128i normal =
+      _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(f, rebias), odd), 13);
+
+   /* infinity and NaN */
+   const __m128i special =
+      _mm_blendv_epi8(half_inf, half_nan, _mm_cmpgt_epi32(f, f32_inf));
+
+   __m128i o = _mm_blendv_epi8(normal, denorm, _mm_cmplt_epi32(f, f16_min_normal));
+   o = _mm_blendv_epi8(o, special, _mm_cmpgt_epi32(f, f16_max));
+   return _mm_or_si128(o, _mm_srli_epi32(sign, 16));
+}
+
+/* Half to float conversion of four values in the low 16 bits of each lane,
+ * with the same results as _mesa_half_to_float(): denormals are exact and
+ * every NaN becomes a float NaN with a mantissa of 1.
+ */
+static inline __m128
+half_to_float4(__m128i h)
+{
+   const __m128i exp_mask = _mm_set1_epi32(0x7c00);
+   const __m128i rebias = _mm_set1_epi32((127 - 15) << 23);
+   const __m128i denorm_magic = _mm_set1_epi32((127 - 14) << 23);
+   const __m128i f32_inf = _mm_set1_epi32(255 << 23);
+   const __m128i f32_nan = _mm_set1_epi32((255 << 23) | 1);
+   const __m128i sign = _mm_slli_epi32(_mm_srli_epi32(h, 15), 31);
+   const __m128i em = _mm_and_si128(h, _mm_set1_epi32(0x7fff));
+   const __m128i e = _mm_and_si128(h, exp_mask);
+
+   const __m128i normal = _mm_add_epi32(_mm_slli_epi32(em, 13), rebias);
+
+   /* denormals: 2^-14 * (1 + m / 1024) - 2^-14 is exact */
+   const __m128i denorm =
+      _mm_castps_si128(_mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(_mm_slli_epi32(em, 13),
+                                                                 denorm_magic)),
+                                  _mm_castsi128_ps(denorm_magic)));
+
+   const __m128i special =
+      _mm_blendv_epi8(f32_inf, f32_nan, _mm_cmpgt_epi32(em, exp_mask));
+
+   __m128i o = _mm_blendv_epi8(normal, denorm,
+                               _mm_cmpeq_epi32(e, _mm_setzero_si128()));
+   o = _mm_blendv_epi8(o, special, _mm_cmpeq_epi32(e, exp_mask));
+   return _mm_castsi128_ps(_mm_or_si128(o, sign));
+}
+
+void
+_mesa_float_to_half_sse41(uint16_t *dst, const float *src, int count)
+{
+   int i;
+
+   for (i = 0; i + 8 <= count; i += 8) {
+      const __m128i lo = float_to_half4(_mm_loadu_si128((const __m128i *)(src + i)));
+      const __m128i hi = float_to_half4(_mm_loadu_si128((const __m128i *)(src + i + 4)));
+
+      _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi32(lo, hi));
+   }
+
+   for (; i < count; i++)
+      dst[i] = _mesa_float_to_half(src[i]);
+}
+
+int
+_mesa_unpack_unorm8_row_sse41(float (*dst)[4], const uint8_t *src,
+                              int num_channels, const uint8_t swizzle[4],
+                              int count)
+{
+   /* Each 16-byte load is expanded to RGBA bytes four pixels at a time, so
+    * a load covers 16, 8 or 4 pixels.
+    */
+   const int groups = num_channels == 3 ? 1 : 4 / num_channels;
+   const int needed = DIV_ROUND_UP(16, num_channels);
+   const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+   __m128i shuffle[4];
+   int i;
+
+   for (int g = 0; g < groups; g++) {
+      uint8_t bytes[16];
+
+      for (int j = 0; j < 16; j++) {
+         const uint8_t s = swizzle[j % 4];
+
+         if (s < num_channels)
+            bytes[j] = (g * 4 + j / 4) * num_channels + s;
+         else
+            bytes[j] = 0x80;
+      }
+      shuffle[g] = _mm_loadu_si128((const __m128i *)bytes);
+   }
+
+   uint8_t ones[16];
+   for (int j = 0; j < 16; j++)
+      ones[j] = swizzle[j % 4] == MESA_FORMAT_SWIZZLE_ONE ? 0xff : 0;
+   const __m128i vones = _mm_loadu_si128((const __m128i *)ones);
+
+   for (i = 0; count - i >= needed; i += groups * 4) {
+      const __m128i v = _mm_loadu_si128((const __m128i *)(src + i * num_channels));
+
+      for (int g = 0; g < groups; g++) {
+         __m128i rgba = _mm_or_si128(_mm_shuffle_epi8(v, shuffle[g]), vones);
+
+         for (int p = 0; p < 4; p++) {
+            const __m128 f = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(rgba));
+
+            _mm_storeu_ps(dst[i + g * 4 + p], _mm_mul_ps(f, scale));
+            rgba = _mm_srli_si128(rgba, 4);
+         }
+      }
+   }
+
+   return i;
+}
+
+int
+_mesa_pack_unorm8_row_sse41(uint8_t *dst, const float (*src)[4],
+                            int num_channels, const uint8_t map[4],
+                            int count)
+{
+   const __m128 zero = _mm_setzero_ps();
+   const __m128 one = _mm_set1_ps(1.0f);
+   const __m128 scale = _mm_set1_ps(255.0f);
+   uint8_t bytes[16];
+   int i;
+
+   for (int j = 0; j < 16; j++) {
+      const int p = j / num_channels, c = j % num_channels;
+
+      bytes[j] = p < 4 && map[c] < 4 ? p * 4 + map[c] : 0x80;
+   }
+   const __m128i shuffle = _mm_loadu_si128((const __m128i *)bytes);
+
+   for (i = 0; i + 4 <= count; i += 4) {
+      __m128i v[4];
+
+      for (int p = 0; p < 4; p++) {
+         /* max() first, so NaN becomes 0 like in _mesa_float_to_unorm() */
+         __m128 f = _mm_max_ps(_mm_loadu_ps(src[i + p]), zero);
+
+         f = _mm_mul_ps(_mm_min_ps(f, one), scale);
+         v[p] = _mm_cvtps_epi32(f);
+      }
+
+      const __m128i rgba =
+         _mm_packus_epi16(_mm_packus_epi32(v[0], v[1]),
+                          _mm_packus_epi32(v[2], v[3]));
+      const __m128i out = _mm_shuffle_epi8(rgba, shuffle);
+      uint8_t *d = dst + i * num_channels;
+
+      switch (num_channels) {
+      case 4:
+         _mm_storeu_si128((__m128i *)d, out);
+         break;
+      case 3: {
+         _mm_storel_epi64((__m128i *)d, out);
+         uint32_t last = _mm_extract_epi32(out, 2);
+         memcpy(d + 8, &last, 4);
+         break;
+      }
+      case 2:
+         _mm_storel_epi64((__m128i *)d, out);
+         break;
+      default: {
+         uint32_t first = _mm_cvtsi128_si32(out);
+         memcpy(d, &first, 4);
+         break;
+      }
+      }
+   }
+
+   return i;
+}
+
+int
+_mesa_unpack_half_row_sse41(float (*dst)[4], const uint16_t *src,
+                            const uint8_t swizzle[4], int count)
+{
+   int keep[4];
+   float ones[4];
+   int i;
+
+   for (int c = 0; c < 4; c++) {
+      assert(swizzle[c] == c || swizzle[c] >= 4);
+      keep[c] = swizzle[c] == c ? ~0 : 0;
+      ones[c] = swizzle[c] == MESA_FORMAT_SWIZZLE_ONE ? 1.0f : 0.0f;
+   }
+
+   const __m128 vkeep = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)keep));
+   const __m128 vones = _mm_loadu_ps(ones);
+
+   for (i = 0; i + 2 <= count; i += 2) {
+      const __m128i h = _mm_loadu_si128((const __m128i *)(src + i * 4));
+      const __m128 lo = half_to_float4(_mm_cvtepu16_epi32(h));
+      const __m128 hi = half_to_float4(_mm_cvtepu16_epi32(_mm_srli_si128(h, 8)));
+
+      _mm_storeu_ps(dst[i], _mm_or_ps(_mm_and_ps(lo, vkeep), vones));
+      _mm_storeu_ps(dst[i + 1], _mm_or_ps(_mm_and_ps(hi, vkeep), vones));
+   }
+
+   return i;
+}
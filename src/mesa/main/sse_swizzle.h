@@ -0,0 +1,69 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef SSE_SWIZZLE_H
+#define SSE_SWIZZLE_H
+
+#include <stdint.h>
+
+/**
+ * Swizzle 8-bit channels, with the same swizzle as
+ * _mesa_swizzle_and_convert().  Returns how many pixels were done; the
+ * caller does the rest.  \p dst and \p src must not overlap.
+ */
+int
+_mesa_swizzle_ubyte_sse41(uint8_t *dst, int num_dst_channels,
+                          const uint8_t *src, int num_src_channels,
+                          const uint8_t swizzle[4], uint8_t one, int count);
+
+/** Same results as _mesa_float_to_half() on each of \p count values. */
+void
+_mesa_float_to_half_sse41(uint16_t *dst, const float *src, int count);
+
+/*
+ * Row kernels for the generated _mesa_unpack_*_row() and _mesa_pack_*_row()
+ * functions.  Each returns how many pixels it did and leaves the rest of the
+ * row to the scalar code, with bit-identical results.
+ *
+ * \p swizzle is the format's swizzle (RGBA from format channels, like
+ * _mesa_swizzle_and_convert()) and \p map its inverse (format channel from
+ * RGBA), with MESA_FORMAT_SWIZZLE_NONE for channels that are written as 0.
+ * The half float kernel only takes four-channel formats whose swizzle is the
+ * identity apart from constant channels.  Packing RGBA half float is just
+ * _mesa_float_to_half_sse41().
+ */
+int
+_mesa_unpack_unorm8_row_sse41(float (*dst)[4], const uint8_t *src,
+                              int num_channels, const uint8_t swizzle[4],
+                              int count);
+
+int
+_mesa_pack_unorm8_row_sse41(uint8_t *dst, const float (*src)[4],
+                            int num_channels, const uint8_t map[4],
+                            int count);
+
+int
+_mesa_unpack_half_row_sse41(float (*dst)[4], const uint16_t *src,
+                            const uint8_t swizzle[4], int count);
+
+#endif /* SSE_SWIZZLE_H */
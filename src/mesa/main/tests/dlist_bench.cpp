@@ -0,0 +1,187 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name dlist_bench.cpp
+ *
+ * Cost of compiling and replaying display lists made of state calls, in
+ * nanoseconds per recorded call, on a compatibility context with no driver
+ * behind it.  Only the dlist.c side of glNewList/glEndList/glCallList and
+ * the core state entry points are measured; no drawing is done.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "GL/gl.h"
+#include "GL/glext.h"
+#include "main/glheader.h"
+#include "main/api_exec.h"
+#include "main/context.h"
+#include "main/dispatch.h"
+#include "main/extensions.h"
+#include "main/vtxfmt.h"
+#include "glapi/glapi.h"
+#include "drivers/common/driverfuncs.h"
+#include "util/os_time.h"
+#include "vbo/vbo.h"
+
+#define LIST 1
+#define COMPILES 20
+#define REPLAYS 2000
+
+/** Calls made by one emit_state() round. */
+#define CALLS_PER_ROUND 18
+
+static struct gl_context ctx;
+
+/**
+ * One round of state calls as an application's state setup might record
+ * them, core and extension opcodes mixed.  With \p repeat every call is
+ * issued twice in a row.
+ */
+static void
+emit_state(int i, bool repeat)
+{
+   for (int r = 0; r <= repeat; r++)
+      CALL_Enable(GET_DISPATCH(), (GL_BLEND));
+   for (int r = 0; r <= repeat; r++)
+      CALL_BlendFunc(GET_DISPATCH(), (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+   for (int r = 0; r <= repeat; r++)
+      CALL_BlendEquationSeparate(GET_DISPATCH(), (GL_FUNC_ADD, GL_MAX));
+   for (int r = 0; r <= repeat; r++)
+      CALL_Enable(GET_DISPATCH(), (GL_DEPTH_TEST));
+   for (int r = 0; r <= repeat; r++)
+      CALL_DepthFunc(GET_DISPATCH(), (i & 1 ? GL_LEQUAL : GL_LESS));
+   for (int r = 0; r <= repeat; r++)
+      CALL_ActiveTexture(GET_DISPATCH(), (GL_TEXTURE0 + (i & 3)));
+   for (int r = 0; r <= repeat; r++)
+      CALL_LineWidth(GET_DISPATCH(), (1.0f + (i & 3)));
+   for (int r = 0; r <= repeat; r++)
+      CALL_CullFace(GET_DISPATCH(), (GL_BACK));
+   for (int r = 0; r <= repeat; r++)
+      CALL_Disable(GET_DISPATCH(), (GL_BLEND));
+}
+
+static void
+emit_rest(int i)
+{
+   CALL_MatrixMode(GET_DISPATCH(), (GL_MODELVIEW));
+   CALL_PushMatrix(GET_DISPATCH(), ());
+   CALL_Translatef(GET_DISPATCH(), (i * 0.5f, 0.0f, -1.0f));
+   CALL_Rotatef(GET_DISPATCH(), (i * 10.0f, 0.0f, 1.0f, 0.0f));
+   CALL_PopMatrix(GET_DISPATCH(), ());
+   CALL_StencilFunc(GET_DISPATCH(), (GL_ALWAYS, i & 0xff, 0xff));
+   CALL_StencilOp(GET_DISPATCH(), (GL_KEEP, GL_KEEP, GL_REPLACE));
+   CALL_BlendColor(GET_DISPATCH(), (0.25f, 0.5f, 0.75f, 1.0f));
+   CALL_Disable(GET_DISPATCH(), (GL_DEPTH_TEST));
+}
+
+/** Compiles \p rounds rounds into LIST and returns ns per call. */
+static double
+compile(int rounds, bool repeat)
+{
+   const int calls = rounds * (CALLS_PER_ROUND + repeat * 9);
+   const int64_t start = os_time_get_nano();
+
+   for (int c = 0; c < COMPILES; c++) {
+      CALL_NewList(GET_DISPATCH(), (LIST, GL_COMPILE));
+      for (int i = 0; i < rounds; i++) {
+         emit_state(i, repeat);
+         emit_rest(i);
+      }
+      CALL_EndList(GET_DISPATCH(), ());
+   }
+
+   return (double) (os_time_get_nano() - start) / ((double) calls * COMPILES);
+}
+
+/** Replays LIST and returns ns per recorded call. */
+static double
+replay(int rounds, bool repeat)
+{
+   const int calls = rounds * (CALLS_PER_ROUND + repeat * 9);
+   const int64_t start = os_time_get_nano();
+
+   for (int i = 0; i < REPLAYS; i++)
+      CALL_CallList(GET_DISPATCH(), (LIST));
+
+   return (double) (os_time_get_nano() - start) / ((double) calls * REPLAYS);
+}
+
+int
+main(int argc, char **argv)
+{
+   static const struct {
+      const char *name;
+      int rounds;
+      bool repeat;
+   } cases[] = {
+      { "short list", 4, false },
+      { "long list", 400, false },
+      { "long list, repeats", 400, true },
+   };
+   struct dd_function_table driver_functions;
+   struct gl_config visual;
+
+   memset(&visual, 0, sizeof(visual));
+   memset(&driver_functions, 0, sizeof(driver_functions));
+   _mesa_init_driver_functions(&driver_functions);
+
+   if (!_mesa_initialize_context(&ctx, API_OPENGL_COMPAT, &visual, NULL,
+                                 &driver_functions)) {
+      fprintf(stderr, "failed to create a context\n");
+      return 1;
+   }
+   _vbo_CreateContext(&ctx);
+   _mesa_enable_sw_extensions(&ctx);
+   ctx.Version = 21;
+   _mesa_initialize_dispatch_tables(&ctx);
+   _mesa_initialize_vbo_vtxfmt(&ctx);
+   _mesa_make_current(&ctx, NULL, NULL);
+
+   printf("%-20s %8s %12s %12s\n", "list", "calls", "compile ns", "replay ns");
+
+   for (unsigned c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+      const int rounds = cases[c].rounds;
+      const bool repeat = cases[c].repeat;
+
+      compile(rounds, repeat); /* warm up */
+      const double compile_ns = compile(rounds, repeat);
+      replay(rounds, repeat);
+      const double replay_ns = replay(rounds, repeat);
+
+      printf("%-20s %8d %12.1f %12.2f\n", cases[c].name,
+             rounds * (CALLS_PER_ROUND + repeat * 9), compile_ns, replay_ns);
+   }
+
+   if (CALL_GetError(GET_DISPATCH(), ()) != GL_NO_ERROR) {
+      fprintf(stderr, "GL error during replay\n");
+      return 1;
+   }
+
+   _mesa_make_current(NULL, NULL, NULL);
+   _mesa_free_context_data(&ctx, true);
+
+   return 0;
+}
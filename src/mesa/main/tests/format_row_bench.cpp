@@ -0,0 +1,124 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name format_row_bench.cpp
+ *
+ * Throughput of _mesa_unpack_rgba_row(), _mesa_unpack_ubyte_rgba_row(),
+ * _mesa_pack_float_rgba_row() and _mesa_pack_ubyte_rgba_row() for every
+ * uncompressed color format, in millions of pixels per second, with and
+ * without the SIMD row kernels.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "main/formats.h"
+#include "main/format_pack.h"
+#include "main/format_unpack.h"
+#include "main/glformats.h"
+#include "util/os_time.h"
+#include "util/u_cpu_detect.h"
+
+#define WIDTH 4096
+#define ROWS 64
+
+static uint8_t src[WIDTH * 16], dst[WIDTH * 16];
+static float fsrc[WIDTH][4];
+static uint8_t usrc[WIDTH][4];
+
+static double
+run(mesa_format f, int func)
+{
+   const int64_t start = os_time_get_nano();
+
+   for (int row = 0; row < ROWS; row++) {
+      switch (func) {
+      case 0:
+         _mesa_unpack_rgba_row(f, WIDTH, src, (float (*)[4]) dst);
+         break;
+      case 1:
+         _mesa_unpack_ubyte_rgba_row(f, WIDTH, src, (uint8_t (*)[4]) dst);
+         break;
+      case 2:
+         _mesa_pack_float_rgba_row(f, WIDTH, fsrc, dst);
+         break;
+      case 3:
+         _mesa_pack_ubyte_rgba_row(f, WIDTH, usrc, dst);
+         break;
+      }
+   }
+
+   return (double) WIDTH * ROWS * 1000.0 / (os_time_get_nano() - start);
+}
+
+int
+main(int argc, char **argv)
+{
+   static const char *names[] = {
+      "unpack float", "unpack ubyte", "pack float", "pack ubyte",
+   };
+
+   util_cpu_detect();
+   const bool simd = util_cpu_caps.has_sse4_1;
+
+   for (unsigned i = 0; i < sizeof(src); i++)
+      src[i] = rand();
+   for (unsigned i = 0; i < WIDTH; i++) {
+      for (unsigned c = 0; c < 4; c++) {
+         fsrc[i][c] = (rand() % 1000) / 800.0f - 0.1f;
+         usrc[i][c] = rand();
+      }
+   }
+
+   printf("%-32s %-14s %10s %10s\n", "format", "function", "scalar", "simd");
+
+   for (int fi = MESA_FORMAT_NONE + 1; fi < MESA_FORMAT_COUNT; ++fi) {
+      mesa_format f = (mesa_format) fi;
+      GLenum base = _mesa_get_format_base_format(f);
+
+      if (!_mesa_get_format_name(f) || _mesa_is_format_compressed(f) ||
+          _mesa_is_format_integer_color(f) ||
+          _mesa_get_format_layout(f) == MESA_FORMAT_LAYOUT_OTHER ||
+          base == GL_DEPTH_COMPONENT || base == GL_STENCIL_INDEX ||
+          base == GL_DEPTH_STENCIL)
+         continue;
+
+      for (int func = 0; func < 4; func++) {
+         util_cpu_caps.has_sse4_1 = 0;
+         run(f, func); /* warm up */
+         const double scalar = run(f, func);
+
+         printf("%-32s %-14s %10.1f", _mesa_get_format_name(f), names[func],
+                scalar);
+
+         if (simd) {
+            util_cpu_caps.has_sse4_1 = 1;
+            printf(" %10.1f", run(f, func));
+         }
+         printf("\n");
+      }
+   }
+
+   return 0;
+}
@@ -30,9 +30,15 @@
  */
 
 #include <gtest/gtest.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "main/formats.h"
+#include "main/format_pack.h"
+#include "main/format_unpack.h"
 #include "main/glformats.h"
+#include "util/u_cpu_detect.h"
 
 /**
  * Debug/test: check that all uncompressed formats are handled in the
@@ -137,3 +143,74 @@ TEST(MesaFormatsTest, FormatSanity)
 
    }
 }
+
+/**
+ * The SIMD paths of the row pack/unpack functions must give the same bits
+ * as the per-pixel code, including for NaN and out of range values.
+ */
+TEST(MesaFormatsTest, RowFunctionsMatchScalar)
+{
+   const unsigned n = 67;
+   uint8_t src[16 * n], dst[2][16 * n];
+   float fsrc[n][4];
+   uint8_t usrc[n][4];
+
+   util_cpu_detect();
+   if (!util_cpu_caps.has_sse4_1)
+      return;
+
+   srand(0);
+   for (unsigned i = 0; i < sizeof(src); i++)
+      src[i] = rand();
+   for (unsigned i = 0; i < n; i++) {
+      for (unsigned c = 0; c < 4; c++) {
+         fsrc[i][c] = (rand() % 1000) / 500.0f - 0.5f;
+         usrc[i][c] = rand();
+      }
+   }
+   fsrc[1][0] = NAN;
+   fsrc[2][1] = INFINITY;
+   fsrc[3][2] = -INFINITY;
+   fsrc[4][3] = 65536.0f;
+
+   for (int fi = MESA_FORMAT_NONE + 1; fi < MESA_FORMAT_COUNT; ++fi) {
+      mesa_format f = (mesa_format) fi;
+      GLenum base = _mesa_get_format_base_format(f);
+
+      if (!_mesa_get_format_name(f) || _mesa_is_format_compressed(f) ||
+          _mesa_is_format_integer_color(f) ||
+          _mesa_get_format_layout(f) == MESA_FORMAT_LAYOUT_OTHER ||
+          _mesa_get_format_color_encoding(f) != GL_LINEAR ||
+          base == GL_DEPTH_COMPONENT || base == GL_STENCIL_INDEX ||
+          base == GL_DEPTH_STENCIL)
+         continue;
+
+      SCOPED_TRACE(_mesa_get_format_name(f));
+
+      for (int func = 0; func < 4; func++) {
+         for (int simd = 0; simd < 2; simd++) {
+            util_cpu_caps.has_sse4_1 = simd;
+            memcpy(dst[simd], src, sizeof(src));
+
+            switch (func) {
+            case 0:
+               _mesa_unpack_rgba_row(f, n, src, (float (*)[4]) dst[simd]);
+               break;
+            case 1:
+               _mesa_unpack_ubyte_rgba_row(f, n, src,
+                                           (uint8_t (*)[4]) dst[simd]);
+               break;
+            case 2:
+               _mesa_pack_float_rgba_row(f, n, fsrc, dst[simd]);
+               break;
+            case 3:
+               _mesa_pack_ubyte_rgba_row(f, n, usrc, dst[simd]);
+               break;
+            }
+         }
+         EXPECT_EQ(memcmp(dst[0], dst[1], sizeof(dst[0])), 0) << func;
+      }
+   }
+
+   util_cpu_caps.has_sse4_1 = 1;
+}
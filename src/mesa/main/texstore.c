@@ -76,6 +76,10 @@
 #include "pixeltransfer.h"
 #include "util/format_rgb9e5.h"
 #include "util/format_r11g11b10f.h"
+#include "util/debug.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_queue.h"
+#include "c11/threads.h"
 
 
 enum {
@@ -90,6 +94,109 @@ enum {
 typedef GLboolean (*StoreTexImageFunc)(TEXSTORE_PARAMS);
 
 
+/* With MESA_TEXSTORE_THREADS=true, color conversions of at least this many
+ * texels are split across threads, with at most this many threads.
+ */
+#define TEXSTORE_THREAD_MIN_TEXELS (256 * 256)
+#define TEXSTORE_MAX_THREADS 8
+
+struct texstore_job {
+   struct util_queue_fence fence;
+   void *dst;
+   uint32_t dst_format;
+   size_t dst_stride;
+   void *src;
+   uint32_t src_format;
+   size_t src_stride;
+   size_t width, height;
+   uint8_t *rebase_swizzle;
+};
+
+static struct util_queue texstore_queue;
+static once_flag texstore_queue_once = ONCE_FLAG_INIT;
+
+static void
+texstore_queue_init(void)
+{
+   const unsigned threads =
+      MIN2(util_cpu_caps.nr_cpus, TEXSTORE_MAX_THREADS) - 1;
+
+   if (threads == 0 || !env_var_as_boolean("MESA_TEXSTORE_THREADS", false))
+      return;
+
+   if (!util_queue_init(&texstore_queue, "texstore", TEXSTORE_MAX_THREADS * 4,
+                        threads, 0))
+      memset(&texstore_queue, 0, sizeof(texstore_queue));
+}
+
+static void
+texstore_job_execute(void *data, int thread_index)
+{
+   struct texstore_job *job = data;
+
+   _mesa_format_convert(job->dst, job->dst_format, job->dst_stride,
+                        job->src, job->src_format, job->src_stride,
+                        job->width, job->height, job->rebase_swizzle);
+}
+
+/**
+ * _mesa_format_convert(), with large images split into bands of rows that
+ * are converted in parallel.
+ */
+static void
+texstore_format_convert(void *dst, uint32_t dst_format, size_t dst_stride,
+                        void *src, uint32_t src_format, size_t src_stride,
+                        size_t width, size_t height, uint8_t *rebase_swizzle)
+{
+   struct texstore_job jobs[TEXSTORE_MAX_THREADS];
+   unsigned num_jobs, rows, i;
+
+   if (width * height >= TEXSTORE_THREAD_MIN_TEXELS)
+      call_once(&texstore_queue_once, texstore_queue_init);
+
+   if (width * height < TEXSTORE_THREAD_MIN_TEXELS ||
+       !util_queue_is_initialized(&texstore_queue)) {
+      _mesa_format_convert(dst, dst_format, dst_stride,
+                           src, src_format, src_stride,
+                           width, height, rebase_swizzle);
+      return;
+   }
+
+   num_jobs = MIN2(texstore_queue.num_threads + 1, height);
+   rows = DIV_ROUND_UP(height, num_jobs);
+   num_jobs = DIV_ROUND_UP(height, rows);
+
+   for (i = 0; i < num_jobs; i++) {
+      struct texstore_job *job = &jobs[i];
+      const size_t y = i * rows;
+
+      job->dst = (GLubyte *) dst + y * dst_stride;
+      job->dst_format = dst_format;
+      job->dst_stride = dst_stride;
+      job->src = (GLubyte *) src + y * src_stride;
+      job->src_format = src_format;
+      job->src_stride = src_stride;
+      job->width = width;
+      job->height = MIN2(rows, height - y);
+      job->rebase_swizzle = rebase_swizzle;
+
+      /* The first band is converted by this thread. */
+      if (i > 0) {
+         util_queue_fence_init(&job->fence);
+         util_queue_add_job(&texstore_queue, job, &job->fence,
+                            texstore_job_execute, NULL);
+      }
+   }
+
+   texstore_job_execute(&jobs[0], 0);
+
+   for (i = 1; i < num_jobs; i++) {
+      util_queue_fence_wait(&jobs[i].fence);
+      util_queue_fence_destroy(&jobs[i].fence);
+   }
+}
+
+
 /**
  * Teximage storage routine for when a simple memcpy will do.
  * No pixel transfer operations or special texel encodings allowed.
@@ -774,9 +881,10 @@ texstore_rgba(TEXSTORE_PARAMS)
       src = (GLubyte *) srcAddr;
       dst = (GLubyte *) tempRGBA;
       for (img = 0; img < srcDepth; img++) {
-         _mesa_format_convert(dst, RGBA32_FLOAT, 4 * srcWidth * sizeof(float),
-                              src, srcMesaFormat, srcRowStride,
-                              srcWidth, srcHeight, NULL);
+         texstore_format_convert(dst, RGBA32_FLOAT,
+                                 4 * srcWidth * sizeof(float),
+                                 src, srcMesaFormat, srcRowStride,
+                                 srcWidth, srcHeight, NULL);
          src += srcHeight * srcRowStride;
          dst += srcHeight * 4 * srcWidth * sizeof(float);
       }
@@ -810,10 +918,10 @@ texstore_rgba(TEXSTORE_PARAMS)
    }
 
    for (img = 0; img < srcDepth; img++) {
-      _mesa_format_convert(dstSlices[img], dstFormat, dstRowStride,
-                           src, srcMesaFormat, srcRowStride,
-                           srcWidth, srcHeight,
-                           needRebase ? rebaseSwizzle : NULL);
+      texstore_format_convert(dstSlices[img], dstFormat, dstRowStride,
+                              src, srcMesaFormat, srcRowStride,
+                              srcWidth, srcHeight,
+                              needRebase ? rebaseSwizzle : NULL);
       src += srcHeight * srcRowStride;
    }
 
@@ -219,6 +219,38 @@ _mesa_bind_vertex_buffer(struct gl_context *ctx,
 }
 
 
+/**
+ * Points a client-memory array of the current vertex array object somewhere
+ * else, without the validation and bookkeeping of glVertexAttribPointer.
+ *
+ * glthread uses this to make a draw call read its own copy of the app's
+ * arrays, and to put the app's pointer back afterwards.  Nothing happens
+ * unless the array is still a client array at \p old_ptr.
+ */
+bool
+_mesa_replace_user_array_pointer(struct gl_context *ctx,
+                                 gl_vert_attrib attrib,
+                                 const GLubyte *old_ptr,
+                                 const GLubyte *new_ptr)
+{
+   struct gl_vertex_array_object *vao = ctx->Array.VAO;
+   struct gl_array_attributes *array = &vao->VertexAttrib[attrib];
+   struct gl_vertex_buffer_binding *binding =
+      &vao->BufferBinding[array->BufferBindingIndex];
+
+   assert(attrib < VERT_ATTRIB_MAX);
+
+   if (array->Ptr != old_ptr || _mesa_is_bufferobj(binding->BufferObj) ||
+       binding->Offset != (GLintptr) old_ptr)
+      return false;
+
+   array->Ptr = new_ptr;
+   binding->Offset = (GLintptr) new_ptr;
+   vao->NewArrays |= vao->Enabled & binding->_BoundArrays;
+   return true;
+}
+
+
 /**
  * Sets the InstanceDivisor field in the vertex buffer binding point
  * given by bindingIndex.
@@ -111,6 +111,13 @@ _mesa_bind_vertex_buffer(struct gl_context *ctx,
                          struct gl_buffer_object *vbo,
                          GLintptr offset, GLsizei stride);
 
+
+extern bool
+_mesa_replace_user_array_pointer(struct gl_context *ctx,
+                                 gl_vert_attrib attrib,
+                                 const GLubyte *old_ptr,
+                                 const GLubyte *new_ptr);
+
 extern void GLAPIENTRY
 _mesa_VertexPointer_no_error(GLint size, GLenum type, GLsizei stride,
                              const GLvoid *ptr);
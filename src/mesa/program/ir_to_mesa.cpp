@@ -53,6 +53,7 @@
 #include "program/prog_print.h"
 #include "program/program.h"
 #include "program/prog_parameter.h"
+#include "util/disk_cache.h"
 
 
 static int swizzle_for_size(int size);
@@ -3113,10 +3114,12 @@ _mesa_ir_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
 }
 
 /**
- * Link a GLSL shader program.  Called via glLinkProgram().
+ * Link a GLSL shader program.  \p from_source is set when linking again
+ * after the driver failed to read back a shader cache item.
  */
-void
-_mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
+static void
+link_shader_program(struct gl_context *ctx, struct gl_shader_program *prog,
+                    bool from_source)
 {
    unsigned int i;
    bool spirv = false;
@@ -3165,6 +3168,16 @@ _mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
    }
 
    if (prog->data->LinkStatus && !ctx->Driver.LinkShader(ctx, prog)) {
+      if (prog->data->LinkStatus == LINKING_SKIPPED && !from_source) {
+         /* The driver could not read its IR from the cache item.  Drop the
+          * item and link again, which misses the cache and recompiles the
+          * attached shaders.
+          */
+         disk_cache_remove(ctx->Cache, prog->data->sha1);
+         link_shader_program(ctx, prog, true);
+         return;
+      }
+
       prog->data->LinkStatus = LINKING_FAILURE;
    }
 
@@ -3189,4 +3202,13 @@ _mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
 #endif
 }
 
+/**
+ * Link a GLSL shader program.  Called via glLinkProgram().
+ */
+void
+_mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
+{
+   link_shader_program(ctx, prog, false);
+}
+
 } /* extern "C" */
@@ -40,6 +40,7 @@
 #include "st_atom.h"
 #include "st_context.h"
 #include "st_cb_bitmap.h"
+#include "st_cb_bufferobjects.h"
 #include "st_cb_readpixels.h"
 #include "st_debug.h"
 #include "state_tracker/st_cb_texture.h"
@@ -68,6 +69,13 @@
  */
 #define ALWAYS_READPIXELS_CACHE false
 
+/* Reads into client memory of at least this many bytes are done by having
+ * the GPU write into the client memory directly, when the driver can wrap
+ * it in a buffer.  The wrapped range is aligned to pages of this size.
+ */
+#define READPIXELS_USER_MEMORY_MIN_SIZE (256 * 1024)
+#define READPIXELS_USER_MEMORY_ALIGN 4096
+
 static boolean
 needs_integer_signed_unsigned_conversion(const struct gl_context *ctx,
                                          GLenum format, GLenum type)
@@ -98,7 +106,8 @@ try_pbo_readpixels(struct st_context *st, struct st_renderbuffer *strb,
                    bool invert_y,
                    GLint x, GLint y, GLsizei width, GLsizei height,
                    enum pipe_format src_format, enum pipe_format dst_format,
-                   const struct gl_pixelstore_attrib *pack, void *pixels)
+                   const struct gl_pixelstore_attrib *pack,
+                   struct pipe_resource *buf, intptr_t buf_offset)
 {
    struct pipe_context *pipe = st->pipe;
    struct pipe_screen *screen = pipe->screen;
@@ -127,7 +136,8 @@ try_pbo_readpixels(struct st_context *st, struct st_renderbuffer *strb,
    addr.width = width;
    addr.height = height;
    addr.depth = 1;
-   if (!st_pbo_addresses_pixelstore(st, GL_TEXTURE_2D, false, pack, pixels, &addr))
+   if (!st_pbo_addresses_buffer(st, buf, buf_offset, GL_TEXTURE_2D, false,
+                                pack, &addr))
       return false;
 
    cso_save_state(cso, (CSO_BIT_FRAGMENT_SAMPLER_VIEWS |
@@ -254,6 +264,81 @@ fail:
    return success;
 }
 
+/**
+ * Let the download shader write straight into client memory through a buffer
+ * wrapping it, so there is neither a staging texture nor a CPU copy.  We
+ * still have to wait for the GPU before returning.
+ *
+ * Pinning the pages costs more than copying a small image, so this is only
+ * used for large reads.
+ */
+static bool
+try_user_memory_readpixels(struct st_context *st, struct st_renderbuffer *strb,
+                           bool invert_y,
+                           GLint x, GLint y, GLsizei width, GLsizei height,
+                           GLenum format, GLenum type,
+                           enum pipe_format src_format,
+                           enum pipe_format dst_format,
+                           const struct gl_pixelstore_attrib *pack,
+                           void *pixels)
+{
+   struct pipe_context *pipe = st->pipe;
+   struct pipe_screen *screen = pipe->screen;
+   struct pipe_resource templ;
+   struct pipe_resource *buf;
+   const GLubyte *start, *end;
+   uintptr_t base;
+   uint64_t size;
+   bool success;
+
+   start = _mesa_image_address2d(pack, pixels, width, height, format, type,
+                                 0, 0);
+   end = (const GLubyte *)
+      _mesa_image_address2d(pack, pixels, width, height, format, type,
+                            height - 1, 0) +
+      width * util_format_get_blocksize(dst_format);
+
+   if (end - start < READPIXELS_USER_MEMORY_MIN_SIZE ||
+       !screen->get_param(screen, PIPE_CAP_RESOURCE_FROM_USER_MEMORY))
+      return false;
+
+   /* Drivers want whole pages.  The shader only writes the pixels of the
+    * image, never the rest of the pages.
+    */
+   base = (uintptr_t) pixels & ~(uintptr_t) (READPIXELS_USER_MEMORY_ALIGN - 1);
+   size = align64((uintptr_t) end - base, READPIXELS_USER_MEMORY_ALIGN);
+   if (size > UINT32_MAX)
+      return false;
+
+   memset(&templ, 0, sizeof(templ));
+   templ.target = PIPE_BUFFER;
+   templ.format = PIPE_FORMAT_R8_UNORM;
+   templ.bind = PIPE_BIND_SHADER_IMAGE;
+   templ.usage = PIPE_USAGE_STAGING;
+   templ.width0 = size;
+   templ.height0 = 1;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+
+   buf = screen->resource_from_user_memory(screen, &templ, (void *) base);
+   if (!buf)
+      return false;
+
+   success = try_pbo_readpixels(st, strb, invert_y, x, y, width, height,
+                                src_format, dst_format, pack,
+                                buf, (uintptr_t) pixels - base);
+   if (success) {
+      struct pipe_fence_handle *fence = NULL;
+
+      pipe->flush(pipe, &fence, 0);
+      screen->fence_finish(screen, NULL, fence, PIPE_TIMEOUT_INFINITE);
+      screen->fence_reference(screen, &fence, NULL);
+   }
+
+   pipe_resource_reference(&buf, NULL);
+   return success;
+}
+
 /**
  * Create a staging texture and blit the requested region to it.
  */
@@ -470,13 +555,23 @@ st_ReadPixels(struct gl_context *ctx, GLint x, GLint y,
       goto fallback;
    }
 
-   if (st->pbo.download_enabled && _mesa_is_bufferobj(pack->BufferObj)) {
-      if (try_pbo_readpixels(st, strb,
-                             st_fb_orientation(ctx->ReadBuffer) == Y_0_TOP,
-                             x, y, width, height,
-                             src_format, dst_format,
-                             pack, pixels))
-         return;
+   if (st->pbo.download_enabled) {
+      if (_mesa_is_bufferobj(pack->BufferObj)) {
+         /* The GPU writes the PBO, and mapping it waits for that. */
+         if (try_pbo_readpixels(st, strb,
+                                st_fb_orientation(ctx->ReadBuffer) == Y_0_TOP,
+                                x, y, width, height,
+                                src_format, dst_format, pack,
+                                st_buffer_object(pack->BufferObj)->buffer,
+                                (intptr_t) pixels))
+            return;
+      } else if (!(ST_DEBUG & DEBUG_NOREADPIXUSERMEM)) {
+         if (try_user_memory_readpixels(st, strb,
+                                        st_fb_orientation(ctx->ReadBuffer) == Y_0_TOP,
+                                        x, y, width, height, format, type,
+                                        src_format, dst_format, pack, pixels))
+            return;
+      }
    }
 
    if (needs_integer_signed_unsigned_conversion(ctx, format, type)) {
@@ -59,6 +59,7 @@ static const struct debug_named_value st_debug_flags[] = {
    { "precompile",  DEBUG_PRECOMPILE, NULL },
    { "gremedy",  DEBUG_GREMEDY, "Enable GREMEDY debug extensions" },
    { "noreadpixcache", DEBUG_NOREADPIXCACHE, NULL },
+   { "noreadpixusermem", DEBUG_NOREADPIXUSERMEM, NULL },
    DEBUG_NAMED_VALUE_END
 };
 
@@ -333,6 +333,7 @@ void st_init_limits(struct pipe_screen *screen,
        * because it can actually optimize SSBO access.
        */
       options->LowerBufferInterfaceBlocks = !prefer_nir;
+      options->OptimizeInNIR = prefer_nir;
    }
 
    c->MaxUserAssignableUniformLocations =
@@ -57,6 +57,12 @@ st_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
       return GL_TRUE;
    }
 
+   /* The GLSL metadata came from the cache but our IR could not be read
+    * back, and there is no GLSL IR to fall back to.
+    */
+   if (prog->data->LinkStatus == LINKING_SKIPPED)
+      return GL_FALSE;
+
    assert(prog->data->LinkStatus);
 
    for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
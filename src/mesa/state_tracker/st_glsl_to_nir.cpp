@@ -42,6 +42,7 @@
 #include "st_program.h"
 
 #include "compiler/nir/nir.h"
+#include "compiler/nir/nir_pass_manager.h"
 #include "compiler/glsl_types.h"
 #include "compiler/glsl/glsl_to_nir.h"
 #include "compiler/glsl/gl_nir.h"
@@ -300,73 +301,120 @@ st_nir_assign_uniform_locations(struct gl_context *ctx,
    }
 }
 
+static bool
+st_nir_lower_alu_to_scalar(nir_shader *nir, const void *data)
+{
+   return nir_lower_alu_to_scalar(nir, NULL);
+}
+
+static bool
+st_nir_opt_if(nir_shader *nir, const void *data)
+{
+   return nir_opt_if(nir, false);
+}
+
+static bool
+st_nir_opt_peephole_select(nir_shader *nir, const void *data)
+{
+   return nir_opt_peephole_select(nir, 8, true, true);
+}
+
+static bool
+st_nir_opt_loop_unroll(nir_shader *nir, const void *data)
+{
+   return nir_opt_loop_unroll(nir, (nir_variable_mode)0);
+}
+
+static bool
+st_nir_lower_flrp(nir_shader *nir, const void *data)
+{
+   unsigned *lower_flrp = (unsigned *) data;
+
+   if (*lower_flrp == 0)
+      return false;
+
+   bool progress = nir_lower_flrp(nir, *lower_flrp,
+                                  false /* always_precise */,
+                                  nir->options->lower_ffma);
+
+   /* Nothing should rematerialize any flrps, so we only need to do this
+    * lowering once.
+    */
+   *lower_flrp = 0;
+
+   return progress;
+}
+
 void
 st_nir_opts(nir_shader *nir, bool scalar)
 {
-   bool progress;
    unsigned lower_flrp =
       (nir->options->lower_flrp16 ? 16 : 0) |
       (nir->options->lower_flrp32 ? 32 : 0) |
       (nir->options->lower_flrp64 ? 64 : 0);
 
-   do {
-      progress = false;
+   const unsigned all = NIR_PASS_TOUCHES_ALL;
+   const unsigned alu = NIR_PASS_TOUCHES_ALU;
 
-      NIR_PASS_V(nir, nir_lower_vars_to_ssa);
+   nir_pass_manager *pm = nir_pass_manager_create(NULL);
 
-      NIR_PASS(progress, nir, nir_opt_copy_prop_vars);
-      NIR_PASS(progress, nir, nir_opt_dead_write_vars);
+   NIR_PM_ADD_V(pm, nir_lower_vars_to_ssa,
+                NIR_PASS_TOUCHES_DEREF | NIR_PASS_TOUCHES_INTRINSIC |
+                NIR_PASS_TOUCHES_VARIABLES, all);
 
-      if (scalar) {
-         NIR_PASS_V(nir, nir_lower_alu_to_scalar, NULL);
-         NIR_PASS_V(nir, nir_lower_phis_to_scalar);
-      }
+   NIR_PM_ADD(pm, nir_opt_copy_prop_vars, all, all);
+   /* Only ever removes stores. */
+   NIR_PM_ADD(pm, nir_opt_dead_write_vars, all, NIR_PASS_TOUCHES_INTRINSIC);
 
-      NIR_PASS_V(nir, nir_lower_alu);
-      NIR_PASS_V(nir, nir_lower_pack);
-      NIR_PASS(progress, nir, nir_copy_prop);
-      NIR_PASS(progress, nir, nir_opt_remove_phis);
-      NIR_PASS(progress, nir, nir_opt_dce);
-      if (nir_opt_trivial_continues(nir)) {
-         progress = true;
-         NIR_PASS(progress, nir, nir_copy_prop);
-         NIR_PASS(progress, nir, nir_opt_dce);
-      }
-      NIR_PASS(progress, nir, nir_opt_if, false);
-      NIR_PASS(progress, nir, nir_opt_dead_cf);
-      NIR_PASS(progress, nir, nir_opt_cse);
-      NIR_PASS(progress, nir, nir_opt_peephole_select, 8, true, true);
-
-      NIR_PASS(progress, nir, nir_opt_algebraic);
-      NIR_PASS(progress, nir, nir_opt_constant_folding);
-
-      if (lower_flrp != 0) {
-         bool lower_flrp_progress = false;
-
-         NIR_PASS(lower_flrp_progress, nir, nir_lower_flrp,
-                  lower_flrp,
-                  false /* always_precise */,
-                  nir->options->lower_ffma);
-         if (lower_flrp_progress) {
-            NIR_PASS(progress, nir,
-                     nir_opt_constant_folding);
-            progress = true;
-         }
+   if (scalar) {
+      nir_pass_manager_add_with_data(pm, "nir_lower_alu_to_scalar",
+                                     st_nir_lower_alu_to_scalar, NULL,
+                                     alu, all, NIR_PASS_IGNORE_PROGRESS);
+      NIR_PM_ADD_V(pm, nir_lower_phis_to_scalar, all, all);
+   }
 
-         /* Nothing should rematerialize any flrps, so we only need to do this
-          * lowering once.
-          */
-         lower_flrp = 0;
-      }
+   NIR_PM_ADD_V(pm, nir_lower_alu, alu, all);
+   NIR_PM_ADD_V(pm, nir_lower_pack, alu, all);
+   NIR_PM_ADD(pm, nir_copy_prop, alu, all);
+   NIR_PM_ADD(pm, nir_opt_remove_phis,
+              NIR_PASS_TOUCHES_PHI | NIR_PASS_TOUCHES_CF, all);
+   NIR_PM_ADD(pm, nir_opt_dce, all, all);
+   NIR_PM_ADD(pm, nir_opt_trivial_continues,
+              NIR_PASS_TOUCHES_CF | NIR_PASS_TOUCHES_JUMP, all);
+   nir_pass_manager_add_with_data(pm, "nir_opt_if", st_nir_opt_if, NULL,
+                                  all, all, 0);
+   NIR_PM_ADD(pm, nir_opt_dead_cf, all, all);
+   NIR_PM_ADD(pm, nir_opt_cse, all, all);
+   nir_pass_manager_add_with_data(pm, "nir_opt_peephole_select",
+                                  st_nir_opt_peephole_select, NULL,
+                                  all, all, 0);
+
+   NIR_PM_ADD(pm, nir_opt_algebraic, all, all);
+   NIR_PM_ADD(pm, nir_opt_constant_folding,
+              alu | NIR_PASS_TOUCHES_INTRINSIC, all);
+
+   /* Progress here makes constant folding, above, run again. */
+   if (lower_flrp != 0) {
+      nir_pass_manager_add_with_data(pm, "nir_lower_flrp", st_nir_lower_flrp,
+                                     &lower_flrp, alu, all, 0);
+   }
 
-      NIR_PASS(progress, nir, gl_nir_opt_access);
+   NIR_PM_ADD(pm, gl_nir_opt_access,
+              NIR_PASS_TOUCHES_DEREF | NIR_PASS_TOUCHES_INTRINSIC |
+              NIR_PASS_TOUCHES_VARIABLES,
+              NIR_PASS_TOUCHES_INTRINSIC | NIR_PASS_TOUCHES_VARIABLES);
+
+   NIR_PM_ADD(pm, nir_opt_undef, all, all);
+   NIR_PM_ADD(pm, nir_opt_conditional_discard,
+              NIR_PASS_TOUCHES_CF | NIR_PASS_TOUCHES_INTRINSIC, all);
+   if (nir->options->max_unroll_iterations) {
+      nir_pass_manager_add_with_data(pm, "nir_opt_loop_unroll",
+                                     st_nir_opt_loop_unroll, NULL,
+                                     all, all, 0);
+   }
 
-      NIR_PASS(progress, nir, nir_opt_undef);
-      NIR_PASS(progress, nir, nir_opt_conditional_discard);
-      if (nir->options->max_unroll_iterations) {
-         NIR_PASS(progress, nir, nir_opt_loop_unroll, (nir_variable_mode)0);
-      }
-   } while (progress);
+   nir_pass_manager_run(pm, nir);
+   nir_pass_manager_destroy(pm);
 }
 
 /* First third of converting glsl_to_nir.. this leaves things in a pre-
@@ -686,8 +686,10 @@ st_context_flush(struct st_context_iface *stctxi, unsigned flags,
     * draw call, which will invoke st_manager_validate_framebuffers, but it
     * won't dirty states if there is no change.
     */
-   if (flags & ST_FLUSH_END_OF_FRAME)
+   if (flags & ST_FLUSH_END_OF_FRAME) {
       st->gfx_shaders_may_be_dirty = true;
+      _mesa_glthread_end_of_frame(st->ctx);
+   }
 }
 
 static boolean
@@ -115,9 +115,23 @@ st_pbo_addresses_pixelstore(struct st_context *st,
                             const void *pixels,
                             struct st_pbo_addresses *addr)
 {
-   struct pipe_resource *buf = st_buffer_object(store->BufferObj)->buffer;
-   intptr_t buf_offset = (intptr_t) pixels;
+   return st_pbo_addresses_buffer(st, st_buffer_object(store->BufferObj)->buffer,
+                                  (intptr_t) pixels, gl_target, skip_images,
+                                  store, addr);
+}
 
+/* Like st_pbo_addresses_pixelstore, but for a buffer that isn't the
+ * pixelstore's buffer object, e.g. one wrapping client memory.
+ *
+ * buf_offset is in bytes.
+ */
+bool
+st_pbo_addresses_buffer(struct st_context *st,
+                        struct pipe_resource *buf, intptr_t buf_offset,
+                        GLenum gl_target, bool skip_images,
+                        const struct gl_pixelstore_attrib *store,
+                        struct st_pbo_addresses *addr)
+{
    if (buf_offset % addr->bytes_per_pixel)
       return false;
 
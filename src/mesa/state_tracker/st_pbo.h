@@ -70,6 +70,13 @@ st_pbo_addresses_pixelstore(struct st_context *st,
                             const void *pixels,
                             struct st_pbo_addresses *addr);
 
+bool
+st_pbo_addresses_buffer(struct st_context *st,
+                        struct pipe_resource *buf, intptr_t buf_offset,
+                        GLenum gl_target, bool skip_images,
+                        const struct gl_pixelstore_attrib *store,
+                        struct st_pbo_addresses *addr);
+
 void
 st_pbo_addresses_invert_y(struct st_pbo_addresses *addr,
                           unsigned viewport_height);
@@ -187,7 +187,7 @@ read_tgsi_from_cache(struct blob_reader *blob_reader,
    blob_copy_bytes(blob_reader, (uint8_t *) *tokens, tokens_size);
 }
 
-static void
+static bool
 st_deserialise_ir_program(struct gl_context *ctx,
                           struct gl_shader_program *shProg,
                           struct gl_program *prog, bool nir)
@@ -352,6 +352,17 @@ st_deserialise_ir_program(struct gl_context *ctx,
       unreachable("Unsupported stage");
    }
 
+   /* nir_deserialize() rejects truncated blobs and blobs written by another
+    * NIR version.  Let the caller drop the item and build from source.
+    */
+   if (nir && !prog->nir) {
+      if (ctx->_Shader->Flags & GLSL_CACHE_INFO) {
+         fprintf(stderr, "Error reading program from cache (invalid NIR "
+                 "cache item)\n");
+      }
+      return false;
+   }
+
    /* Make sure we don't try to read more data than we wrote. This should
     * never happen in release builds but its useful to have this check to
     * catch development bugs.
@@ -372,6 +383,8 @@ st_deserialise_ir_program(struct gl_context *ctx,
    if (ST_DEBUG & DEBUG_PRECOMPILE ||
        st->shader_has_one_variant[prog->info.stage])
       st_precompile_shader_variant(st, prog);
+
+   return true;
 }
 
 bool
@@ -393,13 +406,16 @@ st_load_ir_from_disk_cache(struct gl_context *ctx,
          continue;
 
       struct gl_program *glprog = prog->_LinkedShaders[i]->Program;
-      st_deserialise_ir_program(ctx, prog, glprog, nir);
+      bool loaded = st_deserialise_ir_program(ctx, prog, glprog, nir);
 
       /* We don't need the cached blob anymore so free it */
       ralloc_free(glprog->driver_cache_blob);
       glprog->driver_cache_blob = NULL;
       glprog->driver_cache_blob_size = 0;
 
+      if (!loaded)
+         return false;
+
       if (ctx->_Shader->Flags & GLSL_CACHE_INFO) {
          fprintf(stderr, "%s state tracker IR retrieved from cache\n",
                  _mesa_shader_stage_to_string(i));
@@ -423,12 +439,12 @@ st_serialise_tgsi_program_binary(struct gl_context *ctx,
    st_serialise_ir_program(ctx, prog, false);
 }
 
-void
+bool
 st_deserialise_tgsi_program(struct gl_context *ctx,
                             struct gl_shader_program *shProg,
                             struct gl_program *prog)
 {
-   st_deserialise_ir_program(ctx, shProg, prog, false);
+   return st_deserialise_ir_program(ctx, shProg, prog, false);
 }
 
 void
@@ -445,10 +461,10 @@ st_serialise_nir_program_binary(struct gl_context *ctx,
    st_serialise_ir_program(ctx, prog, true);
 }
 
-void
+bool
 st_deserialise_nir_program(struct gl_context *ctx,
                            struct gl_shader_program *shProg,
                            struct gl_program *prog)
 {
-   st_deserialise_ir_program(ctx, shProg, prog, true);
+   return st_deserialise_ir_program(ctx, shProg, prog, true);
 }
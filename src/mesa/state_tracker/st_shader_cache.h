@@ -46,7 +46,7 @@ st_serialise_tgsi_program_binary(struct gl_context *ctx,
                                  struct gl_shader_program *shProg,
                                  struct gl_program *prog);
 
-void
+bool
 st_deserialise_tgsi_program(struct gl_context *ctx,
                             struct gl_shader_program *shProg,
                             struct gl_program *prog);
@@ -59,7 +59,7 @@ st_serialise_nir_program_binary(struct gl_context *ctx,
                                 struct gl_shader_program *shProg,
                                 struct gl_program *prog);
 
-void
+bool
 st_deserialise_nir_program(struct gl_context *ctx,
                            struct gl_shader_program *shProg,
                            struct gl_program *prog);
@@ -29,6 +29,7 @@
 #include "main/glheader.h"
 #include "main/arrayobj.h"
 #include "main/api_arrayelt.h"
+#include "main/transformfeedback.h"
 #include "main/vtxfmt.h"
 #include "vbo_private.h"
 
@@ -228,3 +229,231 @@ vbo_merge_prims(struct _mesa_prim *p0, const struct _mesa_prim *p1)
    p0->count += p1->count;
    p0->end = p1->end;
 }
+
+
+/**
+ * The separate primitive type that a primitive can be split into, and the
+ * number of indices that takes, or GL_NONE.
+ */
+static GLenum
+merged_prim_mode(const struct _mesa_prim *p, GLuint *count)
+{
+   const GLuint n = p->count;
+
+   switch (p->mode) {
+   case GL_LINES:
+      *count = n / 2 * 2;
+      return GL_LINES;
+   case GL_LINE_STRIP:
+      *count = n >= 2 ? (n - 1) * 2 : 0;
+      return GL_LINES;
+   case GL_TRIANGLES:
+      *count = n / 3 * 3;
+      return GL_TRIANGLES;
+   case GL_TRIANGLE_STRIP:
+   case GL_TRIANGLE_FAN:
+   case GL_POLYGON:
+      *count = n >= 3 ? (n - 2) * 3 : 0;
+      return GL_TRIANGLES;
+   case GL_QUADS:
+      *count = n / 4 * 6;
+      return GL_TRIANGLES;
+   case GL_QUAD_STRIP:
+      *count = n >= 4 ? (n - 2) / 2 * 6 : 0;
+      return GL_TRIANGLES;
+   default:
+      return GL_NONE;
+   }
+}
+
+
+/**
+ * Helper function for determining if a list of primitives is worth drawing
+ * as a single indexed list of separate lines or triangles: that is, if
+ * there is more than one of them, or if it is made of quads or polygons,
+ * which a display list can then split once when it is compiled.
+ *
+ * Returns the mode of the merged primitive, GL_LINES or GL_TRIANGLES, and
+ * the number of indices and the highest vertex it uses, or GL_NONE if the
+ * primitives can't or needn't be merged.
+ */
+GLenum
+vbo_get_merged_prim(const struct _mesa_prim *prims, GLuint nr_prims,
+                    GLuint *count, GLuint *max_index)
+{
+   GLenum mode = GL_NONE;
+   GLuint i;
+
+   *count = 0;
+   *max_index = 0;
+
+   for (i = 0; i < nr_prims; i++) {
+      GLuint n;
+      const GLenum m = merged_prim_mode(&prims[i], &n);
+
+      if (m == GL_NONE || n == 0 || (mode != GL_NONE && m != mode))
+         return GL_NONE;
+
+      mode = m;
+      *count += n;
+      *max_index = MAX2(*max_index, prims[i].start + prims[i].count - 1);
+   }
+
+   if (nr_prims == 1 &&
+       prims[0].mode != GL_QUADS &&
+       prims[0].mode != GL_QUAD_STRIP &&
+       prims[0].mode != GL_POLYGON)
+      return GL_NONE;
+
+   return mode;
+}
+
+
+static GLuint *
+emit_merged_indices(const struct _mesa_prim *p, GLuint *out)
+{
+   const GLuint s = p->start;
+   const GLuint n = p->count;
+   GLuint i;
+
+   switch (p->mode) {
+   case GL_LINES:
+      for (i = 0; i < n / 2 * 2; i++)
+         *out++ = s + i;
+      break;
+   case GL_LINE_STRIP:
+      for (i = 0; i + 2 <= n; i++) {
+         *out++ = s + i;
+         *out++ = s + i + 1;
+      }
+      break;
+   case GL_TRIANGLES:
+      for (i = 0; i < n / 3 * 3; i++)
+         *out++ = s + i;
+      break;
+   case GL_TRIANGLE_STRIP:
+      for (i = 0; i + 3 <= n; i++) {
+         *out++ = s + i + (i & 1);
+         *out++ = s + i + 1 - (i & 1);
+         *out++ = s + i + 2;
+      }
+      break;
+   case GL_TRIANGLE_FAN:
+      for (i = 0; i + 3 <= n; i++) {
+         *out++ = s;
+         *out++ = s + i + 1;
+         *out++ = s + i + 2;
+      }
+      break;
+   case GL_POLYGON:
+      /* The first vertex provokes the whole polygon. */
+      for (i = 0; i + 3 <= n; i++) {
+         *out++ = s + i + 1;
+         *out++ = s + i + 2;
+         *out++ = s;
+      }
+      break;
+   case GL_QUADS:
+      for (i = 0; i + 4 <= n; i += 4) {
+         *out++ = s + i;
+         *out++ = s + i + 1;
+         *out++ = s + i + 3;
+         *out++ = s + i + 1;
+         *out++ = s + i + 2;
+         *out++ = s + i + 3;
+      }
+      break;
+   case GL_QUAD_STRIP:
+      for (i = 0; i + 4 <= n; i += 2) {
+         *out++ = s + i;
+         *out++ = s + i + 1;
+         *out++ = s + i + 3;
+         *out++ = s + i + 2;
+         *out++ = s + i;
+         *out++ = s + i + 3;
+      }
+      break;
+   default:
+      unreachable("Unexpected primitive type");
+   }
+
+   return out;
+}
+
+
+/**
+ * Write the indices of the primitive that vbo_get_merged_prim() accepted.
+ * Each line or triangle keeps the winding of the original, and ends with
+ * the vertex that provokes the original with the last vertex convention.
+ *
+ * \p indices must have room for \p count GLuints.  They are packed to
+ * GLushort if \p max_index allows it, and the index size is returned.
+ */
+unsigned
+vbo_emit_merged_indices(const struct _mesa_prim *prims, GLuint nr_prims,
+                        GLuint count, GLuint max_index, GLuint *indices)
+{
+   GLuint *out = indices;
+   GLuint i;
+
+   for (i = 0; i < nr_prims; i++)
+      out = emit_merged_indices(&prims[i], out);
+   assert(out == indices + count);
+
+   if (max_index > 0xffff)
+      return sizeof(GLuint);
+
+   GLushort *out16 = (GLushort *) indices;
+   for (i = 0; i < count; i++)
+      out16[i] = indices[i];
+
+   return sizeof(GLushort);
+}
+
+
+/**
+ * Can primitives be drawn as the merged primitive in the current state?
+ * Not if splitting quads, polygons or line strips would show, or if the
+ * provoking vertex isn't the one that the merged primitive keeps.
+ */
+bool
+vbo_can_draw_merged_prim(const struct gl_context *ctx, GLenum mode)
+{
+   if (ctx->Light.ProvokingVertex != GL_LAST_VERTEX_CONVENTION_EXT ||
+       ctx->RenderMode != GL_RENDER)
+      return false;
+
+   /* The driver would apply it to our indices. */
+   if (ctx->Array._PrimitiveRestart)
+      return false;
+
+   if (mode == GL_LINES) {
+      /* The stipple pattern restarts with each separate line. */
+      if (ctx->Line.StippleFlag)
+         return false;
+   }
+   else {
+      if (ctx->Polygon.FrontMode != GL_FILL ||
+          ctx->Polygon.BackMode != GL_FILL ||
+          ctx->Polygon.SmoothFlag)
+         return false;
+   }
+
+   /* These see the primitive type, or the order of the vertices. */
+   if (ctx->_Shader->CurrentProgram[MESA_SHADER_GEOMETRY] ||
+       ctx->_Shader->CurrentProgram[MESA_SHADER_TESS_EVAL] ||
+       _mesa_is_xfb_active_and_unpaused(ctx))
+      return false;
+
+   /* gl_PrimitiveID would count the merged lines or triangles, and not
+    * restart at zero for each original primitive.
+    */
+   const struct gl_program *fs =
+      ctx->_Shader->CurrentProgram[MESA_SHADER_FRAGMENT];
+   if (fs && ((fs->info.inputs_read & VARYING_BIT_PRIMITIVE_ID) ||
+              (fs->info.system_values_read &
+               BITFIELD64_BIT(SYSTEM_VALUE_PRIMITIVE_ID))))
+      return false;
+
+   return true;
+}
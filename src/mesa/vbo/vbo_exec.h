@@ -42,8 +42,10 @@ USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 /**
  * Max number of primitives (number of glBegin/End pairs) per VBO.
+ * Runs of these are usually drawn as one indexed primitive, see
+ * vbo_exec_draw_prims(), so this doesn't need to be small.
  */
-#define VBO_MAX_PRIM 64
+#define VBO_MAX_PRIM 256
 
 
 /**
@@ -100,6 +102,10 @@ struct vbo_exec_context
 
       /** pointers into the current 'vertex' array, declared above */
       fi_type *attrptr[VBO_ATTRIB_MAX];
+
+      /** Indices of the primitives merged by vbo_exec_vtx_flush() */
+      GLuint *merged_indices;
+      GLuint merged_indices_size;
    } vtx;
 
    struct {
@@ -1232,6 +1232,10 @@ vbo_exec_vtx_destroy(struct vbo_exec_context *exec)
       ctx->Driver.UnmapBuffer(ctx, exec->vtx.bufferobj, MAP_INTERNAL);
    }
    _mesa_reference_buffer_object(ctx, &exec->vtx.bufferobj, NULL);
+
+   free(exec->vtx.merged_indices);
+   exec->vtx.merged_indices = NULL;
+   exec->vtx.merged_indices_size = 0;
 }
 
 
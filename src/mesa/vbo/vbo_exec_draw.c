@@ -351,6 +351,66 @@ vbo_exec_vtx_map(struct vbo_exec_context *exec)
 
 
 
+/**
+ * Draw the buffered primitives, as a single indexed list of lines or
+ * triangles when that can be done without changing the result.  Apps that
+ * draw many small glBegin/End blocks without changing state in between
+ * then get one draw per buffer instead of one per block.
+ *
+ * A single primitive is always passed on as it is.  Re-indexing a lone
+ * quad or polygon block here would happen at every flush, and drivers
+ * that draw quads natively would get an indexed draw in place of a plain
+ * one.
+ */
+static void
+vbo_exec_draw_prims(struct vbo_exec_context *exec)
+{
+   struct gl_context *ctx = exec->ctx;
+   GLuint count, max_index;
+   const GLenum mode = exec->vtx.prim_count > 1 ?
+      vbo_get_merged_prim(exec->vtx.prim, exec->vtx.prim_count,
+                          &count, &max_index) : GL_NONE;
+
+   if (mode != GL_NONE && vbo_can_draw_merged_prim(ctx, mode)) {
+      if (count > exec->vtx.merged_indices_size) {
+         free(exec->vtx.merged_indices);
+         exec->vtx.merged_indices = malloc(count * sizeof(GLuint));
+         exec->vtx.merged_indices_size =
+            exec->vtx.merged_indices ? count : 0;
+      }
+
+      if (exec->vtx.merged_indices) {
+         struct _mesa_prim prim;
+         struct _mesa_index_buffer ib;
+
+         memset(&prim, 0, sizeof(prim));
+         prim.mode = mode;
+         prim.indexed = 1;
+         prim.begin = 1;
+         prim.end = 1;
+         prim.count = count;
+         prim.num_instances = 1;
+
+         ib.count = count;
+         ib.index_size = vbo_emit_merged_indices(exec->vtx.prim,
+                                                 exec->vtx.prim_count,
+                                                 count, max_index,
+                                                 exec->vtx.merged_indices);
+         ib.obj = ctx->Shared->NullBufferObj;
+         ib.ptr = exec->vtx.merged_indices;
+
+         ctx->Driver.Draw(ctx, &prim, 1, &ib, GL_TRUE, 0,
+                          exec->vtx.vert_count - 1, NULL, 0, NULL);
+         return;
+      }
+   }
+
+   ctx->Driver.Draw(ctx, exec->vtx.prim, exec->vtx.prim_count,
+                    NULL, GL_TRUE, 0, exec->vtx.vert_count - 1,
+                    NULL, 0, NULL);
+}
+
+
 /**
  * Execute the buffer and save copied verts.
  * \param keep_unmapped  if true, leave the VBO unmapped when we're done.
@@ -383,9 +443,7 @@ vbo_exec_vtx_flush(struct vbo_exec_context *exec, GLboolean keepUnmapped)
             printf("%s %d %d\n", __func__, exec->vtx.prim_count,
                    exec->vtx.vert_count);
 
-         ctx->Driver.Draw(ctx, exec->vtx.prim, exec->vtx.prim_count,
-                          NULL, GL_TRUE, 0, exec->vtx.vert_count - 1,
-                          NULL, 0, NULL);
+         vbo_exec_draw_prims(exec);
 
          /* Get new storage -- unless asked not to. */
          if (!keepUnmapped)
@@ -32,13 +32,41 @@
 #include "main/macros.h"
 #include "main/sse_minmax.h"
 #include "x86/common_x86_asm.h"
+#include "util/bitscan.h"
+#include "util/bitset.h"
 #include "util/hash_table.h"
+#include "util/u_cpu_detect.h"
+
+
+/*
+ * Min/max indices of buffer objects are remembered in two ways: the exact
+ * ranges that were drawn, which answers repeated draws without mapping the
+ * buffer, and a tree over the whole buffer per index size, which answers
+ * any other range by scanning only its unaligned ends.
+ *
+ * Writes to the buffer record the written byte range (see
+ * _mesa_buffer_minmax_cache_dirty), and the next lookup drops the exact
+ * ranges and tree nodes that overlap it.
+ */
+
+/* Indices per leaf of the tree, and children per node above the leaves.
+ * The top level has more than that many nodes in buffers of over 2^28
+ * indices, which keeps node sizes in 32 bits.
+ */
+#define MINMAX_TREE_LEAF_SHIFT 8
+#define MINMAX_TREE_FANOUT_SHIFT 4
+#define MINMAX_TREE_MAX_LEVELS 6
+
+/* Exact ranges remembered per buffer before they are all dropped. */
+#define MINMAX_CACHE_MAX_ENTRIES 1024
 
 
 struct minmax_cache_key {
    GLintptr offset;
    GLuint count;
    unsigned index_size;
+   unsigned restart;
+   unsigned restart_index;
 };
 
 
@@ -49,6 +77,139 @@ struct minmax_cache_entry {
 };
 
 
+struct minmax_tree_node {
+   GLuint min;
+   GLuint max;
+};
+
+
+struct minmax_tree_level {
+   unsigned num_nodes;
+   struct minmax_tree_node *nodes;
+   BITSET_WORD *valid;
+};
+
+
+struct vbo_minmax_tree {
+   unsigned index_size;
+   unsigned num_indices;
+   bool restart;
+   unsigned restart_index;
+   unsigned num_levels;
+   struct minmax_tree_level levels[MINMAX_TREE_MAX_LEVELS];
+};
+
+
+/** The index data that a tree lookup may read. */
+struct minmax_scan {
+   const char *indices;
+   unsigned first;
+   unsigned index_size;
+   bool restart;
+   unsigned restart_index;
+};
+
+
+/**
+ * Min and max of \p count indices, skipping restart indices.  Returns ~0
+ * and 0 if there are none.
+ */
+static void
+vbo_scan_minmax(const void *indices, unsigned index_size, unsigned count,
+                bool restart, unsigned restart_index,
+                GLuint *min_index, GLuint *max_index)
+{
+   switch (index_size) {
+   case 4: {
+#if defined(USE_AVX2)
+      if (util_cpu_caps.has_avx2) {
+         _mesa_uint_array_min_max_avx2(indices, count, restart, restart_index,
+                                       min_index, max_index);
+         return;
+      }
+#endif
+#if defined(USE_SSE41)
+      if (cpu_has_sse4_1) {
+         _mesa_uint_array_min_max(indices, count, restart, restart_index,
+                                  min_index, max_index);
+         return;
+      }
+#endif
+      const GLuint *ui_indices = (const GLuint *)indices;
+      GLuint max_ui = 0;
+      GLuint min_ui = ~0U;
+      for (unsigned i = 0; i < count; i++) {
+         if (restart && ui_indices[i] == restart_index)
+            continue;
+         if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
+         if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
+      }
+      *min_index = min_ui;
+      *max_index = max_ui;
+      break;
+   }
+   case 2: {
+#if defined(USE_AVX2)
+      if (util_cpu_caps.has_avx2) {
+         _mesa_ushort_array_min_max_avx2(indices, count, restart,
+                                         restart_index, min_index, max_index);
+         return;
+      }
+#endif
+#if defined(USE_SSE41)
+      if (cpu_has_sse4_1) {
+         _mesa_ushort_array_min_max(indices, count, restart, restart_index,
+                                    min_index, max_index);
+         return;
+      }
+#endif
+      const GLushort *us_indices = (const GLushort *)indices;
+      GLuint max_us = 0;
+      GLuint min_us = ~0U;
+      for (unsigned i = 0; i < count; i++) {
+         if (restart && us_indices[i] == restart_index)
+            continue;
+         if (us_indices[i] > max_us) max_us = us_indices[i];
+         if (us_indices[i] < min_us) min_us = us_indices[i];
+      }
+      *min_index = min_us;
+      *max_index = max_us;
+      break;
+   }
+   case 1: {
+#if defined(USE_AVX2)
+      if (util_cpu_caps.has_avx2) {
+         _mesa_ubyte_array_min_max_avx2(indices, count, restart,
+                                        restart_index, min_index, max_index);
+         return;
+      }
+#endif
+#if defined(USE_SSE41)
+      if (cpu_has_sse4_1) {
+         _mesa_ubyte_array_min_max(indices, count, restart, restart_index,
+                                   min_index, max_index);
+         return;
+      }
+#endif
+      const GLubyte *ub_indices = (const GLubyte *)indices;
+      GLuint max_ub = 0;
+      GLuint min_ub = ~0U;
+      for (unsigned i = 0; i < count; i++) {
+         if (restart && ub_indices[i] == restart_index)
+            continue;
+         if (ub_indices[i] > max_ub) max_ub = ub_indices[i];
+         if (ub_indices[i] < min_ub) min_ub = ub_indices[i];
+      }
+      *min_index = min_ub;
+      *max_index = max_ub;
+      break;
+   }
+   default:
+      unreachable("not reached");
+   }
+}
+
+
 static uint32_t
 vbo_minmax_cache_hash(const struct minmax_cache_key *key)
 {
@@ -61,7 +222,8 @@ vbo_minmax_cache_key_equal(const struct minmax_cache_key *a,
                            const struct minmax_cache_key *b)
 {
    return (a->offset == b->offset) && (a->count == b->count) &&
-          (a->index_size == b->index_size);
+          (a->index_size == b->index_size) && (a->restart == b->restart) &&
+          (a->restart_index == b->restart_index);
 }
 
 
@@ -72,6 +234,181 @@ vbo_minmax_cache_delete_entry(struct hash_entry *entry)
 }
 
 
+static void
+vbo_minmax_tree_destroy(struct vbo_minmax_tree *tree)
+{
+   if (!tree)
+      return;
+
+   for (unsigned l = 0; l < tree->num_levels; l++) {
+      free(tree->levels[l].nodes);
+      free(tree->levels[l].valid);
+   }
+   free(tree);
+}
+
+
+static struct vbo_minmax_tree *
+vbo_minmax_tree_create(unsigned index_size, unsigned num_indices)
+{
+   struct vbo_minmax_tree *tree = CALLOC_STRUCT(vbo_minmax_tree);
+   unsigned num_nodes;
+
+   if (!tree)
+      return NULL;
+
+   tree->index_size = index_size;
+   tree->num_indices = num_indices;
+
+   num_nodes = DIV_ROUND_UP(num_indices, 1u << MINMAX_TREE_LEAF_SHIFT);
+   for (;;) {
+      struct minmax_tree_level *level = &tree->levels[tree->num_levels++];
+
+      level->num_nodes = num_nodes;
+      level->nodes = malloc(num_nodes * sizeof(*level->nodes));
+      level->valid = calloc(BITSET_WORDS(num_nodes), sizeof(BITSET_WORD));
+      if (!level->nodes || !level->valid) {
+         vbo_minmax_tree_destroy(tree);
+         return NULL;
+      }
+
+      if (num_nodes == 1 || tree->num_levels == MINMAX_TREE_MAX_LEVELS)
+         break;
+      num_nodes = DIV_ROUND_UP(num_nodes, 1u << MINMAX_TREE_FANOUT_SHIFT);
+   }
+
+   return tree;
+}
+
+
+static unsigned
+vbo_minmax_tree_shift(unsigned level)
+{
+   return MINMAX_TREE_LEAF_SHIFT + level * MINMAX_TREE_FANOUT_SHIFT;
+}
+
+
+/** Forget the nodes that cover indices [start, end). */
+static void
+vbo_minmax_tree_invalidate(struct vbo_minmax_tree *tree,
+                           unsigned start, unsigned end)
+{
+   end = MIN2(end, tree->num_indices);
+   if (start >= end)
+      return;
+
+   for (unsigned l = 0; l < tree->num_levels; l++) {
+      const unsigned shift = vbo_minmax_tree_shift(l);
+      const unsigned last = (end - 1) >> shift;
+
+      for (unsigned n = start >> shift; n <= last; n++)
+         BITSET_CLEAR(tree->levels[l].valid, n);
+   }
+}
+
+
+static void
+vbo_minmax_tree_scan(const struct minmax_scan *scan, unsigned start,
+                     unsigned end, GLuint *min_index, GLuint *max_index)
+{
+   vbo_scan_minmax(scan->indices + (start - scan->first) * scan->index_size,
+                   scan->index_size, end - start, scan->restart,
+                   scan->restart_index, min_index, max_index);
+}
+
+
+static void
+vbo_minmax_tree_node(struct vbo_minmax_tree *tree,
+                     const struct minmax_scan *scan, unsigned l, unsigned n,
+                     GLuint *min_index, GLuint *max_index)
+{
+   struct minmax_tree_level *level = &tree->levels[l];
+   struct minmax_tree_node *node = &level->nodes[n];
+
+   if (!BITSET_TEST(level->valid, n)) {
+      if (l == 0) {
+         const unsigned start = n << MINMAX_TREE_LEAF_SHIFT;
+         const unsigned end = MIN2(start + (1u << MINMAX_TREE_LEAF_SHIFT),
+                                   tree->num_indices);
+
+         vbo_minmax_tree_scan(scan, start, end, &node->min, &node->max);
+      } else {
+         const unsigned first = n << MINMAX_TREE_FANOUT_SHIFT;
+         const unsigned last = MIN2(first + (1u << MINMAX_TREE_FANOUT_SHIFT),
+                                    tree->levels[l - 1].num_nodes);
+
+         node->min = ~0U;
+         node->max = 0;
+         for (unsigned c = first; c < last; c++) {
+            GLuint min, max;
+
+            vbo_minmax_tree_node(tree, scan, l - 1, c, &min, &max);
+            node->min = MIN2(node->min, min);
+            node->max = MAX2(node->max, max);
+         }
+      }
+      BITSET_SET(level->valid, n);
+   }
+
+   *min_index = node->min;
+   *max_index = node->max;
+}
+
+
+/**
+ * Min and max of indices [start, end), from the nodes of level \p l and
+ * below that lie within the range, and from the index data for the rest.
+ */
+static void
+vbo_minmax_tree_query(struct vbo_minmax_tree *tree,
+                      const struct minmax_scan *scan, unsigned l,
+                      unsigned start, unsigned end,
+                      GLuint *min_index, GLuint *max_index)
+{
+   const unsigned shift = vbo_minmax_tree_shift(l);
+   const unsigned first_node = ((uint64_t) start + (1ull << shift) - 1) >> shift;
+   const unsigned end_node = end == tree->num_indices ?
+      tree->levels[l].num_nodes : end >> shift;
+   GLuint min = ~0U, max = 0;
+   GLuint tmp_min, tmp_max;
+
+   if (first_node >= end_node) {
+      if (l == 0)
+         vbo_minmax_tree_scan(scan, start, end, min_index, max_index);
+      else
+         vbo_minmax_tree_query(tree, scan, l - 1, start, end,
+                               min_index, max_index);
+      return;
+   }
+
+   const unsigned nodes_start = first_node << shift;
+   const unsigned nodes_end = MIN2((uint64_t) end_node << shift, end);
+
+   if (start < nodes_start) {
+      vbo_minmax_tree_query(tree, scan, l, start, nodes_start,
+                            &tmp_min, &tmp_max);
+      min = MIN2(min, tmp_min);
+      max = MAX2(max, tmp_max);
+   }
+
+   for (unsigned n = first_node; n < end_node; n++) {
+      vbo_minmax_tree_node(tree, scan, l, n, &tmp_min, &tmp_max);
+      min = MIN2(min, tmp_min);
+      max = MAX2(max, tmp_max);
+   }
+
+   if (nodes_end < end) {
+      vbo_minmax_tree_query(tree, scan, l, nodes_end, end,
+                            &tmp_min, &tmp_max);
+      min = MIN2(min, tmp_min);
+      max = MAX2(max, tmp_max);
+   }
+
+   *min_index = min;
+   *max_index = max;
+}
+
+
 static GLboolean
 vbo_use_minmax_cache(struct gl_buffer_object *bufferObj)
 {
@@ -97,12 +434,119 @@ vbo_delete_minmax_cache(struct gl_buffer_object *bufferObj)
 {
    _mesa_hash_table_destroy(bufferObj->MinMaxCache, vbo_minmax_cache_delete_entry);
    bufferObj->MinMaxCache = NULL;
+
+   for (unsigned i = 0; i < ARRAY_SIZE(bufferObj->MinMaxTree); i++) {
+      vbo_minmax_tree_destroy(bufferObj->MinMaxTree[i]);
+      bufferObj->MinMaxTree[i] = NULL;
+   }
+}
+
+
+/**
+ * Drop whatever overlaps the range written since the last lookup.  Must be
+ * called with the cache mutex held.
+ */
+static void
+vbo_minmax_cache_validate(struct gl_buffer_object *bufferObj)
+{
+   if (!bufferObj->MinMaxCacheDirty)
+      return;
+
+   const GLintptr start = bufferObj->MinMaxCacheDirtyStart;
+   const GLintptr end = bufferObj->MinMaxCacheDirtyEnd;
+
+   if (bufferObj->MinMaxCache) {
+      hash_table_foreach(bufferObj->MinMaxCache, entry) {
+         const struct minmax_cache_key *key = entry->key;
+
+         if (key->offset < end &&
+             key->offset + (GLintptr) key->count * key->index_size > start) {
+            free(entry->data);
+            _mesa_hash_table_remove(bufferObj->MinMaxCache, entry);
+         }
+      }
+   }
+
+   for (unsigned i = 0; i < ARRAY_SIZE(bufferObj->MinMaxTree); i++) {
+      struct vbo_minmax_tree *tree = bufferObj->MinMaxTree[i];
+
+      if (!tree)
+         continue;
+
+      /* The buffer was reallocated. */
+      if (tree->num_indices != bufferObj->Size / tree->index_size) {
+         vbo_minmax_tree_destroy(tree);
+         bufferObj->MinMaxTree[i] = NULL;
+         continue;
+      }
+
+      vbo_minmax_tree_invalidate(tree, start / tree->index_size,
+                                 DIV_ROUND_UP(end, tree->index_size));
+   }
+
+   bufferObj->MinMaxCacheDirty = false;
+}
+
+
+/**
+ * Get the tree for \p index_size and the given restart index, creating it
+ * if needed.  Must be called with the cache mutex held.
+ */
+static struct vbo_minmax_tree *
+vbo_get_minmax_tree(struct gl_buffer_object *bufferObj, unsigned index_size,
+                    bool restart, unsigned restart_index)
+{
+   const unsigned num_indices = bufferObj->Size / index_size;
+   struct vbo_minmax_tree **tree =
+      &bufferObj->MinMaxTree[util_logbase2(index_size)];
+
+   if (*tree && (*tree)->num_indices != num_indices) {
+      vbo_minmax_tree_destroy(*tree);
+      *tree = NULL;
+   }
+
+   if (!*tree) {
+      *tree = vbo_minmax_tree_create(index_size, num_indices);
+      if (!*tree)
+         return NULL;
+      (*tree)->restart = restart;
+      (*tree)->restart_index = restart_index;
+   }
+
+   /* Toggling primitive restart changes every node. */
+   if ((*tree)->restart != restart ||
+       (restart && (*tree)->restart_index != restart_index)) {
+      for (unsigned l = 0; l < (*tree)->num_levels; l++) {
+         memset((*tree)->levels[l].valid, 0,
+                BITSET_WORDS((*tree)->levels[l].num_nodes) *
+                sizeof(BITSET_WORD));
+      }
+      (*tree)->restart = restart;
+      (*tree)->restart_index = restart_index;
+   }
+
+   return *tree;
+}
+
+
+static void
+vbo_minmax_cache_init_key(struct minmax_cache_key *key, unsigned index_size,
+                          GLintptr offset, GLuint count, bool restart,
+                          unsigned restart_index)
+{
+   memset(key, 0, sizeof(*key));
+   key->offset = offset;
+   key->count = count;
+   key->index_size = index_size;
+   key->restart = restart;
+   key->restart_index = restart ? restart_index : 0;
 }
 
 
 static GLboolean
 vbo_get_minmax_cached(struct gl_buffer_object *bufferObj,
                       unsigned index_size, GLintptr offset, GLuint count,
+                      bool restart, unsigned restart_index,
                       GLuint *min_index, GLuint *max_index)
 {
    GLboolean found = GL_FALSE;
@@ -117,30 +561,10 @@ vbo_get_minmax_cached(struct gl_buffer_object *bufferObj,
 
    simple_mtx_lock(&bufferObj->MinMaxCacheMutex);
 
-   if (bufferObj->MinMaxCacheDirty) {
-      /* Disable the cache permanently for this BO if the number of hits
-       * is asymptotically less than the number of misses. This happens when
-       * applications use the BO for streaming.
-       *
-       * However, some initial optimism allows applications that interleave
-       * draw calls with glBufferSubData during warmup.
-       */
-      unsigned optimism = bufferObj->Size;
-      if (bufferObj->MinMaxCacheMissIndices > optimism &&
-          bufferObj->MinMaxCacheHitIndices < bufferObj->MinMaxCacheMissIndices - optimism) {
-         bufferObj->UsageHistory |= USAGE_DISABLE_MINMAX_CACHE;
-         vbo_delete_minmax_cache(bufferObj);
-         goto out_disable;
-      }
+   vbo_minmax_cache_validate(bufferObj);
 
-      _mesa_hash_table_clear(bufferObj->MinMaxCache, vbo_minmax_cache_delete_entry);
-      bufferObj->MinMaxCacheDirty = false;
-      goto out_invalidate;
-   }
-
-   key.index_size = index_size;
-   key.offset = offset;
-   key.count = count;
+   vbo_minmax_cache_init_key(&key, index_size, offset, count, restart,
+                             restart_index);
    hash = vbo_minmax_cache_hash(&key);
    result = _mesa_hash_table_search_pre_hashed(bufferObj->MinMaxCache, hash, &key);
    if (result) {
@@ -150,22 +574,6 @@ vbo_get_minmax_cached(struct gl_buffer_object *bufferObj,
       found = GL_TRUE;
    }
 
-out_invalidate:
-   if (found) {
-      /* The hit counter saturates so that we don't accidently disable the
-       * cache in a long-running program.
-       */
-      unsigned new_hit_count = bufferObj->MinMaxCacheHitIndices + count;
-
-      if (new_hit_count >= bufferObj->MinMaxCacheHitIndices)
-         bufferObj->MinMaxCacheHitIndices = new_hit_count;
-      else
-         bufferObj->MinMaxCacheHitIndices = ~(unsigned)0;
-   } else {
-      bufferObj->MinMaxCacheMissIndices += count;
-   }
-
-out_disable:
    simple_mtx_unlock(&bufferObj->MinMaxCacheMutex);
    return found;
 }
@@ -175,33 +583,31 @@ static void
 vbo_minmax_cache_store(struct gl_context *ctx,
                        struct gl_buffer_object *bufferObj,
                        unsigned index_size, GLintptr offset, GLuint count,
+                       bool restart, unsigned restart_index,
                        GLuint min, GLuint max)
 {
    struct minmax_cache_entry *entry;
    struct hash_entry *table_entry;
    uint32_t hash;
 
-   if (!vbo_use_minmax_cache(bufferObj))
-      return;
-
-   simple_mtx_lock(&bufferObj->MinMaxCacheMutex);
-
    if (!bufferObj->MinMaxCache) {
       bufferObj->MinMaxCache =
          _mesa_hash_table_create(NULL,
                                  (uint32_t (*)(const void *))vbo_minmax_cache_hash,
                                  (bool (*)(const void *, const void *))vbo_minmax_cache_key_equal);
       if (!bufferObj->MinMaxCache)
-         goto out;
+         return;
    }
 
+   if (bufferObj->MinMaxCache->entries >= MINMAX_CACHE_MAX_ENTRIES)
+      _mesa_hash_table_clear(bufferObj->MinMaxCache, vbo_minmax_cache_delete_entry);
+
    entry = MALLOC_STRUCT(minmax_cache_entry);
    if (!entry)
-      goto out;
+      return;
 
-   entry->key.offset = offset;
-   entry->key.count = count;
-   entry->key.index_size = index_size;
+   vbo_minmax_cache_init_key(&entry->key, index_size, offset, count, restart,
+                             restart_index);
    entry->min = min;
    entry->max = max;
    hash = vbo_minmax_cache_hash(&entry->key);
@@ -214,15 +620,65 @@ vbo_minmax_cache_store(struct gl_context *ctx,
        */
       _mesa_debug(ctx, "duplicate entry in minmax cache\n");
       free(entry);
-      goto out;
+      return;
    }
 
    table_entry = _mesa_hash_table_insert_pre_hashed(bufferObj->MinMaxCache,
                                                     hash, &entry->key, entry);
    if (!table_entry)
       free(entry);
+}
+
+
+/**
+ * Compute min and max of \p count indices mapped from \p offset of the
+ * buffer, through the buffer's tree when the range lies within the buffer,
+ * and remember the result for the exact range.
+ */
+static void
+vbo_get_minmax_uncached(struct gl_context *ctx,
+                        struct gl_buffer_object *bufferObj,
+                        const void *indices, unsigned index_size,
+                        GLintptr offset, GLuint count,
+                        bool restart, unsigned restart_index,
+                        GLuint *min_index, GLuint *max_index)
+{
+   struct vbo_minmax_tree *tree = NULL;
+
+   if (!vbo_use_minmax_cache(bufferObj)) {
+      vbo_scan_minmax(indices, index_size, count, restart, restart_index,
+                      min_index, max_index);
+      return;
+   }
+
+   simple_mtx_lock(&bufferObj->MinMaxCacheMutex);
+
+   vbo_minmax_cache_validate(bufferObj);
+
+   if (count && offset % index_size == 0 &&
+       offset + (GLsizeiptr) count * index_size <= bufferObj->Size)
+      tree = vbo_get_minmax_tree(bufferObj, index_size, restart,
+                                 restart_index);
+
+   if (tree) {
+      const struct minmax_scan scan = {
+         .indices = indices,
+         .first = offset / index_size,
+         .index_size = index_size,
+         .restart = restart,
+         .restart_index = restart_index,
+      };
+
+      vbo_minmax_tree_query(tree, &scan, tree->num_levels - 1, scan.first,
+                            scan.first + count, min_index, max_index);
+   } else {
+      vbo_scan_minmax(indices, index_size, count, restart, restart_index,
+                      min_index, max_index);
+   }
+
+   vbo_minmax_cache_store(ctx, bufferObj, index_size, offset, count,
+                          restart, restart_index, *min_index, *max_index);
 
-out:
    simple_mtx_unlock(&bufferObj->MinMaxCacheMutex);
 }
 
@@ -244,105 +700,31 @@ vbo_get_minmax_index(struct gl_context *ctx,
    const GLuint restartIndex =
       _mesa_primitive_restart_index(ctx, ib->index_size);
    const char *indices;
-   GLuint i;
-   GLintptr offset = 0;
+   GLintptr offset;
+   GLsizeiptr size;
 
    indices = (char *) ib->ptr + prim->start * ib->index_size;
-   if (_mesa_is_bufferobj(ib->obj)) {
-      GLsizeiptr size = MIN2(count * ib->index_size, ib->obj->Size);
+   if (!_mesa_is_bufferobj(ib->obj)) {
+      vbo_scan_minmax(indices, ib->index_size, count, restart, restartIndex,
+                      min_index, max_index);
+      return;
+   }
 
-      if (vbo_get_minmax_cached(ib->obj, ib->index_size, (GLintptr) indices,
-                                count, min_index, max_index))
-         return;
+   offset = (GLintptr) indices;
+   if (vbo_get_minmax_cached(ib->obj, ib->index_size, offset, count,
+                             restart, restartIndex, min_index, max_index))
+      return;
 
-      offset = (GLintptr) indices;
-      indices = ctx->Driver.MapBufferRange(ctx, offset, size,
-                                           GL_MAP_READ_BIT, ib->obj,
-                                           MAP_INTERNAL);
-   }
+   size = MIN2(count * ib->index_size, ib->obj->Size);
+   indices = ctx->Driver.MapBufferRange(ctx, offset, size,
+                                        GL_MAP_READ_BIT, ib->obj,
+                                        MAP_INTERNAL);
 
-   switch (ib->index_size) {
-   case 4: {
-      const GLuint *ui_indices = (const GLuint *)indices;
-      GLuint max_ui = 0;
-      GLuint min_ui = ~0U;
-      if (restart) {
-         for (i = 0; i < count; i++) {
-            if (ui_indices[i] != restartIndex) {
-               if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
-               if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
-            }
-         }
-      }
-      else {
-#if defined(USE_SSE41)
-         if (cpu_has_sse4_1) {
-            _mesa_uint_array_min_max(ui_indices, &min_ui, &max_ui, count);
-         }
-         else
-#endif
-            for (i = 0; i < count; i++) {
-               if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
-               if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
-            }
-      }
-      *min_index = min_ui;
-      *max_index = max_ui;
-      break;
-   }
-   case 2: {
-      const GLushort *us_indices = (const GLushort *)indices;
-      GLuint max_us = 0;
-      GLuint min_us = ~0U;
-      if (restart) {
-         for (i = 0; i < count; i++) {
-            if (us_indices[i] != restartIndex) {
-               if (us_indices[i] > max_us) max_us = us_indices[i];
-               if (us_indices[i] < min_us) min_us = us_indices[i];
-            }
-         }
-      }
-      else {
-         for (i = 0; i < count; i++) {
-            if (us_indices[i] > max_us) max_us = us_indices[i];
-            if (us_indices[i] < min_us) min_us = us_indices[i];
-         }
-      }
-      *min_index = min_us;
-      *max_index = max_us;
-      break;
-   }
-   case 1: {
-      const GLubyte *ub_indices = (const GLubyte *)indices;
-      GLuint max_ub = 0;
-      GLuint min_ub = ~0U;
-      if (restart) {
-         for (i = 0; i < count; i++) {
-            if (ub_indices[i] != restartIndex) {
-               if (ub_indices[i] > max_ub) max_ub = ub_indices[i];
-               if (ub_indices[i] < min_ub) min_ub = ub_indices[i];
-            }
-         }
-      }
-      else {
-         for (i = 0; i < count; i++) {
-            if (ub_indices[i] > max_ub) max_ub = ub_indices[i];
-            if (ub_indices[i] < min_ub) min_ub = ub_indices[i];
-         }
-      }
-      *min_index = min_ub;
-      *max_index = max_ub;
-      break;
-   }
-   default:
-      unreachable("not reached");
-   }
+   vbo_get_minmax_uncached(ctx, ib->obj, indices, ib->index_size, offset,
+                           count, restart, restartIndex,
+                           min_index, max_index);
 
-   if (_mesa_is_bufferobj(ib->obj)) {
-      vbo_minmax_cache_store(ctx, ib->obj, ib->index_size, offset,
-                             count, *min_index, *max_index);
-      ctx->Driver.UnmapBuffer(ctx, ib->obj, MAP_INTERNAL);
-   }
+   ctx->Driver.UnmapBuffer(ctx, ib->obj, MAP_INTERNAL);
 }
 
 /**
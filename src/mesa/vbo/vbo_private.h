@@ -178,6 +178,17 @@ vbo_can_merge_prims(const struct _mesa_prim *p0, const struct _mesa_prim *p1);
 void
 vbo_merge_prims(struct _mesa_prim *p0, const struct _mesa_prim *p1);
 
+GLenum
+vbo_get_merged_prim(const struct _mesa_prim *prims, GLuint nr_prims,
+                    GLuint *count, GLuint *max_index);
+
+unsigned
+vbo_emit_merged_indices(const struct _mesa_prim *prims, GLuint nr_prims,
+                        GLuint count, GLuint max_index, GLuint *indices);
+
+bool
+vbo_can_draw_merged_prim(const struct gl_context *ctx, GLenum mode);
+
 
 /**
  * Get the filter mask for vbo draws depending on the vertex_processing_mode.
@@ -75,6 +75,15 @@ struct vbo_save_vertex_list {
    GLuint prim_count;
 
    struct vbo_save_primitive_store *prim_store;
+
+   /* The prims above converted at compile time to a single indexed
+    * GL_LINES or GL_TRIANGLES draw, with the indices stored after the
+    * vertices in the vertex store.  merged_prim.count is zero if the prims
+    * weren't converted.  The original prims are still drawn when the
+    * conversion would be visible, see vbo_can_draw_merged_prim().
+    */
+   struct _mesa_prim merged_prim;
+   struct _mesa_index_buffer merged_ib;
 };
 
 
@@ -412,6 +412,73 @@ convert_line_loop_to_strip(struct vbo_save_context *save,
 }
 
 
+/**
+ * Convert the prims of a vertex list to a single indexed draw of separate
+ * lines or triangles, if vbo_get_merged_prim() thinks that is worth it.
+ * Quads and polygons are then split once here rather than by the driver
+ * every time the list is drawn, and runs of strips and fans become one
+ * draw call.
+ *
+ * The indices are stored in the vertex store right after the vertices,
+ * padded to a whole number of vertices so that the next vertex list can
+ * still share the VAO.
+ */
+static void
+merge_vertex_list_prims(struct gl_context *ctx,
+                        struct vbo_save_vertex_list *node)
+{
+   struct vbo_save_context *save = &vbo_context(ctx)->save;
+   struct vbo_save_vertex_store *store = save->vertex_store;
+   GLuint count, max_index;
+
+   memset(&node->merged_prim, 0, sizeof(node->merged_prim));
+   memset(&node->merged_ib, 0, sizeof(node->merged_ib));
+
+   if (!save->vertex_size)
+      return;
+
+   const GLenum mode = vbo_get_merged_prim(node->prims, node->prim_count,
+                                           &count, &max_index);
+   if (mode == GL_NONE)
+      return;
+
+   const unsigned max_index_size = max_index <= 0xffff ? 2 : 4;
+   const GLuint index_words =
+      DIV_ROUND_UP(DIV_ROUND_UP(count * max_index_size, sizeof(GLfloat)),
+                   save->vertex_size) * save->vertex_size;
+
+   if (store->used + index_words > VBO_SAVE_BUFFER_SIZE)
+      return;
+
+   GLuint *indices = malloc(count * sizeof(GLuint));
+   if (!indices)
+      return;
+
+   const unsigned index_size =
+      vbo_emit_merged_indices(node->prims, node->prim_count, count,
+                              max_index, indices);
+   assert(index_size == max_index_size);
+   memcpy(store->buffer_map + store->used, indices, count * index_size);
+   free(indices);
+
+   node->merged_prim.mode = mode;
+   node->merged_prim.indexed = 1;
+   node->merged_prim.begin = 1;
+   node->merged_prim.end = 1;
+   node->merged_prim.start = 0;
+   node->merged_prim.count = count;
+   node->merged_prim.num_instances = 1;
+
+   node->merged_ib.count = count;
+   node->merged_ib.index_size = index_size;
+   node->merged_ib.ptr = (const void *) (uintptr_t)
+      (store->used * sizeof(GLfloat));
+   _mesa_reference_buffer_object(ctx, &node->merged_ib.obj, store->bufferobj);
+
+   store->used += index_words;
+}
+
+
 /* Compare the present vao if it has the same setup. */
 static bool
 compare_vao(gl_vertex_processing_mode mode,
@@ -653,6 +720,8 @@ compile_vertex_list(struct gl_context *ctx)
       node->prims[i].start += start_offset;
    }
 
+   merge_vertex_list_prims(ctx, node);
+
    /* Deal with GL_COMPILE_AND_EXECUTE:
     */
    if (ctx->ExecuteFlag) {
@@ -1244,12 +1313,25 @@ _save_End(void)
 {
    GET_CURRENT_CONTEXT(ctx);
    struct vbo_save_context *save = &vbo_context(ctx)->save;
-   const GLint i = save->prim_count - 1;
+   GLint i = save->prim_count - 1;
 
    ctx->Driver.CurrentSavePrimitive = PRIM_OUTSIDE_BEGIN_END;
    save->prims[i].end = 1;
    save->prims[i].count = (save->vert_count - save->prims[i].start);
 
+   /* Merge with the previous primitive right away, rather than when the
+    * vertex list is compiled, so that many short glBegin/End pairs don't
+    * fill up the primitive store and split the list into many draws.
+    */
+   if (i > 0) {
+      vbo_try_prim_conversion(&save->prims[i]);
+      if (vbo_can_merge_prims(&save->prims[i - 1], &save->prims[i])) {
+         vbo_merge_prims(&save->prims[i - 1], &save->prims[i]);
+         save->prim_count--;
+         i--;
+      }
+   }
+
    if (i == (GLint) save->prim_max - 1) {
       compile_vertex_list(ctx);
       assert(save->copied.nr == 0);
@@ -1856,6 +1938,8 @@ vbo_destroy_vertex_list(struct gl_context *ctx, void *data)
    if (--node->prim_store->refcount == 0)
       free(node->prim_store);
 
+   _mesa_reference_buffer_object(ctx, &node->merged_ib.obj, NULL);
+
    free(node->current_data);
    node->current_data = NULL;
 }
@@ -1885,6 +1969,12 @@ vbo_print_vertex_list(struct gl_context *ctx, void *data, FILE *f)
              (prim->begin) ? "BEGIN" : "(wrap)",
              (prim->end) ? "END" : "(wrap)");
    }
+
+   if (node->merged_prim.count) {
+      fprintf(f, "   drawn as indexed %s, %u indices\n",
+              _mesa_lookup_prim_by_nr(node->merged_prim.mode),
+              node->merged_prim.count);
+   }
 }
 
 
@@ -1037,6 +1037,13 @@ disk_cache_put(struct disk_cache *cache, const cache_key key,
    }
 }
 
+void
+disk_cache_wait_for_idle(struct disk_cache *cache)
+{
+   if (!cache->path_init_failed)
+      util_queue_finish(&cache->cache_queue);
+}
+
 /**
  * Decompresses cache entry, returns true if successful.
  */
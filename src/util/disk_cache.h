@@ -194,6 +194,12 @@ disk_cache_put(struct disk_cache *cache, const cache_key key,
                const void *data, size_t size,
                struct cache_item_metadata *cache_item_metadata);
 
+/**
+ * Wait until all items passed to disk_cache_put() have been written.
+ */
+void
+disk_cache_wait_for_idle(struct disk_cache *cache);
+
 /**
  * Retrieve an item previously stored in the cache with the name <key>.
  *
@@ -274,6 +280,12 @@ disk_cache_remove(struct disk_cache *cache, const cache_key key)
    return;
 }
 
+static inline void
+disk_cache_wait_for_idle(struct disk_cache *cache)
+{
+   return;
+}
+
 static inline uint8_t *
 disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
 {
@@ -0,0 +1,214 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * Control byte helpers shared by the open-addressing hash table and set.
+ *
+ * Each slot of the table has a one byte control word alongside it.  A full
+ * slot stores the low 7 bits of the key's hash in its control byte while
+ * free slots use values with the high bit set.  Slots are probed in groups
+ * of HASH_GROUP_WIDTH control bytes so that a single SIMD compare can find
+ * every candidate slot in the group, and only candidates whose control byte
+ * matches get their cached hash and key compared.
+ *
+ * Tables are always a power of two in size.  Tables smaller than a group
+ * pad their control array out to a full group with HASH_CTRL_SENTINEL, which
+ * never matches a lookup, an empty slot or a deleted slot.
+ */
+
+#ifndef _HASH_GROUP_H
+#define _HASH_GROUP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define HASH_GROUP_WIDTH 16
+
+#define HASH_CTRL_EMPTY    ((uint8_t)0x80)
+#define HASH_CTRL_DELETED  ((uint8_t)0xfe)
+#define HASH_CTRL_SENTINEL ((uint8_t)0xff)
+
+/** Smallest table size handed out by hash_ctrl_size_for_entries(). */
+#define HASH_CTRL_MIN_SIZE 8
+
+static inline uint8_t
+hash_ctrl_h2(uint32_t hash)
+{
+   return hash & 0x7f;
+}
+
+static inline bool
+hash_ctrl_is_full(uint8_t ctrl)
+{
+   return ctrl < 0x80;
+}
+
+/**
+ * Maximum number of live plus deleted slots before the table has to be
+ * rehashed.  This keeps the load at or below 7/8 and always leaves at least
+ * one empty slot so that probe sequences terminate.
+ */
+static inline uint32_t
+hash_ctrl_max_entries(uint32_t size)
+{
+   return size - (size / 8 > 0 ? size / 8 : 1);
+}
+
+/** Returns the smallest table size that can hold @entries entries. */
+static inline uint32_t
+hash_ctrl_size_for_entries(uint32_t entries)
+{
+   uint32_t size = HASH_CTRL_MIN_SIZE;
+
+   while (hash_ctrl_max_entries(size) < entries)
+      size *= 2;
+
+   return size;
+}
+
+/** Number of control bytes allocated for a table with @size slots. */
+static inline uint32_t
+hash_ctrl_bytes(uint32_t size)
+{
+   return size < HASH_GROUP_WIDTH ? HASH_GROUP_WIDTH : size;
+}
+
+static inline uint32_t
+hash_ctrl_num_groups(uint32_t size)
+{
+   return hash_ctrl_bytes(size) / HASH_GROUP_WIDTH;
+}
+
+/** Resets a control array of a table with @size slots to all-empty. */
+static inline void
+hash_ctrl_reset(uint8_t *ctrl, uint32_t size)
+{
+   memset(ctrl, HASH_CTRL_EMPTY, size);
+   if (size < HASH_GROUP_WIDTH)
+      memset(ctrl + size, HASH_CTRL_SENTINEL, HASH_GROUP_WIDTH - size);
+}
+
+/**
+ * Returns the first group to probe for @hash.
+ *
+ * The low bits of the hash end up in the control byte, so the group is
+ * picked from a multiplicative mix of the whole hash instead.  This also
+ * copes better with weak hash functions like _mesa_hash_pointer().
+ */
+static inline uint32_t
+hash_group_first(uint32_t hash, uint32_t num_groups)
+{
+   uint32_t mixed = hash * 0x9e3779b1u;
+   return (uint32_t)(((uint64_t)mixed * num_groups) >> 32);
+}
+
+/**
+ * Returns the group probed after @group on probe step @step (starting at 1).
+ *
+ * This is triangular probing, which visits every group exactly once when the
+ * number of groups is a power of two.
+ */
+static inline uint32_t
+hash_group_next(uint32_t group, uint32_t step, uint32_t num_groups)
+{
+   return (group + step) & (num_groups - 1);
+}
+
+#ifdef __SSE2__
+
+static inline uint32_t
+hash_group_match(const uint8_t *group, uint8_t h2)
+{
+   __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+   return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(h2)));
+}
+
+static inline uint32_t
+hash_group_match_empty(const uint8_t *group)
+{
+   __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+   return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl,
+                                           _mm_set1_epi8(HASH_CTRL_EMPTY)));
+}
+
+static inline uint32_t
+hash_group_match_empty_or_deleted(const uint8_t *group)
+{
+   /* EMPTY and DELETED are the only control values below SENTINEL when
+    * interpreted as signed bytes.
+    */
+   __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+   return _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(HASH_CTRL_SENTINEL),
+                                           ctrl));
+}
+
+#else
+
+static inline uint32_t
+hash_group_match(const uint8_t *group, uint8_t h2)
+{
+   uint32_t mask = 0;
+   for (unsigned i = 0; i < HASH_GROUP_WIDTH; i++)
+      mask |= (uint32_t)(group[i] == h2) << i;
+   return mask;
+}
+
+static inline uint32_t
+hash_group_match_empty(const uint8_t *group)
+{
+   return hash_group_match(group, HASH_CTRL_EMPTY);
+}
+
+static inline uint32_t
+hash_group_match_empty_or_deleted(const uint8_t *group)
+{
+   uint32_t mask = 0;
+   for (unsigned i = 0; i < HASH_GROUP_WIDTH; i++) {
+      mask |= (uint32_t)(group[i] == HASH_CTRL_EMPTY ||
+                         group[i] == HASH_CTRL_DELETED) << i;
+   }
+   return mask;
+}
+
+#endif
+
+/**
+ * Returns the control value a slot should get when its entry is removed.
+ *
+ * Lookups stop at the first group that contains an empty slot, so if the
+ * slot's group already has one, no probe sequence can run through this group
+ * and the slot can be made empty again instead of leaving a tombstone.
+ */
+static inline uint8_t
+hash_ctrl_for_removed_slot(const uint8_t *ctrl, uint32_t slot)
+{
+   const uint8_t *group = ctrl + (slot & ~(HASH_GROUP_WIDTH - 1));
+   return hash_group_match_empty(group) ? HASH_CTRL_EMPTY : HASH_CTRL_DELETED;
+}
+
+#endif /* _HASH_GROUP_H */
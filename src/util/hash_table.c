@@ -33,11 +33,12 @@
  */
 
 /**
- * Implements an open-addressing, linear-reprobing hash table.
+ * Implements an open-addressing hash table with power-of-two sizes.
  *
- * For more information, see:
- *
- * http://cgit.freedesktop.org/~anholt/hash_table/tree/README
+ * Every slot has a control byte holding 7 bits of the key's hash, and slots
+ * are probed a group of control bytes at a time (see hash_group.h).  The full
+ * hash is cached in the entry so that the key comparison callback is only
+ * called for entries whose hash matches.
  */
 
 #include <stdlib.h>
@@ -47,79 +48,44 @@
 #include "hash_table.h"
 #include "ralloc.h"
 #include "macros.h"
-#include "main/hash.h"
-#include "fast_urem_by_const.h"
+#include "u_atomic.h"
+#include "hash_group.h"
+#include "bitscan.h"
 
 static const uint32_t deleted_key_value;
 
-/**
- * From Knuth -- a good choice for hash/rehash values is p, p-2 where
- * p and p-2 are both prime.  These tables are sized to have an extra 10%
- * free to avoid exponential performance degradation as the hash table fills
- */
-static const struct {
-   uint32_t max_entries, size, rehash;
-   uint64_t size_magic, rehash_magic;
-} hash_sizes[] = {
-#define ENTRY(max_entries, size, rehash) \
-   { max_entries, size, rehash, \
-      REMAINDER_MAGIC(size), REMAINDER_MAGIC(rehash) }
-
-   ENTRY(2,            5,            3            ),
-   ENTRY(4,            7,            5            ),
-   ENTRY(8,            13,           11           ),
-   ENTRY(16,           19,           17           ),
-   ENTRY(32,           43,           41           ),
-   ENTRY(64,           73,           71           ),
-   ENTRY(128,          151,          149          ),
-   ENTRY(256,          283,          281          ),
-   ENTRY(512,          571,          569          ),
-   ENTRY(1024,         1153,         1151         ),
-   ENTRY(2048,         2269,         2267         ),
-   ENTRY(4096,         4519,         4517         ),
-   ENTRY(8192,         9013,         9011         ),
-   ENTRY(16384,        18043,        18041        ),
-   ENTRY(32768,        36109,        36107        ),
-   ENTRY(65536,        72091,        72089        ),
-   ENTRY(131072,       144409,       144407       ),
-   ENTRY(262144,       288361,       288359       ),
-   ENTRY(524288,       576883,       576881       ),
-   ENTRY(1048576,      1153459,      1153457      ),
-   ENTRY(2097152,      2307163,      2307161      ),
-   ENTRY(4194304,      4613893,      4613891      ),
-   ENTRY(8388608,      9227641,      9227639      ),
-   ENTRY(16777216,     18455029,     18455027     ),
-   ENTRY(33554432,     36911011,     36911009     ),
-   ENTRY(67108864,     73819861,     73819859     ),
-   ENTRY(134217728,    147639589,    147639587    ),
-   ENTRY(268435456,    295279081,    295279079    ),
-   ENTRY(536870912,    590559793,    590559791    ),
-   ENTRY(1073741824,   1181116273,   1181116271   ),
-   ENTRY(2147483648ul, 2362232233ul, 2362232231ul )
-};
-
 static inline bool
 key_pointer_is_reserved(const struct hash_table *ht, const void *key)
 {
    return key == NULL || key == ht->deleted_key;
 }
 
-static int
-entry_is_free(const struct hash_entry *entry)
+/**
+ * Allocates the entry and control arrays for a table of the given size.
+ *
+ * Both live in a single allocation, with the control bytes following the
+ * entries.  On failure, the table is left untouched.
+ */
+static bool
+hash_table_alloc(struct hash_table *ht, void *mem_ctx, uint32_t size)
 {
-   return entry->key == NULL;
-}
+   struct hash_entry *table;
 
-static int
-entry_is_deleted(const struct hash_table *ht, struct hash_entry *entry)
-{
-   return entry->key == ht->deleted_key;
-}
+   table = ralloc_size(mem_ctx, size * sizeof(struct hash_entry) +
+                                hash_ctrl_bytes(size));
+   if (table == NULL)
+      return false;
 
-static int
-entry_is_present(const struct hash_table *ht, struct hash_entry *entry)
-{
-   return entry->key != NULL && entry->key != ht->deleted_key;
+   ht->table = table;
+   ht->ctrl = (uint8_t *)(table + size);
+   ht->size = size;
+   ht->num_groups = hash_ctrl_num_groups(size);
+   ht->max_entries = hash_ctrl_max_entries(size);
+   ht->entries = 0;
+   ht->deleted_entries = 0;
+   hash_ctrl_reset(ht->ctrl, size);
+
+   return true;
 }
 
 bool
@@ -129,20 +95,11 @@ _mesa_hash_table_init(struct hash_table *ht,
                       bool (*key_equals_function)(const void *a,
                                                   const void *b))
 {
-   ht->size_index = 0;
-   ht->size = hash_sizes[ht->size_index].size;
-   ht->rehash = hash_sizes[ht->size_index].rehash;
-   ht->size_magic = hash_sizes[ht->size_index].size_magic;
-   ht->rehash_magic = hash_sizes[ht->size_index].rehash_magic;
-   ht->max_entries = hash_sizes[ht->size_index].max_entries;
    ht->key_hash_function = key_hash_function;
    ht->key_equals_function = key_equals_function;
-   ht->table = rzalloc_array(mem_ctx, struct hash_entry, ht->size);
-   ht->entries = 0;
-   ht->deleted_entries = 0;
    ht->deleted_key = &deleted_key_value;
 
-   return ht->table != NULL;
+   return hash_table_alloc(ht, mem_ctx, HASH_CTRL_MIN_SIZE);
 }
 
 struct hash_table *
@@ -172,6 +129,8 @@ struct hash_table *
 _mesa_hash_table_clone(struct hash_table *src, void *dst_mem_ctx)
 {
    struct hash_table *ht;
+   size_t table_size = src->size * sizeof(struct hash_entry) +
+                       hash_ctrl_bytes(src->size);
 
    ht = ralloc(dst_mem_ctx, struct hash_table);
    if (ht == NULL)
@@ -179,13 +138,14 @@ _mesa_hash_table_clone(struct hash_table *src, void *dst_mem_ctx)
 
    memcpy(ht, src, sizeof(struct hash_table));
 
-   ht->table = ralloc_array(ht, struct hash_entry, ht->size);
+   ht->table = ralloc_size(ht, table_size);
    if (ht->table == NULL) {
       ralloc_free(ht);
       return NULL;
    }
 
-   memcpy(ht->table, src->table, ht->size * sizeof(struct hash_entry));
+   memcpy(ht->table, src->table, table_size);
+   ht->ctrl = (uint8_t *)(ht->table + ht->size);
 
    return ht;
 }
@@ -221,18 +181,13 @@ void
 _mesa_hash_table_clear(struct hash_table *ht,
                        void (*delete_function)(struct hash_entry *entry))
 {
-   struct hash_entry *entry;
-
-   for (entry = ht->table; entry != ht->table + ht->size; entry++) {
-      if (entry->key == NULL)
-         continue;
-
-      if (delete_function != NULL && entry->key != ht->deleted_key)
+   if (delete_function) {
+      hash_table_foreach(ht, entry) {
          delete_function(entry);
-
-      entry->key = NULL;
+      }
    }
 
+   hash_ctrl_reset(ht->ctrl, ht->size);
    ht->entries = 0;
    ht->deleted_entries = 0;
 }
@@ -258,27 +213,28 @@ hash_table_search(struct hash_table *ht, uint32_t hash, const void *key)
 {
    assert(!key_pointer_is_reserved(ht, key));
 
-   uint32_t size = ht->size;
-   uint32_t start_hash_address = util_fast_urem32(hash, size, ht->size_magic);
-   uint32_t double_hash = 1 + util_fast_urem32(hash, ht->rehash,
-                                               ht->rehash_magic);
-   uint32_t hash_address = start_hash_address;
+   const uint8_t h2 = hash_ctrl_h2(hash);
+   uint32_t group = hash_group_first(hash, ht->num_groups);
 
-   do {
-      struct hash_entry *entry = ht->table + hash_address;
+   for (uint32_t step = 1; step <= ht->num_groups; step++) {
+      const uint32_t base = group * HASH_GROUP_WIDTH;
+      const uint8_t *ctrl = ht->ctrl + base;
+      unsigned match = hash_group_match(ctrl, h2);
 
-      if (entry_is_free(entry)) {
-         return NULL;
-      } else if (entry_is_present(ht, entry) && entry->hash == hash) {
-         if (ht->key_equals_function(key, entry->key)) {
+      while (match) {
+         struct hash_entry *entry = ht->table + base + u_bit_scan(&match);
+
+         if (entry->hash == hash &&
+             ht->key_equals_function(key, entry->key)) {
             return entry;
          }
       }
 
-      hash_address += double_hash;
-      if (hash_address >= size)
-         hash_address -= size;
-   } while (hash_address != start_hash_address);
+      if (hash_group_match_empty(ctrl))
+         return NULL;
+
+      group = hash_group_next(group, step, ht->num_groups);
+   }
 
    return NULL;
 }
@@ -304,60 +260,44 @@ _mesa_hash_table_search_pre_hashed(struct hash_table *ht, uint32_t hash,
    return hash_table_search(ht, hash, key);
 }
 
-static struct hash_entry *
-hash_table_insert(struct hash_table *ht, uint32_t hash,
-                  const void *key, void *data);
-
 static void
 hash_table_insert_rehash(struct hash_table *ht, uint32_t hash,
                          const void *key, void *data)
 {
-   uint32_t size = ht->size;
-   uint32_t start_hash_address = util_fast_urem32(hash, size, ht->size_magic);
-   uint32_t double_hash = 1 + util_fast_urem32(hash, ht->rehash,
-                                               ht->rehash_magic);
-   uint32_t hash_address = start_hash_address;
-   do {
-      struct hash_entry *entry = ht->table + hash_address;
+   uint32_t group = hash_group_first(hash, ht->num_groups);
 
-      if (likely(entry->key == NULL)) {
+   for (uint32_t step = 1; ; step++) {
+      const uint32_t base = group * HASH_GROUP_WIDTH;
+      unsigned empty = hash_group_match_empty(ht->ctrl + base);
+
+      if (likely(empty)) {
+         const uint32_t slot = base + ffs(empty) - 1;
+         struct hash_entry *entry = ht->table + slot;
+
+         ht->ctrl[slot] = hash_ctrl_h2(hash);
          entry->hash = hash;
          entry->key = key;
          entry->data = data;
          return;
       }
 
-      hash_address += double_hash;
-      if (hash_address >= size)
-         hash_address -= size;
-   } while (true);
+      group = hash_group_next(group, step, ht->num_groups);
+   }
 }
 
 static void
-_mesa_hash_table_rehash(struct hash_table *ht, unsigned new_size_index)
+_mesa_hash_table_rehash(struct hash_table *ht, uint32_t new_size)
 {
    struct hash_table old_ht;
-   struct hash_entry *table;
 
-   if (new_size_index >= ARRAY_SIZE(hash_sizes))
-      return;
-
-   table = rzalloc_array(ralloc_parent(ht->table), struct hash_entry,
-                         hash_sizes[new_size_index].size);
-   if (table == NULL)
+   /* The table is already as large as it can get. */
+   if (new_size == 0 || new_size > (1u << 31))
       return;
 
    old_ht = *ht;
 
-   ht->table = table;
-   ht->size_index = new_size_index;
-   ht->size = hash_sizes[ht->size_index].size;
-   ht->rehash = hash_sizes[ht->size_index].rehash;
-   ht->size_magic = hash_sizes[ht->size_index].size_magic;
-   ht->rehash_magic = hash_sizes[ht->size_index].rehash_magic;
-   ht->max_entries = hash_sizes[ht->size_index].max_entries;
-   ht->entries = 0;
-   ht->deleted_entries = 0;
+   if (!hash_table_alloc(ht, ralloc_parent(old_ht.table), new_size))
+      return;
 
    hash_table_foreach(&old_ht, entry) {
       hash_table_insert_rehash(ht, entry->hash, entry->key, entry->data);
@@ -372,31 +312,27 @@ static struct hash_entry *
 hash_table_insert(struct hash_table *ht, uint32_t hash,
                   const void *key, void *data)
 {
-   struct hash_entry *available_entry = NULL;
+   uint32_t available_slot = UINT32_MAX;
 
    assert(!key_pointer_is_reserved(ht, key));
 
-   if (ht->entries >= ht->max_entries) {
-      _mesa_hash_table_rehash(ht, ht->size_index + 1);
-   } else if (ht->deleted_entries + ht->entries >= ht->max_entries) {
-      _mesa_hash_table_rehash(ht, ht->size_index);
+   /* Grow the table if it is at least half full of live entries, otherwise
+    * just rehash it in place to get rid of the deleted ones.
+    */
+   if (ht->entries + ht->deleted_entries >= ht->max_entries) {
+      if (ht->entries >= ht->max_entries / 2)
+         _mesa_hash_table_rehash(ht, ht->size * 2);
+      else
+         _mesa_hash_table_rehash(ht, ht->size);
    }
 
-   uint32_t size = ht->size;
-   uint32_t start_hash_address = util_fast_urem32(hash, size, ht->size_magic);
-   uint32_t double_hash = 1 + util_fast_urem32(hash, ht->rehash,
-                                               ht->rehash_magic);
-   uint32_t hash_address = start_hash_address;
-   do {
-      struct hash_entry *entry = ht->table + hash_address;
-
-      if (!entry_is_present(ht, entry)) {
-         /* Stash the first available entry we find */
-         if (available_entry == NULL)
-            available_entry = entry;
-         if (entry_is_free(entry))
-            break;
-      }
+   const uint8_t h2 = hash_ctrl_h2(hash);
+   uint32_t group = hash_group_first(hash, ht->num_groups);
+
+   for (uint32_t step = 1; step <= ht->num_groups; step++) {
+      const uint32_t base = group * HASH_GROUP_WIDTH;
+      const uint8_t *ctrl = ht->ctrl + base;
+      unsigned match = hash_group_match(ctrl, h2);
 
       /* Implement replacement when another insert happens
        * with a matching key.  This is a relatively common
@@ -409,27 +345,41 @@ hash_table_insert(struct hash_table *ht, uint32_t hash,
        * required to avoid memory leaks, perform a search
        * before inserting.
        */
-      if (!entry_is_deleted(ht, entry) &&
-          entry->hash == hash &&
-          ht->key_equals_function(key, entry->key)) {
-         entry->key = key;
-         entry->data = data;
-         return entry;
+      while (match) {
+         struct hash_entry *entry = ht->table + base + u_bit_scan(&match);
+
+         if (entry->hash == hash &&
+             ht->key_equals_function(key, entry->key)) {
+            entry->key = key;
+            entry->data = data;
+            return entry;
+         }
       }
 
-      hash_address += double_hash;
-      if (hash_address >= size)
-         hash_address -= size;
-   } while (hash_address != start_hash_address);
+      /* Stash the first available slot we find */
+      if (available_slot == UINT32_MAX) {
+         unsigned available = hash_group_match_empty_or_deleted(ctrl);
+         if (available)
+            available_slot = base + ffs(available) - 1;
+      }
+
+      if (hash_group_match_empty(ctrl))
+         break;
 
-   if (available_entry) {
-      if (entry_is_deleted(ht, available_entry))
+      group = hash_group_next(group, step, ht->num_groups);
+   }
+
+   if (available_slot != UINT32_MAX) {
+      struct hash_entry *entry = ht->table + available_slot;
+
+      if (ht->ctrl[available_slot] == HASH_CTRL_DELETED)
          ht->deleted_entries--;
-      available_entry->hash = hash;
-      available_entry->key = key;
-      available_entry->data = data;
+      ht->ctrl[available_slot] = h2;
+      entry->hash = hash;
+      entry->key = key;
+      entry->data = data;
       ht->entries++;
-      return available_entry;
+      return entry;
    }
 
    /* We could hit here if a required resize failed. An unchecked-malloc
@@ -472,9 +422,14 @@ _mesa_hash_table_remove(struct hash_table *ht,
    if (!entry)
       return;
 
+   const uint32_t slot = entry - ht->table;
+   const uint8_t ctrl = hash_ctrl_for_removed_slot(ht->ctrl, slot);
+
+   ht->ctrl[slot] = ctrl;
    entry->key = ht->deleted_key;
    ht->entries--;
-   ht->deleted_entries++;
+   if (ctrl == HASH_CTRL_DELETED)
+      ht->deleted_entries++;
 }
 
 /**
@@ -490,21 +445,18 @@ void _mesa_hash_table_remove_key(struct hash_table *ht,
  * This function is an iterator over the hash table.
  *
  * Pass in NULL for the first entry, as in the start of a for loop.  Note that
- * an iteration over the table is O(table_size) not O(entries).
+ * an iteration over the table is O(table_size) not O(entries), although only
+ * the control bytes of empty slots are touched.
  */
 struct hash_entry *
 _mesa_hash_table_next_entry(struct hash_table *ht,
                             struct hash_entry *entry)
 {
-   if (entry == NULL)
-      entry = ht->table;
-   else
-      entry = entry + 1;
+   uint32_t i = entry == NULL ? 0 : (entry - ht->table) + 1;
 
-   for (; entry != ht->table + ht->size; entry++) {
-      if (entry_is_present(ht, entry)) {
-         return entry;
-      }
+   for (; i < ht->size; i++) {
+      if (hash_ctrl_is_full(ht->ctrl[i]))
+         return ht->table + i;
    }
 
    return NULL;
@@ -522,21 +474,16 @@ struct hash_entry *
 _mesa_hash_table_random_entry(struct hash_table *ht,
                               bool (*predicate)(struct hash_entry *entry))
 {
-   struct hash_entry *entry;
-   uint32_t i = rand() % ht->size;
+   uint32_t start = rand() % ht->size;
 
    if (ht->entries == 0)
       return NULL;
 
-   for (entry = ht->table + i; entry != ht->table + ht->size; entry++) {
-      if (entry_is_present(ht, entry) &&
-          (!predicate || predicate(entry))) {
-         return entry;
-      }
-   }
+   for (uint32_t n = 0; n < ht->size; n++) {
+      uint32_t i = (start + n) & (ht->size - 1);
+      struct hash_entry *entry = ht->table + i;
 
-   for (entry = ht->table; entry != ht->table + i; entry++) {
-      if (entry_is_present(ht, entry) &&
+      if (hash_ctrl_is_full(ht->ctrl[i]) &&
           (!predicate || predicate(entry))) {
          return entry;
       }
@@ -604,56 +551,136 @@ _mesa_pointer_hash_table_create(void *mem_ctx)
 }
 
 /**
- * Hash table wrapper which supports 64-bit keys.
+ * Hash table with 64-bit keys.
  *
- * TODO: unify all hash table implementations.
+ * Keys are stored inline next to their data, so unlike the pointer-keyed
+ * table this needs neither a per-key allocation on 32-bit builds nor
+ * indirect hash and compare callbacks.  Every key value, including 0, can
+ * be stored since free slots are tracked by the control bytes.
  */
 
-struct hash_key_u64 {
-   uint64_t value;
+struct hash_table_u64_entry {
+   uint64_t key;
+   void *data;
 };
 
-static uint32_t
-key_u64_hash(const void *key)
+struct hash_table_u64_storage {
+   /** Older storage that lockless readers may still be looking at. */
+   struct hash_table_u64_storage *retired;
+   uint8_t *ctrl;
+   uint32_t size;
+   uint32_t num_groups;
+   struct hash_table_u64_entry entries[];
+};
+
+/* 64-bit finalizer from MurmurHash3, which mixes every key bit into the low
+ * 32 bits we keep.
+ */
+static inline uint32_t
+key_u64_hash(uint64_t key)
 {
-   return _mesa_hash_data(key, sizeof(struct hash_key_u64));
+   key ^= key >> 33;
+   key *= 0xff51afd7ed558ccdull;
+   key ^= key >> 33;
+   return (uint32_t)key;
 }
 
-static bool
-key_u64_equals(const void *a, const void *b)
+static struct hash_table_u64_storage *
+hash_table_u64_storage_create(struct hash_table_u64 *ht, uint32_t size)
 {
-   const struct hash_key_u64 *aa = a;
-   const struct hash_key_u64 *bb = b;
+   struct hash_table_u64_storage *storage;
+
+   storage = ralloc_size(ht, sizeof(*storage) +
+                             size * sizeof(struct hash_table_u64_entry) +
+                             hash_ctrl_bytes(size));
+   if (storage == NULL)
+      return NULL;
+
+   storage->retired = NULL;
+   storage->ctrl = (uint8_t *)(storage->entries + size);
+   storage->size = size;
+   storage->num_groups = hash_ctrl_num_groups(size);
+   hash_ctrl_reset(storage->ctrl, size);
 
-   return aa->value == bb->value;
+   return storage;
 }
 
-#define FREED_KEY_VALUE 0
+/* Writers to a read-mostly table bump the sequence number before and after
+ * modifying it, so that lockless readers can tell that they raced with a
+ * writer and have to retry.
+ */
+static inline void
+hash_table_u64_write_begin(struct hash_table_u64 *ht)
+{
+   if (ht->read_mostly)
+      p_atomic_inc(&ht->seq);
+}
+
+static inline void
+hash_table_u64_write_end(struct hash_table_u64 *ht)
+{
+   if (ht->read_mostly)
+      p_atomic_inc(&ht->seq);
+}
 
 struct hash_table_u64 *
 _mesa_hash_table_u64_create(void *mem_ctx)
 {
-   STATIC_ASSERT(FREED_KEY_VALUE != DELETED_KEY_VALUE);
    struct hash_table_u64 *ht;
 
-   ht = CALLOC_STRUCT(hash_table_u64);
+   ht = rzalloc(mem_ctx, struct hash_table_u64);
    if (!ht)
       return NULL;
 
-   if (sizeof(void *) == 8) {
-      ht->table = _mesa_hash_table_create(mem_ctx, _mesa_hash_pointer,
-                                          _mesa_key_pointer_equal);
-   } else {
-      ht->table = _mesa_hash_table_create(mem_ctx, key_u64_hash,
-                                          key_u64_equals);
+   ht->storage = hash_table_u64_storage_create(ht, HASH_CTRL_MIN_SIZE);
+   if (!ht->storage) {
+      ralloc_free(ht);
+      return NULL;
    }
+   ht->max_entries = hash_ctrl_max_entries(HASH_CTRL_MIN_SIZE);
+
+   return ht;
+}
+
+/**
+ * Creates a 64-bit key table that supports
+ * _mesa_hash_table_u64_search_lockless().
+ *
+ * Modifications still have to be serialized by the caller, and get a little
+ * more expensive.  Storage that is outgrown is only freed along with the
+ * table, since a lockless reader might still be probing it.
+ */
+struct hash_table_u64 *
+_mesa_hash_table_u64_create_read_mostly(void *mem_ctx)
+{
+   struct hash_table_u64 *ht = _mesa_hash_table_u64_create(mem_ctx);
 
-   if (ht->table)
-      _mesa_hash_table_set_deleted_key(ht->table, uint_key(DELETED_KEY_VALUE));
+   if (ht)
+      ht->read_mostly = true;
 
    return ht;
 }
 
+static void
+hash_table_u64_call_delete(struct hash_table_u64 *ht,
+                           void (*delete_function)(struct hash_entry *entry))
+{
+   struct hash_table_u64_storage *storage = ht->storage;
+
+   for (uint32_t i = 0; i < storage->size; i++) {
+      if (!hash_ctrl_is_full(storage->ctrl[i]))
+         continue;
+
+      /* Create a fake entry for the delete function. */
+      struct hash_entry entry = {
+         .hash = key_u64_hash(storage->entries[i].key),
+         .key = (const void *)(uintptr_t)storage->entries[i].key,
+         .data = storage->entries[i].data,
+      };
+      delete_function(&entry);
+   }
+}
+
 void
 _mesa_hash_table_u64_clear(struct hash_table_u64 *ht,
                            void (*delete_function)(struct hash_entry *entry))
@@ -661,132 +688,219 @@ _mesa_hash_table_u64_clear(struct hash_table_u64 *ht,
    if (!ht)
       return;
 
-   if (ht->deleted_key_data) {
-      if (delete_function) {
-         struct hash_table *table = ht->table;
-         struct hash_entry entry;
+   if (delete_function)
+      hash_table_u64_call_delete(ht, delete_function);
 
-         /* Create a fake entry for the delete function. */
-         entry.hash = table->key_hash_function(table->deleted_key);
-         entry.key = table->deleted_key;
-         entry.data = ht->deleted_key_data;
+   hash_table_u64_write_begin(ht);
+   hash_ctrl_reset(ht->storage->ctrl, ht->storage->size);
+   ht->entries = 0;
+   ht->deleted_entries = 0;
+   hash_table_u64_write_end(ht);
+}
 
-         delete_function(&entry);
-      }
-      ht->deleted_key_data = NULL;
-   }
+void
+_mesa_hash_table_u64_destroy(struct hash_table_u64 *ht,
+                             void (*delete_function)(struct hash_entry *entry))
+{
+   if (!ht)
+      return;
 
-   if (ht->freed_key_data) {
-      if (delete_function) {
-         struct hash_table *table = ht->table;
-         struct hash_entry entry;
+   if (delete_function)
+      hash_table_u64_call_delete(ht, delete_function);
 
-         /* Create a fake entry for the delete function. */
-         entry.hash = table->key_hash_function(uint_key(FREED_KEY_VALUE));
-         entry.key = uint_key(FREED_KEY_VALUE);
-         entry.data = ht->freed_key_data;
+   ralloc_free(ht);
+}
 
-         delete_function(&entry);
+static int32_t
+hash_table_u64_find(const struct hash_table_u64_storage *storage,
+                    uint64_t key, uint32_t hash)
+{
+   const uint8_t h2 = hash_ctrl_h2(hash);
+   uint32_t group = hash_group_first(hash, storage->num_groups);
+
+   for (uint32_t step = 1; step <= storage->num_groups; step++) {
+      const uint32_t base = group * HASH_GROUP_WIDTH;
+      const uint8_t *ctrl = storage->ctrl + base;
+      unsigned match = hash_group_match(ctrl, h2);
+
+      while (match) {
+         const uint32_t slot = base + u_bit_scan(&match);
+
+         if (storage->entries[slot].key == key)
+            return slot;
       }
-      ht->freed_key_data = NULL;
+
+      if (hash_group_match_empty(ctrl))
+         return -1;
+
+      group = hash_group_next(group, step, storage->num_groups);
    }
 
-   _mesa_hash_table_clear(ht->table, delete_function);
+   return -1;
 }
 
-void
-_mesa_hash_table_u64_destroy(struct hash_table_u64 *ht,
-                             void (*delete_function)(struct hash_entry *entry))
+static uint32_t
+hash_table_u64_find_available(const struct hash_table_u64_storage *storage,
+                              uint32_t hash)
 {
-   if (!ht)
-      return;
+   uint32_t group = hash_group_first(hash, storage->num_groups);
+
+   for (uint32_t step = 1; ; step++) {
+      const uint32_t base = group * HASH_GROUP_WIDTH;
+      unsigned available =
+         hash_group_match_empty_or_deleted(storage->ctrl + base);
 
-   _mesa_hash_table_u64_clear(ht, delete_function);
-   _mesa_hash_table_destroy(ht->table, delete_function);
-   free(ht);
+      if (likely(available))
+         return base + ffs(available) - 1;
+
+      group = hash_group_next(group, step, storage->num_groups);
+   }
+}
+
+static bool
+hash_table_u64_rehash(struct hash_table_u64 *ht, uint32_t new_size)
+{
+   struct hash_table_u64_storage *old = ht->storage;
+   struct hash_table_u64_storage *storage;
+
+   if (new_size == 0 || new_size > (1u << 31))
+      return false;
+
+   storage = hash_table_u64_storage_create(ht, new_size);
+   if (!storage)
+      return false;
+
+   for (uint32_t i = 0; i < old->size; i++) {
+      if (!hash_ctrl_is_full(old->ctrl[i]))
+         continue;
+
+      const struct hash_table_u64_entry *entry = &old->entries[i];
+      const uint32_t hash = key_u64_hash(entry->key);
+      const uint32_t slot = hash_table_u64_find_available(storage, hash);
+
+      storage->ctrl[slot] = hash_ctrl_h2(hash);
+      storage->entries[slot] = *entry;
+   }
+
+   ht->max_entries = hash_ctrl_max_entries(new_size);
+   ht->deleted_entries = 0;
+
+   if (ht->read_mostly) {
+      storage->retired = old;
+      p_atomic_set(&ht->storage, storage);
+   } else {
+      ht->storage = storage;
+      ralloc_free(old);
+   }
+
+   return true;
 }
 
 void
 _mesa_hash_table_u64_insert(struct hash_table_u64 *ht, uint64_t key,
                             void *data)
 {
-   if (key == FREED_KEY_VALUE) {
-      ht->freed_key_data = data;
-      return;
-   }
+   const uint32_t hash = key_u64_hash(key);
+   int32_t slot = hash_table_u64_find(ht->storage, key, hash);
+
+   hash_table_u64_write_begin(ht);
 
-   if (key == DELETED_KEY_VALUE) {
-      ht->deleted_key_data = data;
+   if (slot >= 0) {
+      ht->storage->entries[slot].data = data;
+      hash_table_u64_write_end(ht);
       return;
    }
 
-   if (sizeof(void *) == 8) {
-      _mesa_hash_table_insert(ht->table, (void *)(uintptr_t)key, data);
-   } else {
-      struct hash_key_u64 *_key = CALLOC_STRUCT(hash_key_u64);
+   /* Grow the table if it is at least half full of live entries, otherwise
+    * just rehash it in place to get rid of the deleted ones.
+    */
+   if (ht->entries + ht->deleted_entries >= ht->max_entries) {
+      uint32_t new_size = ht->storage->size;
 
-      if (!_key)
-         return;
-      _key->value = key;
+      if (ht->entries >= ht->max_entries / 2)
+         new_size *= 2;
 
-      _mesa_hash_table_insert(ht->table, _key, data);
+      if (!hash_table_u64_rehash(ht, new_size) &&
+          ht->entries + ht->deleted_entries >= ht->max_entries) {
+         hash_table_u64_write_end(ht);
+         return;
+      }
    }
+
+   struct hash_table_u64_storage *storage = ht->storage;
+   slot = hash_table_u64_find_available(storage, hash);
+
+   if (storage->ctrl[slot] == HASH_CTRL_DELETED)
+      ht->deleted_entries--;
+   storage->entries[slot].key = key;
+   storage->entries[slot].data = data;
+   storage->ctrl[slot] = hash_ctrl_h2(hash);
+   ht->entries++;
+
+   hash_table_u64_write_end(ht);
 }
 
-static struct hash_entry *
-hash_table_u64_search(struct hash_table_u64 *ht, uint64_t key)
+void *
+_mesa_hash_table_u64_search(struct hash_table_u64 *ht, uint64_t key)
 {
-   if (sizeof(void *) == 8) {
-      return _mesa_hash_table_search(ht->table, (void *)(uintptr_t)key);
-   } else {
-      struct hash_key_u64 _key = { .value = key };
-      return _mesa_hash_table_search(ht->table, &_key);
-   }
+   int32_t slot = hash_table_u64_find(ht->storage, key, key_u64_hash(key));
+
+   return slot >= 0 ? ht->storage->entries[slot].data : NULL;
 }
 
+/**
+ * Looks up a key in a table created with
+ * _mesa_hash_table_u64_create_read_mostly() without holding the lock that
+ * serializes its writers.
+ *
+ * This is a sequence lock: the lookup is simply retried if a writer
+ * modified the table while it was running.
+ */
 void *
-_mesa_hash_table_u64_search(struct hash_table_u64 *ht, uint64_t key)
+_mesa_hash_table_u64_search_lockless(struct hash_table_u64 *ht, uint64_t key)
 {
-   struct hash_entry *entry;
+   const uint32_t hash = key_u64_hash(key);
 
-   if (key == FREED_KEY_VALUE)
-      return ht->freed_key_data;
+   assert(ht->read_mostly);
 
-   if (key == DELETED_KEY_VALUE)
-      return ht->deleted_key_data;
+   while (true) {
+      uint32_t seq = p_atomic_read(&ht->seq);
+      if (seq & 1)
+         continue;
 
-   entry = hash_table_u64_search(ht, key);
-   if (!entry)
-      return NULL;
+      struct hash_table_u64_storage *storage = p_atomic_read(&ht->storage);
+      int32_t slot = hash_table_u64_find(storage, key, hash);
+      void *data = NULL;
+
+      if (slot >= 0)
+         data = p_atomic_read(&storage->entries[slot].data);
+
+      /* The entry has to be read before the sequence number is checked
+       * again, which an acquire load of the sequence number alone doesn't
+       * guarantee.
+       */
+      p_atomic_fence_acquire();
 
-   return entry->data;
+      if (p_atomic_read(&ht->seq) == seq)
+         return data;
+   }
 }
 
 void
 _mesa_hash_table_u64_remove(struct hash_table_u64 *ht, uint64_t key)
 {
-   struct hash_entry *entry;
+   struct hash_table_u64_storage *storage = ht->storage;
+   int32_t slot = hash_table_u64_find(storage, key, key_u64_hash(key));
 
-   if (key == FREED_KEY_VALUE) {
-      ht->freed_key_data = NULL;
+   if (slot < 0)
       return;
-   }
 
-   if (key == DELETED_KEY_VALUE) {
-      ht->deleted_key_data = NULL;
-      return;
-   }
+   const uint8_t ctrl = hash_ctrl_for_removed_slot(storage->ctrl, slot);
 
-   entry = hash_table_u64_search(ht, key);
-   if (!entry)
-      return;
-
-   if (sizeof(void *) == 8) {
-      _mesa_hash_table_remove(ht->table, entry);
-   } else {
-      struct hash_key *_key = (struct hash_key *)entry->key;
-
-      _mesa_hash_table_remove(ht->table, entry);
-      free(_key);
-   }
+   hash_table_u64_write_begin(ht);
+   storage->ctrl[slot] = ctrl;
+   ht->entries--;
+   if (ctrl == HASH_CTRL_DELETED)
+      ht->deleted_entries++;
+   hash_table_u64_write_end(ht);
 }
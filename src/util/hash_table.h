@@ -46,15 +46,13 @@ struct hash_entry {
 
 struct hash_table {
    struct hash_entry *table;
+   uint8_t *ctrl;
    uint32_t (*key_hash_function)(const void *key);
    bool (*key_equals_function)(const void *a, const void *b);
    const void *deleted_key;
    uint32_t size;
-   uint32_t rehash;
-   uint64_t size_magic;
-   uint64_t rehash_magic;
+   uint32_t num_groups;
    uint32_t max_entries;
-   uint32_t size_index;
    uint32_t entries;
    uint32_t deleted_entries;
 };
@@ -169,17 +167,26 @@ hash_table_call_foreach(struct hash_table *ht,
 }
 
 /**
- * Hash table wrapper which supports 64-bit keys.
+ * Hash table with inline 64-bit keys.
  */
+struct hash_table_u64_storage;
+
 struct hash_table_u64 {
-   struct hash_table *table;
-   void *freed_key_data;
-   void *deleted_key_data;
+   struct hash_table_u64_storage *storage;
+   uint32_t max_entries;
+   uint32_t entries;
+   uint32_t deleted_entries;
+   /** Odd while a writer is modifying a read-mostly table. */
+   uint32_t seq;
+   bool read_mostly;
 };
 
 struct hash_table_u64 *
 _mesa_hash_table_u64_create(void *mem_ctx);
 
+struct hash_table_u64 *
+_mesa_hash_table_u64_create_read_mostly(void *mem_ctx);
+
 void
 _mesa_hash_table_u64_destroy(struct hash_table_u64 *ht,
                              void (*delete_function)(struct hash_entry *entry));
@@ -191,6 +198,9 @@ _mesa_hash_table_u64_insert(struct hash_table_u64 *ht, uint64_t key,
 void *
 _mesa_hash_table_u64_search(struct hash_table_u64 *ht, uint64_t key);
 
+void *
+_mesa_hash_table_u64_search_lockless(struct hash_table_u64 *ht, uint64_t key);
+
 void
 _mesa_hash_table_u64_remove(struct hash_table_u64 *ht, uint64_t key);
 
@@ -198,6 +208,12 @@ void
 _mesa_hash_table_u64_clear(struct hash_table_u64 *ht,
                            void (*delete_function)(struct hash_entry *entry));
 
+static inline uint32_t
+_mesa_hash_table_u64_num_entries(struct hash_table_u64 *ht)
+{
+   return ht->entries;
+}
+
 #ifdef __cplusplus
 } /* extern C */
 #endif
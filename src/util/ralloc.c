@@ -66,6 +66,11 @@ struct
    unsigned canary;
 #endif
 
+   /* RALLOC_SLAB_* flags, plus the chunk's offset into its slab page for
+    * slab-allocated blocks.  This fits in what used to be padding.
+    */
+   unsigned flags;
+
    struct ralloc_header *parent;
 
    /* The first child (head of a linked list) */
@@ -83,6 +88,72 @@ typedef struct ralloc_header ralloc_header;
 static void unlink_block(ralloc_header *info);
 static void unsafe_free(ralloc_header *info);
 
+/* The block is a slab context, and a pointer to its slab pool is stored in
+ * the RALLOC_SLAB_PREFIX_SIZE bytes in front of the header.
+ */
+#define RALLOC_SLAB_CONTEXT      0x1
+/* The block was carved from a slab page rather than malloc'ed. */
+#define RALLOC_SLAB_CHUNK        0x2
+/* The block was malloc'ed because it is too large for a slab, but its
+ * parent had a slab pool, which the block's own children should use too.
+ */
+#define RALLOC_SLAB_DESCENDANT   0x4
+/* Offset of a slab chunk from the start of its page, in granules. */
+#define RALLOC_SLAB_OFFSET_SHIFT 3
+
+#define RALLOC_SLAB_PREFIX_SIZE  16
+#define RALLOC_SLAB_GRANULARITY  16
+#define RALLOC_SLAB_NUM_CLASSES  32
+#define RALLOC_SLAB_MAX_CHUNK    (RALLOC_SLAB_NUM_CLASSES * \
+                                  RALLOC_SLAB_GRANULARITY)
+#define RALLOC_SLAB_MIN_PAGE     1024
+#define RALLOC_SLAB_MAX_PAGE     16384
+
+struct ralloc_slab_pool;
+
+/**
+ * A page of same-sized chunks.
+ *
+ * Pages keep a pointer to their pool rather than the other way around, so
+ * that a chunk stolen out of a slab context keeps its page (and the pool's
+ * bookkeeping) alive after the context itself is gone.
+ */
+struct ralloc_slab_page {
+   struct ralloc_slab_pool *pool;
+
+   /* Links in the pool's list of pages with free chunks. */
+   struct ralloc_slab_page *prev;
+   struct ralloc_slab_page *next;
+   bool has_space;
+
+   /* Freed chunks, linked through ralloc_header::next. */
+   ralloc_header *free_list;
+
+   /* Chunks that were never handed out. */
+   char *bump;
+   char *end;
+
+   unsigned class_index;
+   unsigned chunk_size;
+   unsigned live;
+};
+
+#define RALLOC_SLAB_PAGE_HEADER_SIZE \
+   ALIGN_POT(sizeof(struct ralloc_slab_page), RALLOC_SLAB_GRANULARITY)
+
+struct ralloc_slab_pool {
+   /* Per size class list of pages that still have free chunks. */
+   struct ralloc_slab_page *partial[RALLOC_SLAB_NUM_CLASSES];
+   unsigned pages_created[RALLOC_SLAB_NUM_CLASSES];
+
+   unsigned num_pages;
+
+   /* Set once the owning context is freed.  The pool itself lives on
+    * until its last page is released.
+    */
+   bool dead;
+};
+
 static ralloc_header *
 get_header(const void *ptr)
 {
@@ -94,6 +165,219 @@ get_header(const void *ptr)
 
 #define PTR_FROM_HEADER(info) (((char *) info) + sizeof(ralloc_header))
 
+static struct ralloc_slab_pool **
+slab_context_pool(ralloc_header *info)
+{
+   assert(info->flags & RALLOC_SLAB_CONTEXT);
+   return (struct ralloc_slab_pool **)
+      ((char *) info - RALLOC_SLAB_PREFIX_SIZE);
+}
+
+static struct ralloc_slab_page *
+slab_chunk_page(ralloc_header *info)
+{
+   assert(info->flags & RALLOC_SLAB_CHUNK);
+   return (struct ralloc_slab_page *)
+      ((char *) info - (size_t) (info->flags >> RALLOC_SLAB_OFFSET_SHIFT) *
+                       RALLOC_SLAB_GRANULARITY);
+}
+
+/* Returns the slab pool that children of the given block should be carved
+ * from, if any.  All descendants of a slab context keep using its pool, even
+ * when some blocks in between were too large to be slab-allocated.
+ */
+static struct ralloc_slab_pool *
+slab_pool_for_parent(ralloc_header *parent)
+{
+   while (parent->flags & RALLOC_SLAB_DESCENDANT) {
+      parent = parent->parent;
+      if (parent == NULL)
+         return NULL;
+   }
+
+   if (likely(parent->flags & RALLOC_SLAB_CHUNK)) {
+      struct ralloc_slab_pool *pool = slab_chunk_page(parent)->pool;
+      return pool->dead ? NULL : pool;
+   }
+
+   if (parent->flags & RALLOC_SLAB_CONTEXT)
+      return *slab_context_pool(parent);
+
+   return NULL;
+}
+
+static void
+slab_page_unlink(struct ralloc_slab_pool *pool, struct ralloc_slab_page *page)
+{
+   if (page->prev)
+      page->prev->next = page->next;
+   else
+      pool->partial[page->class_index] = page->next;
+
+   if (page->next)
+      page->next->prev = page->prev;
+
+   page->prev = NULL;
+   page->next = NULL;
+   page->has_space = false;
+}
+
+static void
+slab_page_link(struct ralloc_slab_pool *pool, struct ralloc_slab_page *page)
+{
+   page->prev = NULL;
+   page->next = pool->partial[page->class_index];
+   if (page->next)
+      page->next->prev = page;
+   pool->partial[page->class_index] = page;
+   page->has_space = true;
+}
+
+static void
+slab_page_destroy(struct ralloc_slab_pool *pool, struct ralloc_slab_page *page)
+{
+   if (page->has_space)
+      slab_page_unlink(pool, page);
+
+   free(page);
+
+   if (--pool->num_pages == 0 && pool->dead)
+      free(pool);
+}
+
+static struct ralloc_slab_page *
+slab_page_create(struct ralloc_slab_pool *pool, unsigned class_index)
+{
+   unsigned chunk_size = (class_index + 1) * RALLOC_SLAB_GRANULARITY;
+   unsigned shift = MIN2(pool->pages_created[class_index], 4);
+   size_t page_size = RALLOC_SLAB_MIN_PAGE << shift;
+   struct ralloc_slab_page *page;
+
+   /* Start with small pages so that small contexts stay small, and make
+    * sure even the first page holds a few of the largest chunks.
+    */
+   page_size = MAX2(page_size, RALLOC_SLAB_PAGE_HEADER_SIZE + 4 * chunk_size);
+   page_size = MIN2(page_size, RALLOC_SLAB_MAX_PAGE);
+
+   page = malloc(page_size);
+   if (unlikely(page == NULL))
+      return NULL;
+
+   page->pool = pool;
+   page->free_list = NULL;
+   page->bump = (char *) page + RALLOC_SLAB_PAGE_HEADER_SIZE;
+   page->end = (char *) page + page_size;
+   page->class_index = class_index;
+   page->chunk_size = chunk_size;
+   page->live = 0;
+   slab_page_link(pool, page);
+
+   pool->pages_created[class_index]++;
+   pool->num_pages++;
+
+   return page;
+}
+
+static ralloc_header *
+slab_alloc(struct ralloc_slab_pool *pool, size_t total_size)
+{
+   unsigned class_index =
+      (total_size + RALLOC_SLAB_GRANULARITY - 1) / RALLOC_SLAB_GRANULARITY - 1;
+   struct ralloc_slab_page *page = pool->partial[class_index];
+   ralloc_header *info;
+
+   if (page == NULL) {
+      page = slab_page_create(pool, class_index);
+      if (unlikely(page == NULL))
+         return NULL;
+   }
+
+   if (page->free_list != NULL) {
+      info = page->free_list;
+      page->free_list = info->next;
+   } else {
+      info = (ralloc_header *) page->bump;
+      page->bump += page->chunk_size;
+   }
+   page->live++;
+
+   if (page->free_list == NULL && page->bump + page->chunk_size > page->end)
+      slab_page_unlink(pool, page);
+
+   info->flags = RALLOC_SLAB_CHUNK |
+                 ((unsigned) (((char *) info - (char *) page) /
+                              RALLOC_SLAB_GRANULARITY)
+                  << RALLOC_SLAB_OFFSET_SHIFT);
+   return info;
+}
+
+static void
+slab_free(ralloc_header *info)
+{
+   struct ralloc_slab_page *page = slab_chunk_page(info);
+   struct ralloc_slab_pool *pool = page->pool;
+
+   info->next = page->free_list;
+   page->free_list = info;
+
+   if (--page->live == 0) {
+      /* Keep one empty page per size class around for reuse, but give
+       * everything else back.
+       */
+      bool other_pages = page->has_space ?
+         page->prev != NULL || page->next != NULL :
+         pool->partial[page->class_index] != NULL;
+
+      if (pool->dead || other_pages) {
+         slab_page_destroy(pool, page);
+         return;
+      }
+   }
+
+   if (!page->has_space)
+      slab_page_link(pool, page);
+}
+
+/* Called when the slab context owning the pool is freed.  Pages that still
+ * hold chunks which were stolen out of the context stay around until those
+ * are freed.
+ */
+static void
+slab_pool_release(struct ralloc_slab_pool *pool)
+{
+   pool->dead = true;
+
+   for (unsigned i = 0; i < RALLOC_SLAB_NUM_CLASSES; i++) {
+      struct ralloc_slab_page *page = pool->partial[i];
+      while (page != NULL) {
+         struct ralloc_slab_page *next = page->next;
+         if (page->live == 0) {
+            slab_page_unlink(pool, page);
+            free(page);
+            pool->num_pages--;
+         }
+         page = next;
+      }
+   }
+
+   if (pool->num_pages == 0)
+      free(pool);
+}
+
+/* Frees the memory of a single block, without looking at its children. */
+static void
+free_block(ralloc_header *info)
+{
+   if (info->flags & RALLOC_SLAB_CHUNK) {
+      slab_free(info);
+   } else if (info->flags & RALLOC_SLAB_CONTEXT) {
+      slab_pool_release(*slab_context_pool(info));
+      free((char *) info - RALLOC_SLAB_PREFIX_SIZE);
+   } else {
+      free(info);
+   }
+}
+
 static void
 add_child(ralloc_header *parent, ralloc_header *info)
 {
@@ -116,14 +400,24 @@ ralloc_context(const void *ctx)
 void *
 ralloc_size(const void *ctx, size_t size)
 {
-   void *block = malloc(size + sizeof(ralloc_header));
    ralloc_header *info;
    ralloc_header *parent;
+   struct ralloc_slab_pool *pool;
 
-   if (unlikely(block == NULL))
-      return NULL;
+   parent = ctx != NULL ? get_header(ctx) : NULL;
+   pool = parent != NULL ? slab_pool_for_parent(parent) : NULL;
+
+   if (pool != NULL && size <= RALLOC_SLAB_MAX_CHUNK - sizeof(ralloc_header)) {
+      info = slab_alloc(pool, size + sizeof(ralloc_header));
+      if (unlikely(info == NULL))
+         return NULL;
+   } else {
+      info = malloc(size + sizeof(ralloc_header));
+      if (unlikely(info == NULL))
+         return NULL;
+      info->flags = pool != NULL ? RALLOC_SLAB_DESCENDANT : 0;
+   }
 
-   info = (ralloc_header *) block;
    /* measurements have shown that calloc is slower (because of
     * the multiplication overflow checking?), so clear things
     * manually
@@ -134,8 +428,6 @@ ralloc_size(const void *ctx, size_t size)
    info->next = NULL;
    info->destructor = NULL;
 
-   parent = ctx != NULL ? get_header(ctx) : NULL;
-
    add_child(parent, info);
 
 #ifndef NDEBUG
@@ -145,6 +437,47 @@ ralloc_size(const void *ctx, size_t size)
    return PTR_FROM_HEADER(info);
 }
 
+void *
+ralloc_slab_context(const void *ctx)
+{
+   return rzalloc_slab_context_size(ctx, 0);
+}
+
+void *
+rzalloc_slab_context_size(const void *ctx, size_t size)
+{
+   char *block = malloc(RALLOC_SLAB_PREFIX_SIZE + sizeof(ralloc_header) + size);
+   struct ralloc_slab_pool *pool;
+   ralloc_header *info;
+
+   if (unlikely(block == NULL))
+      return NULL;
+
+   pool = calloc(1, sizeof(*pool));
+   if (unlikely(pool == NULL)) {
+      free(block);
+      return NULL;
+   }
+
+   info = (ralloc_header *) (block + RALLOC_SLAB_PREFIX_SIZE);
+   info->flags = RALLOC_SLAB_CONTEXT;
+   info->parent = NULL;
+   info->child = NULL;
+   info->prev = NULL;
+   info->next = NULL;
+   info->destructor = NULL;
+   *slab_context_pool(info) = pool;
+
+   add_child(ctx != NULL ? get_header(ctx) : NULL, info);
+
+#ifndef NDEBUG
+   info->canary = CANARY;
+#endif
+
+   memset(PTR_FROM_HEADER(info), 0, size);
+   return PTR_FROM_HEADER(info);
+}
+
 void *
 rzalloc_size(const void *ctx, size_t size)
 {
@@ -163,10 +496,36 @@ resize(void *ptr, size_t size)
    ralloc_header *child, *old, *info;
 
    old = get_header(ptr);
-   info = realloc(old, size + sizeof(ralloc_header));
 
-   if (info == NULL)
-      return NULL;
+   if (old->flags & RALLOC_SLAB_CHUNK) {
+      unsigned chunk_size = slab_chunk_page(old)->chunk_size;
+
+      if (size + sizeof(ralloc_header) <= chunk_size)
+         return ptr;
+
+      /* Blocks that grow out of their chunk are likely to keep growing, so
+       * move them to the heap.
+       */
+      info = malloc(size + sizeof(ralloc_header));
+      if (info == NULL)
+         return NULL;
+
+      memcpy(info, old, chunk_size);
+      info->flags = RALLOC_SLAB_DESCENDANT;
+      slab_free(old);
+   } else if (old->flags & RALLOC_SLAB_CONTEXT) {
+      char *block = realloc((char *) old - RALLOC_SLAB_PREFIX_SIZE,
+                            RALLOC_SLAB_PREFIX_SIZE + sizeof(ralloc_header) +
+                            size);
+      if (block == NULL)
+         return NULL;
+
+      info = (ralloc_header *) (block + RALLOC_SLAB_PREFIX_SIZE);
+   } else {
+      info = realloc(old, size + sizeof(ralloc_header));
+      if (info == NULL)
+         return NULL;
+   }
 
    /* Update parent and sibling's links to the reallocated node. */
    if (info != old && info->parent != NULL) {
@@ -296,7 +655,7 @@ unsafe_free(ralloc_header *info)
    if (info->destructor != NULL)
       info->destructor(PTR_FROM_HEADER(info));
 
-   free(info);
+   free_block(info);
 }
 
 void
@@ -91,6 +91,34 @@ extern "C" {
  */
 void *ralloc_context(const void *ctx);
 
+/**
+ * Allocate a new ralloc context whose descendants are carved from slabs.
+ *
+ * Small allocations made with the context, or any descendant of it, as
+ * their parent come from per-context pages of same-sized chunks instead of
+ * individual mallocs.  This is meant for short-lived contexts owning many
+ * small, similarly sized objects.
+ *
+ * Freed chunks are only reused by allocations below the same slab context,
+ * and a page is only released once all of its chunks are freed.  A
+ * long-lived context whose contents churn, such as a nir_shader being
+ * optimized and swept, therefore keeps close to its peak size.
+ *
+ * Everything else works as with a regular context: children can be freed
+ * individually, stolen into other contexts, and outlive the slab context.
+ * Note however that a stolen chunk still gives its memory back to the slab
+ * context's pages when freed, so it must not be freed concurrently with
+ * allocations from the slab context in another thread.
+ */
+void *ralloc_slab_context(const void *ctx);
+
+/**
+ * Allocate zero-initialized memory that acts as a slab context.
+ *
+ * \sa ralloc_slab_context
+ */
+void *rzalloc_slab_context_size(const void *ctx, size_t size) MALLOCLIKE;
+
 /**
  * Allocate memory chained off of the given context.
  *
@@ -96,6 +96,24 @@ void
 rb_tree_init(struct rb_tree *T)
 {
     T->root = NULL;
+    T->augment = NULL;
+}
+
+void
+rb_tree_init_augmented(struct rb_tree *T, void (*augment)(struct rb_node *))
+{
+    T->root = NULL;
+    T->augment = augment;
+}
+
+void
+rb_tree_augment_path(struct rb_tree *T, struct rb_node *node)
+{
+    if (T->augment == NULL)
+        return;
+
+    for (; node; node = rb_node_parent(node))
+        T->augment(node);
 }
 
 /**
@@ -135,6 +153,12 @@ rb_tree_rotate_left(struct rb_tree *T, struct rb_node *x)
     rb_tree_splice(T, x, y);
     y->left = x;
     rb_node_set_parent(x, y);
+
+    /* x is now y's child and y covers the same nodes x used to */
+    if (T->augment) {
+        T->augment(x);
+        T->augment(y);
+    }
 }
 
 static void
@@ -149,6 +173,11 @@ rb_tree_rotate_right(struct rb_tree *T, struct rb_node *y)
     rb_tree_splice(T, y, x);
     x->right = y;
     rb_node_set_parent(y, x);
+
+    if (T->augment) {
+        T->augment(y);
+        T->augment(x);
+    }
 }
 
 void
@@ -162,6 +191,7 @@ rb_tree_insert_at(struct rb_tree *T, struct rb_node *parent,
         assert(T->root == NULL);
         T->root = node;
         rb_node_set_black(node);
+        rb_tree_augment_path(T, node);
         return;
     }
 
@@ -174,6 +204,11 @@ rb_tree_insert_at(struct rb_tree *T, struct rb_node *parent,
     }
     rb_node_set_parent(node, parent);
 
+    /* Bring the augmented data up to date before rebalancing.  The
+     * rotations below keep it up to date on their own.
+     */
+    rb_tree_augment_path(T, node);
+
     /* Now we do the insertion fixup */
     struct rb_node *z = node;
     while (rb_node_is_red(rb_node_parent(z))) {
@@ -266,6 +301,9 @@ rb_tree_remove(struct rb_tree *T, struct rb_node *z)
 
     assert(x_p == NULL || x == x_p->left || x == x_p->right);
 
+    /* x_p is the deepest node whose subtree changed */
+    rb_tree_augment_path(T, x_p);
+
     if (!y_was_black)
         return;
 
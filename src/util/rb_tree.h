@@ -65,11 +65,42 @@ rb_node_parent(struct rb_node *n)
  */
 struct rb_tree {
     struct rb_node *root;
+
+    /** Optional callback to recompute per-node augmented data
+     *
+     * If non-NULL, this is called on a node whenever its subtree changes
+     * shape so that the node can recompute data summarizing its subtree
+     * (for instance the largest key in it) from its own data and that of
+     * its children.  Children are always updated before their parents.
+     */
+    void (*augment)(struct rb_node *node);
 };
 
 /** Initialize a red-black tree */
 void rb_tree_init(struct rb_tree *T);
 
+/** Initialize a red-black tree with per-node augmented data
+ *
+ * \param   T       The red-black tree to initialize
+ *
+ * \param   augment The callback used to recompute a node's augmented data
+ *                  from the node itself and its children
+ */
+void rb_tree_init_augmented(struct rb_tree *T,
+                            void (*augment)(struct rb_node *));
+
+/** Recompute augmented data after a node's data has changed
+ *
+ * This must be called whenever the data the augment callback depends on
+ * changes for a node that is already in the tree.  It updates the node and
+ * all of its ancestors.  It does nothing if the tree is not augmented.
+ *
+ * \param   T       The red-black tree containing the node
+ *
+ * \param   node    The node whose data changed
+ */
+void rb_tree_augment_path(struct rb_tree *T, struct rb_node *node);
+
 /** Returns true if the red-black tree is empty */
 static inline bool
 rb_tree_is_empty(const struct rb_tree *T)
@@ -71,11 +71,21 @@
  */
 
 #include <stdbool.h>
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
 
 #include "ralloc.h"
 #include "main/imports.h"
 #include "main/macros.h"
 #include "util/bitset.h"
+#include "util/u_atomic.h"
+#include "util/u_debug.h"
 #include "register_allocate.h"
 
 #define NO_REG ~0U
@@ -186,8 +196,16 @@ struct ra_graph {
       /** Bit-set indicating, for each register, if it pre-assigned */
       BITSET_WORD *reg_assigned;
 
-      /** Bit-set indicating, for each register, the value of the pq test */
-      BITSET_WORD *pq_test;
+      /**
+       * Nodes which passed the pq test and haven't been pushed on the stack
+       * yet.
+       *
+       * A node's q total only ever goes down during ra_simplify(), so nodes
+       * are added here exactly once, either up front or at the point where
+       * removing a neighbor makes them trivially colorable.
+       */
+      unsigned int *worklist;
+      unsigned int worklist_count;
 
       /** For each BITSET_WORD, the minimum q value or ~0 if unknown */
       unsigned int *min_q_total;
@@ -510,7 +528,7 @@ ra_realloc_interference_graph(struct ra_graph *g, unsigned int alloc)
 
    g->tmp.reg_assigned = reralloc(g, g->tmp.reg_assigned, BITSET_WORD,
                                   bitset_count);
-   g->tmp.pq_test = reralloc(g, g->tmp.pq_test, BITSET_WORD, bitset_count);
+   g->tmp.worklist = reralloc(g, g->tmp.worklist, unsigned int, alloc);
    g->tmp.min_q_total = reralloc(g, g->tmp.min_q_total, unsigned int,
                                  bitset_count);
    g->tmp.min_q_node = reralloc(g, g->tmp.min_q_node, unsigned int,
@@ -590,13 +608,24 @@ ra_reset_node_interference(struct ra_graph *g, unsigned int n)
    g->nodes[n].adjacency_count = 0;
 }
 
+static bool
+pq_test(struct ra_graph *g, unsigned int n)
+{
+   int n_class = g->nodes[n].class;
+
+   return g->nodes[n].tmp.q_total < g->regs->classes[n_class]->p;
+}
+
+/**
+ * Updates the simplify state of a node which doesn't pass the pq test yet
+ * after its q total went down.
+ */
 static void
 update_pq_info(struct ra_graph *g, unsigned int n)
 {
    int i = n / BITSET_WORDBITS;
-   int n_class = g->nodes[n].class;
-   if (g->nodes[n].tmp.q_total < g->regs->classes[n_class]->p) {
-      BITSET_SET(g->tmp.pq_test, n);
+   if (pq_test(g, n)) {
+      g->tmp.worklist[g->tmp.worklist_count++] = n;
    } else if (g->tmp.min_q_total[i] != UINT_MAX) {
       /* Only update min_q_total and min_q_node if min_q_total != UINT_MAX so
        * that we don't update while we have stale data and accidentally mark
@@ -626,7 +655,8 @@ add_node_to_stack(struct ra_graph *g, unsigned int n)
       unsigned int n2_class = g->nodes[n2].class;
 
       if (!BITSET_TEST(g->tmp.in_stack, n2) &&
-          !BITSET_TEST(g->tmp.reg_assigned, n2)) {
+          !BITSET_TEST(g->tmp.reg_assigned, n2) &&
+          !pq_test(g, n2)) {
          assert(g->nodes[n2].tmp.q_total >= g->regs->classes[n2_class]->q[n_class]);
          g->nodes[n2].tmp.q_total -= g->regs->classes[n2_class]->q[n_class];
          update_pq_info(g, n2);
@@ -646,6 +676,10 @@ add_node_to_stack(struct ra_graph *g, unsigned int n)
  * trivially-colorable nodes into a stack of nodes to be colored,
  * removing them from the graph, and rinsing and repeating.
  *
+ * Trivially-colorable nodes are taken from a worklist which
+ * add_node_to_stack() keeps up to date, so each node is only visited again
+ * when one of its neighbors gets removed from the graph.
+ *
  * If we encounter a case where we can't push any nodes on the stack, then
  * we optimistically choose a node and push it on the stack. We heuristically
  * push the node with the lowest total q value, since it has the fewest
@@ -654,8 +688,8 @@ add_node_to_stack(struct ra_graph *g, unsigned int n)
 static void
 ra_simplify(struct ra_graph *g)
 {
-   bool progress = true;
    unsigned int stack_optimistic_start = UINT_MAX;
+   unsigned int num_to_stack = 0;
 
    /* Figure out the high bit and bit mask for the first iteration of a loop
     * over BITSET_WORDs.
@@ -664,29 +698,42 @@ ra_simplify(struct ra_graph *g)
 
    /* Do a quick pre-pass to set things up */
    g->tmp.stack_count = 0;
-   for (int i = BITSET_WORDS(g->count) - 1, high_bit = top_word_high_bit;
-        i >= 0; i--, high_bit = BITSET_WORDBITS - 1) {
+   g->tmp.worklist_count = 0;
+   for (int i = BITSET_WORDS(g->count) - 1; i >= 0; i--) {
       g->tmp.in_stack[i] = 0;
       g->tmp.reg_assigned[i] = 0;
-      g->tmp.pq_test[i] = 0;
       g->tmp.min_q_total[i] = UINT_MAX;
       g->tmp.min_q_node[i] = UINT_MAX;
-      for (int j = high_bit; j >= 0; j--) {
-         unsigned int n = i * BITSET_WORDBITS + j;
-         g->nodes[n].reg = g->nodes[n].forced_reg;
-         g->nodes[n].tmp.q_total = g->nodes[n].q_total;
-         if (g->nodes[n].reg != NO_REG)
-            g->tmp.reg_assigned[i] |= BITSET_BIT(j);
-         update_pq_info(g, n);
+   }
+
+   /* The worklist is popped from the back, so adding nodes in increasing
+    * order means that the highest-numbered ones are pushed on the stack
+    * first.
+    */
+   for (unsigned int n = 0; n < g->count; n++) {
+      g->nodes[n].reg = g->nodes[n].forced_reg;
+      g->nodes[n].tmp.q_total = g->nodes[n].q_total;
+      if (g->nodes[n].reg != NO_REG) {
+         BITSET_SET(g->tmp.reg_assigned, n);
+      } else {
+         num_to_stack++;
+         if (pq_test(g, n))
+            g->tmp.worklist[g->tmp.worklist_count++] = n;
       }
    }
 
-   while (progress) {
+   while (g->tmp.stack_count < num_to_stack) {
+      if (g->tmp.worklist_count > 0) {
+         add_node_to_stack(g, g->tmp.worklist[--g->tmp.worklist_count]);
+         continue;
+      }
+
+      /* Nothing is trivially colorable, so pick the node with the lowest q
+       * total to push optimistically.
+       */
       unsigned int min_q_total = UINT_MAX;
       unsigned int min_q_node = UINT_MAX;
 
-      progress = false;
-
       for (int i = BITSET_WORDS(g->count) - 1, high_bit = top_word_high_bit;
            i >= 0; i--, high_bit = BITSET_WORDBITS - 1) {
          BITSET_WORD mask = ~(BITSET_WORD)0 >> (31 - high_bit);
@@ -695,58 +742,34 @@ ra_simplify(struct ra_graph *g)
          if (skip == mask)
             continue;
 
-         BITSET_WORD pq = g->tmp.pq_test[i] & ~skip;
-         if (pq) {
-            /* In this case, we have stuff we can immediately take off the
-             * stack.  This also means that we're guaranteed to make progress
-             * and we don't need to bother updating lowest_q_total because we
-             * know we're going to loop again before attempting to do anything
-             * optimistic.
+         if (g->tmp.min_q_total[i] == UINT_MAX) {
+            /* The min_q_total and min_q_node are dirty because we added
+             * one of these nodes to the stack.  It needs to be
+             * recalculated.
              */
             for (int j = high_bit; j >= 0; j--) {
-               if (pq & BITSET_BIT(j)) {
-                  unsigned int n = i * BITSET_WORDBITS + j;
-                  assert(n < g->count);
-                  add_node_to_stack(g, n);
-                  /* add_node_to_stack() may update pq_test for this word so
-                   * we need to update our local copy.
-                   */
-                  pq = g->tmp.pq_test[i] & ~skip;
-                  progress = true;
-               }
-            }
-         } else if (!progress) {
-            if (g->tmp.min_q_total[i] == UINT_MAX) {
-               /* The min_q_total and min_q_node are dirty because we added
-                * one of these nodes to the stack.  It needs to be
-                * recalculated.
-                */
-               for (int j = high_bit; j >= 0; j--) {
-                  if (skip & BITSET_BIT(j))
-                     continue;
-
-                  unsigned int n = i * BITSET_WORDBITS + j;
-                  assert(n < g->count);
-                  if (g->nodes[n].tmp.q_total < g->tmp.min_q_total[i]) {
-                     g->tmp.min_q_total[i] = g->nodes[n].tmp.q_total;
-                     g->tmp.min_q_node[i] = n;
-                  }
+               if (skip & BITSET_BIT(j))
+                  continue;
+
+               unsigned int n = i * BITSET_WORDBITS + j;
+               assert(n < g->count);
+               if (g->nodes[n].tmp.q_total < g->tmp.min_q_total[i]) {
+                  g->tmp.min_q_total[i] = g->nodes[n].tmp.q_total;
+                  g->tmp.min_q_node[i] = n;
                }
             }
-            if (g->tmp.min_q_total[i] < min_q_total) {
-               min_q_node = g->tmp.min_q_node[i];
-               min_q_total = g->tmp.min_q_total[i];
-            }
+         }
+         if (g->tmp.min_q_total[i] < min_q_total) {
+            min_q_node = g->tmp.min_q_node[i];
+            min_q_total = g->tmp.min_q_total[i];
          }
       }
 
-      if (!progress && min_q_total != UINT_MAX) {
-         if (stack_optimistic_start == UINT_MAX)
-            stack_optimistic_start = g->tmp.stack_count;
+      assert(min_q_node != UINT_MAX);
+      if (stack_optimistic_start == UINT_MAX)
+         stack_optimistic_start = g->tmp.stack_count;
 
-         add_node_to_stack(g, min_q_node);
-         progress = true;
-      }
+      add_node_to_stack(g, min_q_node);
    }
 
    g->tmp.stack_optimistic_start = stack_optimistic_start;
@@ -877,9 +900,108 @@ ra_select(struct ra_graph *g)
    return true;
 }
 
+/**
+ * Writes the register set and the interference graph out in a simple text
+ * format which src/util/tests/register_allocate/ra_bench can replay:
+ *
+ *    regs <count> <round robin>
+ *    reg <r> <num conflicts> <conflicting regs...>     (one line per reg)
+ *    classes <count>
+ *    class <c> <num regs> <regs...>                    (one line per class)
+ *    q <c> <q[c][0]> ... <q[c][count - 1]>             (one line per class)
+ *    nodes <count>
+ *    node <n> <class> <forced reg or -1> <spill cost> <num> <neighbors...>
+ *
+ * Only neighbors with a higher node number are listed for each node.  Any
+ * select_reg callback is not recorded.
+ */
+static void
+ra_dump_graph(struct ra_graph *g, FILE *fp)
+{
+   struct ra_regs *regs = g->regs;
+   BITSET_WORD tmp;
+   int r;
+
+   fprintf(fp, "regs %u %u\n", regs->count, regs->round_robin);
+   for (unsigned int i = 0; i < regs->count; i++) {
+      unsigned int count = 0;
+      BITSET_FOREACH_SET(r, tmp, regs->regs[i].conflicts, regs->count)
+         count++;
+
+      fprintf(fp, "reg %u %u", i, count);
+      BITSET_FOREACH_SET(r, tmp, regs->regs[i].conflicts, regs->count)
+         fprintf(fp, " %d", r);
+      fprintf(fp, "\n");
+   }
+
+   fprintf(fp, "classes %u\n", regs->class_count);
+   for (unsigned int c = 0; c < regs->class_count; c++) {
+      fprintf(fp, "class %u %u", c, regs->classes[c]->p);
+      BITSET_FOREACH_SET(r, tmp, regs->classes[c]->regs, regs->count)
+         fprintf(fp, " %d", r);
+      fprintf(fp, "\n");
+   }
+   for (unsigned int c = 0; c < regs->class_count; c++) {
+      fprintf(fp, "q %u", c);
+      for (unsigned int c2 = 0; c2 < regs->class_count; c2++)
+         fprintf(fp, " %u", regs->classes[c]->q[c2]);
+      fprintf(fp, "\n");
+   }
+
+   fprintf(fp, "nodes %u\n", g->count);
+   for (unsigned int n = 0; n < g->count; n++) {
+      const struct ra_node *node = &g->nodes[n];
+      unsigned int count = 0;
+
+      for (unsigned int i = 0; i < node->adjacency_count; i++) {
+         if (node->adjacency_list[i] > n)
+            count++;
+      }
+
+      fprintf(fp, "node %u %u %d %.9g %u", n, node->class,
+              node->forced_reg == NO_REG ? -1 : (int)node->forced_reg,
+              node->spill_cost, count);
+      for (unsigned int i = 0; i < node->adjacency_count; i++) {
+         if (node->adjacency_list[i] > n)
+            fprintf(fp, " %u", node->adjacency_list[i]);
+      }
+      fprintf(fp, "\n");
+   }
+}
+
+DEBUG_GET_ONCE_OPTION(ra_dump_path, "MESA_RA_DUMP_PATH", NULL)
+
+/**
+ * Records every graph handed to ra_allocate() as a separate file in the
+ * directory named by MESA_RA_DUMP_PATH, if set.
+ */
+static void
+ra_dump_graph_if_requested(struct ra_graph *g)
+{
+   static uint32_t dump_count;
+   const char *path = debug_get_option_ra_dump_path();
+
+   if (path == NULL)
+      return;
+
+   char filename[1024];
+   snprintf(filename, sizeof(filename), "%s/ra-%d-%u.txt", path,
+            (int)getpid(), p_atomic_inc_return(&dump_count));
+
+   FILE *fp = fopen(filename, "w");
+   if (fp == NULL) {
+      fprintf(stderr, "Failed to open %s for writing\n", filename);
+      return;
+   }
+
+   ra_dump_graph(g, fp);
+   fclose(fp);
+}
+
 bool
 ra_allocate(struct ra_graph *g)
 {
+   ra_dump_graph_if_requested(g);
    ra_simplify(g);
    return ra_select(g);
 }
@@ -941,18 +1063,47 @@ ra_get_spill_benefit(struct ra_graph *g, unsigned int n)
 int
 ra_get_best_spill_node(struct ra_graph *g)
 {
-   unsigned int best_node = -1;
-   float best_benefit = 0.0;
-   unsigned int n;
+   unsigned int node;
+
+   if (ra_get_best_spill_nodes(g, &node, 1) == 0)
+      return -1;
+
+   return node;
+}
+
+/**
+ * Picks up to max_nodes nodes to spill at once, in order of decreasing
+ * benefit/cost, and stores them in nodes.  Returns the number of nodes
+ * picked.
+ *
+ * Spilling a node already relieves the pressure on all of its neighbors, so
+ * no two of the returned nodes interfere with each other.  This lets
+ * drivers that spill heavily spill several registers per allocation attempt
+ * without spilling both ends of the same interference.
+ */
+unsigned int
+ra_get_best_spill_nodes(struct ra_graph *g, unsigned int *nodes,
+                        unsigned int max_nodes)
+{
+   unsigned int count = 0;
+   float *ratio;
+
+   if (max_nodes == 0)
+      return 0;
+
+   ratio = malloc(g->count * sizeof(*ratio));
+   if (ratio == NULL)
+      return 0;
 
    /* Consider any nodes that we colored successfully or the node we failed to
     * color for spilling. When we failed to color a node in ra_select(), we
     * only considered these nodes, so spilling any other ones would not result
     * in us making progress.
     */
-   for (n = 0; n < g->count; n++) {
+   for (unsigned int n = 0; n < g->count; n++) {
       float cost = g->nodes[n].spill_cost;
-      float benefit;
+
+      ratio[n] = 0.0f;
 
       if (cost <= 0.0f)
          continue;
@@ -960,15 +1111,34 @@ ra_get_best_spill_node(struct ra_graph *g)
       if (BITSET_TEST(g->tmp.in_stack, n))
          continue;
 
-      benefit = ra_get_spill_benefit(g, n);
+      ratio[n] = ra_get_spill_benefit(g, n) / cost;
+   }
 
-      if (benefit / cost > best_benefit) {
-         best_benefit = benefit / cost;
-         best_node = n;
+   while (count < max_nodes) {
+      unsigned int best_node = -1;
+      float best_ratio = 0.0;
+
+      for (unsigned int n = 0; n < g->count; n++) {
+         if (ratio[n] > best_ratio) {
+            best_ratio = ratio[n];
+            best_node = n;
+         }
       }
+
+      if (best_node == -1)
+         break;
+
+      nodes[count++] = best_node;
+
+      /* Take the node and its neighbors out of the running */
+      ratio[best_node] = 0.0f;
+      for (unsigned int i = 0; i < g->nodes[best_node].adjacency_count; i++)
+         ratio[g->nodes[best_node].adjacency_list[i]] = 0.0f;
    }
 
-   return best_node;
+   free(ratio);
+
+   return count;
 }
 
 /**
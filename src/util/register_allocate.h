@@ -94,6 +94,8 @@ unsigned int ra_get_node_reg(struct ra_graph *g, unsigned int n);
 void ra_set_node_reg(struct ra_graph * g, unsigned int n, unsigned int reg);
 void ra_set_node_spill_cost(struct ra_graph *g, unsigned int n, float cost);
 int ra_get_best_spill_node(struct ra_graph *g);
+unsigned int ra_get_best_spill_nodes(struct ra_graph *g, unsigned int *nodes,
+                                     unsigned int max_nodes);
 /** @} */
 
 
@@ -40,80 +40,44 @@
 #include "macros.h"
 #include "ralloc.h"
 #include "set.h"
-#include "fast_urem_by_const.h"
-
-/*
- * From Knuth -- a good choice for hash/rehash values is p, p-2 where
- * p and p-2 are both prime.  These tables are sized to have an extra 10%
- * free to avoid exponential performance degradation as the hash table fills
- */
+#include "hash_group.h"
+#include "bitscan.h"
 
 static const uint32_t deleted_key_value;
 static const void *deleted_key = &deleted_key_value;
 
-static const struct {
-   uint32_t max_entries, size, rehash;
-   uint64_t size_magic, rehash_magic;
-} hash_sizes[] = {
-#define ENTRY(max_entries, size, rehash) \
-   { max_entries, size, rehash, \
-      REMAINDER_MAGIC(size), REMAINDER_MAGIC(rehash) }
-
-   ENTRY(2,            5,            3            ),
-   ENTRY(4,            7,            5            ),
-   ENTRY(8,            13,           11           ),
-   ENTRY(16,           19,           17           ),
-   ENTRY(32,           43,           41           ),
-   ENTRY(64,           73,           71           ),
-   ENTRY(128,          151,          149          ),
-   ENTRY(256,          283,          281          ),
-   ENTRY(512,          571,          569          ),
-   ENTRY(1024,         1153,         1151         ),
-   ENTRY(2048,         2269,         2267         ),
-   ENTRY(4096,         4519,         4517         ),
-   ENTRY(8192,         9013,         9011         ),
-   ENTRY(16384,        18043,        18041        ),
-   ENTRY(32768,        36109,        36107        ),
-   ENTRY(65536,        72091,        72089        ),
-   ENTRY(131072,       144409,       144407       ),
-   ENTRY(262144,       288361,       288359       ),
-   ENTRY(524288,       576883,       576881       ),
-   ENTRY(1048576,      1153459,      1153457      ),
-   ENTRY(2097152,      2307163,      2307161      ),
-   ENTRY(4194304,      4613893,      4613891      ),
-   ENTRY(8388608,      9227641,      9227639      ),
-   ENTRY(16777216,     18455029,     18455027     ),
-   ENTRY(33554432,     36911011,     36911009     ),
-   ENTRY(67108864,     73819861,     73819859     ),
-   ENTRY(134217728,    147639589,    147639587    ),
-   ENTRY(268435456,    295279081,    295279079    ),
-   ENTRY(536870912,    590559793,    590559791    ),
-   ENTRY(1073741824,   1181116273,   1181116271   ),
-   ENTRY(2147483648ul, 2362232233ul, 2362232231ul )
-};
-
 static inline bool
 key_pointer_is_reserved(const void *key)
 {
    return key == NULL || key == deleted_key;
 }
 
-static int
-entry_is_free(struct set_entry *entry)
+/**
+ * Allocates the entry and control arrays for a set of the given size.
+ *
+ * Both live in a single allocation, with the control bytes following the
+ * entries.  On failure, the set is left untouched.
+ */
+static bool
+set_alloc(struct set *ht, uint32_t size)
 {
-   return entry->key == NULL;
-}
+   struct set_entry *table;
 
-static int
-entry_is_deleted(struct set_entry *entry)
-{
-   return entry->key == deleted_key;
-}
+   table = ralloc_size(ht, size * sizeof(struct set_entry) +
+                           hash_ctrl_bytes(size));
+   if (table == NULL)
+      return false;
 
-static int
-entry_is_present(struct set_entry *entry)
-{
-   return entry->key != NULL && entry->key != deleted_key;
+   ht->table = table;
+   ht->ctrl = (uint8_t *)(table + size);
+   ht->size = size;
+   ht->num_groups = hash_ctrl_num_groups(size);
+   ht->max_entries = hash_ctrl_max_entries(size);
+   ht->entries = 0;
+   ht->deleted_entries = 0;
+   hash_ctrl_reset(ht->ctrl, size);
+
+   return true;
 }
 
 struct set *
@@ -128,19 +92,10 @@ _mesa_set_create(void *mem_ctx,
    if (ht == NULL)
       return NULL;
 
-   ht->size_index = 0;
-   ht->size = hash_sizes[ht->size_index].size;
-   ht->rehash = hash_sizes[ht->size_index].rehash;
-   ht->size_magic = hash_sizes[ht->size_index].size_magic;
-   ht->rehash_magic = hash_sizes[ht->size_index].rehash_magic;
-   ht->max_entries = hash_sizes[ht->size_index].max_entries;
    ht->key_hash_function = key_hash_function;
    ht->key_equals_function = key_equals_function;
-   ht->table = rzalloc_array(ht, struct set_entry, ht->size);
-   ht->entries = 0;
-   ht->deleted_entries = 0;
 
-   if (ht->table == NULL) {
+   if (!set_alloc(ht, HASH_CTRL_MIN_SIZE)) {
       ralloc_free(ht);
       return NULL;
    }
@@ -152,6 +107,8 @@ struct set *
 _mesa_set_clone(struct set *set, void *dst_mem_ctx)
 {
    struct set *clone;
+   size_t table_size = set->size * sizeof(struct set_entry) +
+                       hash_ctrl_bytes(set->size);
 
    clone = ralloc(dst_mem_ctx, struct set);
    if (clone == NULL)
@@ -159,13 +116,14 @@ _mesa_set_clone(struct set *set, void *dst_mem_ctx)
 
    memcpy(clone, set, sizeof(struct set));
 
-   clone->table = ralloc_array(clone, struct set_entry, clone->size);
+   clone->table = ralloc_size(clone, table_size);
    if (clone->table == NULL) {
       ralloc_free(clone);
       return NULL;
    }
 
-   memcpy(clone->table, set->table, clone->size * sizeof(struct set_entry));
+   memcpy(clone->table, set->table, table_size);
+   clone->ctrl = (uint8_t *)(clone->table + clone->size);
 
    return clone;
 }
@@ -203,12 +161,13 @@ _mesa_set_clear(struct set *set, void (*delete_function)(struct set_entry *entry
    if (!set)
       return;
 
-   set_foreach (set, entry) {
-      if (delete_function)
+   if (delete_function) {
+      set_foreach (set, entry) {
          delete_function(entry);
-      entry->key = deleted_key;
+      }
    }
 
+   hash_ctrl_reset(set->ctrl, set->size);
    set->entries = set->deleted_entries = 0;
 }
 
@@ -222,26 +181,28 @@ set_search(const struct set *ht, uint32_t hash, const void *key)
 {
    assert(!key_pointer_is_reserved(key));
 
-   uint32_t size = ht->size;
-   uint32_t start_address = util_fast_urem32(hash, size, ht->size_magic);
-   uint32_t double_hash = util_fast_urem32(hash, ht->rehash,
-                                           ht->rehash_magic) + 1;
-   uint32_t hash_address = start_address;
-   do {
-      struct set_entry *entry = ht->table + hash_address;
+   const uint8_t h2 = hash_ctrl_h2(hash);
+   uint32_t group = hash_group_first(hash, ht->num_groups);
 
-      if (entry_is_free(entry)) {
-         return NULL;
-      } else if (entry_is_present(entry) && entry->hash == hash) {
-         if (ht->key_equals_function(key, entry->key)) {
+   for (uint32_t step = 1; step <= ht->num_groups; step++) {
+      const uint32_t base = group * HASH_GROUP_WIDTH;
+      const uint8_t *ctrl = ht->ctrl + base;
+      unsigned match = hash_group_match(ctrl, h2);
+
+      while (match) {
+         struct set_entry *entry = ht->table + base + u_bit_scan(&match);
+
+         if (entry->hash == hash &&
+             ht->key_equals_function(key, entry->key)) {
             return entry;
          }
       }
 
-      hash_address += double_hash;
-      if (hash_address >= size)
-         hash_address -= size;
-   } while (hash_address != start_address);
+      if (hash_group_match_empty(ctrl))
+         return NULL;
+
+      group = hash_group_next(group, step, ht->num_groups);
+   }
 
    return NULL;
 }
@@ -265,50 +226,39 @@ _mesa_set_search_pre_hashed(const struct set *set, uint32_t hash,
 static void
 set_add_rehash(struct set *ht, uint32_t hash, const void *key)
 {
-   uint32_t size = ht->size;
-   uint32_t start_address = util_fast_urem32(hash, size, ht->size_magic);
-   uint32_t double_hash = util_fast_urem32(hash, ht->rehash,
-                                           ht->rehash_magic) + 1;
-   uint32_t hash_address = start_address;
-   do {
-      struct set_entry *entry = ht->table + hash_address;
-      if (likely(entry->key == NULL)) {
+   uint32_t group = hash_group_first(hash, ht->num_groups);
+
+   for (uint32_t step = 1; ; step++) {
+      const uint32_t base = group * HASH_GROUP_WIDTH;
+      unsigned empty = hash_group_match_empty(ht->ctrl + base);
+
+      if (likely(empty)) {
+         const uint32_t slot = base + ffs(empty) - 1;
+         struct set_entry *entry = ht->table + slot;
+
+         ht->ctrl[slot] = hash_ctrl_h2(hash);
          entry->hash = hash;
          entry->key = key;
          return;
       }
 
-      hash_address = hash_address + double_hash;
-      if (hash_address >= size)
-         hash_address -= size;
-   } while (true);
+      group = hash_group_next(group, step, ht->num_groups);
+   }
 }
 
 static void
-set_rehash(struct set *ht, unsigned new_size_index)
+set_rehash(struct set *ht, uint32_t new_size)
 {
    struct set old_ht;
-   struct set_entry *table;
 
-   if (new_size_index >= ARRAY_SIZE(hash_sizes))
-      return;
-
-   table = rzalloc_array(ht, struct set_entry,
-                         hash_sizes[new_size_index].size);
-   if (table == NULL)
+   /* The set is already as large as it can get. */
+   if (new_size == 0 || new_size > (1u << 31))
       return;
 
    old_ht = *ht;
 
-   ht->table = table;
-   ht->size_index = new_size_index;
-   ht->size = hash_sizes[ht->size_index].size;
-   ht->rehash = hash_sizes[ht->size_index].rehash;
-   ht->size_magic = hash_sizes[ht->size_index].size_magic;
-   ht->rehash_magic = hash_sizes[ht->size_index].rehash_magic;
-   ht->max_entries = hash_sizes[ht->size_index].max_entries;
-   ht->entries = 0;
-   ht->deleted_entries = 0;
+   if (!set_alloc(ht, new_size))
+      return;
 
    set_foreach(&old_ht, entry) {
       set_add_rehash(ht, entry->hash, entry->key);
@@ -326,11 +276,7 @@ _mesa_set_resize(struct set *set, uint32_t entries)
    if (set->entries > entries)
       entries = set->entries;
 
-   unsigned size_index = 0;
-   while (hash_sizes[size_index].max_entries < entries)
-      size_index++;
-
-   set_rehash(set, size_index);
+   set_rehash(set, hash_ctrl_size_for_entries(entries));
 }
 
 /**
@@ -343,55 +289,65 @@ _mesa_set_resize(struct set *set, uint32_t entries)
 static struct set_entry *
 set_search_or_add(struct set *ht, uint32_t hash, const void *key, bool *found)
 {
-   struct set_entry *available_entry = NULL;
+   uint32_t available_slot = UINT32_MAX;
 
    assert(!key_pointer_is_reserved(key));
 
-   if (ht->entries >= ht->max_entries) {
-      set_rehash(ht, ht->size_index + 1);
-   } else if (ht->deleted_entries + ht->entries >= ht->max_entries) {
-      set_rehash(ht, ht->size_index);
+   /* Grow the set if it is at least half full of live entries, otherwise
+    * just rehash it in place to get rid of the deleted ones.
+    */
+   if (ht->entries + ht->deleted_entries >= ht->max_entries) {
+      if (ht->entries >= ht->max_entries / 2)
+         set_rehash(ht, ht->size * 2);
+      else
+         set_rehash(ht, ht->size);
    }
 
-   uint32_t size = ht->size;
-   uint32_t start_address = util_fast_urem32(hash, size, ht->size_magic);
-   uint32_t double_hash = util_fast_urem32(hash, ht->rehash,
-                                           ht->rehash_magic) + 1;
-   uint32_t hash_address = start_address;
-   do {
-      struct set_entry *entry = ht->table + hash_address;
-
-      if (!entry_is_present(entry)) {
-         /* Stash the first available entry we find */
-         if (available_entry == NULL)
-            available_entry = entry;
-         if (entry_is_free(entry))
-            break;
+   const uint8_t h2 = hash_ctrl_h2(hash);
+   uint32_t group = hash_group_first(hash, ht->num_groups);
+
+   for (uint32_t step = 1; step <= ht->num_groups; step++) {
+      const uint32_t base = group * HASH_GROUP_WIDTH;
+      const uint8_t *ctrl = ht->ctrl + base;
+      unsigned match = hash_group_match(ctrl, h2);
+
+      while (match) {
+         struct set_entry *entry = ht->table + base + u_bit_scan(&match);
+
+         if (entry->hash == hash &&
+             ht->key_equals_function(key, entry->key)) {
+            if (found)
+               *found = true;
+            return entry;
+         }
       }
 
-      if (!entry_is_deleted(entry) &&
-          entry->hash == hash &&
-          ht->key_equals_function(key, entry->key)) {
-         if (found)
-            *found = true;
-         return entry;
+      /* Stash the first available slot we find */
+      if (available_slot == UINT32_MAX) {
+         unsigned available = hash_group_match_empty_or_deleted(ctrl);
+         if (available)
+            available_slot = base + ffs(available) - 1;
       }
 
-      hash_address = hash_address + double_hash;
-      if (hash_address >= size)
-         hash_address -= size;
-   } while (hash_address != start_address);
+      if (hash_group_match_empty(ctrl))
+         break;
 
-   if (available_entry) {
+      group = hash_group_next(group, step, ht->num_groups);
+   }
+
+   if (available_slot != UINT32_MAX) {
       /* There is no matching entry, create it. */
-      if (entry_is_deleted(available_entry))
+      struct set_entry *entry = ht->table + available_slot;
+
+      if (ht->ctrl[available_slot] == HASH_CTRL_DELETED)
          ht->deleted_entries--;
-      available_entry->hash = hash;
-      available_entry->key = key;
+      ht->ctrl[available_slot] = h2;
+      entry->hash = hash;
+      entry->key = key;
       ht->entries++;
       if (found)
          *found = false;
-      return available_entry;
+      return entry;
    }
 
    /* We could hit here if a required resize failed. An unchecked-malloc
@@ -497,9 +453,14 @@ _mesa_set_remove(struct set *ht, struct set_entry *entry)
    if (!entry)
       return;
 
+   const uint32_t slot = entry - ht->table;
+   const uint8_t ctrl = hash_ctrl_for_removed_slot(ht->ctrl, slot);
+
+   ht->ctrl[slot] = ctrl;
    entry->key = deleted_key;
    ht->entries--;
-   ht->deleted_entries++;
+   if (ctrl == HASH_CTRL_DELETED)
+      ht->deleted_entries++;
 }
 
 /**
@@ -515,20 +476,17 @@ _mesa_set_remove_key(struct set *set, const void *key)
  * This function is an iterator over the hash table.
  *
  * Pass in NULL for the first entry, as in the start of a for loop.  Note that
- * an iteration over the table is O(table_size) not O(entries).
+ * an iteration over the table is O(table_size) not O(entries), although only
+ * the control bytes of empty slots are touched.
  */
 struct set_entry *
 _mesa_set_next_entry(const struct set *ht, struct set_entry *entry)
 {
-   if (entry == NULL)
-      entry = ht->table;
-   else
-      entry = entry + 1;
+   uint32_t i = entry == NULL ? 0 : (entry - ht->table) + 1;
 
-   for (; entry != ht->table + ht->size; entry++) {
-      if (entry_is_present(entry)) {
-         return entry;
-      }
+   for (; i < ht->size; i++) {
+      if (hash_ctrl_is_full(ht->ctrl[i]))
+         return ht->table + i;
    }
 
    return NULL;
@@ -538,21 +496,16 @@ struct set_entry *
 _mesa_set_random_entry(struct set *ht,
                        int (*predicate)(struct set_entry *entry))
 {
-   struct set_entry *entry;
-   uint32_t i = rand() % ht->size;
+   uint32_t start = rand() % ht->size;
 
    if (ht->entries == 0)
       return NULL;
 
-   for (entry = ht->table + i; entry != ht->table + ht->size; entry++) {
-      if (entry_is_present(entry) &&
-          (!predicate || predicate(entry))) {
-         return entry;
-      }
-   }
+   for (uint32_t n = 0; n < ht->size; n++) {
+      uint32_t i = (start + n) & (ht->size - 1);
+      struct set_entry *entry = ht->table + i;
 
-   for (entry = ht->table; entry != ht->table + i; entry++) {
-      if (entry_is_present(entry) &&
+      if (hash_ctrl_is_full(ht->ctrl[i]) &&
           (!predicate || predicate(entry))) {
          return entry;
       }
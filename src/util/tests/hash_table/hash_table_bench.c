@@ -0,0 +1,277 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Benchmark for struct hash_table and struct set.
+ *
+ * Each case replays the access pattern of a compiler user of the
+ * containers on synthetic data, for shaders of a few hundred to a few
+ * tens of thousands of objects:
+ *
+ *  - clone remap: nir_clone() and nir_serialize() map every variable,
+ *    SSA def and block to its copy and look each one up once per use.
+ *  - block sets: nir_calc_dominance() and friends keep a small pointer set
+ *    per block, with a few adds and many searches.
+ *  - instr set: nir_opt_cse() adds every instruction with a custom hash
+ *    and equality, finds duplicates, and removes them again when leaving a
+ *    dominance subtree.
+ *  - linker names: the GLSL linker matches variables and blocks between
+ *    stages with tables keyed by name, searched with other copies of the
+ *    same strings.
+ *
+ * The time per operation is reported for each case.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash_table.h"
+#include "set.h"
+#include "util/macros.h"
+#include "util/os_time.h"
+#include "util/rand_xor.h"
+
+#define SHADERS 2000
+
+struct fake_instr {
+   uint32_t op;
+   uint32_t src[2];
+};
+
+static uint64_t seed[2];
+
+static unsigned
+rand_below(unsigned n)
+{
+   return rand_xorshift128plus(seed) % n;
+}
+
+/* Shader sizes are mostly small with a long tail, like a game's shaders. */
+static unsigned
+shader_size(void)
+{
+   unsigned size = 200;
+   while (size < 20000 && rand_below(3) == 0)
+      size *= 2;
+   return size + rand_below(size);
+}
+
+static uint32_t
+fake_instr_hash(const void *key)
+{
+   const struct fake_instr *instr = key;
+   return _mesa_hash_data(instr, sizeof(*instr));
+}
+
+static bool
+fake_instr_equal(const void *a, const void *b)
+{
+   return memcmp(a, b, sizeof(struct fake_instr)) == 0;
+}
+
+static uint64_t
+clone_remap(void **objs, void **copies)
+{
+   const unsigned n = shader_size();
+   struct hash_table *remap = _mesa_pointer_hash_table_create(NULL);
+   uint64_t ops = 0;
+
+   for (unsigned i = 0; i < n; i++) {
+      _mesa_hash_table_insert(remap, objs[i], copies[i]);
+      ops++;
+
+      /* Sources mostly refer to recent definitions. */
+      for (unsigned s = 0; s < 2 && i > 0; s++) {
+         unsigned use = i - 1 - rand_below(MIN2(i, 16));
+         if (_mesa_hash_table_search(remap, objs[use])->data != copies[use])
+            abort();
+         ops++;
+      }
+   }
+
+   _mesa_hash_table_destroy(remap, NULL);
+   return ops;
+}
+
+static uint64_t
+block_sets(void **objs)
+{
+   const unsigned blocks = shader_size() / 16 + 1;
+   struct set **sets = malloc(blocks * sizeof(*sets));
+   uint64_t ops = 0;
+
+   for (unsigned b = 0; b < blocks; b++) {
+      sets[b] = _mesa_pointer_set_create(NULL);
+      for (unsigned i = rand_below(8); i > 0; i--) {
+         _mesa_set_add(sets[b], objs[rand_below(blocks)]);
+         ops++;
+      }
+   }
+
+   for (unsigned i = 0; i < blocks * 8; i++) {
+      _mesa_set_search(sets[rand_below(blocks)], objs[rand_below(blocks)]);
+      ops++;
+   }
+
+   for (unsigned b = 0; b < blocks; b++)
+      _mesa_set_destroy(sets[b], NULL);
+   free(sets);
+   return ops;
+}
+
+static uint64_t
+instr_set(struct fake_instr *instrs)
+{
+   const unsigned n = shader_size();
+   struct set *set = _mesa_set_create(NULL, fake_instr_hash,
+                                      fake_instr_equal);
+   uint64_t ops = 0;
+
+   /* About one instruction in four computes something already computed. */
+   for (unsigned i = 0; i < n; i++) {
+      instrs[i].op = rand_below(64);
+      instrs[i].src[0] = rand_below(n / 4 + 1);
+      instrs[i].src[1] = rand_below(4);
+   }
+
+   for (unsigned i = 0; i < n; i++) {
+      _mesa_set_search_or_add(set, &instrs[i]);
+      ops++;
+   }
+
+   for (unsigned i = n; i-- > 0;) {
+      struct set_entry *entry = _mesa_set_search(set, &instrs[i]);
+      if (entry && entry->key == &instrs[i])
+         _mesa_set_remove(set, entry);
+      ops++;
+   }
+
+   _mesa_set_destroy(set, NULL);
+   return ops;
+}
+
+static uint64_t
+linker_names(char **names, char **copies, unsigned num_names)
+{
+   const unsigned n = MIN2(shader_size() / 20 + 8, num_names);
+   const unsigned first = rand_below(num_names - n + 1);
+   struct hash_table *ht =
+      _mesa_hash_table_create(NULL, _mesa_key_hash_string,
+                              _mesa_key_string_equal);
+   uint64_t ops = 0;
+
+   for (unsigned i = first; i < first + n; i++) {
+      _mesa_hash_table_insert(ht, names[i], names[i]);
+      ops++;
+   }
+
+   /* The consumer looks up its inputs and some names that aren't there. */
+   for (unsigned i = 0; i < n * 4; i++) {
+      _mesa_hash_table_search(ht, copies[first + rand_below(n + n / 4)]);
+      ops++;
+   }
+
+   _mesa_hash_table_destroy(ht, NULL);
+   return ops;
+}
+
+int
+main(int argc, char **argv)
+{
+   const unsigned max_objs = 80000, num_names = 4096;
+   void **objs = malloc(max_objs * sizeof(*objs));
+   void **copies = malloc(max_objs * sizeof(*copies));
+   struct fake_instr *instrs = malloc(max_objs * sizeof(*instrs));
+   char **names = malloc(num_names * 2 * sizeof(*names));
+   char **name_copies = malloc(num_names * 2 * sizeof(*name_copies));
+   static const char *const prefixes[] = {
+      "gl_", "u_", "v_", "a_", "block.", "light[",
+   };
+   uint64_t ops;
+   int64_t start;
+
+   if (!objs || !copies || !instrs || !names || !name_copies)
+      return 1;
+
+   /* Stand-ins for ralloc'ed NIR objects, spread over the heap. */
+   for (unsigned i = 0; i < max_objs; i++) {
+      objs[i] = malloc(48);
+      copies[i] = malloc(48);
+   }
+
+   for (unsigned i = 0; i < num_names * 2; i++) {
+      char name[64];
+      snprintf(name, sizeof(name), "%s%s_%u",
+               prefixes[i % ARRAY_SIZE(prefixes)],
+               i % 3 ? "color" : "texcoord", i);
+      names[i] = strdup(name);
+      name_copies[i] = strdup(name);
+   }
+
+   s_rand_xorshift128plus(seed, false);
+
+   start = os_time_get_nano();
+   ops = 0;
+   for (unsigned i = 0; i < SHADERS; i++)
+      ops += clone_remap(objs, copies);
+   printf("clone remap:   %6.1f ns/op\n",
+          (double)(os_time_get_nano() - start) / ops);
+
+   start = os_time_get_nano();
+   ops = 0;
+   for (unsigned i = 0; i < SHADERS; i++)
+      ops += block_sets(objs);
+   printf("block sets:    %6.1f ns/op\n",
+          (double)(os_time_get_nano() - start) / ops);
+
+   start = os_time_get_nano();
+   ops = 0;
+   for (unsigned i = 0; i < SHADERS; i++)
+      ops += instr_set(instrs);
+   printf("instr set:     %6.1f ns/op\n",
+          (double)(os_time_get_nano() - start) / ops);
+
+   start = os_time_get_nano();
+   ops = 0;
+   for (unsigned i = 0; i < SHADERS; i++)
+      ops += linker_names(names, name_copies, num_names);
+   printf("linker names:  %6.1f ns/op\n",
+          (double)(os_time_get_nano() - start) / ops);
+
+   for (unsigned i = 0; i < max_objs; i++) {
+      free(objs[i]);
+      free(copies[i]);
+   }
+   for (unsigned i = 0; i < num_names * 2; i++) {
+      free(names[i]);
+      free(name_copies[i]);
+   }
+   free(objs);
+   free(copies);
+   free(instrs);
+   free(names);
+   free(name_copies);
+
+   return 0;
+}
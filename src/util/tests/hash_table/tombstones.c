@@ -0,0 +1,109 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#undef NDEBUG
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "hash_table.h"
+
+#define SIZE 1000
+
+static uint32_t
+key_value(const void *key)
+{
+   return *(const uint32_t *)key;
+}
+
+/* Gives every key the same control byte, so that every probe has to fall
+ * back to comparing the cached hashes and keys.
+ */
+static uint32_t
+key_hash(const void *key)
+{
+   return key_value(key) << 7;
+}
+
+static bool
+uint32_t_key_equals(const void *a, const void *b)
+{
+   return key_value(a) == key_value(b);
+}
+
+int
+main(int argc, char **argv)
+{
+   struct hash_table *ht;
+   struct hash_entry *entry;
+   uint32_t keys[SIZE];
+   uint32_t i, round;
+
+   (void) argc;
+   (void) argv;
+
+   ht = _mesa_hash_table_create(NULL, key_hash, uint32_t_key_equals);
+
+   for (i = 0; i < SIZE; i++) {
+      keys[i] = i;
+      _mesa_hash_table_insert(ht, keys + i, NULL);
+   }
+
+   /* Repeatedly remove and re-add half of the keys, which leaves deleted
+    * slots all over the table.
+    */
+   for (round = 0; round < 10; round++) {
+      for (i = round % 2; i < SIZE; i += 2) {
+         entry = _mesa_hash_table_search(ht, keys + i);
+         assert(entry);
+         _mesa_hash_table_remove(ht, entry);
+         assert(!_mesa_hash_table_search(ht, keys + i));
+      }
+      assert(ht->entries == SIZE / 2);
+
+      for (i = 0; i < SIZE; i++) {
+         entry = _mesa_hash_table_search(ht, keys + i);
+         assert((entry != NULL) == (i % 2 != round % 2));
+      }
+
+      for (i = round % 2; i < SIZE; i += 2)
+         _mesa_hash_table_insert(ht, keys + i, NULL);
+      assert(ht->entries == SIZE);
+   }
+
+   for (i = 0; i < SIZE; i++) {
+      entry = _mesa_hash_table_search(ht, keys + i);
+      assert(entry);
+      assert(key_value(entry->key) == i);
+   }
+
+   i = 0;
+   hash_table_foreach(ht, entry)
+      i++;
+   assert(i == SIZE);
+
+   _mesa_hash_table_destroy(ht, NULL);
+
+   return 0;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#undef NDEBUG
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "hash_table.h"
+
+#define SIZE 10000
+
+static void *
+key_data(uint64_t key)
+{
+   return (void *)(uintptr_t)(key % 1000 + 1);
+}
+
+int
+main(int argc, char **argv)
+{
+   struct hash_table_u64 *ht;
+   uint64_t i;
+
+   (void) argc;
+   (void) argv;
+
+   ht = _mesa_hash_table_u64_create(NULL);
+
+   /* Keys that the pointer-keyed table reserves are regular keys here. */
+   _mesa_hash_table_u64_insert(ht, 0, key_data(0));
+   _mesa_hash_table_u64_insert(ht, 1, key_data(1));
+   _mesa_hash_table_u64_insert(ht, UINT64_MAX, key_data(UINT64_MAX));
+
+   /* Keys that only differ in their upper 32 bits. */
+   for (i = 2; i < SIZE; i++)
+      _mesa_hash_table_u64_insert(ht, i << 32, key_data(i << 32));
+
+   assert(_mesa_hash_table_u64_num_entries(ht) == SIZE + 1);
+   assert(_mesa_hash_table_u64_search(ht, 0) == key_data(0));
+   assert(_mesa_hash_table_u64_search(ht, 1) == key_data(1));
+   assert(_mesa_hash_table_u64_search(ht, UINT64_MAX) ==
+          key_data(UINT64_MAX));
+   for (i = 2; i < SIZE; i++) {
+      assert(_mesa_hash_table_u64_search(ht, i << 32) == key_data(i << 32));
+      assert(_mesa_hash_table_u64_search(ht, i) == NULL);
+   }
+
+   _mesa_hash_table_u64_remove(ht, 0);
+   assert(_mesa_hash_table_u64_search(ht, 0) == NULL);
+   assert(_mesa_hash_table_u64_search(ht, 1) == key_data(1));
+
+   for (i = 2; i < SIZE; i += 2)
+      _mesa_hash_table_u64_remove(ht, i << 32);
+   for (i = 2; i < SIZE; i++) {
+      assert(_mesa_hash_table_u64_search(ht, i << 32) ==
+             (i % 2 ? key_data(i << 32) : NULL));
+   }
+
+   _mesa_hash_table_u64_clear(ht, NULL);
+   assert(_mesa_hash_table_u64_num_entries(ht) == 0);
+   assert(_mesa_hash_table_u64_search(ht, 1) == NULL);
+   assert(_mesa_hash_table_u64_search(ht, 3ull << 32) == NULL);
+
+   _mesa_hash_table_u64_destroy(ht, NULL);
+
+   return 0;
+}
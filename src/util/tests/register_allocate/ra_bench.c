@@ -0,0 +1,314 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Benchmark for the graph-coloring register allocator.
+ *
+ * Replays interference graphs recorded by running a driver with
+ * MESA_RA_DUMP_PATH=<dir>, or synthetic ones if no files are given.  For
+ * each graph it reports the time a single ra_allocate() takes and then
+ * simulates a spilling driver, once spilling a single node per attempt and
+ * once spilling the way i965 does, reporting the number of attempts and
+ * spilled nodes.  Spilling a node is modelled by removing all of its
+ * interference, as if the spill and fill code had very short live ranges.
+ */
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/os_time.h"
+#include "util/ralloc.h"
+#include "util/rand_xor.h"
+#include "util/register_allocate.h"
+
+#define ITERATIONS 10
+#define MAX_SPILLS_PER_ATTEMPT 16
+
+struct bench_graph {
+   struct ra_regs *regs;
+   struct ra_graph *g;
+   unsigned count;
+};
+
+static bool
+expect(FILE *fp, const char *keyword)
+{
+   char word[32];
+   return fscanf(fp, "%31s", word) == 1 && strcmp(word, keyword) == 0;
+}
+
+static bool
+load_graph(struct bench_graph *bg, void *mem_ctx, const char *filename)
+{
+   FILE *fp = fopen(filename, "r");
+   unsigned reg_count, round_robin, class_count, r, c, n, num;
+
+   if (fp == NULL) {
+      fprintf(stderr, "Failed to open %s\n", filename);
+      return false;
+   }
+
+   if (!expect(fp, "regs") ||
+       fscanf(fp, "%u %u", &reg_count, &round_robin) != 2)
+      goto fail;
+
+   bg->regs = ra_alloc_reg_set(mem_ctx, reg_count, false);
+   if (round_robin)
+      ra_set_allocate_round_robin(bg->regs);
+
+   for (unsigned i = 0; i < reg_count; i++) {
+      if (!expect(fp, "reg") || fscanf(fp, "%u %u", &r, &num) != 2)
+         goto fail;
+      for (unsigned j = 0; j < num; j++) {
+         unsigned r2;
+         if (fscanf(fp, "%u", &r2) != 1)
+            goto fail;
+         if (r2 != r)
+            ra_add_reg_conflict(bg->regs, r, r2);
+      }
+   }
+
+   if (!expect(fp, "classes") || fscanf(fp, "%u", &class_count) != 1)
+      goto fail;
+
+   for (unsigned i = 0; i < class_count; i++) {
+      c = ra_alloc_reg_class(bg->regs);
+      if (!expect(fp, "class") || fscanf(fp, "%u %u", &c, &num) != 2)
+         goto fail;
+      for (unsigned j = 0; j < num; j++) {
+         if (fscanf(fp, "%u", &r) != 1)
+            goto fail;
+         ra_class_add_reg(bg->regs, c, r);
+      }
+   }
+
+   unsigned **q = ralloc_array(mem_ctx, unsigned *, class_count);
+   for (unsigned i = 0; i < class_count; i++) {
+      q[i] = ralloc_array(q, unsigned, class_count);
+      if (!expect(fp, "q") || fscanf(fp, "%u", &c) != 1)
+         goto fail;
+      for (unsigned j = 0; j < class_count; j++) {
+         if (fscanf(fp, "%u", &q[c][j]) != 1)
+            goto fail;
+      }
+   }
+   ra_set_finalize(bg->regs, q);
+
+   if (!expect(fp, "nodes") || fscanf(fp, "%u", &bg->count) != 1)
+      goto fail;
+
+   bg->g = ra_alloc_interference_graph(bg->regs, bg->count);
+   ralloc_steal(mem_ctx, bg->g);
+
+   /* Classes have to be set before any interference is added */
+   long nodes_start = ftell(fp);
+   for (unsigned pass = 0; pass < 2; pass++) {
+      fseek(fp, nodes_start, SEEK_SET);
+      for (unsigned i = 0; i < bg->count; i++) {
+         int forced_reg;
+         float cost;
+         if (!expect(fp, "node") ||
+             fscanf(fp, "%u %u %d %f %u", &n, &c, &forced_reg, &cost,
+                    &num) != 5)
+            goto fail;
+
+         if (pass == 0) {
+            ra_set_node_class(bg->g, n, c);
+            if (forced_reg >= 0)
+               ra_set_node_reg(bg->g, n, forced_reg);
+            ra_set_node_spill_cost(bg->g, n, cost);
+         }
+
+         for (unsigned j = 0; j < num; j++) {
+            unsigned n2;
+            if (fscanf(fp, "%u", &n2) != 1)
+               goto fail;
+            if (pass == 1)
+               ra_add_node_interference(bg->g, n, n2);
+         }
+      }
+   }
+
+   fclose(fp);
+   return true;
+
+fail:
+   fprintf(stderr, "Failed to parse %s\n", filename);
+   fclose(fp);
+   return false;
+}
+
+/* Builds a register set looking like i965's SIMD8 one: 128 registers and
+ * classes for 1 to 4 contiguous registers.
+ */
+static struct ra_regs *
+make_synthetic_regs(void *mem_ctx, unsigned *classes)
+{
+   const unsigned base_regs = 128, max_size = 4;
+   unsigned reg_count = 0;
+
+   for (unsigned size = 1; size <= max_size; size++)
+      reg_count += base_regs - size + 1;
+
+   struct ra_regs *regs = ra_alloc_reg_set(mem_ctx, reg_count, true);
+
+   unsigned reg = 0;
+   for (unsigned size = 1; size <= max_size; size++) {
+      classes[size - 1] = ra_alloc_reg_class(regs);
+      for (unsigned base = 0; base + size <= base_regs; base++, reg++) {
+         ra_class_add_reg(regs, classes[size - 1], reg);
+         if (size > 1) {
+            for (unsigned i = 0; i < size; i++)
+               ra_add_transitive_reg_conflict(regs, base + i, reg);
+         }
+      }
+   }
+
+   ra_set_finalize(regs, NULL);
+
+   return regs;
+}
+
+/* Creates an interference graph from random live ranges in a straight-line
+ * program.
+ */
+static void
+make_synthetic_graph(struct bench_graph *bg, void *mem_ctx, unsigned count,
+                     unsigned avg_length, uint64_t seed)
+{
+   unsigned classes[4];
+   uint64_t state[2] = { seed, seed ^ 0x9e3779b97f4a7c15ull };
+
+   bg->regs = make_synthetic_regs(mem_ctx, classes);
+   bg->count = count;
+   bg->g = ra_alloc_interference_graph(bg->regs, count);
+   ralloc_steal(mem_ctx, bg->g);
+
+   unsigned *start = ralloc_array(mem_ctx, unsigned, count);
+   unsigned *end = ralloc_array(mem_ctx, unsigned, count);
+
+   for (unsigned n = 0; n < count; n++) {
+      uint64_t r = rand_xorshift128plus(state);
+      unsigned size = (r & 0xff) < 192 ? 1 : 1 + ((r >> 8) & 3);
+
+      start[n] = (r >> 16) % count;
+      end[n] = start[n] + 1 + (r >> 40) % (2 * avg_length);
+
+      ra_set_node_class(bg->g, n, classes[size - 1]);
+      ra_set_node_spill_cost(bg->g, n, 1.0f + (r >> 32) % 16);
+   }
+
+   for (unsigned n = 0; n < count; n++) {
+      for (unsigned n2 = n + 1; n2 < count; n2++) {
+         if (start[n] < end[n2] && start[n2] < end[n])
+            ra_add_node_interference(bg->g, n, n2);
+      }
+   }
+}
+
+static void
+bench_graph(const char *name, void *mem_ctx, const char *filename,
+            unsigned count, unsigned avg_length, uint64_t seed)
+{
+   struct bench_graph bg;
+
+   printf("%s:\n", name);
+
+   /* Plain allocation throughput */
+   if (filename) {
+      if (!load_graph(&bg, mem_ctx, filename))
+         return;
+   } else {
+      make_synthetic_graph(&bg, mem_ctx, count, avg_length, seed);
+   }
+
+   int64_t start_time = os_time_get_nano();
+   bool ok = true;
+   for (unsigned i = 0; i < ITERATIONS; i++)
+      ok = ra_allocate(bg.g);
+   int64_t alloc_time = (os_time_get_nano() - start_time) / ITERATIONS;
+
+   printf("   %u nodes, ra_allocate: %" PRId64 " us, %s\n", bg.count,
+          alloc_time / 1000, ok ? "colored" : "needs spilling");
+
+   if (ok)
+      return;
+
+   /* Spilling, one node per attempt and then i965's policy */
+   for (unsigned batched = 0; batched < 2; batched++) {
+      if (filename)
+         load_graph(&bg, mem_ctx, filename);
+      else
+         make_synthetic_graph(&bg, mem_ctx, count, avg_length, seed);
+
+      unsigned attempts = 1, spilled = 0;
+      start_time = os_time_get_nano();
+      while (!ra_allocate(bg.g)) {
+         unsigned nodes[MAX_SPILLS_PER_ATTEMPT];
+         unsigned max_nodes = 1;
+         if (batched) {
+            max_nodes = 1 + spilled / 8;
+            if (max_nodes > MAX_SPILLS_PER_ATTEMPT)
+               max_nodes = MAX_SPILLS_PER_ATTEMPT;
+         }
+
+         unsigned num = ra_get_best_spill_nodes(bg.g, nodes, max_nodes);
+         if (num == 0)
+            break;
+
+         for (unsigned i = 0; i < num; i++) {
+            ra_set_node_spill_cost(bg.g, nodes[i], 0.0f);
+            ra_reset_node_interference(bg.g, nodes[i]);
+         }
+
+         spilled += num;
+         attempts++;
+      }
+      int64_t spill_time = os_time_get_nano() - start_time;
+
+      printf("   %s: %u attempts, %u spilled, %" PRId64 " us\n",
+             batched ? "batched spilling" : "single spilling",
+             attempts, spilled, spill_time / 1000);
+   }
+}
+
+int
+main(int argc, char **argv)
+{
+   void *mem_ctx = ralloc_context(NULL);
+
+   if (argc > 1) {
+      for (int i = 1; i < argc; i++)
+         bench_graph(argv[i], mem_ctx, argv[i], 0, 0, 0);
+   } else {
+      bench_graph("synthetic, no spilling", mem_ctx, NULL, 2000, 30, 1);
+      bench_graph("synthetic, light spilling", mem_ctx, NULL, 2000, 60, 2);
+      bench_graph("synthetic, heavy spilling", mem_ctx, NULL, 2000, 100, 3);
+   }
+
+   ralloc_free(mem_ctx);
+
+   return 0;
+}
@@ -0,0 +1,183 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Throughput and fragmentation benchmark for util_vma_heap.
+ *
+ * The trace first allocates a working set of buffers and then replaces a
+ * random live buffer with a new one for every step, roughly modelling an
+ * application that keeps tens of thousands of buffers alive.  Sizes are
+ * mostly small with an occasional large, 2MiB-aligned buffer, similar to
+ * what the Intel drivers ask for.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "vma.h"
+
+namespace {
+
+static const uint64_t PAGE_SIZE = 4096;
+static const uint64_t HEAP_START = PAGE_SIZE;
+static const uint64_t HEAP_SIZE = (1ull << 47) - HEAP_START;
+
+struct allocation {
+   uint64_t addr;
+   uint64_t size;
+};
+
+struct bench {
+   bench(unsigned long seed) : rand{(uint_fast32_t)seed}
+   {
+      util_vma_heap_init(&heap, HEAP_START, HEAP_SIZE);
+   }
+
+   ~bench()
+   {
+      util_vma_heap_finish(&heap);
+   }
+
+   void alloc()
+   {
+      std::uniform_int_distribution<> percent(0, 99);
+      std::geometric_distribution<> pages(0.25);
+
+      uint64_t size, align;
+      int kind = percent(rand);
+      if (kind < 2) {
+         size = (uint64_t)(1 + pages(rand)) << 21;
+         align = 1ull << 21;
+      } else if (kind < 12) {
+         size = (uint64_t)(1 + pages(rand)) * 16 * PAGE_SIZE;
+         align = 16 * PAGE_SIZE;
+      } else {
+         size = (uint64_t)(1 + pages(rand)) * PAGE_SIZE;
+         align = PAGE_SIZE;
+      }
+
+      uint64_t addr = util_vma_heap_alloc(&heap, size, align);
+      if (addr == 0) {
+         fprintf(stderr, "allocation of %llu bytes failed\n",
+                 (unsigned long long)size);
+         exit(1);
+      }
+      live.push_back(allocation{addr, size});
+   }
+
+   void free_random()
+   {
+      std::uniform_int_distribution<size_t> dist(0, live.size() - 1);
+      std::swap(live.at(dist(rand)), live.back());
+      util_vma_heap_free(&heap, live.back().addr, live.back().size);
+      live.pop_back();
+   }
+
+   void report_fragmentation() const
+   {
+      std::vector<allocation> sorted = live;
+      std::sort(sorted.begin(), sorted.end(),
+                [](const allocation &a, const allocation &b) {
+                   return a.addr < b.addr;
+                });
+
+      uint64_t used = 0, gaps = 0, largest_gap = 0;
+      for (size_t i = 0; i < sorted.size(); i++) {
+         used += sorted[i].size;
+         if (i > 0) {
+            uint64_t prev_end = sorted[i - 1].addr + sorted[i - 1].size;
+            if (sorted[i].addr != prev_end) {
+               gaps++;
+               largest_gap = std::max(largest_gap, sorted[i].addr - prev_end);
+            }
+         }
+      }
+
+      uint64_t span = sorted.back().addr + sorted.back().size -
+                      sorted.front().addr;
+      printf("live buffers:    %zu\n", sorted.size());
+      printf("live bytes:      %llu\n", (unsigned long long)used);
+      printf("address span:    %llu\n", (unsigned long long)span);
+      printf("span utilization: %.2f%%\n", 100.0 * used / span);
+      printf("holes in span:   %llu (largest %llu bytes)\n",
+             (unsigned long long)gaps, (unsigned long long)largest_gap);
+   }
+
+   struct util_vma_heap heap;
+   std::default_random_engine rand;
+   std::vector<allocation> live;
+};
+
+double
+seconds_since(std::chrono::steady_clock::time_point start)
+{
+   return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                        start).count();
+}
+
+}
+
+int main(int argc, char **argv)
+{
+   unsigned long seed = 8675309, working_set = 32768, steps = 1000000;
+   if (argc == 4) {
+      seed = strtoul(argv[1], NULL, 0);
+      working_set = strtoul(argv[2], NULL, 0);
+      steps = strtoul(argv[3], NULL, 0);
+   } else if (argc != 1) {
+      fprintf(stderr, "USAGE: %s [seed working_set steps]\n", argv[0]);
+      return 1;
+   }
+
+   if (working_set == 0) {
+      fprintf(stderr, "working_set must be non-zero\n");
+      return 1;
+   }
+
+   bench b{seed};
+
+   auto start = std::chrono::steady_clock::now();
+   for (unsigned long i = 0; i < working_set; i++)
+      b.alloc();
+   double fill_time = seconds_since(start);
+
+   start = std::chrono::steady_clock::now();
+   for (unsigned long i = 0; i < steps; i++) {
+      b.free_random();
+      b.alloc();
+   }
+   double steady_time = seconds_since(start);
+
+   printf("fill:            %.1f ns/alloc\n", fill_time * 1e9 / working_set);
+   if (steps > 0)
+      printf("steady state:    %.1f ns/(free+alloc)\n",
+             steady_time * 1e9 / steps);
+   b.report_fragmentation();
+
+   return 0;
+}
@@ -49,6 +49,7 @@
 #define p_atomic_inc_return(v) __atomic_add_fetch((v), 1, __ATOMIC_ACQ_REL)
 #define p_atomic_dec_return(v) __atomic_sub_fetch((v), 1, __ATOMIC_ACQ_REL)
 #define p_atomic_xchg(v, i) __atomic_exchange_n((v), (i), __ATOMIC_ACQ_REL)
+#define p_atomic_fence_acquire() __atomic_thread_fence(__ATOMIC_ACQUIRE)
 #define PIPE_NATIVE_ATOMIC_XCHG
 
 #else
@@ -61,6 +62,7 @@
 #define p_atomic_add(v, i) (void) __sync_add_and_fetch((v), (i))
 #define p_atomic_inc_return(v) __sync_add_and_fetch((v), 1)
 #define p_atomic_dec_return(v) __sync_sub_and_fetch((v), 1)
+#define p_atomic_fence_acquire() __sync_synchronize()
 
 #endif
 
@@ -91,6 +93,7 @@
 #define p_atomic_inc_return(_v) (++(*(_v)))
 #define p_atomic_dec_return(_v) (--(*(_v)))
 #define p_atomic_cmpxchg(_v, _old, _new) (*(_v) == (_old) ? (*(_v) = (_new), (_old)) : *(_v))
+#define p_atomic_fence_acquire() ((void) 0)
 
 #endif
 
@@ -120,6 +123,7 @@
 
 #define p_atomic_set(_v, _i) (*(_v) = (_i))
 #define p_atomic_read(_v) (*(_v))
+#define p_atomic_fence_acquire() MemoryBarrier()
 
 #define p_atomic_dec_zero(_v) \
    (p_atomic_dec_return(_v) == 0)
@@ -167,6 +171,7 @@
 
 #define p_atomic_set(_v, _i) (*(_v) = (_i))
 #define p_atomic_read(_v) (*(_v))
+#define p_atomic_fence_acquire() membar_consumer()
 
 #define p_atomic_dec_zero(v) (\
    sizeof(*v) == sizeof(uint8_t)  ? atomic_dec_8_nv ((uint8_t  *)(v)) == 0 : \
@@ -265,6 +265,10 @@ struct util_queue_monitoring
    unsigned num_offloaded_items;
    unsigned num_direct_items;
    unsigned num_syncs;
+   unsigned num_batches;
+
+   /* Time the user of the queue spent waiting for it, in microseconds. */
+   unsigned sync_wait_time_us;
 };
 
 #ifdef __cplusplus
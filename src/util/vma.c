@@ -23,34 +23,85 @@
 
 #include <stdlib.h>
 
+#include "util/macros.h"
 #include "util/u_math.h"
 #include "util/vma.h"
 
 struct util_vma_hole {
-   struct list_head link;
+   struct rb_node node;
    uint64_t offset;
    uint64_t size;
+
+   /** Size of the largest hole in the subtree rooted at this hole */
+   uint64_t max_size;
 };
 
+static inline struct util_vma_hole *
+util_vma_hole_from_node(struct rb_node *node)
+{
+   return node ? rb_node_data(struct util_vma_hole, node, node) : NULL;
+}
+
 #define util_vma_foreach_hole(_hole, _heap) \
-   list_for_each_entry(struct util_vma_hole, _hole, &(_heap)->holes, link)
+   rb_tree_foreach_rev(struct util_vma_hole, _hole, &(_heap)->holes, node)
 
-#define util_vma_foreach_hole_safe(_hole, _heap) \
-   list_for_each_entry_safe(struct util_vma_hole, _hole, &(_heap)->holes, link)
+static void
+util_vma_hole_augment(struct rb_node *node)
+{
+   struct util_vma_hole *hole = util_vma_hole_from_node(node);
+
+   uint64_t max_size = hole->size;
+   if (node->left)
+      max_size = MAX2(max_size, util_vma_hole_from_node(node->left)->max_size);
+   if (node->right)
+      max_size = MAX2(max_size, util_vma_hole_from_node(node->right)->max_size);
+
+   hole->max_size = max_size;
+}
+
+static int
+util_vma_hole_cmp(const struct rb_node *a, const struct rb_node *b)
+{
+   const struct util_vma_hole *ha =
+      rb_node_data(struct util_vma_hole, a, node);
+   const struct util_vma_hole *hb =
+      rb_node_data(struct util_vma_hole, b, node);
+
+   if (ha->offset < hb->offset)
+      return -1;
+   else if (ha->offset > hb->offset)
+      return 1;
+   else
+      return 0;
+}
 
 void
 util_vma_heap_init(struct util_vma_heap *heap,
                    uint64_t start, uint64_t size)
 {
-   list_inithead(&heap->holes);
+   rb_tree_init_augmented(&heap->holes, util_vma_hole_augment);
    util_vma_heap_free(heap, start, size);
 }
 
+static void
+util_vma_hole_free_subtree(struct rb_node *node)
+{
+   if (node == NULL)
+      return;
+
+   /* Walking the tree in order while freeing it does not work as the walk
+    * goes back up through parents which may have been freed already.
+    */
+   util_vma_hole_free_subtree(node->left);
+   util_vma_hole_free_subtree(node->right);
+   free(util_vma_hole_from_node(node));
+}
+
 void
 util_vma_heap_finish(struct util_vma_heap *heap)
 {
-   util_vma_foreach_hole_safe(hole, heap)
-      free(hole);
+   util_vma_hole_free_subtree(heap->holes.root);
+   heap->holes.root = NULL;
 }
 
 #ifndef NDEBUG
@@ -62,7 +113,7 @@ util_vma_heap_validate(struct util_vma_heap *heap)
       assert(hole->offset > 0);
       assert(hole->size > 0);
 
-      if (&hole->link == heap->holes.next) {
+      if (&hole->node == rb_tree_last(&heap->holes)) {
          /* This must be the top-most hole.  Assert that, if it overflows, it
           * overflows to 0, i.e. 2^64.
           */
@@ -78,12 +129,81 @@ util_vma_heap_validate(struct util_vma_heap *heap)
                 hole->size + hole->offset < prev_offset);
       }
       prev_offset = hole->offset;
+
+      /* Every hole's max_size must be up-to-date with its subtree. */
+      uint64_t max_size = hole->max_size;
+      util_vma_hole_augment(&hole->node);
+      assert(hole->max_size == max_size);
    }
 }
 #else
 #define util_vma_heap_validate(heap)
 #endif
 
+/**
+ * Returns the highest address within the hole where a chunk of the given
+ * size and alignment fits, or 0 if it does not fit.
+ */
+static uint64_t
+util_vma_hole_alloc_offset(const struct util_vma_hole *hole,
+                           uint64_t size, uint64_t alignment)
+{
+   if (size > hole->size)
+      return 0;
+
+   /* Compute the offset as the highest address where a chunk of the given
+    * size can be without going over the top of the hole.
+    *
+    * This calculation is known to not overflow because we know that
+    * hole->size + hole->offset can only overflow to 0 and size > 0.
+    */
+   uint64_t offset = (hole->size - size) + hole->offset;
+
+   /* Align the offset.  We align down and not up because we are allocating
+    * from the top of the hole and not the bottom.
+    */
+   offset = (offset / alignment) * alignment;
+
+   if (offset < hole->offset)
+      return 0;
+
+   return offset;
+}
+
+/**
+ * Finds the top-most hole in the subtree rooted at @node that can fit a
+ * chunk of the given size and alignment.
+ *
+ * Subtrees whose largest hole is too small are skipped entirely, so this
+ * only visits holes which are big enough but cannot fit the chunk because of
+ * its alignment.
+ */
+static struct util_vma_hole *
+util_vma_heap_find_hole(struct rb_node *node, uint64_t size,
+                        uint64_t alignment, uint64_t *offset_out)
+{
+   while (node) {
+      struct util_vma_hole *hole = util_vma_hole_from_node(node);
+      if (hole->max_size < size)
+         return NULL;
+
+      struct util_vma_hole *found =
+         util_vma_heap_find_hole(node->right, size, alignment, offset_out);
+      if (found)
+         return found;
+
+      uint64_t offset = util_vma_hole_alloc_offset(hole, size, alignment);
+      if (offset) {
+         *offset_out = offset;
+         return hole;
+      }
+
+      node = node->left;
+   }
+
+   return NULL;
+}
+
 uint64_t
 util_vma_heap_alloc(struct util_vma_heap *heap,
                     uint64_t size, uint64_t alignment)
@@ -94,75 +214,59 @@ util_vma_heap_alloc(struct util_vma_heap *heap,
 
    util_vma_heap_validate(heap);
 
-   util_vma_foreach_hole_safe(hole, heap) {
-      if (size > hole->size)
-         continue;
-
-      /* Compute the offset as the highest address where a chunk of the given
-       * size can be without going over the top of the hole.
-       *
-       * This calculation is known to not overflow because we know that
-       * hole->size + hole->offset can only overflow to 0 and size > 0.
-       */
-      uint64_t offset = (hole->size - size) + hole->offset;
-
-      /* Align the offset.  We align down and not up because we are allocating
-       * from the top of the hole and not the bottom.
-       */
-      offset = (offset / alignment) * alignment;
-
-      if (offset < hole->offset)
-         continue;
-
-      if (offset == hole->offset && size == hole->size) {
-         /* Just get rid of the hole. */
-         list_del(&hole->link);
-         free(hole);
-         util_vma_heap_validate(heap);
-         return offset;
-      }
+   uint64_t offset;
+   struct util_vma_hole *hole =
+      util_vma_heap_find_hole(heap->holes.root, size, alignment, &offset);
+   if (hole == NULL) {
+      /* Failed to allocate */
+      return 0;
+   }
 
-      assert(offset - hole->offset <= hole->size - size);
-      uint64_t waste = (hole->size - size) - (offset - hole->offset);
-      if (waste == 0) {
-         /* We allocated at the top.  Shrink the hole down. */
-         hole->size -= size;
-         util_vma_heap_validate(heap);
-         return offset;
-      }
+   if (offset == hole->offset && size == hole->size) {
+      /* Just get rid of the hole. */
+      rb_tree_remove(&heap->holes, &hole->node);
+      free(hole);
+      util_vma_heap_validate(heap);
+      return offset;
+   }
 
-      if (offset == hole->offset) {
-         /* We allocated at the bottom. Shrink the hole up. */
-         hole->offset += size;
-         hole->size -= size;
-         util_vma_heap_validate(heap);
-         return offset;
-      }
+   assert(offset - hole->offset <= hole->size - size);
+   uint64_t waste = (hole->size - size) - (offset - hole->offset);
+   if (waste == 0) {
+      /* We allocated at the top.  Shrink the hole down. */
+      hole->size -= size;
+      rb_tree_augment_path(&heap->holes, &hole->node);
+      util_vma_heap_validate(heap);
+      return offset;
+   }
 
-      /* We allocated in the middle.  We need to split the old hole into two
-       * holes, one high and one low.
-       */
-      struct util_vma_hole *high_hole = calloc(1, sizeof(*hole));
-      high_hole->offset = offset + size;
-      high_hole->size = waste;
+   if (offset == hole->offset) {
+      /* We allocated at the bottom. Shrink the hole up. */
+      hole->offset += size;
+      hole->size -= size;
+      rb_tree_augment_path(&heap->holes, &hole->node);
+      util_vma_heap_validate(heap);
+      return offset;
+   }
 
-      /* Adjust the hole to be the amount of space left at he bottom of the
-       * original hole.
-       */
-      hole->size = offset - hole->offset;
+   /* We allocated in the middle.  We need to split the old hole into two
+    * holes, one high and one low.
+    */
+   struct util_vma_hole *high_hole = calloc(1, sizeof(*hole));
+   high_hole->offset = offset + size;
+   high_hole->size = waste;
 
-      /* Place the new hole before the old hole so that the list is in order
-       * from high to low.
-       */
-      list_addtail(&high_hole->link, &hole->link);
+   /* Adjust the hole to be the amount of space left at he bottom of the
+    * original hole.
+    */
+   hole->size = offset - hole->offset;
+   rb_tree_augment_path(&heap->holes, &hole->node);
 
-      util_vma_heap_validate(heap);
+   rb_tree_insert(&heap->holes, &high_hole->node, util_vma_hole_cmp);
 
-      return offset;
-   }
+   util_vma_heap_validate(heap);
 
-   /* Failed to allocate */
-   return 0;
+   return offset;
 }
 
 void
@@ -186,12 +290,20 @@ util_vma_heap_free(struct util_vma_heap *heap,
 
    /* Find immediately higher and lower holes if they exist. */
    struct util_vma_hole *high_hole = NULL, *low_hole = NULL;
-   util_vma_foreach_hole(hole, heap) {
+   for (struct rb_node *node = heap->holes.root; node;) {
+      struct util_vma_hole *hole = util_vma_hole_from_node(node);
       if (hole->offset <= offset) {
          low_hole = hole;
-         break;
+         node = node->right;
+      } else {
+         node = node->left;
       }
-      high_hole = hole;
+   }
+
+   if (low_hole) {
+      high_hole = util_vma_hole_from_node(rb_node_next(&low_hole->node));
+   } else {
+      high_hole = util_vma_hole_from_node(rb_tree_first(&heap->holes));
    }
 
    if (high_hole)
@@ -207,15 +319,18 @@ util_vma_heap_free(struct util_vma_heap *heap,
    if (low_adjacent && high_adjacent) {
       /* Merge the two holes */
       low_hole->size += size + high_hole->size;
-      list_del(&high_hole->link);
+      rb_tree_remove(&heap->holes, &high_hole->node);
       free(high_hole);
+      rb_tree_augment_path(&heap->holes, &low_hole->node);
    } else if (low_adjacent) {
       /* Merge into the low hole */
       low_hole->size += size;
+      rb_tree_augment_path(&heap->holes, &low_hole->node);
    } else if (high_adjacent) {
       /* Merge into the high hole */
       high_hole->offset = offset;
       high_hole->size += size;
+      rb_tree_augment_path(&heap->holes, &high_hole->node);
    } else {
       /* Neither hole is adjacent; make a new one */
       struct util_vma_hole *hole = calloc(1, sizeof(*hole));
@@ -223,11 +338,7 @@ util_vma_heap_free(struct util_vma_heap *heap,
       hole->offset = offset;
       hole->size = size;
 
-      /* Add it after the high hole so we maintain high-to-low ordering */
-      if (high_hole)
-         list_add(&hole->link, &high_hole->link);
-      else
-         list_add(&hole->link, &heap->holes);
+      rb_tree_insert(&heap->holes, &hole->node, util_vma_hole_cmp);
    }
 
    util_vma_heap_validate(heap);
@@ -26,14 +26,15 @@
 
 #include <stdint.h>
 
-#include "list.h"
+#include "rb_tree.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 struct util_vma_heap {
-   struct list_head holes;
+   /** Holes sorted by offset, each tracking the largest hole below it */
+   struct rb_tree holes;
 };
 
 void util_vma_heap_init(struct util_vma_heap *heap,
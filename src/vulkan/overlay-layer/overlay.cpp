@@ -38,6 +38,7 @@
 #include "util/ralloc.h"
 #include "util/os_time.h"
 #include "util/simple_mtx.h"
+#include "util/u_atomic.h"
 
 #include "vk_enum_to_str.h"
 #include "vk_util.h"
@@ -207,7 +208,8 @@ thread_local ImGuiContext* __MesaImGui;
 static inline void ensure_vk_object_map(void)
 {
    if (!vk_object_to_data)
-      vk_object_to_data = _mesa_hash_table_u64_create(NULL);
+      p_atomic_set(&vk_object_to_data,
+                   _mesa_hash_table_u64_create_read_mostly(NULL));
 }
 
 #define HKEY(obj) ((uint64_t)(obj))
@@ -217,13 +219,15 @@ static inline void ensure_vk_object_map(void)
 #define FIND_QUEUE_DATA(obj) ((struct queue_data *)find_object_data(HKEY(obj)))
 #define FIND_PHYSICAL_DEVICE_DATA(obj) ((struct instance_data *)find_object_data(HKEY(obj)))
 #define FIND_INSTANCE_DATA(obj) ((struct instance_data *)find_object_data(HKEY(obj)))
+/* Lookups happen on every API call, so they don't take the mutex that
+ * serializes the (much rarer) updates of the map.
+ */
 static void *find_object_data(uint64_t obj)
 {
-   simple_mtx_lock(&vk_object_to_data_mutex);
-   ensure_vk_object_map();
-   void *data = _mesa_hash_table_u64_search(vk_object_to_data, obj);
-   simple_mtx_unlock(&vk_object_to_data_mutex);
-   return data;
+   struct hash_table_u64 *map = p_atomic_read(&vk_object_to_data);
+   if (!map)
+      return NULL;
+   return _mesa_hash_table_u64_search_lockless(map, obj);
 }
 
 static void map_object(uint64_t obj, void *data)